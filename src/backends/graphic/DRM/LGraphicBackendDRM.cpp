@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <cassert>
+#include <mutex>
 
 #include <fcntl.h>
 #include <xf86drm.h>
@@ -122,6 +123,9 @@ struct Output
     std::vector<LTexture*> textures;
     LWeak<DRMLease> lease;
     std::string description;
+
+    // Serializes cursor updates from the main and input threads, see outputHasThreadSafeCursorPosition()
+    std::mutex cursorMutex;
 };
 
 // SRM -> Louvre Subpixel table
@@ -947,15 +951,24 @@ bool LGraphicBackend::outputHasHardwareCursorSupport(LOutput *output)
 void LGraphicBackend::outputSetCursorTexture(LOutput *output, UChar8 *buffer)
 {
     Output *bkndOutput = (Output*)output->imp()->graphicBackendData;
+    std::lock_guard<std::mutex> lock { bkndOutput->cursorMutex };
     srmConnectorSetCursor(bkndOutput->conn, buffer);
 }
 
 void LGraphicBackend::outputSetCursorPosition(LOutput *output, const LPoint &position)
 {
     Output *bkndOutput = (Output*)output->imp()->graphicBackendData;
+    std::lock_guard<std::mutex> lock { bkndOutput->cursorMutex };
     srmConnectorSetCursorPos(bkndOutput->conn, position.x(), position.y());
 }
 
+bool LGraphicBackend::outputHasThreadSafeCursorPosition(LOutput */*output*/)
+{
+    /* SRM already applies cursor updates made by the main thread while the connector render thread is running,
+     * cursorMutex additionally keeps the main and input threads from updating the same connector at once */
+    return true;
+}
+
 /* OUTPUT MODES */
 
 const LOutputMode *LGraphicBackend::outputGetPreferredMode(LOutput *output)
@@ -1181,6 +1194,7 @@ extern "C" LGraphicBackendInterface *getAPI()
     API.outputHasHardwareCursorSupport  = &LGraphicBackend::outputHasHardwareCursorSupport;
     API.outputSetCursorTexture          = &LGraphicBackend::outputSetCursorTexture;
     API.outputSetCursorPosition         = &LGraphicBackend::outputSetCursorPosition;
+    API.outputHasThreadSafeCursorPosition = &LGraphicBackend::outputHasThreadSafeCursorPosition;
 
     /* OUTPUT MODES */
     API.outputGetPreferredMode          = &LGraphicBackend::outputGetPreferredMode;
@@ -0,0 +1,1229 @@
+#include <private/LCompositorPrivate.h>
+#include <private/LOutputPrivate.h>
+#include <private/LFactory.h>
+
+#include <LOutputMode.h>
+#include <SRMFormat.h>
+#include <LOpenGL.h>
+#include <LSeat.h>
+#include <LGPU.h>
+#include <LLog.h>
+
+#include <condition_variable>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <time.h>
+
+using namespace Louvre;
+
+#define BKND_NAME "HEADLESS BACKEND"
+
+// Each output renders into its own set of offscreen buffers
+#define BKND_BUFFERS 2
+
+struct Texture
+{
+    GLuint id;
+    GLenum target;
+};
+
+struct CPUTexture
+{
+    Texture texture;
+    UInt32 pixelSize;
+    const SRMGLFormat *glFmt;
+    bool destroy;
+};
+
+struct DRMTexture
+{
+    Texture texture;
+    EGLImage image;
+};
+
+struct ModeSpec
+{
+    LSize size;
+    UInt32 refreshRate;
+};
+
+struct HeadlessOutput
+{
+    LOutput *output { nullptr };
+    UInt32 id;
+    std::string name;
+    std::string description;
+    LSize physicalSize;
+    std::vector<LOutputMode*> modes;
+    LOutputMode *currentMode { nullptr };
+    LOutputMode *pendingMode { nullptr };
+    bool changingMode { false };
+
+    // Render thread
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    EGLContext context { EGL_NO_CONTEXT };
+    bool initialized { false };
+    bool repaint { false };
+    bool exit { false };
+
+    // Offscreen buffers
+    CPUTexture buffers[BKND_BUFFERS];
+    GLuint framebuffers[BKND_BUFFERS] { 0 };
+    std::vector<LTexture*> textures;
+    UInt32 currentBuffer { 0 };
+
+    // Simulated vblank clock
+    Int64 vblankBase { 0 };
+    Int64 lastPresentation { 0 };
+    UInt64 frame { 0 };
+
+    bool vSync { true };
+    Int32 refreshRateLimit { 0 };
+    LContentType contentType { LContentTypeNone };
+};
+
+static const EGLint eglContextAttribs[]
+{
+    EGL_CONTEXT_CLIENT_VERSION, 2,
+    EGL_NONE
+};
+
+static const EGLint eglConfigAttribs[]
+{
+    EGL_SURFACE_TYPE, 0,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 0,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+    EGL_NONE
+};
+
+class Louvre::LGraphicBackend
+{
+public:
+    inline static EGLDisplay eglDisplay { EGL_NO_DISPLAY };
+    inline static EGLContext eglContext { EGL_NO_CONTEXT };
+    inline static EGLConfig eglConfig { EGL_NO_CONFIG_KHR };
+    inline static std::vector<LGPU*> devices;
+    inline static LGPU allocator;
+    inline static std::vector<LOutput*> connectedOutputs;
+    inline static bool virtualClock { false };
+
+    static UInt32 backendGetId()
+    {
+        return LGraphicBackendHeadless;
+    }
+
+    static void *backendGetContextHandle()
+    {
+        return nullptr;
+    }
+
+    static HeadlessOutput &bkndOutput(LOutput *output)
+    {
+        return *static_cast<HeadlessOutput*>(output->imp()->graphicBackendData);
+    }
+
+    static Int64 nowNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return Int64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static bool parseMode(const std::string &str, ModeSpec &mode)
+    {
+        Int32 w, h;
+        Float64 hz { 60.0 };
+        const Int32 n { sscanf(str.c_str(), "%dx%d@%lf", &w, &h, &hz) };
+
+        if (n < 2 || w <= 0 || h <= 0 || hz <= 0.0)
+            return false;
+
+        mode.size = LSize(w, h);
+        mode.refreshRate = UInt32(hz * 1000.0 + 0.5);
+        return true;
+    }
+
+    /* LOUVRE_HEADLESS_MODES format: modes of each output separated by ';', and modes
+     * of the same output by ',' (the first one is the preferred), e.g. "1920x1080@60,1280x720@60;2560x1440@144" */
+    static std::vector<std::vector<ModeSpec>> parseModes(const char *env)
+    {
+        std::vector<std::vector<ModeSpec>> outputs;
+        const std::string str { env ? env : "" };
+        size_t outputBegin { 0 };
+
+        while (outputBegin <= str.size())
+        {
+            size_t outputEnd { str.find(';', outputBegin) };
+
+            if (outputEnd == std::string::npos)
+                outputEnd = str.size();
+
+            const std::string outputStr { str.substr(outputBegin, outputEnd - outputBegin) };
+            std::vector<ModeSpec> modes;
+            size_t modeBegin { 0 };
+
+            while (modeBegin <= outputStr.size())
+            {
+                size_t modeEnd { outputStr.find(',', modeBegin) };
+
+                if (modeEnd == std::string::npos)
+                    modeEnd = outputStr.size();
+
+                ModeSpec mode;
+
+                if (parseMode(outputStr.substr(modeBegin, modeEnd - modeBegin), mode))
+                    modes.push_back(mode);
+
+                modeBegin = modeEnd + 1;
+            }
+
+            if (!modes.empty())
+                outputs.push_back(std::move(modes));
+
+            outputBegin = outputEnd + 1;
+        }
+
+        if (outputs.empty())
+            outputs.push_back({{ LSize(1280, 720), 60000 }});
+
+        return outputs;
+    }
+
+    static bool initEGL()
+    {
+        EGLint major, minor, n;
+        const char *clientExts { eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS) };
+        const char *displayExts;
+
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+        if (clientExts && LOpenGL::hasExtension(clientExts, "EGL_MESA_platform_surfaceless"))
+            eglDisplay = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#else
+        L_UNUSED(clientExts);
+#endif
+
+        if (eglDisplay == EGL_NO_DISPLAY)
+            eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        if (eglDisplay == EGL_NO_DISPLAY)
+        {
+            LLog::fatal("[%s] Failed to get EGL display.", BKND_NAME);
+            return false;
+        }
+
+        if (!eglInitialize(eglDisplay, &major, &minor))
+        {
+            LLog::fatal("[%s] Failed to initialize EGL display.", BKND_NAME);
+            goto errDisplay;
+        }
+
+        displayExts = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+
+        // Louvre makes the allocator context current without surfaces
+        if (!displayExts || !LOpenGL::hasExtension(displayExts, "EGL_KHR_surfaceless_context"))
+        {
+            LLog::fatal("[%s] EGL_KHR_surfaceless_context not supported.", BKND_NAME);
+            goto errTerminate;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_ES_API))
+        {
+            LLog::fatal("[%s] Failed to bind OpenGL ES API.", BKND_NAME);
+            goto errTerminate;
+        }
+
+        if (!eglChooseConfig(eglDisplay, eglConfigAttribs, &eglConfig, 1, &n) || n != 1)
+        {
+            LLog::fatal("[%s] Failed to get EGL config.", BKND_NAME);
+            goto errTerminate;
+        }
+
+        eglContext = eglCreateContext(eglDisplay, eglConfig, EGL_NO_CONTEXT, eglContextAttribs);
+
+        if (eglContext == EGL_NO_CONTEXT)
+        {
+            LLog::fatal("[%s] Failed to get EGL context.", BKND_NAME);
+            goto errTerminate;
+        }
+
+        return true;
+
+    errTerminate:
+        eglTerminate(eglDisplay);
+    errDisplay:
+        eglDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    static void unitEGL()
+    {
+        if (eglContext != EGL_NO_CONTEXT)
+        {
+            eglDestroyContext(eglDisplay, eglContext);
+            eglContext = EGL_NO_CONTEXT;
+        }
+
+        if (eglDisplay != EGL_NO_DISPLAY)
+        {
+            eglTerminate(eglDisplay);
+            eglDisplay = EGL_NO_DISPLAY;
+        }
+    }
+
+    static void initOutputs()
+    {
+        const char *env { getenv("LOUVRE_HEADLESS_OUTPUTS") };
+        const Int32 count { env ? atoi(env) : 1 };
+        const auto specs { parseModes(getenv("LOUVRE_HEADLESS_MODES")) };
+
+        for (Int32 i = 0; i < count; i++)
+        {
+            HeadlessOutput *bo { new HeadlessOutput() };
+            bo->id = i + 1;
+            bo->name = "HEADLESS-" + std::to_string(bo->id);
+
+            // Outputs without an explicit entry use the last one
+            const auto &modes { specs[std::min(size_t(i), specs.size() - 1)] };
+
+            LOutput::Params params
+            {
+                .callback = [bo, &modes](LOutput *output)
+                {
+                    for (size_t m = 0; m < modes.size(); m++)
+                        bo->modes.push_back(new LOutputMode(output, modes[m].size, modes[m].refreshRate, m == 0, nullptr));
+
+                    bo->output = output;
+                    bo->currentMode = bo->pendingMode = bo->modes.front();
+                    output->imp()->updateRect();
+                },
+                .backendData = bo
+            };
+
+            // Assume 96 DPI
+            bo->physicalSize.setW((modes.front().size.w() * 254) / 960);
+            bo->physicalSize.setH((modes.front().size.h() * 254) / 960);
+            bo->description = "Louvre headless output " + std::to_string(bo->id);
+            connectedOutputs.push_back(LFactory::createObject<LOutput>(&params));
+        }
+    }
+
+    static void unitOutputs()
+    {
+        while (!connectedOutputs.empty())
+        {
+            LOutput *output { connectedOutputs.back() };
+            HeadlessOutput *bo { &bkndOutput(output) };
+            connectedOutputs.pop_back();
+
+            seat()->outputUnplugged(output);
+            Louvre::compositor()->onAnticipatedObjectDestruction(output);
+
+            while (!bo->modes.empty())
+            {
+                delete bo->modes.back();
+                bo->modes.pop_back();
+            }
+
+            delete output;
+            delete bo;
+        }
+    }
+
+    static bool backendInitialize()
+    {
+        const char *env { getenv("LOUVRE_HEADLESS_VIRTUAL_CLOCK") };
+        virtualClock = env && atoi(env) == 1;
+
+        if (!initEGL())
+            return false;
+
+        devices.push_back(&allocator);
+        initOutputs();
+        return true;
+    }
+
+    static void backendUninitialize()
+    {
+        unitOutputs();
+        unitEGL();
+        devices.clear();
+    }
+
+    static void backendSuspend()
+    {
+        /* No TTY switching so no required */
+    }
+
+    static void backendResume()
+    {
+        /* No TTY switching so no required */
+    }
+
+    static const std::vector<LOutput*>* backendGetConnectedOutputs()
+    {
+        return &connectedOutputs;
+    }
+
+    static const std::vector<LGPU*>* backendGetDevices()
+    {
+        return &devices;
+    }
+
+    static const std::vector<LDMAFormat>* backendGetDMAFormats()
+    {
+        static std::vector<LDMAFormat> dummyFormats;
+        return &dummyFormats;
+    }
+
+    static const std::vector<LDMAFormat> *backendGetScanoutDMAFormats()
+    {
+        static std::vector<LDMAFormat> dummyFormats;
+        return &dummyFormats;
+    }
+
+    static EGLDisplay backendGetAllocatorEGLDisplay()
+    {
+        return eglDisplay;
+    }
+
+    static EGLContext backendGetAllocatorEGLContext()
+    {
+        return eglContext;
+    }
+
+    static LGPU *backendGetAllocatorDevice()
+    {
+        return &allocator;
+    }
+
+    /* TEXTURES */
+
+    static bool textureCreateFromCPUBuffer(LTexture *texture, const LSize &size, UInt32 stride, UInt32 format, const void *pixels)
+    {
+        const SRMGLFormat *glFmt { srmFormatDRMToGL(format) };
+
+        if (!glFmt)
+            return false;
+
+        UInt32 depth, bpp, pixelSize;
+
+        if (!srmFormatGetDepthBpp(format, &depth, &bpp))
+            return false;
+
+        if (bpp % 8 != 0)
+            return false;
+
+        pixelSize = bpp/8;
+
+        GLuint textureId { 0 };
+        glGenTextures(1, &textureId);
+
+        if (!textureId)
+            return false;
+
+        glBindTexture(GL_TEXTURE_2D, textureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        if (pixels)
+            glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride / pixelSize);
+
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     glFmt->glInternalFormat,
+                     size.w(),
+                     size.h(),
+                     0,
+                     glFmt->glFormat,
+                     glFmt->glType,
+                     pixels);
+
+        if (pixels)
+            glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+
+        glFlush();
+
+        CPUTexture *cpuTexture { new CPUTexture() };
+        cpuTexture->texture.id = textureId;
+        cpuTexture->texture.target = GL_TEXTURE_2D;
+        cpuTexture->glFmt = glFmt;
+        cpuTexture->pixelSize = pixelSize;
+        cpuTexture->destroy = true;
+        texture->m_graphicBackendData = cpuTexture;
+        return true;
+    }
+
+    static bool textureCreateFromWaylandDRM(LTexture *texture, void *wlBuffer)
+    {
+        if (!Louvre::compositor()->imp()->eglQueryWaylandBufferWL)
+            return false;
+
+        EGLint format, width, height;
+        GLenum target { GL_TEXTURE_2D };
+        EGLImage image;
+        GLuint id;
+
+        if (Louvre::compositor()->imp()->eglQueryWaylandBufferWL(LCompositor::eglDisplay(), (wl_resource*)wlBuffer, EGL_TEXTURE_FORMAT, &format))
+        {
+            Louvre::compositor()->imp()->eglQueryWaylandBufferWL(LCompositor::eglDisplay(), (wl_resource*)wlBuffer, EGL_WIDTH, &width);
+            Louvre::compositor()->imp()->eglQueryWaylandBufferWL(LCompositor::eglDisplay(), (wl_resource*)wlBuffer, EGL_HEIGHT, &height);
+            texture->m_sizeB.setW(width);
+            texture->m_sizeB.setH(height);
+
+            if (format == EGL_TEXTURE_RGB)
+                texture->m_format = DRM_FORMAT_XRGB8888;
+            else if (format == EGL_TEXTURE_RGBA)
+                texture->m_format = DRM_FORMAT_ARGB8888;
+            else if (format == EGL_TEXTURE_EXTERNAL_WL)
+            {
+                texture->m_format = DRM_FORMAT_YUYV;
+                target = GL_TEXTURE_EXTERNAL_OES;
+            }
+            else
+                texture->m_format = DRM_FORMAT_YUYV;
+
+            const static EGLAttrib attribs[3] {
+                EGL_IMAGE_PRESERVED_KHR,
+                EGL_TRUE,
+                EGL_NONE
+            };
+
+            image = eglCreateImage(LCompositor::eglDisplay(), EGL_NO_CONTEXT, EGL_WAYLAND_BUFFER_WL, wlBuffer, attribs);
+
+            if (image == EGL_NO_IMAGE)
+                return false;
+
+            glGenTextures(1, &id);
+            glBindTexture(target, id);
+            glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            Louvre::compositor()->imp()->glEGLImageTargetTexture2DOES(target, image);
+
+            DRMTexture *drmTexture { new DRMTexture() };
+            drmTexture->texture.id = id;
+            drmTexture->texture.target = target;
+            drmTexture->image = image;
+            texture->m_graphicBackendData = drmTexture;
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool textureCreateFromDMA(LTexture */*texture*/, const LDMAPlanes */*planes*/)
+    {
+        /* There is no scanout device, clients can use SHM or wl_drm instead */
+        return false;
+    }
+
+    static bool textureCreateFromGL(LTexture *texture, GLuint id, GLenum target, UInt32 format, const LSize &/*size*/, bool transferOwnership)
+    {
+        const SRMGLFormat *glFmt { srmFormatDRMToGL(format) };
+
+        if (!glFmt)
+            return false;
+
+        UInt32 depth, bpp;
+
+        if (!srmFormatGetDepthBpp(format, &depth, &bpp))
+            return false;
+
+        if (bpp % 8 != 0)
+            return false;
+
+        CPUTexture *cpuTexture { new CPUTexture() };
+        cpuTexture->texture.id = id;
+        cpuTexture->texture.target = target;
+        cpuTexture->glFmt = glFmt;
+        cpuTexture->pixelSize = bpp/8;
+        cpuTexture->destroy = transferOwnership;
+        texture->m_graphicBackendData = cpuTexture;
+        return true;
+    }
+
+    static bool textureUpdateRect(LTexture *texture, UInt32 stride, const LRect &dst, const void *pixels)
+    {
+        if (texture->sourceType() != LTexture::CPU)
+            return false;
+
+        CPUTexture *cpuTexture = (CPUTexture*)texture->m_graphicBackendData;
+
+        if (!cpuTexture)
+            return false;
+
+        glBindTexture(GL_TEXTURE_2D, cpuTexture->texture.id);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / cpuTexture->pixelSize);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, dst.x(), dst.y(), dst.w(), dst.h(),
+                        cpuTexture->glFmt->glFormat, cpuTexture->glFmt->glType, pixels);
+
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glFlush();
+        return true;
+    }
+
+    static UInt32 textureGetID(LOutput */*output*/, LTexture *texture)
+    {
+        Texture *bkndTexture { static_cast<Texture*>(texture->m_graphicBackendData) };
+
+        if (bkndTexture)
+            return bkndTexture->id;
+
+        return 0;
+    }
+
+    static GLenum textureGetTarget(LTexture *texture)
+    {
+        Texture *bkndTexture = (Texture*)texture->m_graphicBackendData;
+
+        if (bkndTexture)
+            return bkndTexture->target;
+
+        return GL_TEXTURE_2D;
+    }
+
+    static void textureSetFence(LTexture */*texture*/)
+    {
+        glFlush();
+    }
+
+    static void textureDestroy(LTexture *texture)
+    {
+        switch (texture->sourceType())
+        {
+        case LTexture::CPU:
+        case LTexture::Framebuffer:
+        case LTexture::GL:
+            {
+                CPUTexture *cpuTexture = (CPUTexture*)texture->m_graphicBackendData;
+
+                if (cpuTexture)
+                {
+                    if (cpuTexture->destroy)
+                        glDeleteTextures(1, &cpuTexture->texture.id);
+                    delete cpuTexture;
+                }
+            }
+            break;
+        case LTexture::WL_DRM:
+            {
+                DRMTexture *drmTexture = (DRMTexture*)texture->m_graphicBackendData;
+
+                if (drmTexture)
+                {
+                    glDeleteTextures(1, &drmTexture->texture.id);
+                    eglDestroyImage(LCompositor::eglDisplay(), drmTexture->image);
+                    delete drmTexture;
+                }
+            }
+            break;
+        case LTexture::DMA:
+            break;
+        }
+    }
+
+    /* RENDER THREAD */
+
+    static bool createBuffers(HeadlessOutput &bo)
+    {
+        const LSize &size { bo.currentMode->sizeB() };
+
+        for (UInt32 i = 0; i < BKND_BUFFERS; i++)
+        {
+            CPUTexture &buffer { bo.buffers[i] };
+            buffer.glFmt = srmFormatDRMToGL(DRM_FORMAT_XBGR8888);
+            buffer.pixelSize = 4;
+            buffer.destroy = false;
+            buffer.texture.target = GL_TEXTURE_2D;
+
+            glGenTextures(1, &buffer.texture.id);
+            glBindTexture(GL_TEXTURE_2D, buffer.texture.id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.w(), size.h(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+            glGenFramebuffers(1, &bo.framebuffers[i]);
+            glBindFramebuffer(GL_FRAMEBUFFER, bo.framebuffers[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture.id, 0);
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            {
+                LLog::error("[%s] Failed to create framebuffer for output %s.", BKND_NAME, bo.name.c_str());
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                destroyBuffers(bo);
+                return false;
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        bo.currentBuffer = 0;
+        return true;
+    }
+
+    static void destroyBuffers(HeadlessOutput &bo)
+    {
+        outputDestroyBuffers(bo.textures);
+
+        for (UInt32 i = 0; i < BKND_BUFFERS; i++)
+        {
+            if (bo.framebuffers[i])
+            {
+                glDeleteFramebuffers(1, &bo.framebuffers[i]);
+                bo.framebuffers[i] = 0;
+            }
+
+            if (bo.buffers[i].texture.id)
+            {
+                glDeleteTextures(1, &bo.buffers[i].texture.id);
+                bo.buffers[i].texture.id = 0;
+            }
+        }
+    }
+
+    /* Waits for the next simulated vblank and fills the presentation time. With the virtual clock,
+     * the clock simply advances one refresh period per frame, so results don't depend on the host load */
+    static void present(HeadlessOutput &bo)
+    {
+        auto &presentation { bo.output->imp()->presentationTime };
+        const Int64 period { 1000000000000 / Int64(bo.currentMode->refreshRate()) };
+        Int64 time;
+
+        if (virtualClock)
+        {
+            bo.frame++;
+            time = bo.vblankBase + Int64(bo.frame) * period;
+        }
+        else if (bo.vSync)
+        {
+            // Frames that took longer than a period miss the following vblanks
+            UInt64 frame { UInt64((nowNs() - bo.vblankBase) / period) + 1 };
+
+            if (frame <= bo.frame)
+                frame = bo.frame + 1;
+
+            bo.frame = frame;
+            time = bo.vblankBase + Int64(frame) * period;
+
+            const timespec ts { time_t(time / 1000000000), long(time % 1000000000) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+        else
+        {
+            if (bo.refreshRateLimit >= 0)
+            {
+                // Same as the DRM backend, 0 limits to twice the refresh rate
+                const Int64 interval { bo.refreshRateLimit == 0 ? period / 2 : 1000000000 / Int64(bo.refreshRateLimit) };
+                const Int64 target { bo.lastPresentation + interval };
+                const timespec ts { time_t(target / 1000000000), long(target % 1000000000) };
+
+                if (target > nowNs())
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+            }
+
+            bo.frame++;
+            time = nowNs();
+        }
+
+        bo.lastPresentation = time;
+        presentation.time.tv_sec = time / 1000000000;
+        presentation.time.tv_nsec = time % 1000000000;
+        presentation.period = (virtualClock || bo.vSync) ? UInt32(period) : 0;
+        presentation.frame = bo.frame;
+        presentation.flags = (virtualClock || bo.vSync) ? SRM_PRESENTATION_TIME_FLAGS_VSYNC : 0;
+        bo.output->imp()->backendPageFlipped();
+    }
+
+    static void applyPendingMode(HeadlessOutput &bo)
+    {
+        destroyBuffers(bo);
+        bo.currentMode = bo.pendingMode;
+        createBuffers(bo);
+
+        // Restart the vblank clock with the new refresh rate
+        bo.vblankBase = bo.lastPresentation;
+        bo.frame = 0;
+
+        bo.output->imp()->backendResizeGL();
+    }
+
+    static void renderLoop(HeadlessOutput *bo)
+    {
+        LOutput *output { bo->output };
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, bo->context);
+
+        const bool ok { createBuffers(*bo) };
+
+        if (ok)
+        {
+            bo->vblankBase = bo->lastPresentation = nowNs();
+            bo->frame = 0;
+            output->imp()->backendInitializeGL();
+        }
+
+        std::unique_lock<std::mutex> lock { bo->mutex };
+        bo->initialized = true;
+        bo->exit = !ok;
+        bo->cond.notify_all();
+
+        while (true)
+        {
+            bo->cond.wait(lock, [bo]{ return bo->repaint || bo->exit || bo->changingMode; });
+
+            if (bo->exit)
+                break;
+
+            if (bo->changingMode)
+            {
+                lock.unlock();
+                applyPendingMode(*bo);
+                lock.lock();
+                bo->changingMode = false;
+                bo->cond.notify_all();
+                continue;
+            }
+
+            bo->repaint = false;
+            lock.unlock();
+
+            if (output->state() == LOutput::Initialized)
+            {
+                output->imp()->backendPaintGL();
+
+                // There is no swap, make sure the frame is complete before presenting it
+                glFinish();
+                bo->currentBuffer = (bo->currentBuffer + 1) % BKND_BUFFERS;
+                present(*bo);
+            }
+            else if (output->state() == LOutput::PendingUninitialize)
+                output->imp()->backendUninitializeGL();
+
+            lock.lock();
+        }
+
+        lock.unlock();
+
+        if (output->state() == LOutput::PendingUninitialize)
+            output->imp()->backendUninitializeGL();
+
+        destroyBuffers(*bo);
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+    /* OUTPUT */
+
+    static bool outputInitialize(LOutput *output)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+        bo.context = eglCreateContext(eglDisplay, eglConfig, eglContext, eglContextAttribs);
+
+        if (bo.context == EGL_NO_CONTEXT)
+        {
+            LLog::error("[%s] Failed to create EGL context for output %s.", BKND_NAME, bo.name.c_str());
+            return false;
+        }
+
+        bo.initialized = false;
+        bo.exit = false;
+        bo.repaint = false;
+        bo.thread = std::thread(renderLoop, &bo);
+
+        // Like other backends, initializeGL() is called before returning
+        std::unique_lock<std::mutex> lock { bo.mutex };
+        bo.cond.wait(lock, [&bo]{ return bo.initialized; });
+
+        if (bo.exit)
+        {
+            lock.unlock();
+            bo.thread.join();
+            eglDestroyContext(eglDisplay, bo.context);
+            bo.context = EGL_NO_CONTEXT;
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool outputRepaint(LOutput *output)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+        bo.mutex.lock();
+        bo.repaint = true;
+        bo.cond.notify_all();
+        bo.mutex.unlock();
+        return true;
+    }
+
+    static void outputUninitialize(LOutput *output)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+
+        if (!bo.thread.joinable())
+            return;
+
+        bo.mutex.lock();
+        bo.exit = true;
+        bo.cond.notify_all();
+        bo.mutex.unlock();
+        bo.thread.join();
+
+        eglDestroyContext(eglDisplay, bo.context);
+        bo.context = EGL_NO_CONTEXT;
+    }
+
+    static bool outputHasBufferDamageSupport(LOutput */*output*/)
+    {
+        return false;
+    }
+
+    static void outputSetBufferDamage(LOutput */*output*/, LRegion &/*region*/)
+    {
+        /* Disabled */
+    }
+
+    /* OUTPUT PROPS */
+
+    static const char *outputGetName(LOutput *output)
+    {
+        return bkndOutput(output).name.c_str();
+    }
+
+    static const char *outputGetManufacturerName(LOutput */*output*/)
+    {
+        return "Cuarzo Software";
+    }
+
+    static const char *outputGetModelName(LOutput */*output*/)
+    {
+        return "Headless Output";
+    }
+
+    static const char *outputGetDescription(LOutput *output)
+    {
+        return bkndOutput(output).description.c_str();
+    }
+
+    static const char *outputGetSerial(LOutput */*output*/)
+    {
+        return nullptr;
+    }
+
+    static const LSize *outputGetPhysicalSize(LOutput *output)
+    {
+        return &bkndOutput(output).physicalSize;
+    }
+
+    static Int32 outputGetSubPixel(LOutput */*output*/)
+    {
+        return WL_OUTPUT_SUBPIXEL_UNKNOWN;
+    }
+
+    static LGPU *outputGetDevice(LOutput */*output*/)
+    {
+        return &allocator;
+    }
+
+    static UInt32 outputGetID(LOutput *output)
+    {
+        return bkndOutput(output).id;
+    }
+
+    static bool outputIsNonDesktop(LOutput */*output*/)
+    {
+        return false;
+    }
+
+    /* OUTPUT BUFFERING */
+
+    static UInt32 outputGetFramebufferID(LOutput *output)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+        return bo.framebuffers[bo.currentBuffer];
+    }
+
+    static Int32 outputGetCurrentBufferIndex(LOutput *output)
+    {
+        return bkndOutput(output).currentBuffer;
+    }
+
+    static UInt32 outputGetBuffersCount(LOutput */*output*/)
+    {
+        return BKND_BUFFERS;
+    }
+
+    static LTexture *outputGetBuffer(LOutput *output, UInt32 bufferIndex)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+
+        if (bufferIndex >= BKND_BUFFERS || !bo.buffers[bufferIndex].texture.id)
+            return nullptr;
+
+        if (bo.textures.empty())
+            bo.textures.resize(BKND_BUFFERS, nullptr);
+
+        if (bo.textures[bufferIndex])
+            return bo.textures[bufferIndex];
+
+        LTexture *tex { new LTexture(true) };
+        tex->m_sourceType = LTexture::Framebuffer;
+        tex->m_graphicBackendData = &bo.buffers[bufferIndex];
+        tex->m_format = DRM_FORMAT_XBGR8888;
+        tex->m_sizeB = bo.currentMode->sizeB();
+        bo.textures[bufferIndex] = tex;
+        return tex;
+    }
+
+    static void outputDestroyBuffers(std::vector<LTexture*> &textures)
+    {
+        while (!textures.empty())
+        {
+            if (textures.back())
+            {
+                // Buffers are owned by the output
+                textures.back()->m_graphicBackendData = nullptr;
+                delete textures.back();
+            }
+
+            textures.pop_back();
+        }
+    }
+
+    /* OUTPUT GAMMA */
+
+    static UInt32 outputGetGammaSize(LOutput */*output*/)
+    {
+        return 0;
+    }
+
+    static bool outputSetGamma(LOutput */*output*/, const LGammaTable &/*table*/)
+    {
+        return false;
+    }
+
+    /* OUTPUT V-SYNC */
+
+    static bool outputHasVSyncControlSupport(LOutput */*output*/)
+    {
+        return true;
+    }
+
+    static bool outputIsVSyncEnabled(LOutput *output)
+    {
+        return bkndOutput(output).vSync;
+    }
+
+    static bool outputEnableVSync(LOutput *output, bool enabled)
+    {
+        bkndOutput(output).vSync = enabled;
+        return true;
+    }
+
+    static void outputSetRefreshRateLimit(LOutput *output, Int32 hz)
+    {
+        bkndOutput(output).refreshRateLimit = hz;
+    }
+
+    static Int32 outputGetRefreshRateLimit(LOutput *output)
+    {
+        return bkndOutput(output).refreshRateLimit;
+    }
+
+    /* OUTPUT TIME */
+
+    static clockid_t outputGetClock(LOutput */*output*/)
+    {
+        return CLOCK_MONOTONIC;
+    }
+
+    /* OUTPUT CURSOR */
+
+    static bool outputHasHardwareCursorSupport(LOutput */*output*/)
+    {
+        return false;
+    }
+
+    static void outputSetCursorTexture(LOutput */*output*/, UChar8 */*buffer*/) {}
+    static void outputSetCursorPosition(LOutput */*output*/, const LPoint &/*position*/) {}
+
+    static bool outputHasThreadSafeCursorPosition(LOutput */*output*/)
+    {
+        return true;
+    }
+
+    /* OUTPUT MODES */
+
+    static const LOutputMode *outputGetPreferredMode(LOutput *output)
+    {
+        return bkndOutput(output).modes.front();
+    }
+
+    static const LOutputMode *outputGetCurrentMode(LOutput *output)
+    {
+        return bkndOutput(output).currentMode;
+    }
+
+    static const std::vector<LOutputMode*>* outputGetModes(LOutput *output)
+    {
+        return &bkndOutput(output).modes;
+    }
+
+    static bool outputSetMode(LOutput *output, LOutputMode *mode)
+    {
+        HeadlessOutput &bo { bkndOutput(output) };
+
+        if (mode->output() != output)
+            return false;
+
+        std::unique_lock<std::mutex> lock { bo.mutex };
+        bo.pendingMode = mode;
+
+        if (!bo.thread.joinable())
+        {
+            bo.currentMode = mode;
+            return true;
+        }
+
+        if (mode == bo.currentMode)
+            return true;
+
+        // The render thread recreates the buffers and calls resizeGL() before returning
+        bo.changingMode = true;
+        bo.cond.notify_all();
+        bo.cond.wait(lock, [&bo]{ return !bo.changingMode || bo.exit; });
+        return bo.currentMode == mode;
+    }
+
+    /* OUTPUT CONTENT TYPE */
+
+    static LContentType outputGetContentType(LOutput *output)
+    {
+        return bkndOutput(output).contentType;
+    }
+
+    static void outputSetContentType(LOutput *output, LContentType type)
+    {
+        bkndOutput(output).contentType = type;
+    }
+
+    /* DIRECT SCANOUT */
+
+    static bool outputSetScanoutBuffer(LOutput */*output*/, LTexture */*texture*/)
+    {
+        return false;
+    }
+
+    /* DRM LEASE */
+
+    static int backendCreateLease(const std::vector<LOutput*> &/*outputs*/) { return -1; }
+    static void backendRevokeLease(int /*fd*/) {}
+};
+
+extern "C" LGraphicBackendInterface *getAPI()
+{
+    static LGraphicBackendInterface API;
+    API.backendGetId                    = &LGraphicBackend::backendGetId;
+    API.backendGetContextHandle         = &LGraphicBackend::backendGetContextHandle;
+    API.backendInitialize               = &LGraphicBackend::backendInitialize;
+    API.backendUninitialize             = &LGraphicBackend::backendUninitialize;
+    API.backendSuspend                  = &LGraphicBackend::backendSuspend;
+    API.backendResume                   = &LGraphicBackend::backendResume;
+    API.backendGetConnectedOutputs      = &LGraphicBackend::backendGetConnectedOutputs;
+    API.backendGetDevices               = &LGraphicBackend::backendGetDevices;
+    API.backendGetDMAFormats            = &LGraphicBackend::backendGetDMAFormats;
+    API.backendGetScanoutDMAFormats     = &LGraphicBackend::backendGetScanoutDMAFormats;
+    API.backendGetAllocatorEGLDisplay   = &LGraphicBackend::backendGetAllocatorEGLDisplay;
+    API.backendGetAllocatorEGLContext   = &LGraphicBackend::backendGetAllocatorEGLContext;
+    API.backendGetAllocatorDevice       = &LGraphicBackend::backendGetAllocatorDevice;
+
+    /* TEXTURES */
+    API.textureCreateFromCPUBuffer      = &LGraphicBackend::textureCreateFromCPUBuffer;
+    API.textureCreateFromWaylandDRM     = &LGraphicBackend::textureCreateFromWaylandDRM;
+    API.textureCreateFromDMA            = &LGraphicBackend::textureCreateFromDMA;
+    API.textureCreateFromGL             = &LGraphicBackend::textureCreateFromGL;
+    API.textureUpdateRect               = &LGraphicBackend::textureUpdateRect;
+    API.textureGetID                    = &LGraphicBackend::textureGetID;
+    API.textureGetTarget                = &LGraphicBackend::textureGetTarget;
+    API.textureSetFence                 = &LGraphicBackend::textureSetFence;
+    API.textureDestroy                  = &LGraphicBackend::textureDestroy;
+
+    /* OUTPUT */
+    API.outputInitialize                = &LGraphicBackend::outputInitialize;
+    API.outputRepaint                   = &LGraphicBackend::outputRepaint;
+    API.outputUninitialize              = &LGraphicBackend::outputUninitialize;
+    API.outputHasBufferDamageSupport    = &LGraphicBackend::outputHasBufferDamageSupport;
+    API.outputSetBufferDamage           = &LGraphicBackend::outputSetBufferDamage;
+
+    /* OUTPUT PROPS */
+    API.outputGetName                   = &LGraphicBackend::outputGetName;
+    API.outputGetManufacturerName       = &LGraphicBackend::outputGetManufacturerName;
+    API.outputGetModelName              = &LGraphicBackend::outputGetModelName;
+    API.outputGetDescription            = &LGraphicBackend::outputGetDescription;
+    API.outputGetSerial                 = &LGraphicBackend::outputGetSerial;
+    API.outputGetPhysicalSize           = &LGraphicBackend::outputGetPhysicalSize;
+    API.outputGetSubPixel               = &LGraphicBackend::outputGetSubPixel;
+    API.outputGetDevice                 = &LGraphicBackend::outputGetDevice;
+    API.outputGetID                     = &LGraphicBackend::outputGetID;
+    API.outputIsNonDesktop              = &LGraphicBackend::outputIsNonDesktop;
+
+    /* OUTPUT BUFFERING */
+    API.outputGetFramebufferID          = &LGraphicBackend::outputGetFramebufferID;
+    API.outputGetCurrentBufferIndex     = &LGraphicBackend::outputGetCurrentBufferIndex;
+    API.outputGetBuffersCount           = &LGraphicBackend::outputGetBuffersCount;
+    API.outputGetBuffer                 = &LGraphicBackend::outputGetBuffer;
+
+    /* OUTPUT GAMMA */
+    API.outputGetGammaSize              = &LGraphicBackend::outputGetGammaSize;
+    API.outputSetGamma                  = &LGraphicBackend::outputSetGamma;
+
+    /* OUTPUT V-SYNC */
+    API.outputHasVSyncControlSupport    = &LGraphicBackend::outputHasVSyncControlSupport;
+    API.outputIsVSyncEnabled            = &LGraphicBackend::outputIsVSyncEnabled;
+    API.outputEnableVSync               = &LGraphicBackend::outputEnableVSync;
+    API.outputSetRefreshRateLimit       = &LGraphicBackend::outputSetRefreshRateLimit;
+    API.outputGetRefreshRateLimit       = &LGraphicBackend::outputGetRefreshRateLimit;
+
+    /* OUTPUT TIME */
+    API.outputGetClock                  = &LGraphicBackend::outputGetClock;
+
+    /* OUTPUT CURSOR */
+    API.outputHasHardwareCursorSupport  = &LGraphicBackend::outputHasHardwareCursorSupport;
+    API.outputSetCursorTexture          = &LGraphicBackend::outputSetCursorTexture;
+    API.outputSetCursorPosition         = &LGraphicBackend::outputSetCursorPosition;
+    API.outputHasThreadSafeCursorPosition = &LGraphicBackend::outputHasThreadSafeCursorPosition;
+
+    /* OUTPUT MODES */
+    API.outputGetPreferredMode          = &LGraphicBackend::outputGetPreferredMode;
+    API.outputGetCurrentMode            = &LGraphicBackend::outputGetCurrentMode;
+    API.outputGetModes                  = &LGraphicBackend::outputGetModes;
+    API.outputSetMode                   = &LGraphicBackend::outputSetMode;
+
+    /* OUTPUT CONTENT TYPE */
+    API.outputGetContentType            = &LGraphicBackend::outputGetContentType;
+    API.outputSetContentType            = &LGraphicBackend::outputSetContentType;
+
+    /* DIRECT SCANOUT */
+    API.outputSetScanoutBuffer          = &LGraphicBackend::outputSetScanoutBuffer;
+
+    /* DRM LEASE */
+    API.backendCreateLease              = &LGraphicBackend::backendCreateLease;
+    API.backendRevokeLease              = &LGraphicBackend::backendRevokeLease;
+
+    return &API;
+}
@@ -79,6 +79,7 @@ public:
     static bool                             outputHasHardwareCursorSupport(LOutput *output);
     static void                             outputSetCursorTexture(LOutput *output, UChar8 *buffer);
     static void                             outputSetCursorPosition(LOutput *output, const LPoint &position);
+    static bool                             outputHasThreadSafeCursorPosition(LOutput *output);
 
     /* OUTPUT MODES */
     static const LOutputMode *              outputGetPreferredMode(LOutput *output);
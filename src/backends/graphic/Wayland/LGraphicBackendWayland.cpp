@@ -1082,6 +1082,12 @@ public:
         }
     }
 
+    // Reads the LCursor state
+    static bool outputHasThreadSafeCursorPosition(LOutput */*output*/)
+    {
+        return false;
+    }
+
     static const LOutputMode *outputGetPreferredMode(LOutput */*output*/)
     {
         return dummyOutputModes.front();
@@ -1323,6 +1329,7 @@ extern "C" LGraphicBackendInterface *getAPI()
     API.outputHasHardwareCursorSupport  = &LGraphicBackend::outputHasHardwareCursorSupport;
     API.outputSetCursorTexture          = &LGraphicBackend::outputSetCursorTexture;
     API.outputSetCursorPosition         = &LGraphicBackend::outputSetCursorPosition;
+    API.outputHasThreadSafeCursorPosition = &LGraphicBackend::outputHasThreadSafeCursorPosition;
 
     /* OUTPUT MODES */
     API.outputGetPreferredMode          = &LGraphicBackend::outputGetPreferredMode;
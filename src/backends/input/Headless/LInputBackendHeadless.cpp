@@ -0,0 +1,449 @@
+#include <private/LCompositorPrivate.h>
+#include <private/LInputRecording.h>
+#include <LPointerMoveEvent.h>
+#include <LPointerButtonEvent.h>
+#include <LPointerScrollEvent.h>
+#include <LPointerSwipeBeginEvent.h>
+#include <LPointerSwipeUpdateEvent.h>
+#include <LPointerSwipeEndEvent.h>
+#include <LPointerPinchBeginEvent.h>
+#include <LPointerPinchUpdateEvent.h>
+#include <LPointerPinchEndEvent.h>
+#include <LPointerHoldBeginEvent.h>
+#include <LPointerHoldEndEvent.h>
+#include <LKeyboardKeyEvent.h>
+#include <LTouchDownEvent.h>
+#include <LTouchMoveEvent.h>
+#include <LTouchUpEvent.h>
+#include <LTouchFrameEvent.h>
+#include <LTouchCancelEvent.h>
+#include <LInputDevice.h>
+#include <LLog.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+using namespace Louvre;
+using namespace Louvre::LInputRecording;
+
+/* Input backend without devices, meant to be used along with the headless graphic backend.
+ * Input events can still be simulated by calling LSeat and LPointer/LKeyboard/LTouch event handlers directly.
+ * If LOUVRE_INPUT_REPLAY is set, it plays back a file recorded with LSeat::startInputRecording() instead. */
+class Louvre::LInputBackend
+{
+public:
+    static inline std::vector<LInputDevice*> devices;
+
+    // Replay
+    struct Entry
+    {
+        Record record;
+        std::string name; // Device records only
+    };
+
+    // Events dispatched per wakeup when LOUVRE_INPUT_REPLAY_SPEED is 0
+    static constexpr size_t MaxEventsPerDispatch { 64 };
+
+    static inline std::vector<Entry> entries;
+    static inline std::vector<LInputDevice*> replayDevices; // Indexed by the recorded device index
+    static inline size_t position { 0 };
+    static inline Float64 speed { 1.0 };
+    static inline UInt64 delayUs { 0 };
+    static inline UInt64 firstEventUs { 0 };
+    static inline UInt64 startUs { 0 };
+    static inline UInt64 suspendedUs { 0 };
+    static inline bool started { false };
+    static inline bool suspended { false };
+    static inline Int32 timerFd { -1 };
+    static inline wl_event_source *timerSource { nullptr };
+
+    static UInt64 nowUs()
+    {
+        const timespec ts { LTime::ns() };
+        return UInt64(ts.tv_sec) * 1000000 + UInt64(ts.tv_nsec) / 1000;
+    }
+
+    static bool loadReplay(const char *path)
+    {
+        std::ifstream file { path, std::ios::binary };
+
+        if (!file)
+        {
+            LLog::error("[LInputBackendHeadless::loadReplay] Failed to open %s.", path);
+            return false;
+        }
+
+        Header header;
+
+        if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+        {
+            LLog::error("[LInputBackendHeadless::loadReplay] %s is not an input recording.", path);
+            return false;
+        }
+
+        if (header.version != Version || header.recordSize != sizeof(Record))
+        {
+            LLog::error("[LInputBackendHeadless::loadReplay] Unsupported input recording version %d.", header.version);
+            return false;
+        }
+
+        Entry entry;
+        bool hasEvents { false };
+
+        while (file.read((char*)&entry.record, sizeof(Record)))
+        {
+            entry.name.clear();
+
+            if (entry.record.kind == DeviceRecord)
+            {
+                entry.name.resize(entry.record.nameLength);
+
+                if (!file.read(entry.name.data(), entry.record.nameLength))
+                    break;
+
+                if (entry.record.device >= replayDevices.size())
+                    replayDevices.resize(entry.record.device + 1, nullptr);
+            }
+            else if (entry.record.kind == EventRecord)
+            {
+                if (!hasEvents)
+                {
+                    hasEvents = true;
+                    firstEventUs = entry.record.us;
+                }
+            }
+            else
+            {
+                LLog::warning("[LInputBackendHeadless::loadReplay] Invalid record found, ignoring the rest of %s.", path);
+                break;
+            }
+
+            entries.push_back(entry);
+        }
+
+        LLog::debug("[LInputBackendHeadless::loadReplay] Replaying %zu records from %s.", entries.size(), path);
+        return true;
+    }
+
+    static void armTimer(UInt64 us)
+    {
+        itimerspec spec {};
+
+        // A zero value would disarm it instead
+        if (us == 0)
+            spec.it_value.tv_nsec = 1;
+        else
+        {
+            spec.it_value.tv_sec = us / 1000000;
+            spec.it_value.tv_nsec = (us % 1000000) * 1000;
+        }
+
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+    }
+
+    static void disarmTimer()
+    {
+        itimerspec spec {};
+        timerfd_settime(timerFd, 0, &spec, NULL);
+    }
+
+    static UInt64 targetUs(const Record &record)
+    {
+        const UInt64 offset { record.us > firstEventUs ? record.us - firstEventUs : 0 };
+        return startUs + UInt64(Float64(offset) / speed);
+    }
+
+    static void plugDevice(const Entry &entry)
+    {
+        LInputDevice *&device { replayDevices[entry.record.device] };
+
+        if (!device)
+            device = new LInputDevice(entry.record.code, entry.name, entry.record.ms, entry.record.us);
+        else
+        {
+            // The same index is not reused by the recorder, but keep the state consistent anyway
+            device->m_capabilities = entry.record.code;
+            device->m_name = entry.name;
+        }
+
+        if (std::find(devices.begin(), devices.end(), device) == devices.end())
+        {
+            devices.push_back(device);
+            device->notifyPlugged();
+        }
+    }
+
+    // Rebuilds the event with the current time and a new serial, returns false if the record is invalid
+    static bool notifyRecord(const Record &record, LInputDevice *device)
+    {
+        const UInt32 serial { LTime::nextSerial() };
+        const UInt32 ms { LTime::ms() };
+        const UInt64 us { nowUs() };
+        const LPointF v01 { record.values[0], record.values[1] };
+        const LPointF v23 { record.values[2], record.values[3] };
+
+        switch ((LEvent::Type)record.type)
+        {
+        case LEvent::Type::Pointer:
+        {
+            switch ((LEvent::Subtype)record.subtype)
+            {
+            case LEvent::Subtype::Move:
+            {
+                LPointerMoveEvent e { v01, v23, serial, ms, us, device };
+                e.setCoalescedEvents(record.code);
+                e.notify();
+                return true;
+            }
+            case LEvent::Subtype::Button:
+                LPointerButtonEvent((LPointerButtonEvent::Button)record.code, (LPointerButtonEvent::State)record.state,
+                                    serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::Scroll:
+                LPointerScrollEvent(v01, v23, (LPointerScrollEvent::Source)record.state, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::SwipeBegin:
+                LPointerSwipeBeginEvent(record.code, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::SwipeUpdate:
+                LPointerSwipeUpdateEvent(record.code, v01, v23, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::SwipeEnd:
+                LPointerSwipeEndEvent(record.code, record.state != 0, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::PinchBegin:
+                LPointerPinchBeginEvent(record.code, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::PinchUpdate:
+                LPointerPinchUpdateEvent(record.code, v01, v23, record.values[4], record.values[5], serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::PinchEnd:
+                LPointerPinchEndEvent(record.code, record.state != 0, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::HoldBegin:
+                LPointerHoldBeginEvent(record.code, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::HoldEnd:
+                LPointerHoldEndEvent(record.code, record.state != 0, serial, ms, us, device).notify();
+                return true;
+            default:
+                return false;
+            }
+        }
+        case LEvent::Type::Keyboard:
+        {
+            if ((LEvent::Subtype)record.subtype != LEvent::Subtype::Key)
+                return false;
+
+            LKeyboardKeyEvent(record.code, (LKeyboardKeyEvent::State)record.state, serial, ms, us, device).notify();
+            return true;
+        }
+        case LEvent::Type::Touch:
+        {
+            switch ((LEvent::Subtype)record.subtype)
+            {
+            case LEvent::Subtype::Down:
+                LTouchDownEvent(record.code, v01, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::Move:
+                LTouchMoveEvent(record.code, v01, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::Up:
+                LTouchUpEvent(record.code, serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::Frame:
+                LTouchFrameEvent(serial, ms, us, device).notify();
+                return true;
+            case LEvent::Subtype::Cancel:
+                LTouchCancelEvent(serial, ms, us, device).notify();
+                return true;
+            default:
+                return false;
+            }
+        }
+        }
+
+        return false;
+    }
+
+    static int processReplay(int, unsigned int, void *)
+    {
+        UInt64 expirations;
+        if (read(timerFd, &expirations, sizeof(expirations)) < 0) {}
+
+        if (suspended)
+            return 0;
+
+        UInt64 now { nowUs() };
+
+        if (!started)
+        {
+            started = true;
+            startUs = now + delayUs;
+
+            if (delayUs > 0)
+            {
+                armTimer(startUs);
+                return 0;
+            }
+        }
+
+        size_t dispatched { 0 };
+
+        while (position < entries.size())
+        {
+            const Entry &entry { entries[position] };
+
+            if (entry.record.kind == DeviceRecord)
+            {
+                plugDevice(entry);
+                position++;
+                continue;
+            }
+
+            if (speed > 0.0)
+            {
+                if (targetUs(entry.record) > now)
+                    break;
+            }
+            else if (dispatched == MaxEventsPerDispatch)
+                break;
+
+            // Events of unknown devices are replayed with the fake device
+            LInputDevice *device { entry.record.device < replayDevices.size() ? replayDevices[entry.record.device] : nullptr };
+            position++;
+
+            if (notifyRecord(entry.record, device))
+                dispatched++;
+
+            // Handlers may take a while
+            if (speed > 0.0 && dispatched % MaxEventsPerDispatch == 0)
+                now = nowUs();
+        }
+
+        if (position < entries.size())
+            armTimer(speed > 0.0 ? targetUs(entries[position].record) : 0);
+        else
+            LLog::debug("[LInputBackendHeadless::processReplay] Input replay finished.");
+
+        return 0;
+    }
+
+    static UInt32 backendGetId()
+    {
+        return LInputBackendHeadless;
+    }
+
+    static void *backendGetContextHandle()
+    {
+        return nullptr;
+    }
+
+    static const std::vector<LInputDevice*> *backendGetDevices()
+    {
+        return &devices;
+    }
+
+    static bool backendInitialize()
+    {
+        const char *path { getenv("LOUVRE_INPUT_REPLAY") };
+
+        if (!path || path[0] == '\0')
+            return true;
+
+        if (!loadReplay(path))
+            return true;
+
+        const char *env { getenv("LOUVRE_INPUT_REPLAY_SPEED") };
+        speed = env ? atof(env) : 1.0;
+
+        if (speed < 0.0)
+            speed = 1.0;
+
+        env = getenv("LOUVRE_INPUT_REPLAY_DELAY");
+        delayUs = env && atoi(env) > 0 ? UInt64(atoi(env)) * 1000 : 0;
+
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        if (timerFd < 0)
+        {
+            LLog::error("[LInputBackendHeadless::backendInitialize] Failed to create replay timer.");
+            entries.clear();
+            return true;
+        }
+
+        timerSource = LCompositor::addFdListener(timerFd, nullptr, &processReplay);
+
+        // Starts once the event loop is dispatched
+        armTimer(0);
+        return true;
+    }
+
+    static void backendUninitialize()
+    {
+        if (timerSource)
+        {
+            LCompositor::removeFdListener(timerSource);
+            timerSource = nullptr;
+        }
+
+        if (timerFd >= 0)
+        {
+            close(timerFd);
+            timerFd = -1;
+        }
+
+        for (LInputDevice *device : replayDevices)
+            delete device;
+
+        devices.clear();
+        replayDevices.clear();
+        entries.clear();
+        position = 0;
+        started = suspended = false;
+    }
+
+    static void backendSuspend()
+    {
+        if (timerFd < 0 || suspended)
+            return;
+
+        suspended = true;
+        suspendedUs = nowUs();
+        disarmTimer();
+    }
+
+    static void backendResume()
+    {
+        if (timerFd < 0 || !suspended)
+            return;
+
+        suspended = false;
+
+        // Events are not replayed while suspended, the remaining ones keep their relative timing
+        if (started)
+            startUs += nowUs() - suspendedUs;
+
+        if (position < entries.size())
+            armTimer(started && speed > 0.0 ? targetUs(entries[position].record) : 0);
+    }
+
+    static void backendForceUpdate() {}
+};
+
+extern "C" LInputBackendInterface *getAPI()
+{
+    static LInputBackendInterface API;
+    API.backendGetId            = &LInputBackend::backendGetId;
+    API.backendGetContextHandle = &LInputBackend::backendGetContextHandle;
+    API.backendGetDevices       = &LInputBackend::backendGetDevices;
+    API.backendInitialize       = &LInputBackend::backendInitialize;
+    API.backendUninitialize     = &LInputBackend::backendUninitialize;
+    API.backendSuspend          = &LInputBackend::backendSuspend;
+    API.backendResume           = &LInputBackend::backendResume;
+    API.backendSetLeds          = NULL;
+    API.backendForceUpdate      = &LInputBackend::backendForceUpdate;
+    return &API;
+}
@@ -1,6 +1,8 @@
 #include <private/LCompositorPrivate.h>
 #include <private/LSeatPrivate.h>
 #include <private/LKeyboardPrivate.h>
+#include <private/LCursorPrivate.h>
+#include <private/LSPSCRing.h>
 #include <LInputDevice.h>
 #include <LPointerMoveEvent.h>
 #include <LPointerButtonEvent.h>
@@ -26,6 +28,12 @@
 #include <cstring>
 #include <libinput.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <condition_variable>
+#include <deque>
 
 using namespace Louvre;
 
@@ -35,6 +43,22 @@ struct DEVICE_FD_ID
     Int32 id;
 };
 
+struct QUEUED_EVENT
+{
+    libinput_event *ev;
+    UInt64 serial;
+};
+
+// Libseat device opened or closed by the main thread on behalf of the input thread
+struct DEVICE_REQUEST
+{
+    const char *path;
+    Int32 flags;
+    Int32 fd;
+    bool open;
+    bool pending { false };
+};
+
 class Louvre::LInputBackend
 {
 public:
@@ -59,6 +83,34 @@ public:
     static inline libinput_event_touch *touchEvent;
     static inline LInputDevice *inputDevice;
 
+    // Relative motion being coalesced in pointerMoveEvent, see LSeat::enablePointerMotionCoalescing()
+    static inline bool pendingMotion { false };
+
+    /* Input thread, see LOUVRE_INPUT_THREAD
+     * libinput is only dispatched from the input thread, which pushes the events into eventQueue and wakes up the main thread
+     * through queueFd. Events are returned through processedQueue once handled, and destroyed by the input thread since
+     * libinput device references are not atomic. Either thread sets contextLocked while using the libinput context
+     * (see lockContext()), contextMutex guards it and deviceRequest, and contextCond is notified when either changes. */
+    static constexpr size_t QueueSize { 4096 };
+    static inline bool threaded { false };
+    static inline std::thread inputThread;
+    static inline thread_local bool isInputThread { false };
+    static inline std::atomic<bool> inputThreadExit { false };
+    static inline std::atomic<bool> inputThreadFinished { false };
+    static inline Int32 queueFd { -1 };
+    static inline Int32 exitFd { -1 };
+    static inline LSPSCRing<QUEUED_EVENT, QueueSize> eventQueue;
+    static inline LSPSCRing<libinput_event*, QueueSize> processedQueue;
+    static inline std::mutex contextMutex;
+    static inline std::condition_variable contextCond;
+    static inline bool contextLocked { false };
+    static inline DEVICE_REQUEST deviceRequest;
+
+    // Input thread only
+    static inline UInt64 queuedEvents { 0 };
+    static inline UInt64 destroyedEvents { 0 };
+    static inline std::deque<std::pair<UInt64, LPointF>> unprocessedMotion;
+
     // Recycled events
     static inline LPointerMoveEvent pointerMoveEvent;
     static inline LPointerButtonEvent pointerButtonEvent;
@@ -81,6 +133,9 @@ public:
 
     static Int32 openRestricted(const char *path, int flags, void */*data*/)
     {
+        if (libseatEnabled && isInputThread)
+            return requestDevice(true, path, flags, -1);
+
         if (libseatEnabled)
         {
             DEVICE_FD_ID dev;
@@ -100,6 +155,12 @@ public:
 
     static void closeRestricted(int fd, void */*data*/)
     {
+        if (libseatEnabled && isInputThread)
+        {
+            requestDevice(false, nullptr, 0, fd);
+            return;
+        }
+
         if (libseatEnabled)
         {
             DEVICE_FD_ID dev {-1, -1};
@@ -136,26 +197,297 @@ public:
         return caps;
     }
 
+    // Libseat is not thread-safe, so the main thread opens and closes devices requested while the input thread dispatches
+    static Int32 requestDevice(bool open, const char *path, Int32 flags, Int32 fd)
+    {
+        std::unique_lock<std::mutex> lock { contextMutex };
+        deviceRequest.open = open;
+        deviceRequest.path = path;
+        deviceRequest.flags = flags;
+        deviceRequest.fd = fd;
+        deviceRequest.pending = true;
+
+        // The main thread could be waiting in lockContext() instead of its event loop
+        contextCond.notify_all();
+        wakeMainThread();
+        contextCond.wait(lock, []{ return !deviceRequest.pending; });
+        return deviceRequest.fd;
+    }
+
+    static void processDeviceRequest()
+    {
+        std::lock_guard<std::mutex> lock { contextMutex };
+        processDeviceRequestLocked();
+    }
+
+    // contextMutex must be held
+    static void processDeviceRequestLocked()
+    {
+        if (!deviceRequest.pending)
+            return;
+
+        if (deviceRequest.open)
+            deviceRequest.fd = openRestricted(deviceRequest.path, deviceRequest.flags, NULL);
+        else
+            closeRestricted(deviceRequest.fd, NULL);
+
+        deviceRequest.pending = false;
+        contextCond.notify_all();
+    }
+
+    static void wakeMainThread()
+    {
+        const UInt64 value { 1 };
+        ssize_t n = write(queueFd, &value, sizeof(value));
+        L_UNUSED(n);
+    }
+
+    /* Must be held by the main thread while using the libinput context or devices, and by the input thread while
+     * dispatching. Blocks until the context is released, handling device requests in the meantime since the input
+     * thread could be waiting for one while holding it */
+    static void lockContext()
+    {
+        if (!threaded)
+            return;
+
+        std::unique_lock<std::mutex> lock { contextMutex };
+
+        while (contextLocked)
+        {
+            if (!isInputThread && deviceRequest.pending)
+                processDeviceRequestLocked();
+            else
+                contextCond.wait(lock);
+        }
+
+        contextLocked = true;
+    }
+
+    static void unlockContext()
+    {
+        if (!threaded)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock { contextMutex };
+            contextLocked = false;
+        }
+
+        contextCond.notify_all();
+    }
+
+    static libinput_event *nextEvent()
+    {
+        if (!threaded)
+            return libinput_get_event(li);
+
+        QUEUED_EVENT queued;
+
+        if (!eventQueue.pop(queued))
+            return NULL;
+
+        // Published to the input thread with the cursor state, see LCursorHwState
+        if (cursor())
+            cursor()->imp()->inputSerial = queued.serial;
+
+        return queued.ev;
+    }
+
+    static void releaseEvent()
+    {
+        // Never full, the input thread limits the events in flight to the queue capacity
+        if (threaded)
+            processedQueue.push(ev);
+        else
+            libinput_event_destroy(ev);
+    }
+
+    static void inputThreadLoop()
+    {
+        pollfd fds[2];
+        fds[0].fd = exitFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = libinput_get_fd(li);
+        fds[1].events = POLLIN;
+        libinput_event *event;
+        UInt64 value;
+        bool full;
+        Int32 ret;
+        isInputThread = true;
+
+        while (!inputThreadExit.load())
+        {
+            while (processedQueue.pop(event))
+            {
+                libinput_event_destroy(event);
+                destroyedEvents++;
+            }
+
+            full = queuedEvents - destroyedEvents >= eventQueue.capacity();
+
+            if (!full)
+            {
+                bool queued { false };
+                bool moved { false };
+
+                lockContext();
+                ret = libinput_dispatch(li);
+
+                if (ret != 0)
+                    LLog::error("[Libinput Backend] Failed to dispatch libinput %s.", strerror(-ret));
+
+                while (queuedEvents - destroyedEvents < eventQueue.capacity() && (event = libinput_get_event(li)) != NULL)
+                {
+                    queuedEvents++;
+
+                    if (libinput_event_get_type(event) == LIBINPUT_EVENT_POINTER_MOTION)
+                    {
+                        libinput_event_pointer *pointer { libinput_event_get_pointer_event(event) };
+                        unprocessedMotion.emplace_back(queuedEvents, LPointF(
+                            libinput_event_pointer_get_dx(pointer),
+                            libinput_event_pointer_get_dy(pointer)));
+                        moved = true;
+                    }
+
+                    eventQueue.push({event, queuedEvents});
+                    queued = true;
+                }
+
+                full = queuedEvents - destroyedEvents >= eventQueue.capacity();
+                unlockContext();
+
+                if (moved)
+                    moveHwCursor();
+
+                if (queued)
+                    wakeMainThread();
+            }
+
+            // If the main thread stops consuming events, leave them in libinput and check again later
+            if (poll(fds, full ? 1 : 2, full ? 1 : -1) > 0 && (fds[0].revents & POLLIN))
+            {
+                ssize_t n = read(exitFd, &value, sizeof(value));
+                L_UNUSED(n);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock { contextMutex };
+            inputThreadFinished.store(true);
+        }
+
+        contextCond.notify_all();
+    }
+
+    /* Moves the hw cursor from the input thread, adding the motion not processed by the main thread yet
+     * to the last published cursor position and clamping it to outputs like LCursor::setPos() does */
+    static void moveHwCursor()
+    {
+        if (!cursor())
+            return;
+
+        LCursor::LCursorPrivate &c { *cursor()->imp() };
+        std::lock_guard<std::mutex> lock { c.hwStateMutex };
+
+        while (!unprocessedMotion.empty() && unprocessedMotion.front().first <= c.hwState.inputSerial)
+            unprocessedMotion.pop_front();
+
+        if (!c.hwState.enabled || unprocessedMotion.empty())
+            return;
+
+        LPointF pos { c.hwState.pos };
+        const LRect *area { nullptr };
+
+        for (const LCursorHwOutput &o : c.hwState.outputs)
+            if (o.rect.containsPoint(pos))
+                area = &o.rect;
+
+        if (!area)
+            return;
+
+        for (const auto &motion : unprocessedMotion)
+        {
+            pos += motion.second;
+
+            for (const LCursorHwOutput &o : c.hwState.outputs)
+                if (o.rect.containsPoint(pos))
+                    area = &o.rect;
+
+            if (pos.x() > area->x() + area->w())
+                pos.setX(area->x() + area->w());
+            if (pos.x() < area->x())
+                pos.setX(area->x());
+
+            if (pos.y() > area->y() + area->h())
+                pos.setY(area->y() + area->h());
+            if (pos.y() < area->y())
+                pos.setY(area->y());
+        }
+
+        const LPointF posS { pos - c.hwState.hotspotS };
+        const LRect rect { posS, c.hwState.size };
+
+        for (const LCursorHwOutput &o : c.hwState.outputs)
+            if (o.hw && o.rect.intersects(rect))
+                compositor()->imp()->graphicBackend->outputSetCursorPosition(o.output,
+                    cursorOutputPos(posS, c.hwState.size, o.rect, o.transform, o.fractionalScale));
+    }
+
     static Int32 processInput(int, unsigned int, void *)
     {
-        const Int32 ret { libinput_dispatch(li) };
+        if (threaded)
+        {
+            UInt64 value;
+            ssize_t n = read(queueFd, &value, sizeof(value));
+            L_UNUSED(n);
+            processDeviceRequest();
 
-        if (ret != 0)
+            if (cursor())
+                cursor()->imp()->hwStateSharing = true;
+        }
+        else
         {
-            LLog::error("[Libinput Backend] Failed to dispatch libinput %s.", strerror(-ret));
-            return 0;
+            const Int32 ret { libinput_dispatch(li) };
+
+            if (ret != 0)
+            {
+                LLog::error("[Libinput Backend] Failed to dispatch libinput %s.", strerror(-ret));
+                return 0;
+            }
         }
 
-        while ((ev = libinput_get_event(li)) != NULL)
+        const bool coalesce { seat()->pointerMotionCoalescingEnabled() };
+
+        while ((ev = nextEvent()) != NULL)
         {
             eventType = libinput_event_get_type(ev);
 
+            if (pendingMotion && eventType != LIBINPUT_EVENT_POINTER_MOTION)
+                notifyPendingMotion();
+
             switch (eventType)
             {
             case LIBINPUT_EVENT_POINTER_MOTION:
                 dev = libinput_event_get_device(ev);
                 inputDevice = (LInputDevice*)libinput_device_get_user_data(dev);
                 pointerEvent = libinput_event_get_pointer_event(ev);
+
+                // Merge with the previous motion of the same device
+                if (pendingMotion && pointerMoveEvent.device() == inputDevice)
+                {
+                    pointerMoveEvent.setDx(pointerMoveEvent.delta().x() + libinput_event_pointer_get_dx(pointerEvent));
+                    pointerMoveEvent.setDy(pointerMoveEvent.delta().y() + libinput_event_pointer_get_dy(pointerEvent));
+                    pointerMoveEvent.setDxUnaccelerated(pointerMoveEvent.deltaUnaccelerated().x() + libinput_event_pointer_get_dx_unaccelerated(pointerEvent));
+                    pointerMoveEvent.setDyUnaccelerated(pointerMoveEvent.deltaUnaccelerated().y() + libinput_event_pointer_get_dy_unaccelerated(pointerEvent));
+                    pointerMoveEvent.setMs(libinput_event_pointer_get_time(pointerEvent));
+                    pointerMoveEvent.setUs(libinput_event_pointer_get_time_usec(pointerEvent));
+                    pointerMoveEvent.setCoalescedEvents(pointerMoveEvent.coalescedEvents() + 1);
+                    break;
+                }
+
+                if (pendingMotion)
+                    notifyPendingMotion();
+
                 pointerMoveEvent.setDevice(inputDevice);
                 pointerMoveEvent.setDx(libinput_event_pointer_get_dx(pointerEvent));
                 pointerMoveEvent.setDy(libinput_event_pointer_get_dy(pointerEvent));
@@ -163,6 +495,14 @@ public:
                 pointerMoveEvent.setDyUnaccelerated(libinput_event_pointer_get_dy_unaccelerated(pointerEvent));
                 pointerMoveEvent.setMs(libinput_event_pointer_get_time(pointerEvent));
                 pointerMoveEvent.setUs(libinput_event_pointer_get_time_usec(pointerEvent));
+                pointerMoveEvent.setCoalescedEvents(1);
+
+                if (coalesce)
+                {
+                    pendingMotion = true;
+                    break;
+                }
+
                 pointerMoveEvent.setSerial(LTime::nextSerial());
                 pointerMoveEvent.notify();
                 break;
@@ -188,6 +528,7 @@ public:
                 pointerMoveEvent.setDy(dy);
                 pointerMoveEvent.setDxUnaccelerated(dx);
                 pointerMoveEvent.setDyUnaccelerated(dy);
+                pointerMoveEvent.setCoalescedEvents(1);
                 pointerMoveEvent.setMs(libinput_event_pointer_get_time(pointerEvent));
                 pointerMoveEvent.setUs(libinput_event_pointer_get_time_usec(pointerEvent));
                 pointerMoveEvent.setSerial(LTime::nextSerial());
@@ -463,14 +804,20 @@ public:
                 inputDevice->m_vendorId = libinput_device_get_id_vendor(dev);
                 inputDevice->m_productId = libinput_device_get_id_product(dev);
                 pluggedDevices.push_back(inputDevice);
+
+                // Users usually configure the device here
+                lockContext();
                 inputDevice->notifyPlugged();
+                unlockContext();
                 break;
             case LIBINPUT_EVENT_DEVICE_REMOVED:
                 dev = libinput_event_get_device(ev);
                 inputDevice = (LInputDevice*)libinput_device_get_user_data(dev);
                 LVectorRemoveOneUnordered(pluggedDevices, inputDevice);
                 unpluggedDevices.push_back(inputDevice);
+                lockContext();
                 inputDevice->notifyUnplugged();
+                unlockContext();
                 inputDevice->m_nativeHandle = nullptr;
                 break;
             default:
@@ -478,12 +825,22 @@ public:
             }
 
             seat()->nativeInputEvent(ev);
-            libinput_event_destroy(ev);
+            releaseEvent();
         }
 
+        if (pendingMotion)
+            notifyPendingMotion();
+
         return 0;
     }
 
+    static void notifyPendingMotion()
+    {
+        pendingMotion = false;
+        pointerMoveEvent.setSerial(LTime::nextSerial());
+        pointerMoveEvent.notify();
+    }
+
     static UInt32 backendGetId()
     {
         return LInputBackendLibinput;
@@ -523,6 +880,25 @@ public:
         else
             libinput_udev_assign_seat(li, "seat0");
 
+        if (getenv("LOUVRE_INPUT_THREAD") && atoi(getenv("LOUVRE_INPUT_THREAD")) == 1)
+        {
+            queueFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            exitFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+            if (queueFd >= 0 && exitFd >= 0)
+            {
+                threaded = true;
+                inputThreadExit.store(false);
+                inputThreadFinished.store(false);
+                inputThread = std::thread(&LInputBackend::inputThreadLoop);
+                eventSource = LCompositor::addFdListener(queueFd, (LSeat*)seat, &LInputBackend::processInput);
+                return true;
+            }
+
+            LLog::error("[Libinput Backend] Failed to create eventfds, reading input from the main thread.");
+            closeThreadFds();
+        }
+
         fd = libinput_get_fd(li);
         eventSource = LCompositor::addFdListener(fd, (LSeat*)seat, &LInputBackend::processInput);
         return true;
@@ -540,6 +916,45 @@ public:
             eventSource = nullptr;
         }
 
+        if (threaded)
+        {
+            inputThreadExit.store(true);
+            const UInt64 value { 1 };
+            ssize_t n = write(exitFd, &value, sizeof(value));
+            L_UNUSED(n);
+
+            // The input thread could be waiting for a device request
+            {
+                std::unique_lock<std::mutex> lock { contextMutex };
+
+                while (!inputThreadFinished.load())
+                {
+                    if (deviceRequest.pending)
+                        processDeviceRequestLocked();
+                    else
+                        contextCond.wait(lock);
+                }
+            }
+
+            inputThread.join();
+            threaded = false;
+
+            QUEUED_EVENT queued;
+
+            while (eventQueue.pop(queued))
+                libinput_event_destroy(queued.ev);
+
+            while (processedQueue.pop(ev))
+                libinput_event_destroy(ev);
+
+            unprocessedMotion.clear();
+            queuedEvents = destroyedEvents = 0;
+            closeThreadFds();
+
+            if (cursor())
+                cursor()->imp()->hwStateSharing = false;
+        }
+
         // Only delete devices, do not notify
         while (!pluggedDevices.empty())
         {
@@ -566,15 +981,36 @@ public:
         }
     }
 
+    static void closeThreadFds()
+    {
+        if (queueFd >= 0)
+        {
+            close(queueFd);
+            queueFd = -1;
+        }
+
+        if (exitFd >= 0)
+        {
+            close(exitFd);
+            exitFd = -1;
+        }
+    }
+
     static void backendSuspend()
     {
+        lockContext();
         libinput_suspend(li);
+        unlockContext();
     }
 
     static void backendResume()
     {
+        lockContext();
+
         if (libinput_resume(li) == -1)
             LLog::error("[Libinput Backend] Failed to resume libinput.");
+
+        unlockContext();
     }
 
     static void backendForceUpdate()
@@ -584,8 +1020,12 @@ public:
 
     static void backendSetLeds(UInt32 leds)
     {
+        lockContext();
+
         for (auto device : pluggedDevices)
             libinput_device_led_update((libinput_device*)device->m_nativeHandle, (libinput_led)leds);
+
+        unlockContext();
     }
 };
 
@@ -0,0 +1,176 @@
+#include <private/LSpatialIndex.h>
+#include <LRegion.h>
+#include <LLog.h>
+#include <chrono>
+#include <random>
+#include <list>
+
+/*
+ * This benchmark measures the cost of hit-testing a point against an increasing number of surfaces,
+ * comparing the linear back-to-front walk previously used by LPointer::surfaceAt() and LScene::viewAt()
+ * against the LSpatialIndex grid.
+ *
+ * Surfaces are randomly placed on a 3840x2160 area, each with an input region of 1 to 4 rects.
+ * Reported values are averages:
+ *
+ * - linear:  Time per query walking all surfaces.
+ * - indexed: Time per query using the index (exact test included).
+ * - rebuild: Time to fill the index from scratch.
+ * - move:    Time to update the bounds of a single moved surface, the usual incremental update.
+ * - tested:  Average number of surfaces exactly tested per indexed query.
+ */
+
+using namespace Louvre;
+using Clock = std::chrono::steady_clock;
+
+#define QUERIES 100000
+#define REBUILDS 1000
+#define MOVES 100000
+
+static const Int32 surfaceCounts[] { 10, 50, 100, 200, 500, 1000, 2000 };
+
+struct Surface
+{
+    LPoint pos;
+    LRegion inputRegion;
+};
+
+static void buildSurfaces(std::list<Surface> &surfaces, Int32 n, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<Int32> posX { -200, 3840 }, posY { -200, 2160 };
+    std::uniform_int_distribution<Int32> size { 16, 1200 }, rects { 1, 4 };
+
+    surfaces.clear();
+
+    for (Int32 i = 0; i < n; i++)
+    {
+        Surface &s { surfaces.emplace_back() };
+        s.pos = LPoint(posX(rng), posY(rng));
+        const Int32 w { size(rng) }, h { size(rng) };
+        const Int32 count { rects(rng) };
+
+        // Similar to the input region of a window with client side decorations
+        for (Int32 r = 0; r < count; r++)
+            s.inputRegion.addRect(r * 4, r * 4, w - r * 8, h - r * 8);
+    }
+}
+
+static LBox surfaceBox(const Surface &s, const LPoint &offset = LPoint())
+{
+    const LBox &ext { s.inputRegion.extents() };
+    const LPoint pos { s.pos + offset };
+    return { ext.x1 + pos.x(), ext.y1 + pos.y(), ext.x2 + pos.x(), ext.y2 + pos.y() };
+}
+
+static void buildIndex(LSpatialIndex<const Surface*> &index, const std::list<Surface> &surfaces)
+{
+    index.clear();
+    UInt64 order { 0 };
+
+    for (const Surface &s : surfaces)
+    {
+        index.setOrder(&s, ++order);
+        index.update(&s, surfaceBox(s));
+    }
+}
+
+int main()
+{
+    LLog::init();
+
+    std::mt19937 rng { 1234 };
+    std::uniform_int_distribution<Int32> pointX { 0, 3839 }, pointY { 0, 2159 };
+    std::vector<LPoint> points;
+    std::vector<const Surface*> candidates;
+    std::vector<const Surface*> linearResults;
+    std::list<Surface> surfaces;
+    LSpatialIndex<const Surface*> index;
+
+    for (Int32 i = 0; i < QUERIES; i++)
+        points.emplace_back(pointX(rng), pointY(rng));
+
+    for (Int32 n : surfaceCounts)
+    {
+        buildSurfaces(surfaces, n, rng);
+
+        // Linear walk
+        linearResults.assign(points.size(), nullptr);
+        auto begin { Clock::now() };
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            for (auto s = surfaces.crbegin(); s != surfaces.crend(); s++)
+            {
+                if (s->inputRegion.containsPoint(points[i] - s->pos))
+                {
+                    linearResults[i] = &(*s);
+                    break;
+                }
+            }
+        }
+
+        const Float64 linear { std::chrono::duration<Float64, std::nano>(Clock::now() - begin).count() / QUERIES };
+
+        // Index rebuild
+        begin = Clock::now();
+
+        for (Int32 i = 0; i < REBUILDS; i++)
+            buildIndex(index, surfaces);
+
+        const Float64 rebuild { std::chrono::duration<Float64, std::micro>(Clock::now() - begin).count() / REBUILDS };
+
+        // Incremental moves, each surface is moved and then restored
+        std::vector<const Surface*> movable;
+
+        for (const Surface &s : surfaces)
+            movable.push_back(&s);
+
+        std::uniform_int_distribution<size_t> pick { 0, movable.size() - 1 };
+        std::uniform_int_distribution<Int32> delta { -300, 300 };
+        begin = Clock::now();
+
+        for (Int32 i = 0; i < MOVES / 2; i++)
+        {
+            const Surface *s { movable[pick(rng)] };
+            index.update(s, surfaceBox(*s, LPoint(delta(rng), delta(rng))));
+            index.update(s, surfaceBox(*s));
+        }
+
+        const Float64 move { std::chrono::duration<Float64, std::nano>(Clock::now() - begin).count() / MOVES };
+
+        // Indexed
+        UInt64 mismatches { 0 };
+        UInt64 tested { 0 };
+        begin = Clock::now();
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const Surface *result { nullptr };
+            index.query(points[i], candidates);
+
+            for (const Surface *s : candidates)
+            {
+                tested++;
+
+                if (s->inputRegion.containsPoint(points[i] - s->pos))
+                {
+                    result = s;
+                    break;
+                }
+            }
+
+            if (result != linearResults[i])
+                mismatches++;
+        }
+
+        const Float64 indexed { std::chrono::duration<Float64, std::nano>(Clock::now() - begin).count() / QUERIES };
+
+        if (mismatches != 0)
+            LLog::error("[louvre-bench-hittest] %lu indexed queries returned a different surface.", (unsigned long)mismatches);
+
+        LLog::log("surfaces: %5d linear: %9.1f ns indexed: %7.1f ns rebuild: %8.2f us move: %7.1f ns tested: %5.2f",
+                  n, linear, indexed, rebuild, move, Float64(tested) / QUERIES);
+    }
+
+    return 0;
+}
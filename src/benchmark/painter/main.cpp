@@ -0,0 +1,161 @@
+#include <private/LPainterPrivate.h>
+#include <LCompositor.h>
+#include <LOutput.h>
+#include <LPainter.h>
+#include <LTexture.h>
+#include <LRegion.h>
+#include <LLog.h>
+#include <chrono>
+
+/*
+ * This benchmark measures the cost of LPainter::drawRegion() for regions with an increasing number of boxes,
+ * comparing the per-box path (one viewport change and draw call per box) against the batched path.
+ *
+ * It runs once on the first output that is repainted, prints the results and then exits.
+ * Reported values are averages per frame:
+ *
+ * - calls: Number of draw calls.
+ * - cpu:   Time spent submitting the draw calls.
+ * - total: Submission time plus glFinish(), which includes the GPU work.
+ */
+
+using namespace Louvre;
+using Clock = std::chrono::steady_clock;
+
+#define FRAMES 100
+
+static const Int32 boxCounts[] { 1, 4, 16, 64, 256, 1024, 4096 };
+
+static UInt8 pixels[]
+{
+    0, 0, 255, 255,
+    0, 255, 0, 255,
+    255, 0, 0, 255,
+    255, 255, 255, 255
+};
+
+/* Builds a region of n 4x4 boxes separated by 1px gaps so that pixman can't merge them */
+static void buildRegion(LRegion &region, const LRect &bounds, Int32 n)
+{
+    region.clear();
+    const Int32 cols { bounds.w() / 5 };
+
+    for (Int32 i = 0; i < n; i++)
+        region.addRect(bounds.x() + (i % cols) * 5, bounds.y() + (i / cols) * 5, 4, 4);
+}
+
+class Output final : public LOutput
+{
+public:
+    using LOutput::LOutput;
+
+    void initializeGL() override
+    {
+        texture.setDataFromMainMemory(LSize(2, 2), 2 * 4, DRM_FORMAT_ARGB8888, pixels);
+        painter()->setClearColor(0.f, 0.f, 0.f, 1.f);
+        repaint();
+    }
+
+    void bench(bool textureMode, bool batching)
+    {
+        LPainter &p { *painter() };
+        LRegion region;
+
+        p.enableRegionBatching(batching);
+
+        for (Int32 n : boxCounts)
+        {
+            Int32 boxes;
+            buildRegion(region, rect(), n);
+            region.boxes(&boxes);
+
+            if (textureMode)
+            {
+                p.bindTextureMode({
+                    .texture = &texture,
+                    .pos = pos(),
+                    .srcRect = LRectF(0.f, 0.f, 2.f, 2.f),
+                    .dstSize = size(),
+                    .srcTransform = LTransform::Normal,
+                    .srcScale = 1.f
+                });
+            }
+            else
+            {
+                p.bindColorMode();
+                p.setColor({1.f, 0.f, 0.f});
+            }
+
+            // Warm up
+            p.drawRegion(region);
+            glFinish();
+
+            const UInt64 prevDrawCalls { p.imp()->drawCalls };
+            const auto begin { Clock::now() };
+
+            for (Int32 i = 0; i < FRAMES; i++)
+                p.drawRegion(region);
+
+            const auto submitted { Clock::now() };
+            glFinish();
+            const auto finished { Clock::now() };
+
+            const Float64 cpu { std::chrono::duration<Float64, std::micro>(submitted - begin).count() / FRAMES };
+            const Float64 total { std::chrono::duration<Float64, std::micro>(finished - begin).count() / FRAMES };
+
+            LLog::log("[%s %s] boxes: %5d calls: %5lu cpu: %9.2f us total: %9.2f us",
+                textureMode ? "texture" : "color  ",
+                batching ? "batched" : "per-box",
+                boxes,
+                (unsigned long)(p.imp()->drawCalls - prevDrawCalls) / FRAMES,
+                cpu, total);
+        }
+    }
+
+    void paintGL() override
+    {
+        if (done)
+            return;
+
+        done = true;
+        painter()->clearScreen();
+
+        for (bool textureMode : { false, true })
+            for (bool batching : { false, true })
+                bench(textureMode, batching);
+
+        painter()->enableRegionBatching(true);
+        compositor()->finish();
+    }
+
+    LTexture texture;
+    bool done { false };
+};
+
+class Compositor final : public LCompositor
+{
+public:
+    /* Deny access to all protocol */
+    bool globalsFilter(LClient */*client*/, LGlobal */*global*/) override { return false; }
+
+    LFactoryObject *createObjectRequest(LFactoryObject::Type objectType, const void *params) override
+    {
+        if (objectType == LFactoryObject::Type::LOutput)
+            return new Output(params);
+
+        return nullptr;
+    }
+};
+
+int main()
+{
+    LLog::init();
+
+    Compositor compositor;
+    compositor.start();
+
+    while (compositor.state() != LCompositor::Uninitialized)
+        compositor.processLoop(-1);
+
+    return 0;
+}
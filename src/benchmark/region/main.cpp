@@ -0,0 +1,376 @@
+/* Microbenchmark of the region operations LSceneView::calcNewDamage() performs for each view.
+ *
+ * The same scene is processed with the previous approach (Pixman operations done in place and temporary
+ * regions for the clipping) and with the current one (LRegion and single box clipping), reporting the
+ * number of heap allocations and the time spent per view. */
+
+#include <LRegion.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Louvre;
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+
+    static UInt64 allocations { 0 };
+
+    void *malloc(size_t size)
+    {
+        allocations++;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size)
+    {
+        allocations++;
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        allocations++;
+        return __libc_realloc(ptr, size);
+    }
+}
+
+static constexpr Int32 SceneW { 1920 };
+static constexpr Int32 SceneH { 1080 };
+
+struct View
+{
+    LRect rect;
+    LPoint velocity;
+    bool moving;
+    bool translucent;
+};
+
+// Scene state kept between frames by each approach
+struct LegacyState
+{
+    std::vector<pixman_region32_t> prevClipping;
+    std::vector<LBox> prevClippingBox;
+    pixman_region32_t newDamage, opaqueSum, damage, opaque;
+};
+
+struct CurrentState
+{
+    std::vector<LRegion> prevClipping;
+    std::vector<LBox> prevClippingBox;
+    LRegion newDamage, opaqueSum, damage, opaque;
+};
+
+static UInt32 randomSeed { 1 };
+
+static Int32 nextRandom(Int32 max)
+{
+    randomSeed = randomSeed * 1103515245 + 12345;
+    return (randomSeed >> 16) % max;
+}
+
+static LBox clippingBoxOf(const LRect &rect)
+{
+    LBox box { std::max(rect.x(), 0), std::max(rect.y(), 0), std::min(rect.x() + rect.w(), SceneW), std::min(rect.y() + rect.h(), SceneH) };
+
+    if (box.x1 >= box.x2 || box.y1 >= box.y2)
+        box = { 0, 0, 0, 0 };
+
+    return box;
+}
+
+static bool boxEqual(const LBox &a, const LBox &b)
+{
+    return a.x1 == b.x1 && a.y1 == b.y1 && a.x2 == b.x2 && a.y2 == b.y2;
+}
+
+// Same as LSceneView::addBoxDifference()
+static void addBoxDifference(LRegion &region, const LBox &a, const LBox &b)
+{
+    if (a.x1 >= a.x2 || a.y1 >= a.y2)
+        return;
+
+    if (b.x1 >= b.x2 || b.y1 >= b.y2 || a.x2 <= b.x1 || b.x2 <= a.x1 || a.y2 <= b.y1 || b.y2 <= a.y1)
+    {
+        region.addRect(a.x1, a.y1, a.x2 - a.x1, a.y2 - a.y1);
+        return;
+    }
+
+    const Int32 y1 { std::max(a.y1, b.y1) };
+    const Int32 y2 { std::min(a.y2, b.y2) };
+
+    if (a.y1 < y1)
+        region.addRect(a.x1, a.y1, a.x2 - a.x1, y1 - a.y1);
+
+    if (y2 < a.y2)
+        region.addRect(a.x1, y2, a.x2 - a.x1, a.y2 - y2);
+
+    if (a.x1 < b.x1)
+        region.addRect(a.x1, y1, b.x1 - a.x1, y2 - y1);
+
+    if (b.x2 < a.x2)
+        region.addRect(b.x2, y1, a.x2 - b.x2, y2 - y1);
+}
+
+static void moveViews(std::vector<View> &views)
+{
+    for (View &view : views)
+    {
+        if (!view.moving)
+            continue;
+
+        LPoint pos { view.rect.pos() + view.velocity };
+
+        if (pos.x() < -view.rect.w() / 2 || pos.x() > SceneW - view.rect.w() / 2)
+            view.velocity.setX(-view.velocity.x());
+
+        if (pos.y() < -view.rect.h() / 2 || pos.y() > SceneH - view.rect.h() / 2)
+            view.velocity.setY(-view.velocity.y());
+
+        view.rect.setPos(view.rect.pos() + view.velocity);
+    }
+}
+
+// Damage of each view, either the whole rect if moved or a few small rects every few frames
+static void viewDamage(const View &view, UInt32 frame, UInt32 index, LBox *boxes, Int32 *n)
+{
+    *n = 0;
+
+    if (view.moving)
+    {
+        boxes[(*n)++] = { view.rect.x(), view.rect.y(), view.rect.x() + view.rect.w(), view.rect.y() + view.rect.h() };
+        return;
+    }
+
+    if ((frame + index) % 4 != 0)
+        return;
+
+    const Int32 w { view.rect.w() / 4 };
+    const Int32 h { view.rect.h() / 4 };
+    boxes[(*n)++] = { view.rect.x(), view.rect.y(), view.rect.x() + w, view.rect.y() + h };
+    boxes[(*n)++] = { view.rect.x() + 2 * w, view.rect.y() + 2 * h, view.rect.x() + 3 * w, view.rect.y() + 3 * h };
+}
+
+static void legacyFrame(const std::vector<View> &views, LegacyState &state, UInt32 frame)
+{
+    pixman_region32_t &opaqueSum { state.opaqueSum }, &damage { state.damage }, &opaque { state.opaque };
+    pixman_region32_clear(&opaqueSum);
+    pixman_region32_clear(&state.newDamage);
+
+    for (Int32 i = views.size() - 1; i >= 0; i--)
+    {
+        const View &view { views[i] };
+        LBox boxes[2];
+        Int32 n;
+        viewDamage(view, frame, i, boxes, &n);
+
+        pixman_region32_clear(&damage);
+
+        for (Int32 j = 0; j < n; j++)
+            pixman_region32_union_rect(&damage, &damage, boxes[j].x1, boxes[j].y1, boxes[j].x2 - boxes[j].x1, boxes[j].y2 - boxes[j].y1);
+
+        const LBox clippingBox { clippingBoxOf(view.rect) };
+
+        if (!boxEqual(clippingBox, state.prevClippingBox[i]))
+        {
+            pixman_region32_t currentClipping, newExposedClipping;
+            pixman_region32_init(&currentClipping);
+            pixman_region32_init(&newExposedClipping);
+
+            if (clippingBox.x1 < clippingBox.x2)
+                pixman_region32_union_rect(&currentClipping, &currentClipping, clippingBox.x1, clippingBox.y1, clippingBox.x2 - clippingBox.x1, clippingBox.y2 - clippingBox.y1);
+
+            pixman_region32_subtract(&newExposedClipping, &currentClipping, &state.prevClipping[i]);
+            pixman_region32_union(&damage, &damage, &newExposedClipping);
+            pixman_region32_subtract(&state.prevClipping[i], &state.prevClipping[i], &currentClipping);
+            pixman_region32_union(&state.newDamage, &state.newDamage, &state.prevClipping[i]);
+            pixman_region32_fini(&state.prevClipping[i]);
+            state.prevClipping[i] = currentClipping;
+            state.prevClippingBox[i] = clippingBox;
+            pixman_region32_fini(&newExposedClipping);
+        }
+
+        pixman_region32_intersect(&damage, &damage, &state.prevClipping[i]);
+        pixman_region32_subtract(&damage, &damage, &opaqueSum);
+        pixman_region32_union(&state.newDamage, &state.newDamage, &damage);
+
+        if (!view.translucent)
+        {
+            pixman_region32_copy(&opaque, &state.prevClipping[i]);
+            pixman_region32_union(&opaqueSum, &opaqueSum, &opaque);
+        }
+    }
+}
+
+static void currentFrame(const std::vector<View> &views, CurrentState &state, UInt32 frame)
+{
+    LRegion &opaqueSum { state.opaqueSum }, &damage { state.damage }, &opaque { state.opaque };
+    opaqueSum.clear();
+    state.newDamage.clear();
+
+    for (Int32 i = views.size() - 1; i >= 0; i--)
+    {
+        const View &view { views[i] };
+        LBox boxes[2];
+        Int32 n;
+        viewDamage(view, frame, i, boxes, &n);
+
+        damage.clear();
+
+        for (Int32 j = 0; j < n; j++)
+            damage.addRect(boxes[j].x1, boxes[j].y1, boxes[j].x2 - boxes[j].x1, boxes[j].y2 - boxes[j].y1);
+
+        const LBox clippingBox { clippingBoxOf(view.rect) };
+
+        if (!boxEqual(clippingBox, state.prevClippingBox[i]))
+        {
+            addBoxDifference(damage, clippingBox, state.prevClippingBox[i]);
+            addBoxDifference(state.newDamage, state.prevClippingBox[i], clippingBox);
+            state.prevClipping[i].clear();
+
+            if (clippingBox.x1 < clippingBox.x2)
+                state.prevClipping[i].addRect(clippingBox.x1, clippingBox.y1, clippingBox.x2 - clippingBox.x1, clippingBox.y2 - clippingBox.y1);
+
+            state.prevClippingBox[i] = clippingBox;
+        }
+
+        damage.intersectRegion(state.prevClipping[i]);
+        damage.subtractRegion(opaqueSum);
+        state.newDamage.addRegion(damage);
+
+        if (!view.translucent)
+        {
+            opaque = state.prevClipping[i];
+            opaqueSum.addRegion(opaque);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    UInt32 viewsCount { 200 };
+    UInt32 frames { 2000 };
+    bool json { false };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+            viewsCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            randomSeed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--views N] [--frames N] [--seed N] [--json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (viewsCount == 0 || frames == 0)
+        return 1;
+
+    std::vector<View> initialViews;
+    initialViews.reserve(viewsCount);
+
+    for (UInt32 i = 0; i < viewsCount; i++)
+    {
+        View view;
+        view.rect = LRect(nextRandom(SceneW), nextRandom(SceneH), 32 + nextRandom(480), 32 + nextRandom(360));
+        view.velocity = LPoint(1 + nextRandom(8), 1 + nextRandom(8));
+        view.moving = nextRandom(4) == 0;
+        view.translucent = nextRandom(3) == 0;
+        initialViews.push_back(view);
+    }
+
+    LegacyState legacy;
+    legacy.prevClipping.resize(viewsCount);
+    legacy.prevClippingBox.resize(viewsCount, { 0, 0, 0, 0 });
+
+    for (pixman_region32_t *region : { &legacy.newDamage, &legacy.opaqueSum, &legacy.damage, &legacy.opaque })
+        pixman_region32_init(region);
+
+    for (pixman_region32_t &region : legacy.prevClipping)
+        pixman_region32_init(&region);
+
+    CurrentState current;
+    current.prevClipping.resize(viewsCount);
+    current.prevClippingBox.resize(viewsCount, { 0, 0, 0, 0 });
+
+    struct Result
+    {
+        const char *name;
+        Float64 mallocsPerView;
+        Float64 nsPerView;
+    } results[2];
+
+    for (Int32 mode = 0; mode < 2; mode++)
+    {
+        std::vector<View> views { initialViews };
+
+        // The first frame populates the state of each view, only the steady state is measured
+        if (mode == 0)
+            legacyFrame(views, legacy, 0);
+        else
+            currentFrame(views, current, 0);
+
+        const UInt64 allocationsBefore { allocations };
+        const auto start { std::chrono::steady_clock::now() };
+
+        for (UInt32 frame = 1; frame <= frames; frame++)
+        {
+            moveViews(views);
+
+            if (mode == 0)
+                legacyFrame(views, legacy, frame);
+            else
+                currentFrame(views, current, frame);
+        }
+
+        const auto end { std::chrono::steady_clock::now() };
+        const Float64 count { Float64(frames) * Float64(viewsCount) };
+        results[mode].name = mode == 0 ? "before" : "after";
+        results[mode].mallocsPerView = Float64(allocations - allocationsBefore) / count;
+        results[mode].nsPerView = Float64(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / count;
+    }
+
+    // Both approaches must produce the same damage
+    const bool equal { pixman_region32_equal(&legacy.newDamage, &current.newDamage.m_region) != 0 };
+
+    if (json)
+    {
+        printf("{\n  \"views\": %u,\n  \"frames\": %u,\n  \"equal_damage\": %s,\n", viewsCount, frames, equal ? "true" : "false");
+
+        for (Int32 i = 0; i < 2; i++)
+            printf("  \"%s\": { \"mallocs_per_view\": %.3f, \"ns_per_view\": %.1f }%s\n",
+                   results[i].name, results[i].mallocsPerView, results[i].nsPerView, i == 0 ? "," : "");
+
+        printf("}\n");
+    }
+    else
+    {
+        printf("%u views, %u frames\n\n", viewsCount, frames);
+        printf("%-8s %16s %12s\n", "", "mallocs/view", "ns/view");
+
+        for (Int32 i = 0; i < 2; i++)
+            printf("%-8s %16.3f %12.1f\n", results[i].name, results[i].mallocsPerView, results[i].nsPerView);
+
+        if (!equal)
+            printf("\nWarning: the damage calculated by both approaches differs.\n");
+    }
+
+    for (pixman_region32_t &region : legacy.prevClipping)
+        pixman_region32_fini(&region);
+
+    for (pixman_region32_t *region : { &legacy.newDamage, &legacy.opaqueSum, &legacy.damage, &legacy.opaque })
+        pixman_region32_fini(region);
+
+    return equal ? 0 : 2;
+}
@@ -0,0 +1,380 @@
+#!/usr/bin/env python3
+"""
+Runs the louvre-bench-client scenarios against a Louvre compositor using the headless backends
+and prints the results as JSON. See ../README.md for details.
+"""
+
+import argparse
+import json
+import math
+import os
+import shutil
+import signal
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+SCENARIOS = [
+    'static-subsurfaces',
+    'damaged-subsurface',
+    'fragmented-damage',
+    'popups',
+    'shm-4k',
+    'dmabuf',
+    'many-clients',
+    'pointer-motion',
+]
+
+COMPOSITORS = ['louvre-weston-clone', 'louvre-views', 'louvre-default']
+
+# Lower is better, compared against the baseline with --baseline
+GATED_METRICS = [
+    'cpu_ms_per_frame',
+    'frame_time_ms.p50',
+    'frame_time_ms.p99',
+    'draw_calls.mean',
+    'peak_rss_kib',
+]
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Must match src/lib/core/private/LInputRecording.h
+RECORD_MAGIC = b'LVRINPUT'
+RECORD_VERSION = 1
+RECORD_FORMAT = '=BBBBHHIIQ6f'
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+POINTER_MOVE = (0, 4)  # LEvent::Type::Pointer, LEvent::Subtype::Move
+DEVICE_NAME = b'louvre-bench pointer'
+
+
+def log(msg):
+    print(msg, file=sys.stderr, flush=True)
+
+
+def find_executable(name, build_subdir):
+    built = os.path.join(SCRIPT_DIR, build_subdir, name)
+
+    if os.access(built, os.X_OK):
+        return built
+
+    return shutil.which(name)
+
+
+def write_pointer_recording(path, duration_ms, rate_hz=1000, radius=300.0):
+    """Circular motion at rate_hz, for the headless input backend (LOUVRE_INPUT_REPLAY)."""
+    with open(path, 'wb') as f:
+        f.write(struct.pack('=8sII', RECORD_MAGIC, RECORD_VERSION, RECORD_SIZE))
+        # Device record: capabilities = Pointer, vendor and product 0
+        f.write(struct.pack(RECORD_FORMAT, 0, 0, 0, 0, 0, len(DEVICE_NAME), 1 << 0, 0, 0, 0, 0, 0, 0, 0, 0))
+        f.write(DEVICE_NAME)
+
+        count = duration_ms * rate_hz // 1000
+        step_us = 1000000 // rate_hz
+        prev_x, prev_y = radius, 0.0
+
+        for i in range(1, count + 1):
+            angle = 2.0 * math.pi * i / rate_hz  # One turn per second
+            x, y = radius * math.cos(angle), radius * math.sin(angle)
+            dx, dy = x - prev_x, y - prev_y
+            prev_x, prev_y = x, y
+            us = i * step_us
+            f.write(struct.pack(RECORD_FORMAT, 1, POINTER_MOVE[0], POINTER_MOVE[1], 0, 0, 0, 1,
+                                (us // 1000) & 0xFFFFFFFF, us, dx, dy, dx, dy, 0, 0))
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+
+    values = sorted(values)
+    k = (len(values) - 1) * p / 100.0
+    lo, hi = math.floor(k), math.ceil(k)
+    return values[lo] + (values[hi] - values[lo]) * (k - lo)
+
+
+def summary(values):
+    if not values:
+        return {'mean': 0.0, 'p50': 0.0, 'p90': 0.0, 'p99': 0.0, 'max': 0.0}
+
+    return {
+        'mean': round(sum(values) / len(values), 4),
+        'p50': round(percentile(values, 50), 4),
+        'p90': round(percentile(values, 90), 4),
+        'p99': round(percentile(values, 99), 4),
+        'max': round(max(values), 4),
+    }
+
+
+def proc_cpu_ms(pid):
+    with open(f'/proc/{pid}/stat') as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+
+    # utime and stime, fields 14 and 15
+    ticks = int(fields[11]) + int(fields[12])
+    return 1000.0 * ticks / os.sysconf('SC_CLK_TCK')
+
+
+def proc_memory_kib(pid):
+    mem = {}
+
+    with open(f'/proc/{pid}/status') as f:
+        for line in f:
+            key, _, value = line.partition(':')
+
+            if key in ('VmRSS', 'VmHWM'):
+                mem[key] = int(value.split()[0])
+
+    return mem.get('VmRSS', 0), mem.get('VmHWM', 0)
+
+
+def frames_from_trace(path, begin_us, end_us):
+    with open(path) as f:
+        events = json.load(f)['traceEvents']
+
+    return [e for e in events if e.get('name') == 'paintGL' and begin_us <= e['ts'] <= end_us]
+
+
+def run_scenario(args, scenario, index):
+    tmp = tempfile.mkdtemp(prefix='louvre-bench-')
+    socket = f'louvre-bench-{os.getpid()}-{index}'
+    runtime_dir = os.environ.get('XDG_RUNTIME_DIR') or tmp
+    trace = os.path.join(tmp, 'trace.json')
+
+    env = dict(os.environ)
+    env.update({
+        'XDG_RUNTIME_DIR': runtime_dir,
+        'LOUVRE_WAYLAND_DISPLAY': socket,
+        'LOUVRE_GRAPHIC_BACKEND': 'headless',
+        'LOUVRE_INPUT_BACKEND': 'headless',
+        'LOUVRE_HEADLESS_MODES': args.mode,
+        'LOUVRE_FRAME_TRACE': trace,
+    })
+    env.pop('WAYLAND_DISPLAY', None)
+
+    if args.unthrottled:
+        env['LOUVRE_HEADLESS_VIRTUAL_CLOCK'] = '1'
+
+    if args.software:
+        env['LIBGL_ALWAYS_SOFTWARE'] = '1'
+        env['GALLIUM_DRIVER'] = 'llvmpipe'
+
+    if scenario == 'pointer-motion':
+        recording = os.path.join(tmp, 'pointer.rec')
+        write_pointer_recording(recording, args.duration + 2 * args.startup)
+        env['LOUVRE_INPUT_REPLAY'] = recording
+        env['LOUVRE_INPUT_REPLAY_DELAY'] = str(args.startup)
+
+    compositor = subprocess.Popen([args.compositor], env=env, stdout=subprocess.DEVNULL,
+                                  stderr=None if args.verbose else subprocess.DEVNULL)
+    socket_path = os.path.join(runtime_dir, socket)
+    deadline = time.monotonic() + 10.0
+
+    while not os.path.exists(socket_path):
+        if compositor.poll() is not None or time.monotonic() > deadline:
+            compositor.kill()
+            shutil.rmtree(tmp, ignore_errors=True)
+            return {'error': 'the compositor failed to start'}
+
+        time.sleep(0.05)
+
+    # Let the compositor paint its first frames
+    time.sleep(args.startup / 1000.0)
+
+    client_env = dict(env)
+    client_env['WAYLAND_DISPLAY'] = socket
+    cpu_begin = proc_cpu_ms(compositor.pid)
+    begin_us = time.monotonic_ns() / 1000.0
+    cmd = [args.client, scenario, str(args.duration), str(args.count), str(args.seed)]
+
+    try:
+        client = subprocess.run(cmd, env=client_env, capture_output=True, text=True,
+                                timeout=args.duration / 1000.0 + 60.0)
+    except subprocess.TimeoutExpired:
+        compositor.kill()
+        shutil.rmtree(tmp, ignore_errors=True)
+        return {'error': 'the client timed out'}
+
+    end_us = time.monotonic_ns() / 1000.0
+    cpu_ms = proc_cpu_ms(compositor.pid) - cpu_begin
+    rss, peak_rss = proc_memory_kib(compositor.pid)
+
+    compositor.send_signal(signal.SIGTERM)
+
+    try:
+        compositor.wait(timeout=10.0)
+    except subprocess.TimeoutExpired:
+        compositor.kill()
+
+    try:
+        client_result = json.loads(client.stdout.strip().splitlines()[-1])
+    except (IndexError, ValueError):
+        shutil.rmtree(tmp, ignore_errors=True)
+        return {'error': f'the client failed: {client.stderr.strip()}'}
+
+    if 'skipped' in client_result:
+        shutil.rmtree(tmp, ignore_errors=True)
+        return client_result
+
+    try:
+        frames = frames_from_trace(trace, begin_us, end_us)
+    except (OSError, ValueError, KeyError):
+        frames = []
+
+    shutil.rmtree(tmp, ignore_errors=True)
+
+    if not frames:
+        return {'error': 'no frames found in the frame trace', 'client': client_result}
+
+    args_of = [f['args'] for f in frames]
+    duration_s = (end_us - begin_us) / 1000000.0
+
+    # Outputs only keep the last LOutput::frameStatsCapacity() frames, so the rate is taken from the sampled span
+    span_s = (frames[-1]['ts'] - frames[0]['ts']) / 1000000.0
+    fps = (len(frames) - 1) / span_s if len(frames) > 1 and span_s > 0 else len(frames) / duration_s
+    total_frames = max(1, round(fps * duration_s))
+
+    return {
+        'client': client_result,
+        'frames': total_frames,
+        'sampled_frames': len(frames),
+        'fps': round(fps, 2),
+        'cpu_percent': round(100.0 * cpu_ms / (duration_s * 1000.0), 2),
+        'cpu_ms_per_frame': round(cpu_ms / total_frames, 4),
+        'frame_time_ms': summary([f['dur'] / 1000.0 for f in frames]),
+        'draw_ms': summary([a['draw'] / 1000.0 for a in args_of]),
+        'damage_calc_ms': summary([a['damageCalc'] / 1000.0 for a in args_of]),
+        'render_lock_wait_ms': summary([a['renderLockWait'] / 1000.0 for a in args_of]),
+        'draw_calls': summary([float(a['drawCalls']) for a in args_of]),
+        'damage_area': summary([float(a['damageArea']) for a in args_of]),
+        'rss_kib': rss,
+        'peak_rss_kib': peak_rss,
+    }
+
+
+def metric(result, path):
+    value = result
+
+    for key in path.split('.'):
+        if not isinstance(value, dict) or key not in value:
+            return None
+
+        value = value[key]
+
+    return value
+
+
+def compare(results, baseline, tolerance):
+    """Returns the list of regressions of results relative to baseline."""
+    regressions = []
+
+    for scenario, result in results['scenarios'].items():
+        base = baseline.get('scenarios', {}).get(scenario)
+
+        if not base or 'frames' not in base or 'frames' not in result:
+            continue
+
+        for path in GATED_METRICS:
+            old, new = metric(base, path), metric(result, path)
+
+            if old is None or new is None:
+                continue
+
+            # Ignore noise on tiny values
+            if new > old * (1.0 + tolerance) and new - old > 0.01:
+                regressions.append(f'{scenario}: {path} {old} -> {new} (+{100.0 * (new - old) / max(old, 1e-9):.1f}%)')
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Louvre headless benchmark suite.')
+    parser.add_argument('scenarios', nargs='*', default=SCENARIOS, help='Scenarios to run (default: all).')
+    parser.add_argument('--compositor', help='Compositor executable (default: louvre-weston-clone from the build dir or PATH).')
+    parser.add_argument('--client', help='louvre-bench-client executable (default: next to this script or PATH).')
+    parser.add_argument('--duration', type=int, default=5000, help='Duration of each scenario in ms (default: 5000).')
+    parser.add_argument('--startup', type=int, default=500, help='Time given to the compositor and clients to settle in ms (default: 500).')
+    parser.add_argument('--count', type=int, default=0, help='Subsurfaces, damage rects or clients, depending on the scenario (default: per scenario).')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed passed to the client (default: 1).')
+    parser.add_argument('--repeat', type=int, default=1, help='Runs per scenario, the one with the median CPU time per frame is kept (default: 1).')
+    parser.add_argument('--mode', default='1920x1080@60', help='Headless output mode (default: 1920x1080@60).')
+    parser.add_argument('--software', action='store_true', help='Force Mesa software rendering (llvmpipe), for GPU-less machines.')
+    parser.add_argument('--unthrottled', action='store_true', help='Use the headless virtual clock, frames are presented as fast as they are rendered.')
+    parser.add_argument('--output', '-o', help='Write the JSON results to this file instead of stdout.')
+    parser.add_argument('--baseline', help='JSON results of a previous run, exits with 1 if any gated metric regresses.')
+    parser.add_argument('--tolerance', type=float, default=0.10, help='Allowed relative regression when using --baseline (default: 0.10).')
+    parser.add_argument('--verbose', '-v', action='store_true', help='Show the compositor output.')
+    args = parser.parse_args()
+
+    for scenario in args.scenarios:
+        if scenario not in SCENARIOS:
+            parser.error(f'unknown scenario {scenario}, available: {", ".join(SCENARIOS)}')
+
+    if not args.compositor:
+        for name in COMPOSITORS:
+            args.compositor = find_executable(name, os.path.join('..', '..', 'examples', name))
+
+            if args.compositor:
+                break
+
+    if not args.client:
+        args.client = find_executable('louvre-bench-client', '.')
+
+    if not args.compositor or not args.client:
+        parser.error('compositor or louvre-bench-client not found, use --compositor and --client')
+
+    results = {
+        'compositor': os.path.basename(args.compositor),
+        'software_rendering': args.software,
+        'unthrottled': args.unthrottled,
+        'mode': args.mode,
+        'duration_ms': args.duration,
+        'seed': args.seed,
+        'scenarios': {},
+    }
+
+    for i, scenario in enumerate(args.scenarios):
+        runs = []
+
+        for r in range(args.repeat):
+            log(f'[{i + 1}/{len(args.scenarios)}] {scenario} ({r + 1}/{args.repeat})')
+            runs.append(run_scenario(args, scenario, i * args.repeat + r))
+
+            if 'frames' not in runs[-1]:
+                break
+
+        valid = sorted([r for r in runs if 'frames' in r], key=lambda r: r['cpu_ms_per_frame'])
+        results['scenarios'][scenario] = valid[len(valid) // 2] if valid else runs[-1]
+
+        if not valid:
+            log(f'    {json.dumps(runs[-1])}')
+
+    output = json.dumps(results, indent=2)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(output + '\n')
+    else:
+        print(output)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+        regressions = compare(results, baseline, args.tolerance)
+
+        for regression in regressions:
+            log(f'REGRESSION {regression}')
+
+        if regressions:
+            return 1
+
+        log('No regressions found.')
+
+    errors = [s for s, r in results['scenarios'].items() if 'error' in r]
+    return 2 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
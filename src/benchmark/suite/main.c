@@ -0,0 +1,824 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <wayland-client-protocol.h>
+
+#include "shm.h"
+#include "xdg-shell-client-protocol.h"
+
+#ifdef HAVE_DMABUF
+#include <fcntl.h>
+#include <gbm.h>
+#include <drm_fourcc.h>
+#include "linux-dmabuf-v1-client-protocol.h"
+#endif
+
+/*
+ * Benchmark client used by louvre-bench.py, each scenario stresses a different part of the compositor.
+ * Usage: louvre-bench-client <scenario> [duration ms] [count] [seed]
+ * A JSON object with the client side results is printed to stdout once the duration elapses.
+ */
+
+#define MAX_CLIENTS 256
+#define CHILD_SIZE 256
+#define POPUP_W 200
+#define POPUP_H 150
+#define CURSOR_SIZE 24
+
+struct Buffer
+{
+    struct wl_buffer *buffer;
+    uint32_t *data;
+    int width, height;
+#ifdef HAVE_DMABUF
+    struct gbm_bo *bo;
+#endif
+};
+
+struct Client
+{
+    struct wl_display *display;
+    struct wl_compositor *compositor;
+    struct wl_subcompositor *subcompositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm;
+    struct wl_seat *seat;
+    struct wl_pointer *pointer;
+#ifdef HAVE_DMABUF
+    struct zwp_linux_dmabuf_v1 *dmabuf;
+#endif
+    int outputW, outputH;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdgSurface;
+    struct xdg_toplevel *toplevel;
+    int width, height;
+    bool configured;
+
+    struct Buffer buffers[2];
+    uint64_t frames;
+};
+
+struct Child
+{
+    struct wl_surface *surface;
+    struct wl_subsurface *subsurface;
+};
+
+struct Popup
+{
+    struct wl_surface *surface;
+    struct xdg_surface *xdgSurface;
+    struct xdg_popup *popup;
+};
+
+struct Scenario
+{
+    const char *name;
+    int defaultCount;
+    bool maximized;
+    const char *(*init)(void); // Returns a reason if the scenario can't run
+    void (*frame)(struct Client *client);
+};
+
+static struct Client clients[MAX_CLIENTS];
+static int clientsCount = 1;
+static int count;
+static int64_t durationMs = 5000;
+static const struct Scenario *scenario;
+
+static struct Buffer opaqueBuffer, translucentBuffer, topBuffers[2], popupBuffer, cursorBuffer;
+static struct Child *children;
+static struct Child top;
+static struct Popup popup;
+static struct wl_surface *cursorSurface;
+static uint64_t popupsCreated = 0;
+static uint64_t motionEvents = 0;
+
+#ifdef HAVE_DMABUF
+static int drmFd = -1;
+static struct gbm_device *gbm;
+#endif
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint32_t color(uint64_t frame, uint32_t alpha)
+{
+    const float t = (float)frame * 0.05f;
+    const uint32_t r = (sinf(t) + 1.f) * 127.f;
+    const uint32_t g = (cosf(t * 0.7f) + 1.f) * 127.f;
+    const uint32_t b = (cosf(t * 0.3f) + 1.f) * 127.f;
+    return (alpha << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void noop() {}
+
+/* Buffers */
+
+static bool create_shm_buffer(struct Client *client, struct Buffer *buffer, int w, int h)
+{
+    const int stride = w * 4;
+    const int size = stride * h;
+    const int fd = create_shm_file(size);
+
+    if (fd < 0)
+        return false;
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, size);
+    buffer->buffer = wl_shm_pool_create_buffer(pool, 0, w, h, stride, WL_SHM_FORMAT_ARGB8888);
+    buffer->data = data;
+    buffer->width = w;
+    buffer->height = h;
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return true;
+}
+
+static void fill(struct Buffer *buffer, int x, int y, int w, int h, uint32_t pixel)
+{
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > buffer->width) w = buffer->width - x;
+    if (y + h > buffer->height) h = buffer->height - y;
+
+    for (int j = y; j < y + h; j++)
+    {
+        uint32_t *row = buffer->data + j * buffer->width;
+
+        for (int i = x; i < x + w; i++)
+            row[i] = pixel;
+    }
+}
+
+/* Toplevels */
+
+static void xdg_surface_handle_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    struct Client *client = data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+    client->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener =
+{
+    .configure = xdg_surface_handle_configure
+};
+
+static void xdg_toplevel_handle_configure(void *data, struct xdg_toplevel *xdg_toplevel, int32_t w, int32_t h, struct wl_array *states)
+{
+    (void)xdg_toplevel; (void)states;
+    struct Client *client = data;
+
+    if (w > 0 && h > 0)
+    {
+        client->width = w;
+        client->height = h;
+    }
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener =
+{
+    .configure = xdg_toplevel_handle_configure,
+    .close = noop
+};
+
+static void xdg_wm_base_handle_ping(void *data, struct xdg_wm_base *wm, uint32_t serial)
+{
+    (void)data;
+    xdg_wm_base_pong(wm, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener =
+{
+    .ping = xdg_wm_base_handle_ping
+};
+
+// Width or height of 0 uses the configured (maximized) or output size
+static bool create_toplevel(struct Client *client, int w, int h, bool maximized)
+{
+    client->surface = wl_compositor_create_surface(client->compositor);
+    client->xdgSurface = xdg_wm_base_get_xdg_surface(client->wm, client->surface);
+    client->toplevel = xdg_surface_get_toplevel(client->xdgSurface);
+    xdg_surface_add_listener(client->xdgSurface, &xdg_surface_listener, client);
+    xdg_toplevel_add_listener(client->toplevel, &xdg_toplevel_listener, client);
+    xdg_toplevel_set_title(client->toplevel, "louvre-bench-client");
+    xdg_toplevel_set_app_id(client->toplevel, "louvre-bench-client");
+
+    if (maximized)
+        xdg_toplevel_set_maximized(client->toplevel);
+
+    wl_surface_commit(client->surface);
+
+    while (!client->configured)
+        if (wl_display_dispatch(client->display) == -1)
+            return false;
+
+    if (w == 0 || h == 0)
+    {
+        w = client->width > 0 ? client->width : client->outputW;
+        h = client->height > 0 ? client->height : client->outputH;
+    }
+
+    if (w <= 0 || h <= 0)
+    {
+        w = 1280;
+        h = 720;
+    }
+
+    client->width = w;
+    client->height = h;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!create_shm_buffer(client, &client->buffers[i], w, h))
+            return false;
+
+        fill(&client->buffers[i], 0, 0, w, h, 0xFFFFFFFF);
+    }
+
+    struct wl_region *region = wl_compositor_create_region(client->compositor);
+    wl_region_add(region, 0, 0, w, h);
+    wl_surface_set_opaque_region(client->surface, region);
+    wl_region_destroy(region);
+    wl_surface_attach(client->surface, client->buffers[0].buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, w, h);
+    wl_surface_commit(client->surface);
+    return wl_display_roundtrip(client->display) != -1;
+}
+
+/* Globals */
+
+static void wl_output_handle_mode(void *data, struct wl_output *output, uint32_t flags, int32_t w, int32_t h, int32_t refresh)
+{
+    (void)output; (void)refresh;
+    struct Client *client = data;
+
+    if (flags & WL_OUTPUT_MODE_CURRENT)
+    {
+        client->outputW = w;
+        client->outputH = h;
+    }
+}
+
+static const struct wl_output_listener wl_output_listener =
+{
+    .geometry = noop,
+    .mode = wl_output_handle_mode,
+    .done = noop,
+    .scale = noop
+};
+
+static void wl_pointer_handle_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y)
+{
+    (void)data; (void)surface; (void)x; (void)y;
+    wl_pointer_set_cursor(pointer, serial, cursorSurface, 0, 0);
+}
+
+static void wl_pointer_handle_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+    (void)data; (void)pointer; (void)time; (void)x; (void)y;
+    motionEvents++;
+}
+
+static const struct wl_pointer_listener wl_pointer_listener =
+{
+    .enter = wl_pointer_handle_enter,
+    .leave = noop,
+    .motion = wl_pointer_handle_motion,
+    .button = noop,
+    .axis = noop
+};
+
+static void handle_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+    struct Client *client = data;
+
+    if (strcmp(interface, wl_shm_interface.name) == 0)
+        client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    else if (strcmp(interface, wl_compositor_interface.name) == 0 && version >= 4)
+        client->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+    else if (strcmp(interface, wl_subcompositor_interface.name) == 0)
+        client->subcompositor = wl_registry_bind(registry, name, &wl_subcompositor_interface, 1);
+    else if (strcmp(interface, xdg_wm_base_interface.name) == 0)
+    {
+        client->wm = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(client->wm, &xdg_wm_base_listener, client);
+    }
+    else if (strcmp(interface, wl_output_interface.name) == 0 && client->outputW == 0)
+    {
+        struct wl_output *output = wl_registry_bind(registry, name, &wl_output_interface, 1);
+        wl_output_add_listener(output, &wl_output_listener, client);
+    }
+    else if (strcmp(interface, wl_seat_interface.name) == 0 && !client->seat)
+        client->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+#ifdef HAVE_DMABUF
+    else if (strcmp(interface, zwp_linux_dmabuf_v1_interface.name) == 0 && version >= 2)
+        client->dmabuf = wl_registry_bind(registry, name, &zwp_linux_dmabuf_v1_interface, 2);
+#endif
+}
+
+static const struct wl_registry_listener registry_listener =
+{
+    .global = handle_global,
+    .global_remove = noop
+};
+
+static bool connect_client(struct Client *client)
+{
+    client->display = wl_display_connect(NULL);
+
+    if (!client->display)
+        return false;
+
+    struct wl_registry *registry = wl_display_get_registry(client->display);
+    wl_registry_add_listener(registry, &registry_listener, client);
+    wl_display_roundtrip(client->display);
+    wl_display_roundtrip(client->display);
+    return client->shm && client->compositor && client->subcompositor && client->wm;
+}
+
+/* Scenarios */
+
+static void create_child(struct Child *child, struct Buffer *buffer, int x, int y, bool opaque)
+{
+    struct Client *client = &clients[0];
+    child->surface = wl_compositor_create_surface(client->compositor);
+    child->subsurface = wl_subcompositor_get_subsurface(client->subcompositor, child->surface, client->surface);
+    wl_subsurface_set_desync(child->subsurface);
+    wl_subsurface_set_position(child->subsurface, x, y);
+
+    if (opaque)
+    {
+        struct wl_region *region = wl_compositor_create_region(client->compositor);
+        wl_region_add(region, 0, 0, buffer->width, buffer->height);
+        wl_surface_set_opaque_region(child->surface, region);
+        wl_region_destroy(region);
+    }
+
+    wl_surface_attach(child->surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(child->surface, 0, 0, buffer->width, buffer->height);
+    wl_surface_commit(child->surface);
+}
+
+// Minimal damage on the toplevel, keeps frame callbacks coming without changing the scene
+static void touch_toplevel(struct Client *client)
+{
+    fill(&client->buffers[0], 0, 0, 1, 1, color(client->frames, 255));
+    wl_surface_attach(client->surface, client->buffers[0].buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, 1, 1);
+}
+
+static const char *static_subsurfaces_init(void)
+{
+    struct Client *client = &clients[0];
+
+    if (!create_shm_buffer(client, &opaqueBuffer, CHILD_SIZE, CHILD_SIZE) ||
+        !create_shm_buffer(client, &translucentBuffer, CHILD_SIZE, CHILD_SIZE))
+        return "failed to create SHM buffers";
+
+    fill(&opaqueBuffer, 0, 0, CHILD_SIZE, CHILD_SIZE, 0xFF0000FF);
+    fill(&translucentBuffer, 0, 0, CHILD_SIZE, CHILD_SIZE, 0x64FF0000);
+    children = calloc(count, sizeof(struct Child));
+
+    for (int i = 0; i < count; i++)
+        create_child(&children[i], i % 2 == 0 ? &opaqueBuffer : &translucentBuffer,
+                     rand() % (client->width - CHILD_SIZE / 2), rand() % (client->height - CHILD_SIZE / 2), i % 2 == 0);
+
+    wl_surface_commit(client->surface);
+    return NULL;
+}
+
+static void static_subsurfaces_frame(struct Client *client)
+{
+    touch_toplevel(client);
+}
+
+static const char *damaged_subsurface_init(void)
+{
+    const char *error = static_subsurfaces_init();
+
+    if (error)
+        return error;
+
+    struct Client *client = &clients[0];
+
+    for (int i = 0; i < 2; i++)
+        if (!create_shm_buffer(client, &topBuffers[i], CHILD_SIZE, CHILD_SIZE))
+            return "failed to create SHM buffers";
+
+    create_child(&top, &topBuffers[0], (client->width - CHILD_SIZE) / 2, (client->height - CHILD_SIZE) / 2, true);
+    wl_surface_commit(client->surface);
+    return NULL;
+}
+
+static void damaged_subsurface_frame(struct Client *client)
+{
+    struct Buffer *buffer = &topBuffers[client->frames % 2];
+    fill(buffer, 0, 0, CHILD_SIZE, CHILD_SIZE, color(client->frames, 255));
+    wl_surface_attach(top.surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(top.surface, 0, 0, CHILD_SIZE, CHILD_SIZE);
+    wl_surface_commit(top.surface);
+    touch_toplevel(client);
+}
+
+static const char *fragmented_damage_init(void)
+{
+    return NULL;
+}
+
+static void fragmented_damage_frame(struct Client *client)
+{
+    struct Buffer *buffer = &client->buffers[client->frames % 2];
+    const uint32_t pixel = color(client->frames, 255);
+
+    // Rects are small and scattered so they are not merged into a few large ones
+    for (int i = 0; i < count; i++)
+    {
+        const int w = 8 + rand() % 25;
+        const int h = 8 + rand() % 25;
+        const int x = rand() % (client->width - w);
+        const int y = rand() % (client->height - h);
+        fill(buffer, x, y, w, h, pixel);
+        wl_surface_damage_buffer(client->surface, x, y, w, h);
+    }
+
+    wl_surface_attach(client->surface, buffer->buffer, 0, 0);
+}
+
+static void xdg_popup_surface_handle_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    (void)data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+
+    if (xdg_surface != popup.xdgSurface)
+        return;
+
+    wl_surface_attach(popup.surface, popupBuffer.buffer, 0, 0);
+    wl_surface_damage_buffer(popup.surface, 0, 0, POPUP_W, POPUP_H);
+    wl_surface_commit(popup.surface);
+}
+
+static const struct xdg_surface_listener xdg_popup_surface_listener =
+{
+    .configure = xdg_popup_surface_handle_configure
+};
+
+static const struct xdg_popup_listener xdg_popup_listener =
+{
+    .configure = noop,
+    .popup_done = noop,
+    .repositioned = noop
+};
+
+static const char *popups_init(void)
+{
+    if (!create_shm_buffer(&clients[0], &popupBuffer, POPUP_W, POPUP_H))
+        return "failed to create SHM buffers";
+
+    fill(&popupBuffer, 0, 0, POPUP_W, POPUP_H, 0xFF404040);
+    return NULL;
+}
+
+static void popups_frame(struct Client *client)
+{
+    if (popup.popup)
+    {
+        xdg_popup_destroy(popup.popup);
+        xdg_surface_destroy(popup.xdgSurface);
+        wl_surface_destroy(popup.surface);
+    }
+
+    struct xdg_positioner *positioner = xdg_wm_base_create_positioner(client->wm);
+    xdg_positioner_set_size(positioner, POPUP_W, POPUP_H);
+    xdg_positioner_set_anchor_rect(positioner, rand() % (client->width - POPUP_W), rand() % (client->height - POPUP_H), 1, 1);
+    xdg_positioner_set_anchor(positioner, XDG_POSITIONER_ANCHOR_TOP_LEFT);
+    xdg_positioner_set_gravity(positioner, XDG_POSITIONER_GRAVITY_BOTTOM_RIGHT);
+
+    popup.surface = wl_compositor_create_surface(client->compositor);
+    popup.xdgSurface = xdg_wm_base_get_xdg_surface(client->wm, popup.surface);
+    xdg_surface_add_listener(popup.xdgSurface, &xdg_popup_surface_listener, NULL);
+    popup.popup = xdg_surface_get_popup(popup.xdgSurface, client->xdgSurface, positioner);
+    xdg_popup_add_listener(popup.popup, &xdg_popup_listener, NULL);
+    xdg_positioner_destroy(positioner);
+    wl_surface_commit(popup.surface);
+    popupsCreated++;
+    touch_toplevel(client);
+}
+
+static const char *shm_4k_init(void)
+{
+    return NULL;
+}
+
+// The whole buffer is damaged, so the compositor uploads 32 MiB per frame
+static void shm_4k_frame(struct Client *client)
+{
+    struct Buffer *buffer = &client->buffers[client->frames % 2];
+    fill(buffer, 0, (client->frames * 16) % buffer->height, buffer->width, 16, color(client->frames, 255));
+    wl_surface_attach(client->surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, buffer->width, buffer->height);
+}
+
+#ifdef HAVE_DMABUF
+static const char *dmabuf_init(void)
+{
+    struct Client *client = &clients[0];
+
+    if (!client->dmabuf)
+        return "zwp_linux_dmabuf_v1 not supported by the compositor";
+
+    const char *node = getenv("LOUVRE_BENCH_RENDER_NODE");
+    drmFd = open(node ? node : "/dev/dri/renderD128", O_RDWR | O_CLOEXEC);
+
+    if (drmFd < 0)
+        return "no DRM render node available";
+
+    gbm = gbm_create_device(drmFd);
+
+    if (!gbm)
+        return "failed to create GBM device";
+
+    for (int i = 0; i < 2; i++)
+    {
+        struct Buffer *buffer = &topBuffers[i];
+        buffer->width = client->width;
+        buffer->height = client->height;
+        buffer->bo = gbm_bo_create(gbm, buffer->width, buffer->height, GBM_FORMAT_XRGB8888, GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
+
+        if (!buffer->bo)
+            return "failed to allocate GBM buffers";
+
+        const uint64_t modifier = gbm_bo_get_modifier(buffer->bo);
+        const int fd = gbm_bo_get_fd(buffer->bo);
+        struct zwp_linux_buffer_params_v1 *params = zwp_linux_dmabuf_v1_create_params(client->dmabuf);
+        zwp_linux_buffer_params_v1_add(params, fd, 0, gbm_bo_get_offset(buffer->bo, 0), gbm_bo_get_stride(buffer->bo),
+                                       modifier >> 32, modifier & 0xFFFFFFFF);
+        buffer->buffer = zwp_linux_buffer_params_v1_create_immed(params, buffer->width, buffer->height, DRM_FORMAT_XRGB8888, 0);
+        zwp_linux_buffer_params_v1_destroy(params);
+        close(fd);
+    }
+
+    if (wl_display_roundtrip(client->display) == -1)
+        return "the compositor rejected the DMA buffers";
+
+    return NULL;
+}
+
+static void dmabuf_frame(struct Client *client)
+{
+    struct Buffer *buffer = &topBuffers[client->frames % 2];
+    uint32_t stride;
+    void *mapData = NULL;
+    uint32_t *pixels = gbm_bo_map(buffer->bo, 0, (client->frames * 16) % buffer->height, buffer->width, 16,
+                                  GBM_BO_TRANSFER_WRITE, &stride, &mapData);
+
+    if (pixels)
+    {
+        const uint32_t pixel = color(client->frames, 255);
+
+        for (int j = 0; j < 16; j++)
+            for (int i = 0; i < buffer->width; i++)
+                pixels[j * (stride / 4) + i] = pixel;
+
+        gbm_bo_unmap(buffer->bo, mapData);
+    }
+
+    wl_surface_attach(client->surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, buffer->width, buffer->height);
+}
+#else
+static const char *dmabuf_init(void)
+{
+    return "built without GBM and wayland-scanner";
+}
+
+static void dmabuf_frame(struct Client *client)
+{
+    (void)client;
+}
+#endif
+
+static const char *many_clients_init(void)
+{
+    clientsCount = count;
+
+    for (int i = 1; i < clientsCount; i++)
+        if (!connect_client(&clients[i]) || !create_toplevel(&clients[i], CHILD_SIZE, CHILD_SIZE, false))
+            return "failed to connect the clients";
+
+    return NULL;
+}
+
+static void many_clients_frame(struct Client *client)
+{
+    struct Buffer *buffer = &client->buffers[client->frames % 2];
+    fill(buffer, 0, 0, buffer->width, buffer->height, color(client->frames + (client - clients) * 10, 255));
+    wl_surface_attach(client->surface, buffer->buffer, 0, 0);
+    wl_surface_damage_buffer(client->surface, 0, 0, buffer->width, buffer->height);
+}
+
+static const char *pointer_motion_init(void)
+{
+    struct Client *client = &clients[0];
+
+    if (!client->seat)
+        return "no wl_seat";
+
+    if (!create_shm_buffer(client, &cursorBuffer, CURSOR_SIZE, CURSOR_SIZE))
+        return "failed to create SHM buffers";
+
+    fill(&cursorBuffer, 0, 0, CURSOR_SIZE, CURSOR_SIZE, 0xFF000000);
+    cursorSurface = wl_compositor_create_surface(client->compositor);
+    wl_surface_attach(cursorSurface, cursorBuffer.buffer, 0, 0);
+    wl_surface_damage_buffer(cursorSurface, 0, 0, CURSOR_SIZE, CURSOR_SIZE);
+    wl_surface_commit(cursorSurface);
+
+    // Motion is replayed by the headless input backend, see louvre-bench.py
+    client->pointer = wl_seat_get_pointer(client->seat);
+    wl_pointer_add_listener(client->pointer, &wl_pointer_listener, client);
+    return NULL;
+}
+
+static void pointer_motion_frame(struct Client *client)
+{
+    touch_toplevel(client);
+}
+
+static const struct Scenario scenarios[] =
+{
+    { "static-subsurfaces", 50,  true,  static_subsurfaces_init, static_subsurfaces_frame },
+    { "damaged-subsurface", 50,  true,  damaged_subsurface_init, damaged_subsurface_frame },
+    { "fragmented-damage",  64,  true,  fragmented_damage_init,  fragmented_damage_frame  },
+    { "popups",             1,   true,  popups_init,             popups_frame             },
+    { "shm-4k",             1,   false, shm_4k_init,             shm_4k_frame             },
+    { "dmabuf",             1,   true,  dmabuf_init,             dmabuf_frame             },
+    { "many-clients",       32,  false, many_clients_init,       many_clients_frame       },
+    { "pointer-motion",     1,   true,  pointer_motion_init,     pointer_motion_frame     },
+};
+
+/* Main loop */
+
+static struct wl_callback_listener wl_callback_listener;
+
+static void request_frame(struct Client *client)
+{
+    struct wl_callback *callback = wl_surface_frame(client->surface);
+    wl_callback_add_listener(callback, &wl_callback_listener, client);
+    wl_surface_commit(client->surface);
+}
+
+static void wl_callback_handle_done(void *data, struct wl_callback *callback, uint32_t ms)
+{
+    (void)ms;
+    struct Client *client = data;
+    wl_callback_destroy(callback);
+    client->frames++;
+    scenario->frame(client);
+    request_frame(client);
+}
+
+static struct wl_callback_listener wl_callback_listener =
+{
+    .done = wl_callback_handle_done
+};
+
+static void print_result(const char *skipped, int64_t elapsed)
+{
+    if (skipped)
+    {
+        printf("{\"scenario\":\"%s\",\"skipped\":\"%s\"}\n", scenario->name, skipped);
+        return;
+    }
+
+    uint64_t frames = 0;
+
+    for (int i = 0; i < clientsCount; i++)
+        frames += clients[i].frames;
+
+    printf("{\"scenario\":\"%s\",\"count\":%d,\"clients\":%d,\"duration_ms\":%lld,\"frames\":%llu,"
+           "\"fps_per_client\":%.2f,\"popups\":%llu,\"motion_events\":%llu}\n",
+           scenario->name, count, clientsCount, (long long)elapsed, (unsigned long long)frames,
+           elapsed > 0 ? 1000.0 * (double)frames / (double)clientsCount / (double)elapsed : 0.0,
+           (unsigned long long)popupsCreated, (unsigned long long)motionEvents);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <scenario> [duration ms] [count] [seed]\nScenarios:", argv[0]);
+
+        for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+            fprintf(stderr, " %s", scenarios[i].name);
+
+        fprintf(stderr, "\n");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+        if (strcmp(argv[1], scenarios[i].name) == 0)
+            scenario = &scenarios[i];
+
+    if (!scenario)
+    {
+        fprintf(stderr, "Unknown scenario %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    durationMs = argc > 2 ? atoi(argv[2]) : 5000;
+    count = argc > 3 && atoi(argv[3]) > 0 ? atoi(argv[3]) : scenario->defaultCount;
+    srand(argc > 4 ? atoi(argv[4]) : 1);
+
+    if (count > MAX_CLIENTS && strcmp(scenario->name, "many-clients") == 0)
+        count = MAX_CLIENTS;
+
+    struct Client *first = &clients[0];
+
+    if (!connect_client(first))
+    {
+        fprintf(stderr, "Failed to connect to the compositor or required globals missing.\n");
+        return EXIT_FAILURE;
+    }
+
+    const bool is4K = strcmp(scenario->name, "shm-4k") == 0;
+
+    if (!create_toplevel(first, is4K ? 3840 : 0, is4K ? 2160 : 0, scenario->maximized))
+    {
+        fprintf(stderr, "Failed to create the toplevel.\n");
+        return EXIT_FAILURE;
+    }
+
+    const char *skipped = scenario->init();
+
+    if (skipped)
+    {
+        print_result(skipped, 0);
+        return EXIT_SUCCESS;
+    }
+
+    for (int i = 0; i < clientsCount; i++)
+        request_frame(&clients[i]);
+
+    struct pollfd fds[MAX_CLIENTS];
+
+    for (int i = 0; i < clientsCount; i++)
+    {
+        fds[i].fd = wl_display_get_fd(clients[i].display);
+        fds[i].events = POLLIN;
+    }
+
+    const int64_t start = now_ms();
+    int64_t elapsed = 0;
+
+    while (elapsed < durationMs)
+    {
+        for (int i = 0; i < clientsCount; i++)
+        {
+            wl_display_dispatch_pending(clients[i].display);
+            wl_display_flush(clients[i].display);
+        }
+
+        if (poll(fds, clientsCount, durationMs - elapsed) < 0)
+            break;
+
+        for (int i = 0; i < clientsCount; i++)
+        {
+            if ((fds[i].revents & POLLIN) && wl_display_dispatch(clients[i].display) == -1)
+            {
+                fprintf(stderr, "Lost connection to the compositor.\n");
+                return EXIT_FAILURE;
+            }
+        }
+
+        elapsed = now_ms() - start;
+    }
+
+    print_result(NULL, elapsed);
+
+    for (int i = 0; i < clientsCount; i++)
+        wl_display_disconnect(clients[i].display);
+
+    return EXIT_SUCCESS;
+}
@@ -21,13 +21,34 @@
 
 void Output::loadWallpaper() noexcept
 {
-    std::unique_ptr<LTexture> background { LOpenGL::loadTexture(std::filesystem::path(getenvString("HOME")) / ".config/Louvre/wallpaper.jpg") };
+    // Decoded in the background, the output is painted without wallpaper until it's ready
+    LWeak<Output> output { this };
+
+    LOpenGL::loadTextureAsync(std::filesystem::path(getenvString("HOME")) / ".config/Louvre/wallpaper.jpg", [output](LTexture *background) {
+        if (!output)
+            delete background;
+        else if (background)
+            output->setWallpaper(background);
+        else
+            LOpenGL::loadTextureAsync(compositor()->defaultAssetsPath() / "wallpaper.png", [output](LTexture *background) {
+                if (output)
+                    output->setWallpaper(background);
+                else
+                    delete background;
+            }, output->sizeB());
+    }, sizeB());
+}
 
-    if (!background)
-        background.reset(LOpenGL::loadTexture(compositor()->defaultAssetsPath() / "wallpaper.png"));
+void Output::setWallpaper(LTexture *background) noexcept
+{
+    std::unique_ptr<LTexture> texture { background };
 
-    if (background)
-        backgroundTexture.reset(background->copy(sizeB()));
+    if (!texture)
+        return;
+
+    backgroundTexture.reset(texture->copy(sizeB()));
+    fullDamage();
+    repaint();
 }
 
 void Output::fullDamage() noexcept
@@ -20,6 +20,7 @@ public:
 
     bool tryFullscreenScanoutIfNoOverlayContent() noexcept;
     void loadWallpaper() noexcept;
+    void setWallpaper(LTexture *background) noexcept;
     void fullDamage()  noexcept;
     void initializeGL() noexcept override;
     void resizeGL() noexcept override;
@@ -1,7 +1,6 @@
 #include <private/LCompositorPrivate.h>
+#include <private/LOutputPrivate.h>
 #include <LAnimation.h>
-#include <algorithm>
-#include <LTime.h>
 
 using namespace Louvre;
 
@@ -10,20 +9,14 @@ LAnimation::LAnimation(UInt32 durationMs, const Callback &onUpdate, const Callba
     m_duration(durationMs),
     m_onFinish(onFinish)
 {
-    compositor()->imp()->animations.push_back(this);
+    compositor()->imp()->addAnimation(this);
 }
 
 LAnimation::~LAnimation()
 {
     notifyDestruction();
     stop();
-
-    auto it { std::find(compositor()->imp()->animations.begin(), compositor()->imp()->animations.end(), this) };
-    if (it != compositor()->imp()->animations.end())
-    {
-        compositor()->imp()->animationsVectorChanged = true;
-        compositor()->imp()->animations.erase(it);
-    }
+    compositor()->imp()->removeAnimation(this);
 }
 
 void LAnimation::oneShot(UInt32 durationMs, const Callback &onUpdate, const Callback &onFinish) noexcept
@@ -55,9 +48,10 @@ void LAnimation::start() noexcept
         return;
 
     m_value = 0.0;
-    m_beginTime = std::chrono::steady_clock::now();
+    m_beginTime = LOutput::LOutputPrivate::frameStatsTime();
+    m_lastTime = m_beginTime;
     m_running = true;
-    compositor()->repaintAllOutputs();
+    repaintOutputs();
 }
 
 void LAnimation::stop()
@@ -74,3 +68,22 @@ void LAnimation::stop()
     if (m_destroyOnFinish)
         m_pendingDestroy = true;
 }
+
+void LAnimation::setOutput(LOutput *output) noexcept
+{
+    if (output == m_output)
+        return;
+
+    m_output.reset(output);
+
+    if (m_running)
+        repaintOutputs();
+}
+
+void LAnimation::repaintOutputs() noexcept
+{
+    if (m_output && (m_output->state() == LOutput::Initialized || m_output->state() == LOutput::ChangingMode))
+        m_output->repaint();
+    else
+        compositor()->repaintAllOutputs();
+}
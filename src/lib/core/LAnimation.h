@@ -2,6 +2,7 @@
 #define LANIMATION_H
 
 #include <LObject.h>
+#include <LWeak.h>
 #include <chrono>
 #include <functional>
 
@@ -14,7 +15,14 @@
  * access the value() property, which is a 64-bit floating-point number linearly interpolated from 0.0 to 1.0,
  * indicating the completion percentage of the animation.
  *
- * @note It is essential to manually invoke LOutput::repaint() on the outputs you are animating; otherwise, the `onUpdate()` callback may not be invoked.
+ * The value() is calculated from the time at which the frame being painted is expected to be presented (the next vblank of
+ * the output), rather than the time at which the callback is invoked, so the motion stays smooth even if rendering is delayed.
+ *
+ * While running, an animation keeps repainting the outputs it is synchronized with: all initialized outputs by default, or
+ * only the one assigned with setOutput(). Assigning an output is recommended when the animated content is only visible there,
+ * since other outputs are then neither repainted nor advance the animation.
+ *
+ * Animations can be created, started, stopped or destroyed from within the callbacks of other animations.
  *
  * After the animation finishes, the `onFinish()` callback is triggered, and the value() property has a value of 1.0.\n
  */
@@ -145,14 +153,40 @@ public:
         return m_running;
     }
 
+    /**
+     * @brief Synchronizes the animation with a single output.
+     *
+     * When set, the animation is only updated before the paintGL() calls of the given output, using its frame clock,
+     * and only that output is repainted while it runs.\n
+     * If the output is uninitialized or destroyed, the animation falls back to being synchronized with all outputs.
+     *
+     * @param output The output to synchronize with, or `nullptr` to synchronize with all outputs (default).
+     */
+    void setOutput(LOutput *output) noexcept;
+
+    /**
+     * @brief The output the animation is synchronized with.
+     *
+     * @see setOutput()
+     *
+     * @return The output or `nullptr` if synchronized with all outputs.
+     */
+    LOutput *output() const noexcept
+    {
+        return m_output;
+    }
+
 private:
     friend class LCompositor;
+    void repaintOutputs() noexcept;
     Callback m_onUpdate { nullptr };
     Float64 m_value { 0.0 };
     Int64 m_duration;
-    std::chrono::steady_clock::time_point m_beginTime;
+    UInt64 m_beginTime { 0 }; // CLOCK_MONOTONIC ns
+    UInt64 m_lastTime { 0 };  // Time of the last update, never decreases
+    LWeak<LOutput> m_output;
+    size_t m_slot { 0 };      // Index in LCompositorPrivate::animations
     bool m_running { false };
-    bool m_processed { false };
     bool m_pendingDestroy { false };
     bool m_destroyOnFinish { false };
     Callback m_onFinish { nullptr };
@@ -1,4 +1,5 @@
 #include <protocols/Wayland/RDataSource.h>
+#include <private/LCompositorPrivate.h>
 #include <LClipboard.h>
 #include <LSeat.h>
 #include <cassert>
@@ -25,6 +26,7 @@ void LClipboard::clear() noexcept
 {
     while (!m_persistentMimeTypes.empty())
     {
+        compositor()->imp()->clipboardTransfers.cancel(m_persistentMimeTypes.back().tmp);
         fclose(m_persistentMimeTypes.back().tmp);
         m_persistentMimeTypes.pop_back();
     }
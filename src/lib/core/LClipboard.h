@@ -27,7 +27,7 @@ public:
     struct MimeTypeFile
     {
         std::string mimeType; /**< Mime type string. */
-        FILE *tmp { NULL }; /**< Clipboard content for the MIME type (can be NULL). */
+        FILE *tmp { NULL }; /**< Clipboard content for the MIME type (can be NULL). Written asynchronously by the source client, so it may still be incomplete. */
     };
 
     /**
@@ -63,7 +63,9 @@ public:
      * @brief Filter of persistent clipboard MIME types.
      *
      * Keep the clipboard data for specific MIME types even after the
-     * client owning the clipboard data is disconnected.
+     * client owning the clipboard data is disconnected.\n
+     * The data is captured in memory from the event loop, and discarded if it exceeds `LOUVRE_CLIPBOARD_MAX_SIZE`
+     * (see @ref environment_page) or the source client stops writing for 10 seconds.
      *
      * @return `true` to make the MIME type persistent, `false` otherwise.
      *
@@ -100,6 +100,13 @@ LCompositor::LCompositor() noexcept : LPRIVATE_INIT_UNIQUE(LCompositor)
     imp()->eglQueryWaylandBufferWL = (PFNEGLQUERYWAYLANDBUFFERWL) eglGetProcAddress ("eglQueryWaylandBufferWL");
     imp()->glEGLImageTargetRenderbufferStorageOES = (PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC) eglGetProcAddress ("glEGLImageTargetRenderbufferStorageOES");
     imp()->glEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress ("glEGLImageTargetTexture2DOES");
+    imp()->eglCreateSyncKHR = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress ("eglCreateSyncKHR");
+    imp()->eglDestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress ("eglDestroySyncKHR");
+    imp()->eglClientWaitSyncKHR = (PFNEGLCLIENTWAITSYNCKHRPROC) eglGetProcAddress ("eglClientWaitSyncKHR");
+    imp()->glMapBufferRange = (PFNGLMAPBUFFERRANGEEXTPROC) eglGetProcAddress ("glMapBufferRange");
+    imp()->glUnmapBuffer = (PFNGLUNMAPBUFFEROESPROC) eglGetProcAddress ("glUnmapBuffer");
+    imp()->glGetProgramBinaryOES = (PFNGLGETPROGRAMBINARYOESPROC) eglGetProcAddress ("glGetProgramBinaryOES");
+    imp()->glProgramBinaryOES = (PFNGLPROGRAMBINARYOESPROC) eglGetProcAddress ("glProgramBinaryOES");
 
     imp()->defaultAssetsPath = LOUVRE_DEFAULT_ASSETS_PATH;
     imp()->defaultBackendsPath = LOUVRE_DEFAULT_BACKENDS_PATH;
@@ -286,7 +293,7 @@ Int32 LCompositor::processLoop(Int32 msTimeout)
 
     if (!seat()->enabled())
     {
-        imp()->processAnimations();
+        imp()->processAnimations(nullptr);
         imp()->inputBackend->backendForceUpdate();
     }
 
@@ -326,6 +333,8 @@ Int32 LCompositor::processLoop(Int32 msTimeout)
         }
     }
 
+    imp()->notifyPendingOrderChanges();
+
     if (seat()->enabled())
     {
         if (!seat()->isUserIdleHint())
@@ -346,7 +355,7 @@ Int32 LCompositor::processLoop(Int32 msTimeout)
     {
         uninitialized();
 
-        imp()->processAnimations();
+        imp()->processAnimations(nullptr);
 
         while (!outputs().empty())
             removeOutput(outputs().back());
@@ -363,18 +372,24 @@ Int32 LCompositor::processLoop(Int32 msTimeout)
         imp()->unitSeat();
         imp()->unitWayland();
 
-        retry:
-        for (LAnimation *a : imp()->animations)
+        imp()->animationsIterating++;
+
+        for (size_t i = 0; i < imp()->animations.size(); i++)
         {
+            LAnimation *a { imp()->animations[i] };
+
+            if (!a)
+                continue;
+
             if (a->m_destroyOnFinish)
-            {
                 delete a;
-                goto retry;
-            }
             else
                 a->stop();
         }
 
+        imp()->animationsIterating--;
+        imp()->compactAnimations();
+
         while (!imp()->oneShotTimers.empty())
             delete imp()->oneShotTimers.back();
 
@@ -466,6 +481,33 @@ bool LCompositor::addOutput(LOutput *output)
     if (output->lease())
         output->lease()->finished();
 
+    // Lowest slot not used by other outputs, 0 is reserved for the main thread
+    output->imp()->threadSlot = 1;
+
+    for (bool used { true }; used; )
+    {
+        used = false;
+
+        for (LOutput *o : outputs())
+        {
+            if (o->imp()->threadSlot == output->imp()->threadSlot)
+            {
+                output->imp()->threadSlot++;
+                used = true;
+                break;
+            }
+        }
+    }
+
+    // Allocate the thread slot data of views before the output thread starts, see LView::ThreadSlots
+    if (output->imp()->threadSlot >= imp()->threadSlotsCount)
+    {
+        imp()->threadSlotsCount = output->imp()->threadSlot + 1;
+
+        for (LView *v : imp()->views)
+            v->resizeThreadSlots(imp()->threadSlotsCount);
+    }
+
     imp()->outputs.push_back(output);
 
     if (imp()->outputs.size() == 1)
@@ -518,12 +560,17 @@ void LCompositor::removeOutput(LOutput *output)
             }
 
             imp()->lock();
+
+            if (cursor())
+                cursor()->imp()->removeHwStateOutput(output);
+
             imp()->graphicBackend->outputUninitialize(output);
 
             while (output->imp()->state != LOutput::Uninitialized)
                 usleep(1000);
 
             output->imp()->callLock.store(true);
+            imp()->collectFrameTrace(output);
 
             for (auto *head : output->imp()->wlrOutputHeads)
                 head->enabled(false);
@@ -532,7 +579,7 @@ void LCompositor::removeOutput(LOutput *output)
                 s->sendOutputLeaveEvent(output);
 
             for (LView *v : imp()->views)
-                v->removeThread(o->threadId());
+                v->removeThreadSlot(o->imp()->threadSlot);
 
             LVectorRemoveOne(imp()->outputs, output);
 
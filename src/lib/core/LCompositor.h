@@ -105,6 +105,8 @@ public:
     /**
      * @brief Uninitializes the compositor.
      *
+     * Also called when the process receives `SIGTERM` or `SIGINT`, so that backends are properly uninitialized.
+     *
      * @see uninitialized().
      */
     void finish() noexcept;
@@ -109,6 +109,11 @@ LCursor::LCursor() noexcept : LPRIVATE_INIT_UNIQUE(LCursor)
 
     skipGL:
 
+    imp()->readbackTimer.setCallback([this](LTimer *)
+    {
+        imp()->processReadbacks();
+    });
+
     setSize(LSize(24));
     useDefault();
     setVisible(true);
@@ -120,6 +125,12 @@ LCursor::~LCursor()
 
     compositor()->imp()->cursor = nullptr;
 
+    imp()->readbackTimer.cancel();
+    imp()->readbacks.clear();
+
+    if (imp()->readbackSync != EGL_NO_SYNC_KHR)
+        compositor()->imp()->eglDestroySyncKHR(compositor()->eglDisplay(), imp()->readbackSync);
+
     if (imp()->glRenderbuffer)
         glDeleteRenderbuffers(1, &imp()->glRenderbuffer);
 
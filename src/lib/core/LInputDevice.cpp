@@ -1,3 +1,4 @@
+#include <private/LSeatPrivate.h>
 #include <LInputDevice.h>
 #include <LCompositor.h>
 
@@ -10,5 +11,6 @@ void LInputDevice::notifyPlugged()
 
 void LInputDevice::notifyUnplugged()
 {
+    compositor()->seat()->imp()->inputRecorder.forgetDevice(this);
     compositor()->seat()->inputDeviceUnplugged(this);
 }
@@ -112,6 +112,8 @@ public:
      *
      * @warning This method can return `nullptr` in cases where the input backend does not provide a handle or the input device has been unplugged.
      *
+     * @note If the **LOUVRE_INPUT_THREAD** environment variable is enabled, libinput runs on its own thread, so the device should only be configured within LSeat::inputDevicePlugged().
+     *
      * @return A pointer to the native data structure.
      */
     void *nativeHandle() const noexcept
@@ -285,7 +285,8 @@ namespace Louvre
     enum LGraphicBackendID : UInt32
     {
         LGraphicBackendDRM = 0,    ///< ID for the DRM graphic backend.
-        LGraphicBackendWayland = 1 ///< ID for the Wayland graphic backend.
+        LGraphicBackendWayland = 1, ///< ID for the Wayland graphic backend.
+        LGraphicBackendHeadless = 2 ///< ID for the headless graphic backend.
     };
 
     /**
@@ -296,7 +297,8 @@ namespace Louvre
     enum LInputBackendID : UInt32
     {
         LInputBackendLibinput = 0, ///< ID for the Libinput input backend.
-        LInputBackendWayland = 1   ///< ID for the Wayland input backend.
+        LInputBackendWayland = 1,  ///< ID for the Wayland input backend.
+        LInputBackendHeadless = 2  ///< ID for the headless input backend.
     };
 
     /**
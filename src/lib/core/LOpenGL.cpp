@@ -1,5 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <other/stb_image.h>
+#include <private/LCompositorPrivate.h>
+#include <private/LImageLoader.h>
 #include <LOpenGL.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -134,15 +136,7 @@ LTexture *LOpenGL::loadTexture(const std::filesystem::path &file)
 
     if (!texture->setDataFromMainMemory(LSize(width, height), width * 4, DRM_FORMAT_ABGR8888, image))
     {
-        UInt8 pix { 0 };
-
-        for (int i = 0; i < width * 4 * height; i+=4)
-        {
-            pix = image[i + 2];
-            image[i + 2] = image[i];
-            image[i] = pix;
-        }
-
+        LImageLoader::swizzle(image, LSize(width, height), width * 4);
         texture->setDataFromMainMemory(LSize(width, height), width * 4, DRM_FORMAT_ARGB8888, image);
     }
 
@@ -150,6 +144,21 @@ LTexture *LOpenGL::loadTexture(const std::filesystem::path &file)
     return texture;
 }
 
+void LOpenGL::loadTextureAsync(const std::filesystem::path &file, const std::function<void (LTexture *)> &callback, const LSize &maxSize)
+{
+    compositor()->imp()->imageLoader.load(file, maxSize, false, callback);
+}
+
+void LOpenGL::loadCachedTextureAsync(const std::filesystem::path &file, const std::function<void (LTexture *)> &callback, const LSize &maxSize)
+{
+    compositor()->imp()->imageLoader.load(file, maxSize, true, callback);
+}
+
+void LOpenGL::clearTextureCache()
+{
+    compositor()->imp()->imageLoader.clearCache();
+}
+
 bool LOpenGL::hasExtension(const char *extensions, const char *extension)
 {
     size_t extlen = strlen(extension);
@@ -2,7 +2,9 @@
 #define LOPENGL_H
 
 #include <LNamespaces.h>
+#include <LPoint.h>
 #include <filesystem>
+#include <functional>
 
 /**
  * @brief OpenGL utility functions.
@@ -63,6 +65,43 @@ public:
      */
     static LTexture *loadTexture(const std::filesystem::path &file);
 
+    /**
+     * @brief Create a texture from an image file without blocking the compositor.
+     *
+     * The image is decoded on a pool of worker threads and the texture is created on the main thread once it's ready.\n
+     * The callback is then invoked from the main thread with the new texture, or `nullptr` in case of error. The texture
+     * is owned by the caller, just like those returned by loadTexture().
+     *
+     * @note The callback may be invoked after the object that requested the texture is destroyed, capture an LWeak if needed.
+     *
+     * @param file Path to the image file, see loadTexture() for supported formats.
+     * @param callback Function called when the texture is ready or the image could not be loaded.
+     * @param maxSize If not empty, the image is downscaled while decoding to fit into this size (in buffer coordinates) keeping its aspect ratio.
+     *                A width or height <= 0 leaves that axis unconstrained. Images are never upscaled.
+     */
+    static void loadTextureAsync(const std::filesystem::path &file, const std::function<void(LTexture*)> &callback, const LSize &maxSize = LSize());
+
+    /**
+     * @brief Create a shared texture from an image file without blocking the compositor.
+     *
+     * Same as loadTextureAsync() but textures are cached by path and max size, so each image is decoded only once.\n
+     * If the texture is already cached, the callback is invoked immediately.
+     *
+     * @warning Cached textures are owned by Louvre and must not be destroyed. They stay alive until clearTextureCache() is called or the compositor is uninitialized.
+     *
+     * @param file Path to the image file, see loadTexture() for supported formats.
+     * @param callback Function called when the texture is ready or the image could not be loaded.
+     * @param maxSize If not empty, the image is downscaled while decoding to fit into this size keeping its aspect ratio.
+     */
+    static void loadCachedTextureAsync(const std::filesystem::path &file, const std::function<void(LTexture*)> &callback, const LSize &maxSize = LSize());
+
+    /**
+     * @brief Destroy all textures created by loadCachedTextureAsync().
+     *
+     * @warning Make sure none of the cached textures are still in use before calling it.
+     */
+    static void clearTextureCache();
+
     /**
      * @brief Check if a specific OpenGL extension is available.
      *
@@ -63,6 +63,41 @@ bool LOutput::needsFullRepaint() const noexcept
     return imp()->stateFlags.check(LOutput::LOutputPrivate::NeedsFullRepaint);
 }
 
+void LOutput::enableFrameStats(bool enabled) noexcept
+{
+    imp()->frameStatsEnabled = enabled;
+}
+
+bool LOutput::frameStatsEnabled() const noexcept
+{
+    return imp()->frameStatsEnabled;
+}
+
+std::vector<LOutputFrameStats> LOutput::frameStats() const noexcept
+{
+    std::vector<LOutputFrameStats> stats;
+    std::lock_guard<std::mutex> lock { imp()->frameStatsMutex };
+
+    if (imp()->frameStatsCount == 0)
+        return stats;
+
+    const size_t size { imp()->frameStatsRing.size() };
+    const size_t first { (imp()->frameStatsHead + size - imp()->frameStatsCount) % size };
+    stats.reserve(imp()->frameStatsCount);
+
+    for (size_t i = 0; i < imp()->frameStatsCount; i++)
+        stats.push_back(imp()->frameStatsRing[(first + i) % size]);
+
+    return stats;
+}
+
+void LOutput::clearFrameStats() noexcept
+{
+    std::lock_guard<std::mutex> lock { imp()->frameStatsMutex };
+    imp()->frameStatsHead = 0;
+    imp()->frameStatsCount = 0;
+}
+
 const LRect &LOutput::availableGeometry() const noexcept
 {
     return imp()->availableGeometry;
@@ -134,6 +169,27 @@ void LOutput::setRefreshRateLimit(Int32 hz) noexcept
     return compositor()->imp()->graphicBackend->outputSetRefreshRateLimit((LOutput*)this, hz);
 }
 
+void LOutput::enableRepaintScheduling(bool enabled) noexcept
+{
+    imp()->repaintScheduling = enabled;
+}
+
+bool LOutput::repaintSchedulingEnabled() const noexcept
+{
+    return imp()->repaintScheduling;
+}
+
+void LOutput::setRenderBudget(UInt32 us) noexcept
+{
+    imp()->fixedRenderBudget = us;
+}
+
+UInt32 LOutput::renderBudget() const noexcept
+{
+    const UInt32 fixed { imp()->fixedRenderBudget };
+    return fixed != 0 ? fixed : imp()->adaptiveRenderBudget.load();
+}
+
 UInt32 LOutput::gammaSize() const noexcept
 {
     return compositor()->imp()->graphicBackend->outputGetGammaSize((LOutput*)this);
@@ -7,6 +7,7 @@
 #include <LRegion.h>
 #include <LFramebuffer.h>
 #include <LContentType.h>
+#include <LOutputFrameStats.h>
 
 #include <thread>
 #include <list>
@@ -193,6 +194,13 @@
  * Clients using the Tearing Protocol can indicate their preference for each individual surface.\n
  * See LSurface::preferVSync() and LSurface::preferVSyncChanged() for more details.
  *
+ * @section repaint_scheduling Repaint Scheduling
+ *
+ * By default, paintGL() is triggered as soon as a repaint is requested and the graphic backend has a free buffer, which
+ * can be well before the next vblank. With enableRepaintScheduling(), painting is instead delayed until just before the
+ * next vblank, leaving only renderBudget() to render the frame. Client commits arriving late in the frame are then still
+ * presented on the next vblank, and the latency between input and presentation drops.
+ *
  * @section drm_leasing DRM Leasing
  *
  * [DRM leasing](https://wayland.app/protocols/drm-lease-v1) is a Wayland protocol and backend feature that allows clients to take control of a specific set of displays.\n
@@ -483,6 +491,8 @@ public:
      *       being displayed.
      *       Destroying a buffer while it is being displayed is safe, the graphic backend ensures it remains alive until it is no longer in use.
      *
+     * @see LScene::enableAutoScanout() to let LScene decide when to scan out surface buffers.
+     *
      * @param texture The texture to scan or `nullptr` to restore the internal output framebuffers.
      * @return `true` if the buffer is going to be displayed, `false` if the internal output framebuffers will be displayed.
      */
@@ -539,6 +549,44 @@ public:
      */
     void setRefreshRateLimit(Int32 hz) noexcept;
 
+    /**
+     * @brief Enables or disables repaint scheduling.
+     *
+     * When enabled, paintGL() is delayed until renderBudget() before the next expected vblank, estimated
+     * from the last page flip timestamp and the refresh period. If that point has already passed, or VSync is disabled,
+     * the output is painted right away as usual.\n
+     * Disabled by default, unless the **LOUVRE_REPAINT_SCHEDULING** environment variable is set to `1`.
+     *
+     * @see @ref repaint_scheduling
+     */
+    void enableRepaintScheduling(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if repaint scheduling is enabled.
+     *
+     * @see enableRepaintScheduling()
+     */
+    bool repaintSchedulingEnabled() const noexcept;
+
+    /**
+     * @brief Sets the time reserved to render a frame when repaint scheduling is enabled.
+     *
+     * A value of 0 (the default) makes the budget adaptive, estimated from the slowest of the last frames plus a safety margin.\n
+     * Larger values are safer but increase latency, while values smaller than the actual render time make frames miss the vblank.
+     *
+     * @param us Render budget in microseconds, or 0 for the adaptive mode.
+     */
+    void setRenderBudget(UInt32 us) noexcept;
+
+    /**
+     * @brief Time reserved to render a frame when repaint scheduling is enabled.
+     *
+     * Returns the value set with setRenderBudget(), or the current estimate if it is adaptive.
+     *
+     * @return The render budget in microseconds.
+     */
+    UInt32 renderBudget() const noexcept;
+
     /**
      * @brief Gets the size of the gamma table.
      *
@@ -689,6 +737,47 @@ public:
      */
     bool needsFullRepaint() const noexcept;
 
+    /**
+     * @brief Enables or disables the collection of per-frame statistics.
+     *
+     * When enabled, the timings and counters of the last frames painted (see LOutputFrameStats) are stored
+     * in a ring buffer of frameStatsCapacity() entries, which can be retrieved at any time with frameStats().\n
+     * Disabled by default, unless the `LOUVRE_FRAME_TRACE` environment variable is set.
+     *
+     * @note Disabling it doesn't clear the already collected statistics, use clearFrameStats() instead.
+     */
+    void enableFrameStats(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if per-frame statistics are being collected.
+     *
+     * @see enableFrameStats()
+     */
+    bool frameStatsEnabled() const noexcept;
+
+    /**
+     * @brief Maximum number of frames stored by frameStats().
+     */
+    static constexpr UInt32 frameStatsCapacity() noexcept
+    {
+        return 512;
+    }
+
+    /**
+     * @brief Statistics of the last painted frames.
+     *
+     * Returns a copy of the collected statistics ordered from oldest to newest.\n
+     * The page flip fields of the newest frame may not be filled yet.
+     *
+     * @note This method is thread-safe.
+     */
+    std::vector<LOutputFrameStats> frameStats() const noexcept;
+
+    /**
+     * @brief Removes all the statistics collected so far.
+     */
+    void clearFrameStats() noexcept;
+
     /**
      * @brief Gets the dots per inch (DPI) of the output.
      *
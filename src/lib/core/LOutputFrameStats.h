@@ -0,0 +1,32 @@
+#ifndef LOUTPUTFRAMESTATS_H
+#define LOUTPUTFRAMESTATS_H
+
+#include <LNamespaces.h>
+
+namespace Louvre
+{
+    /**
+     * @brief Timings and counters of a single output frame.
+     *
+     * Collected by each LOutput when enabled with LOutput::enableFrameStats() and retrieved with LOutput::frameStats().\n
+     * Timestamps are in nanoseconds, taken from `CLOCK_MONOTONIC`, and durations are also in nanoseconds.\n
+     * Fields related to LScene are only filled for outputs rendered with LScene::handlePaintGL().
+     */
+    struct LOutputFrameStats
+    {
+        UInt64 frame { 0 };             ///< Number of page flips of the output before the frame was painted.
+        UInt64 paintBegin { 0 };        ///< Time at which the paintGL() event was triggered.
+        UInt64 repaintDelay { 0 };      ///< Time paintGL() was delayed before paintBegin, see LOutput::enableRepaintScheduling().
+        UInt64 paintEnd { 0 };          ///< Time at which the frame was handed back to the graphic backend.
+        UInt64 renderLockWait { 0 };    ///< Time spent waiting for the compositor and scene render locks.
+        UInt64 damageCalc { 0 };        ///< Time spent calculating the scene damage.
+        UInt64 draw { 0 };              ///< CPU time spent drawing the scene (GL commands execute asynchronously).
+        UInt32 drawCalls { 0 };         ///< Number of draw calls issued by the output LPainter.
+        UInt64 damageArea { 0 };        ///< Damaged area in surface coordinates, see LOutput::setBufferDamage().
+        bool scanout { false };         ///< `true` if a custom scanout buffer was used instead of compositing.
+        UInt64 pageFlip { 0 };          ///< Time at which the backend notified the page flip, or 0 if it hasn't yet.
+        UInt64 pageFlipLatency { 0 };   ///< Time between paintEnd and pageFlip, or 0 if not page flipped yet.
+    };
+};
+
+#endif // LOUTPUTFRAMESTATS_H
@@ -33,21 +33,22 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
 {
     imp()->painter = this;
 
-    compositor()->imp()->threadsMap[std::this_thread::get_id()].painter = this;
+    LCompositor::LCompositorPrivate::threadPainter = this;
 
     imp()->updateExtensions();
     imp()->updateCPUFormats();
 
-    // Open the vertex/fragment shaders
-    GLchar vShaderStr[] = R"(
+    // Open the vertex/fragment shaders, the vertex shader source is kept for variants compiled later
+    static const GLchar vShaderStr[] = R"(
         precision mediump float;
         precision mediump int;
         uniform mediump vec2 texSize;
         uniform mediump vec4 srcRect;
-        attribute mediump vec4 vertexPosition;
+        attribute highp vec4 vertexPosition;
         varying mediump vec2 v_texcoord;
         uniform lowp int mode;
         uniform bool has90deg;
+        uniform bool batched;
 
         void main()
         {
@@ -55,15 +56,21 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
 
             if (mode == 1)
             {
-                if (vertexPosition.x == -1.0)
-                    v_texcoord.x = srcRect.x;
+                // Texture coords already calculated for each vertex
+                if (batched)
+                    v_texcoord = vertexPosition.zw;
                 else
-                    v_texcoord.x = srcRect.z;
+                {
+                    if (vertexPosition.x == -1.0)
+                        v_texcoord.x = srcRect.x;
+                    else
+                        v_texcoord.x = srcRect.z;
 
-                if (vertexPosition.y == 1.0)
-                    v_texcoord.y = srcRect.y;
-                else
-                    v_texcoord.y = srcRect.w;
+                    if (vertexPosition.y == 1.0)
+                        v_texcoord.y = srcRect.y;
+                    else
+                        v_texcoord.y = srcRect.w;
+                }
 
                 if (has90deg)
                     v_texcoord.yx = v_texcoord;
@@ -181,34 +188,16 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
     std::string fShaderStrScalerExternal = fShaderStr;
     makeExternalShader(fShaderStrScalerExternal);
 
-    imp()->vertexShader = LOpenGL::compileShader(GL_VERTEX_SHADER, vShaderStr);
-    imp()->fragmentShader = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderStr);
-    imp()->fragmentShaderExternal = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderStrExternal.c_str());
-    imp()->fragmentShaderScaler = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderStrScaler);
-    imp()->fragmentShaderScalerExternal = LOpenGL::compileShader(GL_FRAGMENT_SHADER, fShaderStrScalerExternal.c_str());
+    imp()->vertexShaderSource = vShaderStr;
 
-    GLint linked;
+    // Programs are linked from cached binaries when available, shaders are only compiled on misses
 
     /************** SCALER PROGRAM **************/
 
-    imp()->programObjectScaler = glCreateProgram();
-    glAttachShader(imp()->programObjectScaler, imp()->vertexShader);
-    glAttachShader(imp()->programObjectScaler, imp()->fragmentShaderScaler);
+    imp()->programObjectScaler = compositor()->imp()->programCache.link(vShaderStr, fShaderStrScaler);
 
-    // Link the program
-    glLinkProgram(imp()->programObjectScaler);
-
-    // Check the link status
-    glGetProgramiv(imp()->programObjectScaler, GL_LINK_STATUS, &linked);
-
-    if (!linked)
-    {
-        GLint infoLen = 0;
-        glGetProgramiv(imp()->programObjectScaler, GL_INFO_LOG_LENGTH, &infoLen);
-        glDeleteProgram(imp()->programObjectScaler);
-        imp()->programObjectScaler = 0;
+    if (!imp()->programObjectScaler)
         LLog::error("[LPainter::LPainter] Failed to compile scaler shader.");
-    }
     else
     {
         imp()->currentProgram = imp()->programObjectScaler;
@@ -218,24 +207,10 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
 
     /************** SCALER PROGRAM EXTERNAL **************/
 
-    imp()->programObjectScalerExternal = glCreateProgram();
-    glAttachShader(imp()->programObjectScalerExternal, imp()->vertexShader);
-    glAttachShader(imp()->programObjectScalerExternal, imp()->fragmentShaderScalerExternal);
-
-    // Link the program
-    glLinkProgram(imp()->programObjectScalerExternal);
+    imp()->programObjectScalerExternal = compositor()->imp()->programCache.link(vShaderStr, fShaderStrScalerExternal.c_str());
 
-    // Check the link status
-    glGetProgramiv(imp()->programObjectScalerExternal, GL_LINK_STATUS, &linked);
-
-    if (!linked)
-    {
-        GLint infoLen = 0;
-        glGetProgramiv(imp()->programObjectScalerExternal, GL_INFO_LOG_LENGTH, &infoLen);
-        glDeleteProgram(imp()->programObjectScalerExternal);
-        imp()->programObjectScalerExternal = 0;
+    if (!imp()->programObjectScalerExternal)
         LLog::error("[LPainter::LPainter] Failed to compile scaler shader external.");
-    }
     else
     {
         imp()->currentProgram = imp()->programObjectScalerExternal;
@@ -243,61 +218,27 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
         imp()->setupProgramScaler();
     }
 
-    /************** RENDER PROGRAM EXTERNAL **************/
-
-    imp()->programObjectExternal = glCreateProgram();
-    glAttachShader(imp()->programObjectExternal, imp()->vertexShader);
-    glAttachShader(imp()->programObjectExternal, imp()->fragmentShaderExternal);
-
-    // Link the program
-    glLinkProgram(imp()->programObjectExternal);
+    /************** RENDER PROGRAMS **************/
 
-    // Check the link status
-    glGetProgramiv(imp()->programObjectExternal, GL_LINK_STATUS, &linked);
+    imp()->buildProgram(imp()->uberExternal, fShaderStrExternal.c_str());
 
-    if (!linked)
-    {
-        GLint infoLen = 0;
-        glGetProgramiv(imp()->programObjectExternal, GL_INFO_LOG_LENGTH, &infoLen);
-        glDeleteProgram(imp()->programObjectExternal);
+    if (imp()->uberExternal.failed)
         LLog::error("[LPainter::LPainter] Failed to compile external OES shader.");
-    }
-    else
-    {
-        imp()->currentProgram = imp()->programObjectExternal;
-#if LPAINTER_TRACK_UNIFORMS == 1
-        imp()->currentState = &imp()->stateExternal;
-#endif
-        imp()->currentUniforms = &imp()->uniformsExternal;
-        imp()->setupProgram();
-    }
 
-    /************** RENDER PROGRAM **************/
+    imp()->buildProgram(imp()->uber, fShaderStr);
 
-    imp()->programObject = glCreateProgram();
-    glAttachShader(imp()->programObject, imp()->vertexShader);
-    glAttachShader(imp()->programObject, imp()->fragmentShader);
-
-    // Link the program
-    glLinkProgram(imp()->programObject);
+    if (imp()->uber.failed)
+        exit(-1);
 
-    // Check the link status
-    glGetProgramiv(imp()->programObject, GL_LINK_STATUS, &linked);
+    imp()->boundProgram = &imp()->uber;
+    imp()->currentProgram = imp()->uber.id;
+    glUseProgram(imp()->currentProgram);
 
-    if (!linked)
-    {
-        GLint infoLen = 0;
-        glGetProgramiv(imp()->programObject, GL_INFO_LOG_LENGTH, &infoLen);
-        glDeleteProgram(imp()->programObject);
-        exit(-1);
-    }
+    // Load the vertex data
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, imp()->square);
 
-    imp()->currentProgram = imp()->programObject;
-#if LPAINTER_TRACK_UNIFORMS == 1
-    imp()->currentState = &imp()->state;
-#endif
-    imp()->currentUniforms = &imp()->uniforms;
-    imp()->setupProgram();
+    // Enables the vertex array
+    glEnableVertexAttribArray(0);
 
     glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
@@ -318,37 +259,106 @@ LPainter::LPainter() noexcept : LPRIVATE_INIT_UNIQUE(LPainter)
 LPainter::~LPainter() noexcept
 {
     notifyDestruction();
-    glDeleteProgram(imp()->programObject);
-    glDeleteProgram(imp()->programObjectExternal);
-    glDeleteShader(imp()->fragmentShaderExternal);
-    glDeleteShader(imp()->fragmentShader);
-    glDeleteShader(imp()->vertexShader);
+
+    if (LCompositor::LCompositorPrivate::threadPainter == this)
+        LCompositor::LCompositorPrivate::threadPainter = nullptr;
+
+    for (auto &variant : imp()->variants)
+        if (variant.id)
+            glDeleteProgram(variant.id);
+
+    glDeleteProgram(imp()->uber.id);
+    glDeleteProgram(imp()->uberExternal.id);
+    glDeleteProgram(imp()->programObjectScaler);
+    glDeleteProgram(imp()->programObjectScalerExternal);
 }
 
-void LPainter::LPainterPrivate::setupProgram() noexcept
+void LPainter::LPainterPrivate::buildProgram(Program &program, const char *fragmentSource) noexcept
 {
-    glBindAttribLocation(currentProgram, 0, "vertexPosition");
+    program.id = compositor()->imp()->programCache.link(vertexShaderSource, fragmentSource);
 
-    // Use the program object
-    glUseProgram(currentProgram);
+    if (!program.id)
+    {
+        program.failed = true;
+        return;
+    }
 
-    // Load the vertex data
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, square);
+    // Get Uniform Variables
+    program.uniforms.texSize = glGetUniformLocation(program.id, "texSize");
+    program.uniforms.srcRect = glGetUniformLocation(program.id, "srcRect");
+    program.uniforms.activeTexture = glGetUniformLocation(program.id, "tex");
+    program.uniforms.mode = glGetUniformLocation(program.id, "mode");
+    program.uniforms.color= glGetUniformLocation(program.id, "color");
+    program.uniforms.texColorEnabled = glGetUniformLocation(program.id, "texColorEnabled");
+    program.uniforms.colorFactorEnabled = glGetUniformLocation(program.id, "colorFactorEnabled");
+    program.uniforms.alpha = glGetUniformLocation(program.id, "alpha");
+    program.uniforms.premultipliedAlpha = glGetUniformLocation(program.id, "premultipliedAlpha");
+    program.uniforms.has90deg = glGetUniformLocation(program.id, "has90deg");
+    program.uniforms.batched = glGetUniformLocation(program.id, "batched");
+}
 
-    // Enables the vertex array
-    glEnableVertexAttribArray(0);
+void LPainter::LPainterPrivate::compileVariant(UInt32 variant) noexcept
+{
+    static const char *variantShaderStr { R"(
+        uniform mediump sampler2D tex;
+        uniform mediump float alpha;
+        uniform mediump vec3 color;
+        varying mediump vec2 v_texcoord;
 
-    // Get Uniform Variables
-    currentUniforms->texSize = glGetUniformLocation(currentProgram, "texSize");
-    currentUniforms->srcRect = glGetUniformLocation(currentProgram, "srcRect");
-    currentUniforms->activeTexture = glGetUniformLocation(currentProgram, "tex");
-    currentUniforms->mode = glGetUniformLocation(currentProgram, "mode");
-    currentUniforms->color= glGetUniformLocation(currentProgram, "color");
-    currentUniforms->texColorEnabled = glGetUniformLocation(currentProgram, "texColorEnabled");
-    currentUniforms->colorFactorEnabled = glGetUniformLocation(currentProgram, "colorFactorEnabled");
-    currentUniforms->alpha = glGetUniformLocation(currentProgram, "alpha");
-    currentUniforms->premultipliedAlpha = glGetUniformLocation(currentProgram, "premultipliedAlpha");
-    currentUniforms->has90deg = glGetUniformLocation(currentProgram, "has90deg");
+        void main()
+        {
+        #ifdef TEXTURE
+            #ifdef TEX_COLOR
+                gl_FragColor.xyz = color;
+                gl_FragColor.w = texture2D(tex, v_texcoord).w * alpha;
+            #else
+                gl_FragColor = texture2D(tex, v_texcoord);
+
+                #ifdef ALPHA
+                    #ifdef PREMULTIPLIED
+                        gl_FragColor *= alpha;
+                    #else
+                        gl_FragColor.w *= alpha;
+                    #endif
+                #endif
+
+                #ifdef COLOR_FACTOR
+                    gl_FragColor.xyz *= color;
+                #endif
+            #endif
+        #else
+            gl_FragColor = vec4(color, alpha);
+        #endif
+        }
+        )" };
+
+    std::string source;
+
+    if (variant & VariantTexture)
+        source += "#define TEXTURE\n";
+
+    if (variant & VariantTexColor)
+        source += "#define TEX_COLOR\n";
+
+    if (variant & VariantAlpha)
+        source += "#define ALPHA\n";
+
+    if (variant & VariantPremultiplied)
+        source += "#define PREMULTIPLIED\n";
+
+    if (variant & VariantColorFactor)
+        source += "#define COLOR_FACTOR\n";
+
+    source += variantShaderStr;
+
+    if (variant & VariantExternal)
+        makeExternalShader(source);
+
+    Program &program { variants[variant] };
+    buildProgram(program, source.c_str());
+
+    if (program.failed)
+        LLog::error("[LPainter::LPainterPrivate::compileVariant] Failed to compile shader variant %u, using the generic one instead.", variant);
 }
 
 void LPainter::LPainterPrivate::setupProgramScaler() noexcept
@@ -378,6 +388,11 @@ void LPainter::LPainterPrivate::updateExtensions() noexcept
     const char *exts = (const char*)glGetString(GL_EXTENSIONS);
     openGLExtensions.EXT_read_format_bgra = LOpenGL::hasExtension(exts, "GL_EXT_read_format_bgra");
     openGLExtensions.OES_EGL_image = LOpenGL::hasExtension(exts, "GL_OES_EGL_image");
+
+    const char *version = (const char*)glGetString(GL_VERSION);
+    Int32 major { 0 };
+    openGLExtensions.PBO = version && sscanf(version, "OpenGL ES %d", &major) == 1 && major >= 3 &&
+        compositor()->imp()->glMapBufferRange && compositor()->imp()->glUnmapBuffer;
 }
 
 void LPainter::LPainterPrivate::updateCPUFormats() noexcept
@@ -418,10 +433,11 @@ void LPainter::bindTextureMode(const TextureParams &p) noexcept
         imp()->needsBlendFuncUpdate = true;
     }
 
-    if (!imp()->userState.texture.get() || imp()->userState.texture.get()->premultipliedAlpha() != p.texture->premultipliedAlpha())
+    if (!imp()->userState.textureBound || imp()->userState.texturePremultipliedAlpha != p.texture->premultipliedAlpha())
         imp()->needsBlendFuncUpdate = true;
 
-    imp()->userState.texture = p.texture;
+    imp()->userState.textureBound = true;
+    imp()->userState.texturePremultipliedAlpha = p.texture->premultipliedAlpha();
 
     Float32 fbScale;
 
@@ -698,8 +714,11 @@ void LPainter::drawBox(const LBox &box) noexcept
     if (imp()->needsBlendFuncUpdate)
         imp()->updateBlendingParams();
 
+    imp()->shaderSetBatched(false);
     imp()->setViewport(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+    imp()->useProgram();
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    imp()->drawCalls++;
 }
 
 void LPainter::drawRect(const LRect &rect) noexcept
@@ -707,8 +726,11 @@ void LPainter::drawRect(const LRect &rect) noexcept
     if (imp()->needsBlendFuncUpdate)
         imp()->updateBlendingParams();
 
+    imp()->shaderSetBatched(false);
     imp()->setViewport(rect.x(), rect.y(), rect.w(), rect.h());
+    imp()->useProgram();
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    imp()->drawCalls++;
 }
 
 void LPainter::drawRegion(const LRegion &region) noexcept
@@ -718,17 +740,38 @@ void LPainter::drawRegion(const LRegion &region) noexcept
 
     Int32 n;
     const LBox *box = region.boxes(&n);
+
+    if (n > 1 && imp()->regionBatching)
+    {
+        imp()->drawBoxesBatched(box, n);
+        return;
+    }
+
+    imp()->shaderSetBatched(false);
+
     for (Int32 i = 0; i < n; i++)
     {
         imp()->setViewport(box->x1,
                            box->y1,
                            box->x2 - box->x1,
                            box->y2 - box->y1);
+        imp()->useProgram();
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        imp()->drawCalls++;
         box++;
     }
 }
 
+void LPainter::enableRegionBatching(bool enabled) noexcept
+{
+    imp()->regionBatching = enabled;
+}
+
+bool LPainter::regionBatchingEnabled() const noexcept
+{
+    return imp()->regionBatching;
+}
+
 void LPainter::enableCustomTextureColor(bool enabled) noexcept
 {
     if (imp()->userState.customTextureColor == enabled)
@@ -845,7 +888,8 @@ void LPainter::clearScreen() noexcept
 
 void LPainter::bindProgram() noexcept
 {
-    glUseProgram(imp()->programObject);
+    // Rebound with the variant required by the next draw call
+    imp()->boundProgram = nullptr;
 }
 
 void LPainter::setBlendFunc(const LBlendFunc &blendFunc) const noexcept
@@ -117,6 +117,24 @@ public:
      */
     void drawRegion(const LRegion &region) noexcept;
 
+    /**
+     * @brief Enables or disables batched region drawing.
+     *
+     * When enabled, drawRegion() submits all the boxes of a region with a single draw call, calculating the
+     * vertices and texture coordinates on the CPU. When disabled, each box is drawn individually by setting
+     * the viewport to its bounds.
+     *
+     * Enabled by default.
+     */
+    void enableRegionBatching(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if batched region drawing is enabled.
+     *
+     * @see enableRegionBatching()
+     */
+    bool regionBatchingEnabled() const noexcept;
+
     /**
      * @brief Enables or disables a custom texture color.
      *
@@ -381,16 +381,22 @@ bool LPointer::isButtonPressed(LPointerButtonEvent::Button button) const noexcep
 
 LSurface *LPointer::surfaceAt(const LPoint &point)
 {
+    auto &c { *compositor()->imp() };
+
     retry:
-    compositor()->imp()->surfacesListChanged = false;
+    c.surfacesListChanged = false;
+
+    // Only surfaces whose input region bounds contain the point are tested
+    c.updateSurfacesIndex();
+    c.surfacesIndex.query(point, c.surfacesIndexCandidates);
 
-    for (std::list<LSurface*>::const_reverse_iterator s = compositor()->surfaces().rbegin(); s != compositor()->surfaces().rend(); s++)
-        if ((*s)->mapped() && !(*s)->minimized())
+    for (LSurface *s : c.surfacesIndexCandidates)
+        if (s->mapped() && !s->minimized())
         {
-            if ((*s)->inputRegion().containsPoint(point - (*s)->rolePos()))
-                return *s;
+            if (s->inputRegion().containsPoint(point - s->rolePos()))
+                return s;
 
-            if (compositor()->imp()->surfacesListChanged)
+            if (c.surfacesListChanged)
                 goto retry;
         }
 
@@ -111,7 +111,9 @@ public:
      *
      * This method looks for the first mapped surface that contains the point given point.\n
      * It takes into account the surfaces rolePos(), size(), inputRegion() and the reverse order
-     * given by the LCompositor::surfaces() list.
+     * given by the LCompositor::surfaces() list.\n
+     * Only surfaces whose input region bounds contain the point are tested, using an index that is rebuilt after
+     * surfaces are mapped, moved with LSurface::setPos(), committed or restacked.
      *
      * @note Some surface roles do not have an input region such as LCursorRole or LDNDIconRole so these surfaces are always ignored.
      *
@@ -1,201 +1,361 @@
 #include <LRegion.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
 
 using namespace Louvre;
 
-void LRegion::multiply(Float32 factor) noexcept
+/* Pixman reallocates the rectangles of the destination region when it is also one of the operands.
+ * Operations are instead performed into this region, which reuses its storage when large enough,
+ * and then swapped with the destination, which leaves the previous storage here for the next one */
+static pixman_region32_t &scratch() noexcept
 {
-    if (factor == 1.f)
+    struct Scratch
+    {
+        Scratch() noexcept { pixman_region32_init(&region); }
+
+        // Left valid in case static regions are modified while the main thread exits
+        ~Scratch() noexcept { pixman_region32_fini(&region); pixman_region32_init(&region); }
+        pixman_region32_t region;
+    };
+
+    static thread_local Scratch scratch;
+    return scratch.region;
+}
+
+static void commit(pixman_region32_t &region) noexcept
+{
+    std::swap(region, scratch());
+}
+
+// Keeps the storage of a region about to be cleared if larger than the scratch one
+static void recycle(pixman_region32_t &region) noexcept
+{
+    pixman_region32_t &s { scratch() };
+
+    if (region.data && region.data->size > 0 && (!s.data || s.data->size < region.data->size))
+        std::swap(region, s);
+}
+
+// Single rectangle regions don't have data
+static bool isSingleBox(const pixman_region32_t &region) noexcept
+{
+    return !region.data;
+}
+
+static bool boxContains(const pixman_box32_t &a, const pixman_box32_t &b) noexcept
+{
+    return a.x1 <= b.x1 && a.y1 <= b.y1 && a.x2 >= b.x2 && a.y2 >= b.y2;
+}
+
+static bool boxOverlaps(const pixman_box32_t &a, const pixman_box32_t &b) noexcept
+{
+    return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+static void setBox(pixman_region32_t &region, const pixman_box32_t &box) noexcept
+{
+    recycle(region);
+    pixman_region32_fini(&region);
+    pixman_region32_init_with_extents(&region, &box);
+}
+
+// Used to build regions from transformed boxes
+static std::vector<LBox> &boxesBuffer() noexcept
+{
+    static thread_local std::vector<LBox> boxes;
+    return boxes;
+}
+
+void LRegion::clear() noexcept
+{
+    recycle(m_region);
+    pixman_region32_clear(&m_region);
+}
+
+void LRegion::addRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
+{
+    if (w <= 0 || h <= 0)
         return;
 
-    pixman_region32_t tmp;
-    pixman_region32_init(&tmp);
+    const pixman_box32_t box { x, y, x + w, y + h };
 
-    int n;
-    const pixman_box32_t *rects { pixman_region32_rectangles(&m_region, &n) };
+    if (empty() || boxContains(box, m_region.extents))
+    {
+        setBox(m_region, box);
+        return;
+    }
 
-    if (factor == 0.5f)
+    if (isSingleBox(m_region) && boxContains(m_region.extents, box))
+        return;
+
+    pixman_region32_union_rect(&scratch(), &m_region, x, y, w, h);
+    commit(m_region);
+}
+
+void LRegion::addRegion(const LRegion &region) noexcept
+{
+    if (&region == this || region.empty())
+        return;
+
+    if (isSingleBox(region.m_region))
     {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                        &tmp,
-                        &tmp,
-                        rects->x1 >> 1,
-                        rects->y1 >> 1,
-                        (rects->x2 - rects->x1) >> 1,
-                        (rects->y2 - rects->y1) >> 1);
-            rects++;
-        }
+        const pixman_box32_t &box { region.m_region.extents };
+        addRect(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        return;
     }
-    else if (factor == 2.f)
+
+    if (empty())
     {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                        &tmp,
-                        &tmp,
-                        rects->x1 << 1,
-                        rects->y1 << 1,
-                        (rects->x2 - rects->x1) << 1,
-                        (rects->y2 - rects->y1) << 1);
-            rects++;
-        }
+        pixman_region32_copy(&m_region, &region.m_region);
+        return;
     }
-    else
+
+    if (isSingleBox(m_region) && boxContains(m_region.extents, region.m_region.extents))
+        return;
+
+    pixman_region32_union(&scratch(), &m_region, &region.m_region);
+    commit(m_region);
+}
+
+void LRegion::subtractRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
+{
+    if (w <= 0 || h <= 0 || empty())
+        return;
+
+    const pixman_box32_t box { x, y, x + w, y + h };
+
+    if (!boxOverlaps(box, m_region.extents))
+        return;
+
+    if (boxContains(box, m_region.extents))
     {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                &tmp,
-                &tmp,
-                floorf(float(rects->x1) * factor),
-                floorf(float(rects->y1) * factor),
-                ceilf(float(rects->x2 - rects->x1) * factor),
-                ceilf(float(rects->y2 - rects->y1) * factor));
-            rects++;
-        }
+        clear();
+        return;
     }
 
-    pixman_region32_fini(&m_region);
-    m_region = tmp;
+    // Single rectangle regions don't allocate
+    pixman_region32_t rect;
+    pixman_region32_init_with_extents(&rect, &box);
+    pixman_region32_subtract(&scratch(), &m_region, &rect);
+    commit(m_region);
 }
 
-void LRegion::multiply(Float32 xFactor, Float32 yFactor) noexcept
+void LRegion::subtractRegion(const LRegion &region) noexcept
 {
-    if (xFactor == 1.f && yFactor == 1.f)
+    if (empty() || region.empty() || !boxOverlaps(m_region.extents, region.m_region.extents))
+        return;
+
+    if (&region == this)
+    {
+        clear();
         return;
+    }
+
+    if (isSingleBox(region.m_region))
+    {
+        const pixman_box32_t &box { region.m_region.extents };
+        subtractRect(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        return;
+    }
 
-    pixman_region32_t tmp;
-    pixman_region32_init(&tmp);
+    pixman_region32_subtract(&scratch(), &m_region, &region.m_region);
+    commit(m_region);
+}
 
-    int n;
-    const pixman_box32_t *rects { pixman_region32_rectangles(&m_region, &n) };
+void LRegion::intersectRegion(const LRegion &region) noexcept
+{
+    if (&region == this || empty())
+        return;
 
-    for (int i = 0; i < n; i++)
+    if (region.empty() || !boxOverlaps(m_region.extents, region.m_region.extents))
     {
-        pixman_region32_union_rect(
-            &tmp,
-            &tmp,
-            floor(float(rects->x1) * xFactor),
-            floor(float(rects->y1) * yFactor),
-            ceil(float(rects->x2 - rects->x1) * xFactor),
-            ceil(float(rects->y2 - rects->y1) * yFactor));
-        rects++;
+        clear();
+        return;
     }
 
-    pixman_region32_fini(&m_region);
-    m_region = tmp;
+    if (isSingleBox(region.m_region))
+    {
+        const pixman_box32_t &box { region.m_region.extents };
+        clip(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        return;
+    }
+
+    pixman_region32_intersect(&scratch(), &m_region, &region.m_region);
+    commit(m_region);
 }
 
-void LRegion::transform(const LSize &size, LTransform transform) noexcept
+void LRegion::clip(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
 {
-    pixman_region32_intersect_rect(&m_region, &m_region, 0, 0, size.w(), size.h());
+    if (empty())
+        return;
+
+    if (w <= 0 || h <= 0)
+    {
+        clear();
+        return;
+    }
 
-    LBox *boxes;
-    Int32 n, i;
-    pixman_region32_t tmp;
+    const pixman_box32_t box { x, y, x + w, y + h };
 
-    switch (transform)
+    if (boxContains(box, m_region.extents))
+        return;
+
+    if (!boxOverlaps(box, m_region.extents))
     {
-    case LTransform::Normal:
+        clear();
         return;
-    case LTransform::Flipped270:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       size.h() - boxes->y2,
-                                       size.w() - boxes->x2,
-                                       boxes->y2 - boxes->y1,
-                                       boxes->x2 - boxes->x1);
-            boxes++;
-        }
-        break;
-    case LTransform::Flipped90:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       boxes->y1,
-                                       boxes->x1,
-                                       boxes->y2 - boxes->y1,
-                                       boxes->x2 - boxes->x1);
-            boxes++;
-        }
-        break;
-    case LTransform::Flipped180:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       boxes->x1,
-                                       size.h() - boxes->y2,
-                                       boxes->x2 - boxes->x1,
-                                       boxes->y2 - boxes->y1);
-            boxes++;
-        }
-        break;
-    case LTransform::Rotated180:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
+    }
+
+    if (isSingleBox(m_region))
+    {
+        m_region.extents.x1 = std::max(m_region.extents.x1, box.x1);
+        m_region.extents.y1 = std::max(m_region.extents.y1, box.y1);
+        m_region.extents.x2 = std::min(m_region.extents.x2, box.x2);
+        m_region.extents.y2 = std::min(m_region.extents.y2, box.y2);
+        return;
+    }
+
+    pixman_region32_intersect_rect(&scratch(), &m_region, x, y, w, h);
+    commit(m_region);
+}
+
+void LRegion::inverse(const LRect &rect) noexcept
+{
+    const pixman_box32_t box {
+        rect.x(),
+        rect.y(),
+        rect.x() + rect.w(),
+        rect.y() + rect.h()
+    };
+
+    if (empty() && rect.w() > 0 && rect.h() > 0)
+    {
+        setBox(m_region, box);
+        return;
+    }
+
+    pixman_region32_inverse(&scratch(), &m_region, &box);
+    commit(m_region);
+}
+
+void LRegion::setBoxes(const LBox *boxes, Int32 n) noexcept
+{
+    recycle(m_region);
+    pixman_region32_fini(&m_region);
+
+    if (n <= 0)
+        pixman_region32_init(&m_region);
+    else
+        pixman_region32_init_rects(&m_region, (const pixman_box32_t*)boxes, n);
+}
+
+/* Scales the boxes of src into the boxes buffer. The integer paths truncate sizes instead of rounding them up,
+ * which is what multiply(Float32) always did */
+static const std::vector<LBox> &multiplyBoxes(const LRegion &src, Float32 xFactor, Float32 yFactor, bool integerPaths) noexcept
+{
+    std::vector<LBox> &dst { boxesBuffer() };
+    Int32 n;
+    const LBox *box { src.boxes(&n) };
+    dst.resize(n);
+
+    if (integerPaths && xFactor == 0.5f && yFactor == 0.5f)
+    {
+        for (Int32 i = 0; i < n; i++, box++)
         {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       size.w() - boxes->x2,
-                                       size.h() - boxes->y2,
-                                       boxes->x2 - boxes->x1,
-                                       boxes->y2 - boxes->y1);
-            boxes++;
+            dst[i].x1 = box->x1 >> 1;
+            dst[i].y1 = box->y1 >> 1;
+            dst[i].x2 = dst[i].x1 + ((box->x2 - box->x1) >> 1);
+            dst[i].y2 = dst[i].y1 + ((box->y2 - box->y1) >> 1);
         }
-        break;
-    case LTransform::Flipped:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
+    }
+    else if (integerPaths && xFactor == 2.f && yFactor == 2.f)
+    {
+        for (Int32 i = 0; i < n; i++, box++)
         {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       size.w() - boxes->x2,
-                                       boxes->y1,
-                                       boxes->x2 - boxes->x1,
-                                       boxes->y2 - boxes->y1);
-            boxes++;
+            dst[i].x1 = box->x1 << 1;
+            dst[i].y1 = box->y1 << 1;
+            dst[i].x2 = box->x2 << 1;
+            dst[i].y2 = box->y2 << 1;
         }
-        break;
-    case LTransform::Rotated90:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
+    }
+    else
+    {
+        for (Int32 i = 0; i < n; i++, box++)
         {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       boxes->y1,
-                                       size.w() - boxes->x2,
-                                       boxes->y2 - boxes->y1,
-                                       boxes->x2 - boxes->x1);
-            boxes++;
+            dst[i].x1 = floorf(Float32(box->x1) * xFactor);
+            dst[i].y1 = floorf(Float32(box->y1) * yFactor);
+            dst[i].x2 = dst[i].x1 + Int32(ceilf(Float32(box->x2 - box->x1) * xFactor));
+            dst[i].y2 = dst[i].y1 + Int32(ceilf(Float32(box->y2 - box->y1) * yFactor));
         }
-        break;
-    case LTransform::Rotated270:
-        pixman_region32_init(&tmp);
-        boxes = (LBox*)pixman_region32_rectangles(&m_region, &n);
-        for (i = 0; i < n; i++)
+    }
+
+    return dst;
+}
+
+void LRegion::multiply(Float32 factor) noexcept
+{
+    if (factor == 1.f)
+        return;
+
+    const std::vector<LBox> &boxes { multiplyBoxes(*this, factor, factor, true) };
+    setBoxes(boxes.data(), boxes.size());
+}
+
+void LRegion::multiply(Float32 xFactor, Float32 yFactor) noexcept
+{
+    if (xFactor == 1.f && yFactor == 1.f)
+        return;
+
+    const std::vector<LBox> &boxes { multiplyBoxes(*this, xFactor, yFactor, false) };
+    setBoxes(boxes.data(), boxes.size());
+}
+
+void LRegion::transform(const LSize &size, LTransform transform) noexcept
+{
+    clip(0, 0, size.w(), size.h());
+
+    if (transform == LTransform::Normal || empty())
+        return;
+
+    std::vector<LBox> &dst { boxesBuffer() };
+    Int32 n;
+    const LBox *box { boxes(&n) };
+    dst.resize(n);
+
+    for (Int32 i = 0; i < n; i++, box++)
+    {
+        LBox &b { dst[i] };
+
+        switch (transform)
         {
-            pixman_region32_union_rect(&tmp, &tmp,
-                                       size.h() - boxes->y2,
-                                       boxes->x1,
-                                       boxes->y2 - boxes->y1,
-                                       boxes->x2 - boxes->x1);
-            boxes++;
+        case LTransform::Flipped270:
+            b = { size.h() - box->y2, size.w() - box->x2, size.h() - box->y1, size.w() - box->x1 };
+            break;
+        case LTransform::Flipped90:
+            b = { box->y1, box->x1, box->y2, box->x2 };
+            break;
+        case LTransform::Flipped180:
+            b = { box->x1, size.h() - box->y2, box->x2, size.h() - box->y1 };
+            break;
+        case LTransform::Rotated180:
+            b = { size.w() - box->x2, size.h() - box->y2, size.w() - box->x1, size.h() - box->y1 };
+            break;
+        case LTransform::Flipped:
+            b = { size.w() - box->x2, box->y1, size.w() - box->x1, box->y2 };
+            break;
+        case LTransform::Rotated90:
+            b = { box->y1, size.w() - box->x2, box->y2, size.w() - box->x1 };
+            break;
+        case LTransform::Rotated270:
+            b = { size.h() - box->y2, box->x1, size.h() - box->y1, box->x2 };
+            break;
+        default:
+            return;
         }
-        break;
-    default:
-        return;
     }
 
-    pixman_region32_fini(&m_region);
-    m_region = tmp;
+    setBoxes(dst.data(), n);
 }
 
 LPointF LRegion::closestPointFrom(const LPointF &point, Float32 margin) const noexcept
@@ -267,51 +427,6 @@ void LRegion::multiply(LRegion *dst, LRegion *src, Float32 factor) noexcept
         return;
     }
 
-    pixman_region32_clear(&dst->m_region);
-
-    int n;
-    const pixman_box32_t *rects { pixman_region32_rectangles(&src->m_region, &n) };
-
-    if (factor == 0.5f)
-    {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                &dst->m_region,
-                &dst->m_region,
-                rects->x1 >> 1,
-                rects->y1 >> 1,
-                (rects->x2 - rects->x1) >> 1,
-                (rects->y2 - rects->y1) >> 1);
-            rects++;
-        }
-    }
-    else if (factor == 2.f)
-    {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                &dst->m_region,
-                &dst->m_region,
-                rects->x1 << 1,
-                rects->y1 << 1,
-                (rects->x2 - rects->x1) << 1,
-                (rects->y2 - rects->y1) << 1);
-            rects++;
-        }
-    }
-    else
-    {
-        for (int i = 0; i < n; i++)
-        {
-            pixman_region32_union_rect(
-                &dst->m_region,
-                &dst->m_region,
-                floor(float(rects->x1) * factor),
-                floor(float(rects->y1) * factor),
-                ceil(float(rects->x2 - rects->x1) * factor),
-                ceil(float(rects->y2 - rects->y1) * factor));
-            rects++;
-        }
-    }
+    const std::vector<LBox> &boxes { multiplyBoxes(*src, factor, factor, true) };
+    dst->setBoxes(boxes.data(), boxes.size());
 }
@@ -13,6 +13,10 @@
  * It offers methods for performing operations such as additions, subtractions, intersections, and more on rectangles.
  * This class is extensively used by the library for tasks like calculating surface damage, defining opaque, translucent, and input regions, among others.
  * Internally, LRegion employs the algorithm and functions from the [Pixman](http://www.pixman.org/) library.
+ *
+ * Operations that modify the region are performed into a per-thread scratch region which is then swapped with this one,
+ * so the storage of the rectangles is recycled between operations instead of being allocated each time.
+ * Operands consisting of a single rectangle are also handled without calling Pixman when the result is trivial.
  */
 class Louvre::LRegion
 {
@@ -102,10 +106,7 @@ public:
     /**
      * @brief Clears the LRegion, deleting all rectangles.
      */
-    void clear() noexcept
-    {
-        pixman_region32_clear(&m_region);
-    }
+    void clear() noexcept;
 
     /**
      * @brief Adds a rectangle to the LRegion (union operation).
@@ -114,7 +115,7 @@ public:
      */
     void addRect(const LRect &rect) noexcept
     {
-        pixman_region32_union_rect(&m_region, &m_region, rect.x(), rect.y(), rect.w(), rect.h());
+        addRect(rect.x(), rect.y(), rect.w(), rect.h());
     }
 
     /**
@@ -125,7 +126,7 @@ public:
      */
     void addRect(const LPoint &pos, const LSize &size) noexcept
     {
-        pixman_region32_union_rect(&m_region, &m_region, pos.x(), pos.y(), size.w(), size.h());
+        addRect(pos.x(), pos.y(), size.w(), size.h());
     }
 
     /**
@@ -137,7 +138,7 @@ public:
      */
     void addRect(Int32 x, Int32 y, const LSize &size) noexcept
     {
-        pixman_region32_union_rect(&m_region, &m_region, x, y, size.w(), size.h());
+        addRect(x, y, size.w(), size.h());
     }
 
     /**
@@ -149,7 +150,7 @@ public:
      */
     void addRect(const LPoint &pos, Int32 w, Int32 h) noexcept
     {
-        pixman_region32_union_rect(&m_region, &m_region, pos.x(), pos.y(), w, h);
+        addRect(pos.x(), pos.y(), w, h);
     }
 
     /**
@@ -160,21 +161,14 @@ public:
      * @param w The width of the rectangle.
      * @param h The height of the rectangle.
      */
-    void addRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
-    {
-        pixman_region32_union_rect(&m_region, &m_region, x, y, w, h);
-    }
+    void addRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept;
 
     /**
      * @brief Adds the content of another LRegion to this LRegion (union operation).
      *
      * @param region The LRegion to add.
      */
-    void addRegion(const LRegion &region) noexcept
-    {
-        if (&region != this)
-            pixman_region32_union(&m_region, &m_region, &region.m_region);
-    }
+    void addRegion(const LRegion &region) noexcept;
 
     /**
      * @brief Subtracts a rectangle from the LRegion.
@@ -183,10 +177,7 @@ public:
      */
     void subtractRect(const LRect &rect) noexcept
     {
-        pixman_region32_t tmp;
-        pixman_region32_init_rect(&tmp, rect.x(), rect.y(), rect.w(), rect.h());
-        pixman_region32_subtract(&m_region, &m_region, &tmp);
-        pixman_region32_fini(&tmp);        
+        subtractRect(rect.x(), rect.y(), rect.w(), rect.h());
     }
 
     /**
@@ -197,10 +188,7 @@ public:
      */
     void subtractRect(const LPoint &pos, const LSize &size) noexcept
     {
-        pixman_region32_t tmp;
-        pixman_region32_init_rect(&tmp, pos.x(), pos.y(), size.w(), size.h());
-        pixman_region32_subtract(&m_region, &m_region, &tmp);
-        pixman_region32_fini(&tmp);
+        subtractRect(pos.x(), pos.y(), size.w(), size.h());
     }
 
     /**
@@ -212,10 +200,7 @@ public:
      */
     void subtractRect(const LPoint &pos, Int32 w, Int32 h) noexcept
     {
-        pixman_region32_t tmp;
-        pixman_region32_init_rect(&tmp, pos.x(), pos.y(), w, h);
-        pixman_region32_subtract(&m_region, &m_region, &tmp);
-        pixman_region32_fini(&tmp);
+        subtractRect(pos.x(), pos.y(), w, h);
     }
 
     /**
@@ -227,10 +212,7 @@ public:
      */
     void subtractRect(Int32 x, Int32 y, const LSize &size) noexcept
     {
-        pixman_region32_t tmp;
-        pixman_region32_init_rect(&tmp, x, y, size.w(), size.h());
-        pixman_region32_subtract(&m_region, &m_region, &tmp);
-        pixman_region32_fini(&tmp);
+        subtractRect(x, y, size.w(), size.h());
     }
 
     /**
@@ -241,34 +223,21 @@ public:
      * @param w The width of the rectangle.
      * @param h The height of the rectangle.
      */
-    void subtractRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
-    {
-        pixman_region32_t tmp;
-        pixman_region32_init_rect(&tmp, x, y, w, h);
-        pixman_region32_subtract(&m_region, &m_region, &tmp);
-        pixman_region32_fini(&tmp);
-    }
+    void subtractRect(Int32 x, Int32 y, Int32 w, Int32 h) noexcept;
 
     /**
      * @brief Subtracts another LRegion from this LRegion.
      *
      * @param region The LRegion to subtract.
      */
-    void subtractRegion(const LRegion &region) noexcept
-    {
-        pixman_region32_subtract(&m_region, &m_region, &region.m_region);
-    }
+    void subtractRegion(const LRegion &region) noexcept;
 
     /**
      * @brief Intersects this LRegion with another LRegion.
      *
      * @param region The LRegion to intersect with.
      */
-    void intersectRegion(const LRegion &region) noexcept
-    {
-        if (&region != this)
-            pixman_region32_intersect(&m_region, &m_region, &region.m_region);
-    }
+    void intersectRegion(const LRegion &region) noexcept;
 
     /**
      * @brief Multiplies the components of each rectangle in the LRegion by the given factor.
@@ -328,17 +297,7 @@ public:
      *
      * @param rect The rectangle to define the area of inversion.
      */
-    void inverse(const LRect &rect) noexcept
-    {
-        pixman_box32_t r {
-            rect.x(),
-            rect.y(),
-            rect.x() + rect.w(),
-            rect.y() + rect.h()
-        };
-
-        pixman_region32_inverse(&m_region, &m_region, &r);
-    }
+    void inverse(const LRect &rect) noexcept;
 
     /**
      * @brief Check if the LRegion is empty (contains no rectangles).
@@ -357,7 +316,7 @@ public:
      */
     void clip(const LRect &rect) noexcept
     {
-        pixman_region32_intersect_rect(&m_region, &m_region, rect.x(), rect.y(), rect.w(), rect.h());
+        clip(rect.x(), rect.y(), rect.w(), rect.h());
     }
 
     /**
@@ -365,16 +324,13 @@ public:
      */
     void clip(const LPoint &pos, const LSize &size) noexcept
     {
-        pixman_region32_intersect_rect(&m_region, &m_region, pos.x(), pos.y(), size.w(), size.h());
+        clip(pos.x(), pos.y(), size.w(), size.h());
     }
 
     /**
      * @brief Clips the LRegion to the area defined by the specified rectangle.
      */
-    void clip(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
-    {
-        pixman_region32_intersect_rect(&m_region, &m_region, x, y, w, h);
-    }
+    void clip(Int32 x, Int32 y, Int32 w, Int32 h) noexcept;
 
     /**
      * @brief Gets the extents of the LRegion.
@@ -402,6 +358,17 @@ public:
         return (LBox*)pixman_region32_rectangles(&m_region, n);
     }
 
+    /**
+     * @brief Replaces the content of the region with the given boxes.
+     *
+     * The boxes can overlap and be in any order. This is considerably faster than calling addRect() for each of them,
+     * since the region is built in a single pass.
+     *
+     * @param boxes Array of boxes, empty ones are ignored.
+     * @param n The number of boxes.
+     */
+    void setBoxes(const LBox *boxes, Int32 n) noexcept;
+
     /**
      * @brief Applies the specified transform to all rectangles within the given size.
      *
@@ -31,137 +31,210 @@ void LScreenshotRequest::accept(bool accept) noexcept
     resource().m_stateFlags.setFlag(RScreenCopyFrame::Accepted, accept);
 }
 
+// rowLength is the destination pitch in pixels
+static void readPixels(const LRegion &region, const LRect &rectB, Int32 glY, GLenum format, Int32 rowLength, UInt8 *pixels) noexcept
+{
+    Int32 n;
+    const LBox *box { region.boxes(&n) };
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_PACK_ROW_LENGTH, rowLength);
+
+    for (Int32 i = 0; i < n; i++)
+    {
+        glPixelStorei(GL_PACK_SKIP_PIXELS, box[i].x1);
+        glPixelStorei(GL_PACK_SKIP_ROWS, box[i].y1);
+        glReadPixels(rectB.x() + box[i].x1,
+                     glY + box[i].y1,
+                     box[i].x2 - box[i].x1,
+                     box[i].y2 - box[i].y1,
+                     format,
+                     GL_UNSIGNED_BYTE,
+                     pixels);
+    }
+
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+}
+
 Int8 LScreenshotRequest::copy() noexcept
 {
+    LOutput *output { resource().output() };
+    const LRect &rectB { resource().rectB() };
     LRegion damage;
 
-    if (wl_shm_buffer_get(resource().buffer()))
+    if (resource().screenCopyManagerRes())
     {
-        if (resource().screenCopyManagerRes())
-        {
-            auto &outputDamage { resource().screenCopyManagerRes()->damage[resource().output()] };
-            outputDamage.damage.clip(resource().rectB());
+        auto &outputDamage { resource().screenCopyManagerRes()->damage[output] };
+        outputDamage.damage.clip(rectB);
 
-            // No damage, wait...
-            if (resource().waitForDamage() && outputDamage.damage.empty())
-                return 0;
+        // No damage, wait...
+        if (resource().waitForDamage() && outputDamage.damage.empty())
+            return 0;
 
-            damage = std::move(outputDamage.damage);
-        }
-        else
-        {
-            // No damage tracking
-            damage.addRect(resource().rectB());
-        }
+        damage = std::move(outputDamage.damage);
+    }
+    else
+    {
+        // No damage tracking
+        damage.addRect(rectB);
+    }
 
-        wl_shm_buffer *shm_buffer = wl_shm_buffer_get(resource().buffer());
-        wl_shm_buffer_begin_access(shm_buffer);
-        UInt8 *pixels { static_cast<UInt8*>(wl_shm_buffer_get_data(shm_buffer)) };
-        const GLenum format { static_cast<GLenum>(resource().output()->painter()->imp()->openGLExtensions.EXT_read_format_bgra ? GL_BGRA : GL_RGBA) };
-        const Int32 screenH { resource().output()->currentMode()->sizeB().h() };
-        glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        glPixelStorei(GL_PACK_ROW_LENGTH, wl_shm_buffer_get_width(shm_buffer));
-        glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
-        glPixelStorei(GL_PACK_SKIP_ROWS, 0);
-
-        glReadPixels(resource().rectB().x(),
-                     screenH - (resource().rectB().y() + resource().rectB().h()),
-                     resource().rectB().w(),
-                     resource().rectB().h(),
-                     format,
-                     GL_UNSIGNED_BYTE,
-                     pixels);
+    /* Region of the client buffer that needs to be written (local coords). Clients using copy_with_damage
+     * expect the buffer to keep its previous content, so only what changed since it was last written is copied */
+    auto &buffer { output->imp()->screenshotBuffer(resource().buffer()) };
+    LRegion copyRegion;
 
-        wl_shm_buffer_end_access(shm_buffer);
+    if (resource().waitForDamage() && buffer.tracked && buffer.rectB == rectB)
+    {
+        copyRegion = std::move(buffer.damage);
+        copyRegion.clip(rectB);
+        copyRegion.offset(-rectB.x(), -rectB.y());
+    }
+    else
+        copyRegion.addRect(0, rectB.size());
+
+    buffer.damage.clear();
+    buffer.tracked = true;
+    buffer.rectB = rectB;
+
+    const bool async { compositor()->imp()->KHR_fence_sync };
+    LOutput::LOutputPrivate::ScreenshotReadback *readback { nullptr };
+
+    if (wl_shm_buffer *shmBuffer = wl_shm_buffer_get(resource().buffer()))
+    {
+        const GLenum format { static_cast<GLenum>(output->painter()->imp()->openGLExtensions.EXT_read_format_bgra ? GL_BGRA : GL_RGBA) };
+        const Int32 screenH { output->currentMode()->sizeB().h() };
 
         GLint currentFramebuffer { 0 };
         glGetIntegerv(GL_FRAMEBUFFER_BINDING, &currentFramebuffer);
-        resource().flags(currentFramebuffer == 0 ? ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0);
-    }
-    else // DMA buffer
-    {
-        LDMABuffer *dmaBuffer { static_cast<LDMABuffer*>(wl_resource_get_user_data(resource().buffer())) };
-        UInt32 i { 0 };
-        EGLAttrib attribs[19];
-        attribs[i++] = EGL_WIDTH;
-        attribs[i++] = dmaBuffer->planes()->width;
-        attribs[i++] = EGL_HEIGHT;
-        attribs[i++] = dmaBuffer->planes()->height;
-        attribs[i++] = EGL_LINUX_DRM_FOURCC_EXT;
-        attribs[i++] = dmaBuffer->planes()->format;
-        attribs[i++] = EGL_DMA_BUF_PLANE0_FD_EXT;
-        attribs[i++] = dmaBuffer->planes()->fds[0];
-        attribs[i++] = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
-        attribs[i++] = dmaBuffer->planes()->offsets[0];
-        attribs[i++] = EGL_DMA_BUF_PLANE0_PITCH_EXT;
-        attribs[i++] = dmaBuffer->planes()->strides[0];
-        attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT;
-        attribs[i++] = dmaBuffer->planes()->modifiers[0] & 0xFFFFFFFF;
-        attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT;
-        attribs[i++] = dmaBuffer->planes()->modifiers[0] >> 32;
-        attribs[i++] = EGL_IMAGE_PRESERVED_KHR;
-        attribs[i++] = EGL_TRUE;
-        attribs[i++] = EGL_NONE;
-
-        EGLImage image { eglCreateImage(compositor()->eglDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, NULL, attribs) };
-
-        if (image == EGL_NO_IMAGE)
-        {
-            resource().failed();
-            return -1;
-        }
+        const bool yInvert { currentFramebuffer == 0 };
+        resource().flags(yInvert ? ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0);
 
-        GLuint rb, fb;
-        glGenRenderbuffers(1, &rb);
-        glBindRenderbuffer(GL_RENDERBUFFER, rb);
-        compositor()->imp()->glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER, image);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        // Rows of the client buffer are read bottom-up
+        if (yInvert)
+        {
+            LRegion tmp;
+            Int32 n;
+            const LBox *box { copyRegion.boxes(&n) };
 
-        glGenFramebuffers(1, &fb);
-        glBindFramebuffer(GL_FRAMEBUFFER, fb);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb);
-        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            for (Int32 i = 0; i < n; i++)
+                tmp.addRect(box[i].x1, rectB.h() - box[i].y2, box[i].x2 - box[i].x1, box[i].y2 - box[i].y1);
 
-        if (status != GL_FRAMEBUFFER_COMPLETE)
-        {
-            glDeleteFramebuffers(1, &fb);
-            glDeleteRenderbuffers(1, &rb);
-            eglDestroyImage(compositor()->eglDisplay(), image);
-            resource().failed();
-            return -1;
+            copyRegion = std::move(tmp);
         }
 
-        if (resource().screenCopyManagerRes())
+        const Int32 glY { screenH - (rectB.y() + rectB.h()) };
+
+        /* Read into a pixel pack buffer, the pixels are copied to the client buffer
+         * in processScreenshotReadbacks() once the GPU is done, without stalling */
+        if (output->painter()->imp()->openGLExtensions.PBO)
         {
-            auto &outputDamage { resource().screenCopyManagerRes()->damage[resource().output()] };
-            outputDamage.damage.clip(resource().rectB());
+            readback = &output->imp()->screenshotReadbacks.emplace_back();
+            // Rows are packed using the rect width, copied with the client buffer stride later
+            readback->pboStride = rectB.w() * 4;
+            readback->pboSize = rectB.h() * readback->pboStride;
+
+            auto &pbos { output->imp()->screenshotPBOs };
+
+            for (auto it = pbos.begin(); it != pbos.end(); it++)
+            {
+                if (it->second >= readback->pboSize)
+                {
+                    readback->pbo = it->first;
+                    readback->pboSize = it->second;
+                    pbos.erase(it);
+                    break;
+                }
+            }
 
-            // No damage, wait...
-            if (resource().waitForDamage() && outputDamage.damage.empty())
+            if (!readback->pbo)
             {
-                glDeleteFramebuffers(1, &fb);
-                glDeleteRenderbuffers(1, &rb);
-                eglDestroyImage(compositor()->eglDisplay(), image);
-                return 0;
+                glGenBuffers(1, &readback->pbo);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+                glBufferData(GL_PIXEL_PACK_BUFFER, readback->pboSize, NULL, GL_STREAM_READ);
             }
+            else
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
 
-            damage = std::move(outputDamage.damage);
+            readPixels(copyRegion, rectB, glY, format, rectB.w(), nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            readback->copied = std::move(copyRegion);
         }
         else
         {
-            // No damage tracking
-            damage.addRect(resource().rectB());
+            wl_shm_buffer_begin_access(shmBuffer);
+            readPixels(copyRegion, rectB, glY, format, wl_shm_buffer_get_stride(shmBuffer) / 4, static_cast<UInt8*>(wl_shm_buffer_get_data(shmBuffer)));
+            wl_shm_buffer_end_access(shmBuffer);
         }
+    }
+    else // DMA buffer
+    {
+        // Imported once and kept while the client keeps using the buffer
+        if (!buffer.framebuffer)
+        {
+            LDMABuffer *dmaBuffer { static_cast<LDMABuffer*>(wl_resource_get_user_data(resource().buffer())) };
+            UInt32 i { 0 };
+            EGLAttrib attribs[19];
+            attribs[i++] = EGL_WIDTH;
+            attribs[i++] = dmaBuffer->planes()->width;
+            attribs[i++] = EGL_HEIGHT;
+            attribs[i++] = dmaBuffer->planes()->height;
+            attribs[i++] = EGL_LINUX_DRM_FOURCC_EXT;
+            attribs[i++] = dmaBuffer->planes()->format;
+            attribs[i++] = EGL_DMA_BUF_PLANE0_FD_EXT;
+            attribs[i++] = dmaBuffer->planes()->fds[0];
+            attribs[i++] = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
+            attribs[i++] = dmaBuffer->planes()->offsets[0];
+            attribs[i++] = EGL_DMA_BUF_PLANE0_PITCH_EXT;
+            attribs[i++] = dmaBuffer->planes()->strides[0];
+            attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT;
+            attribs[i++] = dmaBuffer->planes()->modifiers[0] & 0xFFFFFFFF;
+            attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT;
+            attribs[i++] = dmaBuffer->planes()->modifiers[0] >> 32;
+            attribs[i++] = EGL_IMAGE_PRESERVED_KHR;
+            attribs[i++] = EGL_TRUE;
+            attribs[i++] = EGL_NONE;
+
+            buffer.image = eglCreateImage(compositor()->eglDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
 
-        LFramebufferWrapper glFb(
-            fb,
-            LSize((Int32)dmaBuffer->planes()->width, (Int32)dmaBuffer->planes()->height),
-            resource().rectB().pos());
+            if (buffer.image == EGL_NO_IMAGE)
+            {
+                buffer.tracked = false;
+                resource().failed();
+                return -1;
+            }
 
-        LTexture *outputTexture { resource().output()->bufferTexture(resource().output()->currentBuffer()) };
-        LPainter &p { *resource().output()->painter() };
+            glGenRenderbuffers(1, &buffer.renderbuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, buffer.renderbuffer);
+            compositor()->imp()->glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER, buffer.image);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glGenFramebuffers(1, &buffer.framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffer.renderbuffer);
+            GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+            if (status != GL_FRAMEBUFFER_COMPLETE)
+            {
+                glDeleteFramebuffers(1, &buffer.framebuffer);
+                glDeleteRenderbuffers(1, &buffer.renderbuffer);
+                eglDestroyImage(compositor()->eglDisplay(), buffer.image);
+                buffer.framebuffer = buffer.renderbuffer = 0;
+                buffer.image = EGL_NO_IMAGE;
+                buffer.tracked = false;
+                resource().failed();
+                return -1;
+            }
+        }
+
+        LFramebufferWrapper glFb(buffer.framebuffer, rectB.size(), rectB.pos());
+        copyRegion.offset(rectB.pos());
+
+        LTexture *outputTexture { output->bufferTexture(output->currentBuffer()) };
+        LPainter &p { *output->painter() };
         LFramebuffer *prevFb { p.boundFramebuffer() };
-        /* TODO: glFinish();*/
         p.setAlpha(1.f);
         p.setColorFactor(1.f, 1.f, 1.f, 1.f);
         p.bindFramebuffer(&glFb);
@@ -175,21 +248,36 @@ Int8 LScreenshotRequest::copy() noexcept
             .srcScale = 1.f,
         });
         glDisable(GL_BLEND);
-        p.drawRect(resource().rectB());
-        /* TODO: glFinish(); */
+        p.drawRegion(copyRegion);
         p.bindFramebuffer(prevFb);
-        glDeleteFramebuffers(1, &fb);
-        glDeleteRenderbuffers(1, &rb);
-        eglDestroyImage(compositor()->eglDisplay(), image);
         resource().flags(0);
+
+        // The client must not read the buffer until the GPU is done
+        if (async)
+            readback = &output->imp()->screenshotReadbacks.emplace_back();
     }
 
     if (resource().waitForDamage())
+        damage.offset(-rectB.x(), -rectB.y());
+
+    if (readback)
     {
-        damage.offset(-resource().rectB().x(), -resource().rectB().y());
-        resource().damage(damage);
+        readback->frame.reset(&resource());
+        readback->buffer = resource().buffer();
+        readback->sendDamage = resource().waitForDamage();
+        readback->damage = std::move(damage);
+
+        if (async)
+            readback->sync = compositor()->imp()->eglCreateSyncKHR(eglGetCurrentDisplay(), EGL_SYNC_FENCE_KHR, NULL);
+
+        glFlush();
+        output->repaint();
+        return 1;
     }
 
+    if (resource().waitForDamage())
+        resource().damage(damage);
+
     /* Backend presentation time may not be available, use LTime instead */
     resource().ready(LTime::ns());
     return 1;
@@ -47,6 +47,14 @@ LSeat::LSeat(const void *params) : LFactoryObject(FactoryObjectType), LPRIVATE_I
     LFactory::createObject<LTouch>(&m_touch);
     LFactory::createObject<LClipboard>(&m_clipboard);
     imp()->enabled = true;
+
+    const char *env { getenv("LOUVRE_POINTER_COALESCING") };
+    imp()->pointerMotionCoalescing = env && atoi(env) == 1;
+
+    env = getenv("LOUVRE_INPUT_RECORD");
+
+    if (env && env[0] != '\0')
+        imp()->inputRecorder.start(env);
 }
 
 LSeat::~LSeat()
@@ -95,6 +103,36 @@ bool LSeat::isUserIdleHint() const noexcept
     return imp()->isUserIdleHint;
 }
 
+void LSeat::enablePointerMotionCoalescing(bool enabled) noexcept
+{
+    imp()->pointerMotionCoalescing = enabled;
+}
+
+bool LSeat::pointerMotionCoalescingEnabled() const noexcept
+{
+    return imp()->pointerMotionCoalescing;
+}
+
+const LSeat::PointerMotionStats &LSeat::pointerMotionStats() const noexcept
+{
+    return imp()->pointerMotionStats;
+}
+
+bool LSeat::startInputRecording(const std::filesystem::path &path) noexcept
+{
+    return imp()->inputRecorder.start(path);
+}
+
+void LSeat::stopInputRecording() noexcept
+{
+    imp()->inputRecorder.stop();
+}
+
+bool LSeat::inputRecordingActive() const noexcept
+{
+    return imp()->inputRecorder.active();
+}
+
 const char *LSeat::name() const noexcept
 {
     if (imp()->libseatHandle)
@@ -4,6 +4,7 @@
 #include <LFactoryObject.h>
 #include <LToplevelRole.h>
 #include <LSurface.h>
+#include <filesystem>
 
 struct libseat;
 
@@ -130,6 +131,72 @@ public:
      */
     bool isUserIdleHint() const noexcept;
 
+    /**
+     * @brief Counters of pointer motion events.
+     *
+     * @see pointerMotionStats()
+     */
+    struct PointerMotionStats
+    {
+        UInt64 received { 0 };   ///< Motion events read from the input backend.
+        UInt64 dispatched { 0 }; ///< LPointerMoveEvents notified, `received - dispatched` were merged.
+    };
+
+    /**
+     * @brief Enables or disables pointer motion coalescing.
+     *
+     * When enabled, input backends that support it (currently `libinput`) merge consecutive relative motion events of the same device
+     * read in a single dispatch into one LPointerMoveEvent with the summed deltas. Hit-testing, focus changes and `wl_pointer.motion` events
+     * then run once per batch instead of once per event, which matters with high polling rate mice.\n
+     * Both the accelerated and unaccelerated deltas are summed, so the total motion, including the one sent to relative pointer clients, is preserved.
+     * Other events, including absolute motion, are never reordered relative to the merged motion.
+     *
+     * Disabled by default, unless the **LOUVRE_POINTER_COALESCING** environment variable is set to `1`.
+     *
+     * @see LPointerMoveEvent::coalescedEvents() and pointerMotionStats().
+     */
+    void enablePointerMotionCoalescing(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if pointer motion coalescing is enabled.
+     *
+     * @see enablePointerMotionCoalescing()
+     */
+    bool pointerMotionCoalescingEnabled() const noexcept;
+
+    /**
+     * @brief Pointer motion counters since the compositor started.
+     *
+     * @see enablePointerMotionCoalescing()
+     */
+    const PointerMotionStats &pointerMotionStats() const noexcept;
+
+    /**
+     * @brief Starts recording input events into a file.
+     *
+     * Every input event notified by the input backend (pointer, keyboard, touch and gestures), along with its timestamps
+     * and the properties of the device that originated it, is appended to a compact binary file. Recordings can be played
+     * back later using the `headless` input backend, see the **LOUVRE_INPUT_REPLAY** environment variable.
+     *
+     * Recording starts automatically if the **LOUVRE_INPUT_RECORD** environment variable is set to a file path.
+     *
+     * @param path Path of the file, overwritten if it already exists.
+     * @return `true` on success, `false` if the file could not be created.
+     */
+    bool startInputRecording(const std::filesystem::path &path) noexcept;
+
+    /**
+     * @brief Stops the current input recording, if any, and closes the file.
+     */
+    void stopInputRecording() noexcept;
+
+    /**
+     * @brief Checks if input events are being recorded.
+     *
+     * @see startInputRecording()
+     */
+    bool inputRecordingActive() const noexcept;
+
     /**
      * @brief The seat name
      *
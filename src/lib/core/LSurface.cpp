@@ -112,23 +112,28 @@ LBaseSurfaceRole *LSurface::role() const noexcept
 
 void LSurface::setPos(const LPoint &newPos) noexcept
 {
-    imp()->pos = newPos;
+    setPos(newPos.x(), newPos.y());
 }
 
 void LSurface::setPos(Int32 x, Int32 y) noexcept
 {
+    if (imp()->pos.x() == x && imp()->pos.y() == y)
+        return;
+
     imp()->pos.setX(x);
     imp()->pos.setY(y);
+    compositor()->imp()->invalidateInputIndex();
+    imp()->repaintViews(true);
 }
 
 void LSurface::setX(Int32 x) noexcept
 {
-    imp()->pos.setX(x);
+    setPos(x, imp()->pos.y());
 }
 
 void LSurface::setY(Int32 y) noexcept
 {
-    imp()->pos.setY(y);
+    setPos(imp()->pos.x(), y);
 }
 
 const LSize &LSurface::sizeB() const noexcept
@@ -176,6 +181,8 @@ void LSurface::setMinimized(bool state)
     if (state != minimized())
     {
         imp()->stateFlags.setFlag(LSurfacePrivate::Minimized, state);
+        compositor()->imp()->invalidateInputIndex();
+        imp()->repaintViews(false);
 
         if (toplevel())
         {
@@ -195,6 +202,8 @@ void LSurface::setMinimized(bool state)
 
 void LSurface::repaintOutputs() noexcept
 {
+    imp()->repaintViews(true);
+
     for (LOutput *o : outputs())
         o->repaint();
 }
@@ -351,6 +360,7 @@ void LSurface::sendOutputEnterEvent(LOutput *output) noexcept
             surfaceResource()->enter(global);
 
     imp()->sendPreferredScale();
+    imp()->updateDMAFeedback();
 
     if (toplevel())
     {
@@ -382,6 +392,7 @@ void LSurface::sendOutputLeaveEvent(LOutput *output) noexcept
                     surfaceResource()->leave(global);
 
             imp()->sendPreferredScale();
+            imp()->updateDMAFeedback();
 
             if (toplevel())
             {
@@ -583,3 +594,11 @@ LSurface *LSurface::nextSurface() const noexcept
     else
         return *std::next(imp()->compositorLink);
 }
+
+bool LSurface::isAbove(const LSurface *surface) const noexcept
+{
+    if (!surface || imp()->stateFlags.check(LSurfacePrivate::Destroyed) || surface->imp()->stateFlags.check(LSurfacePrivate::Destroyed))
+        return false;
+
+    return imp()->orderKey > surface->imp()->orderKey;
+}
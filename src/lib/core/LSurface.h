@@ -560,6 +560,16 @@ public:
      */
     LSurface *nextSurface() const noexcept;
 
+    /**
+     * @brief Check if the surface is positioned after another surface in the compositor surfaces list.
+     *
+     * Surfaces are labeled with order keys, so this check runs in constant time, unlike walking the list with nextSurface().
+     *
+     * @param surface The surface to compare with.
+     * @return `true` if this surface is rendered above the given surface, `false` otherwise or if any of them is destroyed or `nullptr`.
+     */
+    bool isAbove(const LSurface *surface) const noexcept;
+
     /**
      * @name Roles
      *
@@ -849,6 +859,11 @@ public:
      * Override this virtual method if you wish to be informed about changes in the order of the surface within
      * the compositor's list of surfaces.
      *
+     * Reorders are coalesced: this event is triggered once after each batch of dispatched events, and only for surfaces whose
+     * prevSurface() changed, i.e. the moved surfaces and the surfaces that were and are now placed right after them.
+     * The events of a batch are delivered in stacking order, so prevSurface() has already been notified when it also changed.
+     * Surfaces cannot be raised while these events are being delivered.
+     *
      * #### Default Implementation
      * @snippet LSurfaceDefault.cpp orderChanged
      */
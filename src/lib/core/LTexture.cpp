@@ -346,7 +346,6 @@ LTexture *LTexture::copy(const LSize &dst, const LRect &src, bool highQualitySca
         LTexture::LTexturePrivate::setTextureParams(textureId, textureTarget, GL_REPEAT, GL_REPEAT, GL_LINEAR, GL_LINEAR);
         glUniform2f(painter->imp()->currentUniformsScaler->pixelSize, pixSizeW, pixSizeH);
         glUniform2i(painter->imp()->currentUniformsScaler->iters, wScale, hScale);
-        painter->imp()->shaderSetMode(LPainter::LPainterPrivate::LegacyMode);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
         textureCopy = new LTexture(premultipliedAlpha());
         ret = textureCopy->setDataFromGL(texCopy, GL_TEXTURE_2D, DRM_FORMAT_ABGR8888, dstSize, true);
@@ -594,6 +593,8 @@ void LTexture::setFence() noexcept
 
 GLuint LTexture::id(LOutput *output) const noexcept
 {
+    compositor()->imp()->textureUploader.wait(this);
+
     if (initialized())
         return compositor()->imp()->graphicBackend->textureGetID(output, (LTexture*)this);
 
@@ -619,6 +620,7 @@ void LTexture::reset() noexcept
 
     if (m_graphicBackendData)
     {
+        compositor()->imp()->textureUploader.wait(this);
         compositor()->imp()->graphicBackend->textureDestroy(this);
         m_graphicBackendData = nullptr;
     }
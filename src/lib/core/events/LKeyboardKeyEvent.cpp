@@ -1,4 +1,5 @@
 #include <private/LKeyboardPrivate.h>
+#include <private/LSeatPrivate.h>
 #include <LKeyboardKeyEvent.h>
 #include <LUtils.h>
 
@@ -6,6 +7,8 @@ using namespace Louvre;
 
 void LKeyboardKeyEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     LKeyboard::LKeyboardPrivate &keyboard { *seat()->keyboard()->imp() };
 
     // CTRL + ALT + (F1, F2, ..., F10) : Switch TTY.
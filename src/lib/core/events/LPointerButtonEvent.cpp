@@ -1,4 +1,5 @@
 #include <private/LPointerPrivate.h>
+#include <private/LSeatPrivate.h>
 #include <LPointerButtonEvent.h>
 #include <LCompositor.h>
 #include <LUtils.h>
@@ -8,6 +9,8 @@ using namespace Louvre;
 
 void LPointerButtonEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     if (compositor()->state() == LCompositor::Initialized)
     {
         seat()->onEvent(*this);
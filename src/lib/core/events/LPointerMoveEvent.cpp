@@ -1,3 +1,4 @@
+#include <private/LSeatPrivate.h>
 #include <LPointerMoveEvent.h>
 #include <LCompositor.h>
 #include <LSeat.h>
@@ -7,8 +8,12 @@ using namespace Louvre;
 
 void LPointerMoveEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     if (compositor()->state() == LCompositor::Initialized)
     {
+        seat()->imp()->pointerMotionStats.received += m_coalescedEvents;
+        seat()->imp()->pointerMotionStats.dispatched++;
         seat()->onEvent(*this);
         seat()->pointer()->pointerMoveEvent(*this);
     }
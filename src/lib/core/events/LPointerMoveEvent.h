@@ -92,6 +92,27 @@ public:
         return m_deltaUnaccelerated;
     }
 
+    /**
+     * @brief Sets the number of backend motion events merged into this one.
+     *
+     * @see coalescedEvents()
+     */
+    void setCoalescedEvents(UInt32 count) noexcept
+    {
+        m_coalescedEvents = count;
+    }
+
+    /**
+     * @brief Number of backend motion events merged into this one.
+     *
+     * Greater than 1 when the input backend coalesced consecutive motion events, in which case the deltas are the sum
+     * of all of them and the timestamp is the one of the last. See LSeat::enablePointerMotionCoalescing().
+     */
+    UInt32 coalescedEvents() const noexcept
+    {
+        return m_coalescedEvents;
+    }
+
     /**
      * @brief The surface or view local position where the pointer is positioned in surface coordinates.
      */
@@ -100,6 +121,7 @@ public:
 protected:
     LPointF m_delta;
     LPointF m_deltaUnaccelerated;
+    UInt32 m_coalescedEvents { 1 };
 private:
     friend class LInputBackend;
     void notify();
@@ -1,3 +1,4 @@
+#include <private/LSeatPrivate.h>
 #include <LPointerPinchEndEvent.h>
 #include <LCompositor.h>
 #include <LSeat.h>
@@ -7,6 +8,8 @@ using namespace Louvre;
 
 void LPointerPinchEndEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     if (compositor()->state() == LCompositor::Initialized)
     {
         seat()->onEvent(*this);
@@ -1,3 +1,4 @@
+#include <private/LSeatPrivate.h>
 #include <LPointerPinchUpdateEvent.h>
 #include <LCompositor.h>
 #include <LSeat.h>
@@ -7,6 +8,8 @@ using namespace Louvre;
 
 void LPointerPinchUpdateEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     if (compositor()->state() == LCompositor::Initialized)
     {
         seat()->onEvent(*this);
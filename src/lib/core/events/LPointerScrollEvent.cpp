@@ -1,3 +1,4 @@
+#include <private/LSeatPrivate.h>
 #include <LPointerScrollEvent.h>
 #include <LCompositor.h>
 #include <LPointer.h>
@@ -7,6 +8,8 @@ using namespace Louvre;
 
 void LPointerScrollEvent::notify()
 {
+    seat()->imp()->inputRecorder.record(*this);
+
     if (compositor()->state() == LCompositor::Initialized)
     {
         seat()->onEvent(*this);
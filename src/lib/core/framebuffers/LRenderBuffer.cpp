@@ -56,7 +56,16 @@ void LRenderBuffer::setFence() noexcept
 
 void LRenderBuffer::setFramebufferDamage(const LRegion *damage) noexcept
 {
-    L_UNUSED(damage);
+    if (damage)
+    {
+        m_damage = *damage;
+        m_damage.clip(m_rect);
+    }
+    else
+    {
+        m_damage.clear();
+        m_damage.addRect(m_rect);
+    }
 }
 
 LTransform LRenderBuffer::transform() const noexcept
@@ -3,6 +3,7 @@
 
 #include <LTexture.h>
 #include <LFramebuffer.h>
+#include <LRegion.h>
 #include <thread>
 
 /**
@@ -145,6 +146,17 @@ public:
         }
     }
 
+    /**
+     * @brief Region updated by the last render pass.
+     *
+     * Contains the damage passed to setFramebufferDamage() in surface coordinates, clipped to rect().\n
+     * LSceneView sets it each time it renders into the buffer, an empty region means the previous content was retained as-is.
+     */
+    const LRegion &damage() const noexcept
+    {
+        return m_damage;
+    }
+
     Float32 scale() const noexcept override;
     Int32 buffersCount() const noexcept override;
     Int32 currentBufferIndex() const noexcept override;
@@ -159,6 +171,7 @@ private:
     };
     mutable LTexture m_texture { true };
     LRect m_rect;
+    LRegion m_damage;
     Float32 m_scale { 1.f };
     mutable std::unordered_map<std::thread::id, ThreadData> m_threadsMap;
 };
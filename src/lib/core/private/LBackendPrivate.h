@@ -78,6 +78,10 @@ namespace Louvre
         void                                (*outputSetCursorTexture)(LOutput *output, UChar8 *buffer);
         void                                (*outputSetCursorPosition)(LOutput *output, const LPoint &position);
 
+        /* If true, outputSetCursorPosition() can be called from a thread other than the main thread while output threads
+         * are running, the input backend uses it to move the cursor before the main thread processes the events */
+        bool                                (*outputHasThreadSafeCursorPosition)(LOutput *output);
+
         /* OUTPUT MODES */
         const LOutputMode *                 (*outputGetPreferredMode)(LOutput *output);
         const LOutputMode *                 (*outputGetCurrentMode)(LOutput *output);
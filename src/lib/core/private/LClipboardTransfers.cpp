@@ -0,0 +1,402 @@
+#include <private/LClipboardTransfers.h>
+#include <private/LCompositorPrivate.h>
+#include <LLog.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+
+using namespace Louvre;
+
+/* Writing to a pipe whose reader is gone raises SIGPIPE, which would kill the compositor by default.
+ * It is blocked on this thread while writing and the generated one consumed, so the process-wide
+ * disposition chosen by the compositor is left untouched (pipes don't support MSG_NOSIGNAL) */
+class SigpipeGuard
+{
+public:
+    SigpipeGuard() noexcept
+    {
+        sigemptyset(&m_sigpipe);
+        sigaddset(&m_sigpipe, SIGPIPE);
+
+        sigset_t pending;
+        sigpending(&pending);
+        m_wasPending = sigismember(&pending, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &m_sigpipe, &m_prevMask);
+    }
+
+    ~SigpipeGuard() noexcept
+    {
+        sigset_t pending;
+        sigpending(&pending);
+
+        if (!m_wasPending && sigismember(&pending, SIGPIPE) == 1)
+        {
+            const timespec timeout { 0, 0 };
+            while (sigtimedwait(&m_sigpipe, NULL, &timeout) == -1 && errno == EINTR) {}
+        }
+
+        pthread_sigmask(SIG_SETMASK, &m_prevMask, NULL);
+    }
+
+private:
+    sigset_t m_sigpipe, m_prevMask;
+    bool m_wasPending;
+};
+
+FILE *LClipboardTransfers::capture(Int32 *clientFd) noexcept
+{
+    if (m_maxSize == 0)
+    {
+        const char *env { getenv("LOUVRE_CLIPBOARD_MAX_SIZE") };
+        const Int32 maxSizeMiB { env ? atoi(env) : 0 };
+        m_maxSize = size_t(maxSizeMiB > 0 ? maxSizeMiB : 64) * 1024 * 1024;
+    }
+
+    FILE *file { NULL };
+    const Int32 memFd { memfd_create("louvre-clipboard", MFD_CLOEXEC) };
+
+    if (memFd >= 0)
+    {
+        file = fdopen(memFd, "w+");
+
+        if (!file)
+            close(memFd);
+    }
+    else
+        file = tmpfile();
+
+    if (!file)
+    {
+        LLog::error("[LClipboardTransfers::capture] Failed to create clipboard file.");
+        return NULL;
+    }
+
+    Int32 fds[2];
+
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        LLog::error("[LClipboardTransfers::capture] Failed to create pipe.");
+        fclose(file);
+        return NULL;
+    }
+
+    // Only our end is non-blocking, the client may not expect EAGAIN
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    m_captures.emplace_back().file = file;
+    Transfer &transfer { m_transfers.emplace_back() };
+    transfer.engine = this;
+    transfer.file = file;
+    transfer.fd = fds[0];
+    transfer.capture = true;
+    start(transfer);
+
+    *clientFd = fds[1];
+    return file;
+}
+
+void LClipboardTransfers::replay(FILE *file, Int32 fd) noexcept
+{
+    Capture *capture { findCapture(file) };
+
+    if (capture && capture->failed)
+    {
+        close(fd);
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    Transfer &transfer { m_transfers.emplace_back() };
+    transfer.engine = this;
+    transfer.file = file;
+    transfer.fd = fd;
+    transfer.capture = false;
+
+    // Otherwise started once the capture finishes
+    if (!capture || capture->done)
+        start(transfer);
+}
+
+void LClipboardTransfers::cancel(FILE *file) noexcept
+{
+    for (auto it = m_transfers.begin(); it != m_transfers.end();)
+    {
+        if (it->file == file)
+        {
+            if (it->fdSource)
+                wl_event_source_remove(it->fdSource);
+
+            if (it->timeoutSource)
+                wl_event_source_remove(it->timeoutSource);
+
+            close(it->fd);
+            it = m_transfers.erase(it);
+        }
+        else
+            it++;
+    }
+
+    for (auto it = m_captures.begin(); it != m_captures.end(); it++)
+    {
+        if (it->file == file)
+        {
+            m_captures.erase(it);
+            break;
+        }
+    }
+}
+
+void LClipboardTransfers::unit() noexcept
+{
+    while (!m_transfers.empty())
+        cancel(m_transfers.front().file);
+
+    m_captures.clear();
+}
+
+void LClipboardTransfers::start(Transfer &transfer) noexcept
+{
+    if (!transfer.capture)
+    {
+        struct stat st;
+
+        if (fstat(fileno(transfer.file), &st) == 0)
+            transfer.size = st.st_size;
+
+        // The source client has not written any data
+        if (transfer.size == 0)
+        {
+            finish(find(&transfer), true);
+            return;
+        }
+    }
+
+    transfer.started = true;
+    transfer.fdSource = LCompositor::addFdListener(transfer.fd, &transfer, &LClipboardTransfers::onFdEvent,
+                                                   transfer.capture ? WL_EVENT_READABLE : WL_EVENT_WRITABLE);
+    transfer.timeoutSource = wl_event_loop_add_timer(compositor()->imp()->auxEventLoop, &LClipboardTransfers::onTimeout, &transfer);
+    wl_event_source_timer_update(transfer.timeoutSource, Timeout);
+}
+
+void LClipboardTransfers::finish(std::list<Transfer>::iterator it, bool success) noexcept
+{
+    FILE *file { it->file };
+    const bool capture { it->capture };
+
+    if (it->fdSource)
+        wl_event_source_remove(it->fdSource);
+
+    if (it->timeoutSource)
+        wl_event_source_remove(it->timeoutSource);
+
+    close(it->fd);
+    m_transfers.erase(it);
+
+    if (!capture)
+        return;
+
+    Capture *cap { findCapture(file) };
+
+    if (cap)
+    {
+        cap->done = true;
+        cap->failed = !success;
+    }
+
+    // Release the memory, the MIME type is kept but offers no data
+    if (!success && ftruncate(fileno(file), 0) != 0)
+        LLog::warning("[LClipboardTransfers::finish] Failed to truncate clipboard file.");
+
+    // Start or discard pending replays
+    for (auto replay = m_transfers.begin(); replay != m_transfers.end();)
+    {
+        if (replay->file != file || replay->started)
+        {
+            replay++;
+            continue;
+        }
+
+        if (success)
+        {
+            Transfer &transfer { *replay };
+            replay++;
+            start(transfer);
+        }
+        else
+        {
+            close(replay->fd);
+            replay = m_transfers.erase(replay);
+        }
+    }
+}
+
+LClipboardTransfers::Capture *LClipboardTransfers::findCapture(FILE *file) noexcept
+{
+    for (Capture &capture : m_captures)
+        if (capture.file == file)
+            return &capture;
+
+    return nullptr;
+}
+
+std::list<LClipboardTransfers::Transfer>::iterator LClipboardTransfers::find(const Transfer *transfer) noexcept
+{
+    return std::find_if(m_transfers.begin(), m_transfers.end(), [transfer](const Transfer &t){ return &t == transfer; });
+}
+
+Int8 LClipboardTransfers::doCapture(Transfer &transfer) noexcept
+{
+    size_t moved { 0 };
+    ssize_t n;
+    UChar8 buffer[16384];
+
+    while (moved < MaxBytesPerDispatch)
+    {
+        if (transfer.useSyscall)
+        {
+            n = splice(transfer.fd, NULL, fileno(transfer.file), &transfer.offset, 65536, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                transfer.useSyscall = false;
+                continue;
+            }
+        }
+        else
+        {
+            n = read(transfer.fd, buffer, sizeof(buffer));
+
+            if (n > 0)
+            {
+                if (pwrite(fileno(transfer.file), buffer, n, transfer.offset) != n)
+                    return -1;
+
+                transfer.offset += n;
+            }
+        }
+
+        // EOF, the client closed its end
+        if (n == 0)
+            return 0;
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            return -1;
+        }
+
+        moved += n;
+
+        if (size_t(transfer.offset) > m_maxSize)
+        {
+            LLog::warning("[LClipboardTransfers::doCapture] Clipboard data exceeds LOUVRE_CLIPBOARD_MAX_SIZE, discarding it.");
+            return -1;
+        }
+    }
+
+    if (moved > 0)
+        wl_event_source_timer_update(transfer.timeoutSource, Timeout);
+
+    return 1;
+}
+
+Int8 LClipboardTransfers::doReplay(Transfer &transfer) noexcept
+{
+    // Failed writes return EPIPE instead
+    const SigpipeGuard sigpipeGuard;
+    size_t moved { 0 };
+    ssize_t n;
+    UChar8 buffer[16384];
+
+    while (moved < MaxBytesPerDispatch && transfer.offset < transfer.size)
+    {
+        const size_t len { std::min(size_t(transfer.size - transfer.offset), size_t(65536)) };
+
+        if (transfer.useSyscall)
+        {
+            n = sendfile(transfer.fd, fileno(transfer.file), &transfer.offset, len);
+
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                transfer.useSyscall = false;
+                continue;
+            }
+        }
+        else
+        {
+            const ssize_t readN { pread(fileno(transfer.file), buffer, std::min(len, sizeof(buffer)), transfer.offset) };
+
+            if (readN <= 0)
+                return -1;
+
+            // Bytes not written are read again next time
+            n = write(transfer.fd, buffer, readN);
+
+            if (n > 0)
+                transfer.offset += n;
+        }
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            return -1;
+        }
+
+        if (n == 0)
+            break;
+
+        moved += n;
+    }
+
+    if (transfer.offset >= transfer.size)
+        return 0;
+
+    if (moved > 0)
+        wl_event_source_timer_update(transfer.timeoutSource, Timeout);
+
+    return 1;
+}
+
+int LClipboardTransfers::onFdEvent(int /*fd*/, UInt32 mask, void *data) noexcept
+{
+    Transfer &transfer { *static_cast<Transfer*>(data) };
+    LClipboardTransfers &engine { *transfer.engine };
+    Int8 ret;
+
+    // The writer hanging up is expected, captures read until EOF
+    if (!transfer.capture && (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)))
+        ret = -1;
+    else
+        ret = transfer.capture ? engine.doCapture(transfer) : engine.doReplay(transfer);
+
+    if (ret != 1)
+        engine.finish(engine.find(&transfer), ret == 0);
+
+    return 0;
+}
+
+int LClipboardTransfers::onTimeout(void *data) noexcept
+{
+    Transfer &transfer { *static_cast<Transfer*>(data) };
+    LClipboardTransfers &engine { *transfer.engine };
+    LLog::warning("[LClipboardTransfers::onTimeout] Clipboard transfer timed out.");
+    engine.finish(engine.find(&transfer), false);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef LCLIPBOARDTRANSFERS_H
+#define LCLIPBOARDTRANSFERS_H
+
+#include <LNamespaces.h>
+#include <wayland-server.h>
+#include <stdio.h>
+#include <list>
+
+namespace Louvre
+{
+    /* Moves persistent clipboard data between clients and memory from the main event loop.
+     * Fds are non-blocking and only serviced when ready, using splice()/sendfile() when the kernel allows,
+     * so a slow or stuck client never freezes the compositor. */
+    class LClipboardTransfers
+    {
+    public:
+        // Transfers without progress for this long are aborted
+        static constexpr UInt32 Timeout { 10000 };
+
+        // Max bytes moved per fd event, so that a fast client can't monopolize the event loop
+        static constexpr size_t MaxBytesPerDispatch { 1024 * 1024 };
+
+        /* Creates an in-memory file the source client writes into through a pipe.
+         * Returns NULL on failure, otherwise clientFd is the write end to send to the client, which must then be closed */
+        FILE *capture(Int32 *clientFd) noexcept;
+
+        // Writes the captured data into fd once the capture finishes, takes ownership of fd
+        void replay(FILE *file, Int32 fd) noexcept;
+
+        // Aborts all transfers of the file, must be called before closing it
+        void cancel(FILE *file) noexcept;
+
+        void unit() noexcept;
+
+    private:
+        struct Transfer
+        {
+            LClipboardTransfers *engine;
+            FILE *file;
+            Int32 fd;
+            bool capture;
+            bool started { false };
+            bool useSyscall { true }; // splice() or sendfile()
+            off_t offset { 0 };
+            off_t size { 0 };
+            wl_event_source *fdSource { nullptr };
+            wl_event_source *timeoutSource { nullptr };
+        };
+
+        struct Capture
+        {
+            FILE *file;
+            bool done { false };
+            bool failed { false };
+        };
+
+        void start(Transfer &transfer) noexcept;
+        void finish(std::list<Transfer>::iterator it, bool success) noexcept;
+        Capture *findCapture(FILE *file) noexcept;
+        std::list<Transfer>::iterator find(const Transfer *transfer) noexcept;
+
+        // Return 1 if there is still data to move, 0 once finished or -1 on failure
+        Int8 doCapture(Transfer &transfer) noexcept;
+        Int8 doReplay(Transfer &transfer) noexcept;
+        static int onFdEvent(int fd, UInt32 mask, void *data) noexcept;
+        static int onTimeout(void *data) noexcept;
+
+        std::list<Transfer> m_transfers;
+        std::list<Capture> m_captures;
+        size_t m_maxSize { 0 };
+    };
+};
+
+#endif // LCLIPBOARDTRANSFERS_H
@@ -9,6 +9,7 @@
 #include <private/LCursorPrivate.h>
 #include <private/LToplevelRolePrivate.h>
 #include <private/LPopupRolePrivate.h>
+#include <private/LOrderChanges.h>
 #include <private/LFactory.h>
 #include <LActivationTokenManager.h>
 #include <LSessionLockManager.h>
@@ -27,10 +28,13 @@
 #include <EGL/egl.h>
 #include <dlfcn.h>
 #include <string.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 
 #include <private/LFactory.h>
 
@@ -102,6 +106,14 @@ static void clientConnectedEvent(wl_listener *listener, void *data)
         LFactory::createObject<LClient>(params));
 }
 
+// Exits cleanly so that backends are uninitialized and LOUVRE_FRAME_TRACE gets written
+static int exitSignalEvent(int signalNumber, void */*data*/)
+{
+    LLog::debug("[LCompositorPrivate::exitSignalEvent] Received signal %d, finishing.", signalNumber);
+    compositor()->finish();
+    return 0;
+}
+
 bool LCompositor::LCompositorPrivate::initWayland()
 {
     unitWayland();
@@ -146,6 +158,15 @@ bool LCompositor::LCompositorPrivate::initWayland()
     waylandEventLoop = wl_display_get_event_loop(display);
     auxEventLoop = wl_event_loop_create();
 
+    /* Only when a frame trace is requested, since it blocks the signals process-wide and replaces any
+     * handler installed by the compositor. Signals are then read through a signalfd, threads created
+     * later (render threads, input thread, etc) inherit the mask so they are always handled here */
+    if (getenv("LOUVRE_FRAME_TRACE"))
+    {
+        exitSignalSources[0] = wl_event_loop_add_signal(auxEventLoop, SIGTERM, &exitSignalEvent, nullptr);
+        exitSignalSources[1] = wl_event_loop_add_signal(auxEventLoop, SIGINT, &exitSignalEvent, nullptr);
+    }
+
     compositor()->imp()->events[LEV_WAYLAND].events = EPOLLIN | EPOLLOUT;
     compositor()->imp()->events[LEV_WAYLAND].data.fd = wl_event_loop_get_fd(waylandEventLoop);
 
@@ -197,6 +218,15 @@ bool LCompositor::LCompositorPrivate::initWayland()
 
 void LCompositor::LCompositorPrivate::unitWayland()
 {
+    for (wl_event_source *&source : exitSignalSources)
+    {
+        if (source)
+        {
+            wl_event_source_remove(source);
+            source = nullptr;
+        }
+    }
+
     if (auxEventLoop)
     {
         wl_event_loop_destroy(auxEventLoop);
@@ -349,10 +379,16 @@ bool LCompositor::LCompositorPrivate::initGraphicBackend()
     if (WL_bind_wayland_display)
         eglBindWaylandDisplayWL(eglDisplay(), display);
 
+    KHR_fence_sync = LOpenGL::hasExtension(eglExts, "EGL_KHR_fence_sync") &&
+        eglCreateSyncKHR && eglDestroySyncKHR && eglClientWaitSyncKHR;
+
+    programCache.init();
     painter = new LPainter();
     cursor = new LCursor();
     initDRMLeaseGlobals();
     initDMAFeedback();
+    textureUploader.init();
+    imageLoader.init();
     return true;
 }
 
@@ -461,6 +497,10 @@ void LCompositor::LCompositorPrivate::unitInputBackend(bool closeLib)
 
 void LCompositor::LCompositorPrivate::unitGraphicBackend(bool closeLib)
 {
+    writeFrameTrace();
+    textureUploader.unit();
+    imageLoader.unit();
+    clipboardTransfers.unit();
     unitDMAFeedback();
     unitDRMLeaseGlobals();
 
@@ -476,6 +516,8 @@ void LCompositor::LCompositorPrivate::unitGraphicBackend(bool closeLib)
         LLog::debug("[LCompositorPrivate::unitGraphicBackend] Graphic backend uninitialized successfully.");
     }
 
+    programCache.unit();
+
     mainEGLDisplay = EGL_NO_DISPLAY;
     mainEGLContext = EGL_NO_CONTEXT;
 
@@ -630,23 +672,88 @@ bool LCompositor::LCompositorPrivate::loadInputBackend(const std::filesystem::pa
     return true;
 }
 
-void LCompositor::LCompositorPrivate::notifyOrderChangeFromSurface(LSurface *from)
+void LCompositor::LCompositorPrivate::addPendingOrderChange(LSurface *surface) noexcept
+{
+    if (!surface || surface->imp()->stateFlags.check(LSurface::LSurfacePrivate::OrderChangePending))
+        return;
+
+    surface->imp()->stateFlags.add(LSurface::LSurfacePrivate::OrderChangePending);
+    pendingOrderChanges.emplace_back(surface);
+}
+
+void LCompositor::LCompositorPrivate::notifyPendingOrderChanges()
+{
+    if (pendingOrderChanges.empty())
+        return;
+
+    surfaceRaiseAllowedCounter++;
+
+    // orderChanged() may insert surfaces again (e.g. by changing a parent), those are notified in the next iteration
+    std::vector<LWeak<LSurface>> batch;
+
+    while (!pendingOrderChanges.empty())
+    {
+        batch.swap(pendingOrderChanges);
+        batch.erase(std::remove_if(batch.begin(), batch.end(), [](const LWeak<LSurface> &surface){ return !surface; }), batch.end());
+
+        for (LWeak<LSurface> &surface : batch)
+            surface->imp()->stateFlags.remove(LSurface::LSurfacePrivate::OrderChangePending);
+
+        LSortOrderChanges(batch, [](const LWeak<LSurface> &surface){ return surface->imp()->orderKey; });
+
+        // A previous orderChanged() call may have destroyed the surface
+        for (LWeak<LSurface> &surface : batch)
+            if (surface && !surface->imp()->stateFlags.check(LSurface::LSurfacePrivate::Destroyed))
+                surface->orderChanged();
+
+        batch.clear();
+    }
+
+    surfaceRaiseAllowedCounter--;
+}
+
+void LCompositor::LCompositorPrivate::updateOrderKey(LSurface *surface) noexcept
 {
-    compositor()->imp()->surfaceRaiseAllowedCounter++;
+    auto &imp { *surface->imp() };
+    const UInt64 prevKey { surface == surfaces.front() ? 0 : (*std::prev(imp.compositorLink))->imp()->orderKey };
 
-    if (from)
-        for (auto it = from->imp()->compositorLink; it != surfaces.end(); it++)
-            (*it)->orderChanged();
+    if (surface == surfaces.back())
+    {
+        if (prevKey <= UINT64_MAX - orderKeySpacing)
+        {
+            imp.orderKey = prevKey + orderKeySpacing;
+            return;
+        }
+    }
     else
-        for (LSurface *surface : surfaces)
-            surface->orderChanged();
+    {
+        const UInt64 nextKey { (*std::next(imp.compositorLink))->imp()->orderKey };
 
-    compositor()->imp()->surfaceRaiseAllowedCounter--;
+        if (nextKey > prevKey + 1)
+        {
+            imp.orderKey = prevKey + (nextKey - prevKey) / 2;
+            return;
+        }
+    }
+
+    relabelOrderKeys();
 }
 
+void LCompositor::LCompositorPrivate::relabelOrderKeys() noexcept
+{
+    UInt64 key { 0 };
+
+    for (LSurface *surface : surfaces)
+    {
+        key += orderKeySpacing;
+        surface->imp()->orderKey = key;
+    }
+}
 
 void LCompositor::LCompositorPrivate::insertSurfaceAfter(LSurface *prevSurface, LSurface *surfaceToInsert, LBitset<InsertOptions> options)
 {
+    invalidateInputIndex();
+
     if (options.check(UpdateLayers))
     {
         if (prevSurface)
@@ -674,6 +781,10 @@ void LCompositor::LCompositorPrivate::insertSurfaceAfter(LSurface *prevSurface,
 
     if (options.check(UpdateSurfaces) && surfaceToInsert->prevSurface() != prevSurface)
     {
+        // Only the moved surface and its old and new next surfaces get a different previous surface
+        addPendingOrderChange(surfaceToInsert);
+        addPendingOrderChange(surfaceToInsert->nextSurface());
+
         if (prevSurface)
         {
             surfaces.erase(surfaceToInsert->imp()->compositorLink);
@@ -694,7 +805,8 @@ void LCompositor::LCompositorPrivate::insertSurfaceAfter(LSurface *prevSurface,
             surfacesListChanged = true;
         }
 
-        notifyOrderChangeFromSurface(prevSurface);
+        addPendingOrderChange(surfaceToInsert->nextSurface());
+        updateOrderKey(surfaceToInsert);
     }
 
 #if LOUVRE_ASSERT_CHECKS == 1
@@ -704,6 +816,8 @@ void LCompositor::LCompositorPrivate::insertSurfaceAfter(LSurface *prevSurface,
 
 void LCompositor::LCompositorPrivate::insertSurfaceBefore(LSurface *nextSurface, LSurface *surfaceToInsert, LBitset<InsertOptions> options)
 {
+    invalidateInputIndex();
+
     if (options.check(UpdateLayers))
     {
         assert(nextSurface->layer() == surfaceToInsert->layer() && "Surfaces do not belong to the same layer.");
@@ -714,10 +828,13 @@ void LCompositor::LCompositorPrivate::insertSurfaceBefore(LSurface *nextSurface,
 
     if (options.check(UpdateSurfaces) && surfaceToInsert->nextSurface() != nextSurface)
     {
+        addPendingOrderChange(surfaceToInsert);
+        addPendingOrderChange(surfaceToInsert->nextSurface());
+        addPendingOrderChange(nextSurface);
         surfaces.erase(surfaceToInsert->imp()->compositorLink);
         surfaceToInsert->imp()->compositorLink = surfaces.insert(nextSurface->imp()->compositorLink, surfaceToInsert);
         surfacesListChanged = true;
-        notifyOrderChangeFromSurface(surfaceToInsert);
+        updateOrderKey(surfaceToInsert);
     }
 
 #if LOUVRE_ASSERT_CHECKS == 1
@@ -725,47 +842,130 @@ void LCompositor::LCompositorPrivate::insertSurfaceBefore(LSurface *nextSurface,
 #endif
 }
 
-bool LCompositor::LCompositorPrivate::runningAnimations()
+void LCompositor::LCompositorPrivate::updateSurfacesIndex() noexcept
 {
-    bool running { false };
+    const UInt64 serial { inputIndexSerial.load(std::memory_order_relaxed) };
+
+    if (surfacesIndexSerial == serial)
+        return;
+
+    surfacesIndexSerial = serial;
 
-    for (LAnimation *anim : animations)
+    for (LSurface *surface : surfaces)
     {
-        anim->m_processed = false;
+        surfacesIndex.setOrder(surface, surface->imp()->orderKey);
+
+        if (!surface->mapped() || surface->minimized())
+        {
+            surfacesIndex.update(surface, { 0, 0, 0, 0 });
+            continue;
+        }
 
-        if (anim->m_running || anim->m_pendingDestroy)
-            running = true;
+        const LBox &ext { surface->inputRegion().extents() };
+        const LPoint &pos { surface->rolePos() };
+        surfacesIndex.update(surface, { ext.x1 + pos.x(), ext.y1 + pos.y(), ext.x2 + pos.x(), ext.y2 + pos.y() });
     }
+}
 
-    return running;
+void LCompositor::LCompositorPrivate::addAnimation(LAnimation *animation) noexcept
+{
+    animation->m_slot = animations.size();
+    animations.push_back(animation);
 }
 
-void LCompositor::LCompositorPrivate::processAnimations()
+void LCompositor::LCompositorPrivate::removeAnimation(LAnimation *animation) noexcept
 {
-    Int64 elapsed;
-    Int64 duration;
-    retry:
-    animationsVectorChanged = false;
-    for (LAnimation *a : animations)
+    animations[animation->m_slot] = nullptr;
+    removedAnimations++;
+
+    if (animationsIterating == 0 && removedAnimations > animations.size() / 2)
+        compactAnimations();
+}
+
+void LCompositor::LCompositorPrivate::compactAnimations() noexcept
+{
+    size_t count { 0 };
+
+    for (LAnimation *animation : animations)
     {
-        if (a->m_processed)
+        if (!animation)
+            continue;
+
+        animation->m_slot = count;
+        animations[count++] = animation;
+    }
+
+    animations.resize(count);
+    removedAnimations = 0;
+}
+
+// Output an animation is synchronized with, nullptr if all
+static LOutput *animationOutput(LOutput *output) noexcept
+{
+    if (output && (output->state() == LOutput::Initialized || output->state() == LOutput::ChangingMode))
+        return output;
+
+    return nullptr;
+}
+
+bool LCompositor::LCompositorPrivate::hasRunningAnimations(LOutput *output) const noexcept
+{
+    for (const LAnimation *animation : animations)
+    {
+        if (!animation)
+            continue;
+
+        // Destroyed by the next processAnimations() call of any output
+        if (animation->m_pendingDestroy)
+            return true;
+
+        if (!animation->m_running)
+            continue;
+
+        LOutput *target { animationOutput(animation->m_output) };
+
+        if (!output || !target || target == output)
+            return true;
+    }
+
+    return false;
+}
+
+void LCompositor::LCompositorPrivate::processAnimations(LOutput *output)
+{
+    const UInt64 time { output ? output->imp()->predictedPresentationTime() : LOutput::LOutputPrivate::frameStatsTime() };
+    animationsIterating++;
+
+    // The size is checked each time since callbacks may add animations, which are also processed
+    for (size_t i = 0; i < animations.size(); i++)
+    {
+        LAnimation *a { animations[i] };
+
+        if (!a)
             continue;
 
         if (a->m_pendingDestroy)
         {
             delete a;
-            goto retry;
+            continue;
         }
 
-        a->m_processed = true;
-
         if (!a->m_running)
             continue;
 
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - a->m_beginTime).count();
+        if (output)
+        {
+            LOutput *target { animationOutput(a->m_output) };
+
+            if (target && target != output)
+                continue;
+        }
 
-        duration = static_cast<Int64>(a->m_duration);
+        // Outputs are not in phase, the value must never go backwards
+        a->m_lastTime = std::max(a->m_lastTime, time);
+
+        const UInt64 elapsed { a->m_lastTime - a->m_beginTime };
+        const UInt64 duration { static_cast<UInt64>(a->m_duration) * 1000000 };
 
         if (elapsed >= duration)
             a->m_value = 1.0;
@@ -776,18 +976,19 @@ void LCompositor::LCompositorPrivate::processAnimations()
         {
             a->m_onUpdate(a);
 
-            if (animationsVectorChanged)
-                goto retry;
+            // Destroyed by the callback
+            if (animations[i] != a)
+                continue;
         }
 
-        if (a->m_value == 1.0)
-        {
+        if (a->m_running && a->m_value == 1.0)
             a->stop();
-
-            if (animationsVectorChanged)
-                goto retry;
-        }
     }
+
+    animationsIterating--;
+
+    if (animationsIterating == 0 && removedAnimations > 0)
+        compactAnimations();
 }
 
 void LCompositor::LCompositorPrivate::destroyPendingRenderBuffers(std::thread::id *id)
@@ -815,6 +1016,7 @@ void LCompositor::LCompositorPrivate::addRenderBufferToDestroy(std::thread::id t
 void LCompositor::LCompositorPrivate::lock()
 {
     renderMutex.lock();
+    waitParallelDraws();
 }
 
 void LCompositor::LCompositorPrivate::unlock()
@@ -822,6 +1024,32 @@ void LCompositor::LCompositorPrivate::unlock()
     renderMutex.unlock();
 }
 
+void LCompositor::LCompositorPrivate::waitParallelDraws()
+{
+    std::unique_lock<std::mutex> lock { parallelDrawMutex };
+    parallelDrawCond.wait(lock, [this]{ return parallelDraws == 0; });
+}
+
+void LCompositor::LCompositorPrivate::beginParallelDraw()
+{
+    parallelDrawMutex.lock();
+    parallelDraws++;
+    parallelDrawMutex.unlock();
+    renderMutex.unlock();
+}
+
+void LCompositor::LCompositorPrivate::endParallelDraw()
+{
+    parallelDrawMutex.lock();
+    parallelDraws--;
+    parallelDrawMutex.unlock();
+    parallelDrawCond.notify_all();
+
+    /* Other output threads may still be drawing, the caller modifies state they could be reading
+     * once this returns (rest of paintGL(), frame callbacks, etc), so wait for them as well */
+    lock();
+}
+
 void LCompositor::LCompositorPrivate::unlockPoll()
 {
     if (pollUnlocked)
@@ -895,7 +1123,6 @@ void LCompositor::LCompositorPrivate::initDMAFeedback() noexcept
     char name[] = "/louvre-XXXXXXXX";
     Int32 i, rw;
     UInt8 *map, *ptr;
-    UInt16 formatIndex { 0 };
 retryName:
     i = 8;
     while (i < 15)
@@ -950,8 +1177,6 @@ retryName:
         goto err;
     }
 
-    wl_array_init(&dmaFeedback.formatIndices);
-    wl_array_init(&dmaFeedback.scanoutIndices);
     dmaFeedback.device = graphicBackend->backendGetAllocatorDevice()->dev();
 
     ptr = map;
@@ -961,25 +1186,10 @@ retryName:
         ptr+=8;
         memcpy(ptr, &format.modifier, sizeof(UInt64));
         ptr+=8;
-
-        bool isScanout { false };
-
-        for (const auto &scanoutFmt : *graphicBackend->backendGetScanoutDMAFormats())
-        {
-            if (scanoutFmt == format)
-            {
-                *(UInt16*)wl_array_add(&dmaFeedback.scanoutIndices, sizeof(UInt16)) = formatIndex;
-                isScanout = true;
-                break;
-            }
-        }
-
-        if (!isScanout)
-            *(UInt16*)wl_array_add(&dmaFeedback.formatIndices, sizeof(UInt16)) = formatIndex;
-
-        formatIndex++;
     }
 
+    dmaFeedback.tranches.build(*graphicBackend->backendGetDMAFormats(), *graphicBackend->backendGetScanoutDMAFormats());
+
     munmap(map, dmaFeedback.tableSize);
     close(rw);
 
@@ -996,8 +1206,7 @@ void LCompositor::LCompositorPrivate::unitDMAFeedback() noexcept
     {
         close(dmaFeedback.tableFd);
         dmaFeedback.tableFd = -1;
-        wl_array_release(&dmaFeedback.formatIndices);
-        wl_array_release(&dmaFeedback.scanoutIndices);
+        dmaFeedback.tranches.clear();
     }
 }
 
@@ -1021,6 +1230,7 @@ void LCompositor::LCompositorPrivate::assertSurfacesOrder()
         {
             assert(ls == surf);
             surf = surf->nextSurface();
+            assert(!surf || surf->imp()->orderKey > ls->imp()->orderKey);
         }
     }
 
@@ -1045,3 +1255,83 @@ void LCompositor::LCompositorPrivate::unitDRMLeaseGlobals()
         if (gpu->m_leaseGlobal)
             compositor()->removeGlobal(gpu->m_leaseGlobal);
 }
+
+void LCompositor::LCompositorPrivate::collectFrameTrace(LOutput *output)
+{
+    if (!getenv("LOUVRE_FRAME_TRACE"))
+        return;
+
+    const std::vector<LOutputFrameStats> stats { output->frameStats() };
+    const UInt32 tid { output->id() };
+    char buff[512];
+
+    // Output names come from EDIDs or users, so quotes, backslashes and control characters must be escaped
+    std::string name;
+
+    for (const char *c { output->name() }; c && *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            name += '\\';
+            name += *c;
+        }
+        else if (static_cast<UChar8>(*c) < 0x20)
+        {
+            snprintf(buff, sizeof(buff), "\\u%04x", static_cast<UChar8>(*c));
+            name += buff;
+        }
+        else
+            name += *c;
+    }
+
+    // Timestamps are in microseconds
+    frameTrace += "{\"ph\":\"M\",\"pid\":1,\"tid\":";
+    frameTrace += std::to_string(tid);
+    frameTrace += ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+    frameTrace += name;
+    frameTrace += "\"}},\n";
+
+    for (const LOutputFrameStats &f : stats)
+    {
+        snprintf(buff, sizeof(buff),
+                 "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"paintGL\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"args\":{\"frame\":%lu,\"repaintDelay\":%.3f,\"renderLockWait\":%.3f,\"damageCalc\":%.3f,\"draw\":%.3f,"
+                 "\"drawCalls\":%u,\"damageArea\":%lu,\"scanout\":%s,\"pageFlipLatency\":%.3f}},\n",
+                 tid, Float64(f.paintBegin) / 1000.0, Float64(f.paintEnd - f.paintBegin) / 1000.0,
+                 (unsigned long)f.frame, Float64(f.repaintDelay) / 1000.0, Float64(f.renderLockWait) / 1000.0, Float64(f.damageCalc) / 1000.0,
+                 Float64(f.draw) / 1000.0, f.drawCalls, (unsigned long)f.damageArea,
+                 f.scanout ? "true" : "false", Float64(f.pageFlipLatency) / 1000.0);
+        frameTrace += buff;
+
+        if (f.pageFlip != 0)
+        {
+            snprintf(buff, sizeof(buff),
+                     "{\"ph\":\"i\",\"pid\":1,\"tid\":%u,\"name\":\"pageFlip\",\"s\":\"t\",\"ts\":%.3f},\n",
+                     tid, Float64(f.pageFlip) / 1000.0);
+            frameTrace += buff;
+        }
+    }
+}
+
+void LCompositor::LCompositorPrivate::writeFrameTrace()
+{
+    const char *path { getenv("LOUVRE_FRAME_TRACE") };
+
+    if (!path || frameTrace.empty())
+        return;
+
+    FILE *file { fopen(path, "w") };
+
+    if (!file)
+    {
+        LLog::error("[LCompositorPrivate::writeFrameTrace] Failed to open %s.", path);
+        return;
+    }
+
+    // Remove the trailing comma
+    frameTrace.resize(frameTrace.size() - 2);
+    fprintf(file, "{\"traceEvents\":[\n%s\n]}\n", frameTrace.c_str());
+    fclose(file);
+    frameTrace.clear();
+    LLog::debug("[LCompositorPrivate::writeFrameTrace] Frame trace written to %s.", path);
+}
@@ -2,14 +2,23 @@
 #define LCOMPOSITORPRIVATE_H
 
 #include <private/LBackendPrivate.h>
+#include <private/LTextureUploader.h>
+#include <private/LImageLoader.h>
+#include <private/LProgramCache.h>
+#include <private/LClipboardTransfers.h>
+#include <private/LDMAFeedbackTranches.h>
+#include <private/LSpatialIndex.h>
 #include <LCompositor.h>
 #include <LOutput.h>
 #include <LInputDevice.h>
 #include <LRenderBuffer.h>
+#include <LWeak.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <sys/epoll.h>
 #include <map>
+#include <condition_variable>
+#include <atomic>
 #include <unistd.h>
 #include <string>
 #include <filesystem>
@@ -37,6 +46,7 @@ LPRIVATE_CLASS(LCompositor)
         wl_event_loop *auxEventLoop { nullptr }; // Backends + User events
         wl_listener clientConnectedListener;
         wl_event_source *clientDisconnectedEventSource;
+        wl_event_source *exitSignalSources[2] { nullptr, nullptr }; // SIGTERM and SIGINT
 #define LEV_UNLOCK 0
 #define LEV_LIBSEAT 1
 #define LEV_AUX 2
@@ -47,7 +57,25 @@ LPRIVATE_CLASS(LCompositor)
     void unitWayland();
 
     bool surfacesListChanged { false };
-    bool animationsVectorChanged { false };
+
+    /* Hit-testing index of mapped surfaces, see LPointer::surfaceAt(). It's updated lazily when
+     * inputIndexSerial changes, only the cells of surfaces whose bounds changed are moved */
+    std::atomic<UInt64> inputIndexSerial { 1 };
+    UInt64 surfacesIndexSerial { 0 };
+    LSpatialIndex<LSurface*> surfacesIndex;
+    std::vector<LSurface*> surfacesIndexCandidates;
+    void updateSurfacesIndex() noexcept;
+    void invalidateInputIndex() noexcept
+    {
+        inputIndexSerial.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Incremented each time a view changes (see LView::markChanged()). LSceneView skips subtrees
+     * that didn't change since the serial it last calculated them with. Views added, removed
+     * or reordered update viewsStructureSerial, which makes scenes recalculate every view */
+    UInt64 viewsChangeSerial { 1 };
+    UInt64 viewsStructureSerial { 1 };
+
     bool pollUnlocked { false };
     bool isGraphicBackendInitialized { false };
 
@@ -58,6 +86,14 @@ LPRIVATE_CLASS(LCompositor)
         PFNEGLQUERYWAYLANDBUFFERWL eglQueryWaylandBufferWL { NULL };
         PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glEGLImageTargetRenderbufferStorageOES { NULL };
         PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES { NULL };
+        bool KHR_fence_sync { false };
+        PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR { NULL };
+        PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR { NULL };
+        PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR { NULL };
+        PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRange { NULL };
+        PFNGLUNMAPBUFFEROESPROC glUnmapBuffer { NULL };
+        PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES { NULL };
+        PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES { NULL };
         EGLDisplay mainEGLDisplay { EGL_NO_DISPLAY };
         EGLContext mainEGLContext { EGL_NO_CONTEXT };
         LGraphicBackendInterface *graphicBackend { nullptr };
@@ -87,9 +123,35 @@ LPRIVATE_CLASS(LCompositor)
     std::thread::id threadId;
     std::mutex renderMutex;
 
+    /* Waits for scenes being drawn in parallel by output threads (see LScene::enableParallelRendering())
+     * before returning, so the caller gains exclusive access to the compositor state */
     void lock();
     void unlock();
 
+    // Async SHM buffer uploads
+    LTextureUploader textureUploader;
+    LImageLoader imageLoader;
+    LProgramCache programCache;
+    LClipboardTransfers clipboardTransfers;
+
+    /* Chrome trace events of removed outputs, written to LOUVRE_FRAME_TRACE
+     * when the graphic backend is uninitialized (see LOutput::enableFrameStats()) */
+    std::string frameTrace;
+    void collectFrameTrace(LOutput *output);
+    void writeFrameTrace();
+
+    // Parallel scene drawing
+    std::mutex parallelDrawMutex;
+    std::condition_variable parallelDrawCond;
+    UInt32 parallelDraws { 0 };
+    void waitParallelDraws();
+
+    /* Must be called from an output thread that holds the render mutex, it's released until
+     * endParallelDraw() is called, during which the thread must only read state cached beforehand.
+     * endParallelDraw() reacquires it and waits for other parallel draws, so state can be modified after */
+    void beginParallelDraw();
+    void endParallelDraw();
+
     bool loadGraphicBackend(const std::filesystem::path &path);
     bool loadInputBackend(const std::filesystem::path &path);
 
@@ -99,7 +161,18 @@ LPRIVATE_CLASS(LCompositor)
         UpdateLayers    = static_cast<UInt8>(1) << 1
     };
 
-    void notifyOrderChangeFromSurface(LSurface *from);
+    /* Surfaces whose previous surface in the surfaces list changed. Instead of notifying every reorder,
+     * LSurface::orderChanged() is called once per surface after each dispatch batch */
+    std::vector<LWeak<LSurface>> pendingOrderChanges;
+    void addPendingOrderChange(LSurface *surface) noexcept;
+    void notifyPendingOrderChanges();
+
+    /* Order-maintenance labels: keys strictly increase along the surfaces list, so relative order
+     * queries don't require walking it (see LSurface::isAbove()). Inserted surfaces take the middle
+     * of the gap between their neighbours, and the whole list is relabeled when a gap is exhausted */
+    static constexpr UInt64 orderKeySpacing { UInt64(1) << 32 };
+    void updateOrderKey(LSurface *surface) noexcept;
+    void relabelOrderKeys() noexcept;
     void insertSurfaceAfter(LSurface *prevSurface, LSurface *surfaceToInsert, LBitset<InsertOptions> options);
     void insertSurfaceBefore(LSurface *nextSurface, LSurface *surfaceToInsert, LBitset<InsertOptions> options);
 
@@ -108,19 +181,41 @@ LPRIVATE_CLASS(LCompositor)
     std::vector<LOutput*>outputs;
     std::vector<LView*>views;
     std::vector<LTexture*>textures;
-    std::vector<LAnimation*>animations;
     std::vector<LTimer*>oneShotTimers;
 
-    bool runningAnimations();
-    void processAnimations();
+    /* Animations removed while being iterated leave a nullptr, so they can be added and removed from
+     * callbacks without restarting the iteration. Gaps are compacted once no iteration is in progress */
+    std::vector<LAnimation*>animations;
+    UInt32 animationsIterating { 0 };
+    size_t removedAnimations { 0 };
+    void addAnimation(LAnimation *animation) noexcept;
+    void removeAnimation(LAnimation *animation) noexcept;
+    void compactAnimations() noexcept;
+
+    /* Checks if animations synchronized with the output are running (all outputs if nullptr), or if
+     * any animation is pending destruction */
+    bool hasRunningAnimations(LOutput *output) const noexcept;
+
+    /* Updates the animations synchronized with the output using its predicted presentation time,
+     * or all of them using the current time if nullptr */
+    void processAnimations(LOutput *output);
 
     // Thread specific data
     struct ThreadData
     {
-        LPainter *painter { nullptr };
         std::vector<LRenderBuffer::ThreadData> renderBuffersToDestroy;
     };
 
+    /* Dense index of the current thread used to access per-thread data of views (see LView::ThreadSlots),
+     * 0 for the main thread and LOutputPrivate::threadSlot for output threads */
+    static inline thread_local UInt32 threadSlot { 0 };
+
+    // Highest LOutputPrivate::threadSlot assigned so far + 1, views size their thread slots with it
+    UInt32 threadSlotsCount { 1 };
+
+    // Painter of the current thread
+    static inline thread_local LPainter *threadPainter { nullptr };
+
     std::map<std::thread::id, ThreadData> threadsMap;
     void destroyPendingRenderBuffers(std::thread::id *id);
     void addRenderBufferToDestroy(std::thread::id thread, LRenderBuffer::ThreadData &data);
@@ -136,8 +231,7 @@ LPRIVATE_CLASS(LCompositor)
         Int32 tableFd { -1 };
         UInt32 tableSize;
         dev_t device;
-        wl_array formatIndices;
-        wl_array scanoutIndices;
+        LDMAFeedbackTranches tranches;
     } dmaFeedback;
 
     void initDMAFeedback() noexcept;
@@ -1,14 +1,25 @@
 #include <private/LCursorPrivate.h>
+#include <LPointer.h>
+#include <LSurface.h>
+#include <LSeat.h>
 
 LCursor::LCursorPrivate::LCursorPrivate() : defaultTexture() {}
 
 void LCursor::LCursorPrivate::textureUpdate() noexcept
 {
+    if (!readbacks.empty())
+        processReadbacks();
+
     if (!cursor()->output())
         return;
 
     if (!textureChanged && !posChanged)
+    {
+        if (hwStateSharing && hwState.inputSerial != inputSerial)
+            publishHwState();
+
         return;
+    }
 
     const LSizeF sizeBckp { size };
 
@@ -33,69 +44,203 @@ void LCursor::LCursorPrivate::textureUpdate() noexcept
             if (cursor()->hasHardwareSupport(o) && (textureChanged || !found))
             {
                 if (cursor()->enabled(o) && cursor()->hwCompositingEnabled(o))
-                {
-                    texture2Buffer(cursor(), size * o->fractionalScale(), o->transform());
-                    compositor()->imp()->graphicBackend->outputSetCursorTexture(o, buffer);
-                }
+                    requestBuffer(o, size * o->fractionalScale(), o->transform());
                 else
+                {
+                    cancelBufferRequest(o);
                     compositor()->imp()->graphicBackend->outputSetCursorTexture(o, nullptr);
+                }
             }
         }
         else
         {
             LVectorRemoveOneUnordered(intersectedOutputs, o);
+            cancelBufferRequest(o);
             compositor()->imp()->graphicBackend->outputSetCursorTexture(o, nullptr);
         }
 
         if (cursor()->enabled(o) && cursor()->hasHardwareSupport(o))
+            compositor()->imp()->graphicBackend->outputSetCursorPosition(o, cursorOutputPos(newPosS, size, o->rect(), o->transform(), o->fractionalScale()));
+    }
+
+    size = sizeBckp;
+
+    textureChanged = false;
+    posChanged = false;
+
+    if (hwStateSharing)
+        publishHwState();
+}
+
+void LCursor::LCursorPrivate::requestBuffer(LOutput *output, const LSizeF &size, LTransform transform) noexcept
+{
+    const LSize sizeB { size };
+    LCursorBuffer *buffer { findBuffer(texture, sizeB, transform) };
+
+    if (buffer)
+    {
+        cancelBufferRequest(output);
+        compositor()->imp()->graphicBackend->outputSetCursorTexture(output, buffer->pixels);
+        return;
+    }
+
+    for (LCursorReadback &readback : readbacks)
+    {
+        if (readback.texture == texture && readback.textureSerial == texture->serial() &&
+            readback.sizeB == sizeB && readback.transform == transform)
         {
-            LPointF p { newPosS - LPointF(o->pos()) };
+            for (const LWeak<LOutput> &o : readback.outputs)
+                if (o == output)
+                    return;
 
-            if (o->transform() == LTransform::Flipped)
-                p.setX(o->rect().w() - p.x() - size.w());
-            else if (o->transform() == LTransform::Rotated270)
-            {
-                const Float32 tmp { p.x() };
-                p.setX(o->rect().h() - p.y() - size.h());
-                p.setY(tmp);
-            }
-            else if (o->transform() == LTransform::Rotated180)
+            cancelBufferRequest(output);
+            readback.outputs.emplace_back(output);
+            return;
+        }
+    }
+
+    cancelBufferRequest(output);
+    LCursorReadback &readback { readbacks.emplace_back() };
+    readback.texture.reset(texture);
+    readback.textureSerial = texture->serial();
+    readback.sizeB = sizeB;
+    readback.transform = transform;
+    readback.outputs.emplace_back(output);
+    processReadbacks();
+}
+
+void LCursor::LCursorPrivate::cancelBufferRequest(LOutput *output) noexcept
+{
+    for (LCursorReadback &readback : readbacks)
+    {
+        for (auto it = readback.outputs.begin(); it != readback.outputs.end(); it++)
+        {
+            if (*it == output)
             {
-                p.setX(o->rect().w() - p.x() - size.w());
-                p.setY(o->rect().h() - p.y() - size.h());
+                readback.outputs.erase(it);
+                return;
             }
-            else if (o->transform() == LTransform::Rotated90)
+        }
+    }
+}
+
+LCursorBuffer *LCursor::LCursorPrivate::findBuffer(const LTexture *texture, const LSize &sizeB, LTransform transform) noexcept
+{
+    for (auto it = bufferCache.begin(); it != bufferCache.end();)
+    {
+        // The texture was destroyed
+        if (!it->texture)
+        {
+            it = bufferCache.erase(it);
+            continue;
+        }
+
+        if (it->texture == texture && it->textureSerial == texture->serial() && it->sizeB == sizeB && it->transform == transform)
+        {
+            if (it != bufferCache.begin())
+                bufferCache.splice(bufferCache.begin(), bufferCache, it);
+
+            return &bufferCache.front();
+        }
+
+        it++;
+    }
+
+    return nullptr;
+}
+
+void LCursor::LCursorPrivate::processReadbacks() noexcept
+{
+    const EGLDisplay display { compositor()->eglDisplay() };
+
+    while (!readbacks.empty())
+    {
+        LCursorReadback &readback { readbacks.front() };
+
+        if (readbackSync == EGL_NO_SYNC_KHR)
+        {
+            // Nothing to render, the texture was destroyed or updated, or the outputs no longer need it
+            if (!readback.texture || readback.texture->serial() != readback.textureSerial || readback.outputs.empty())
             {
-                const Float32 tmp { p.x() };
-                p.setX(p.y());
-                p.setY(o->rect().w() - tmp - size.h());
+                readbacks.pop_front();
+                continue;
             }
-            else if (o->transform() == LTransform::Flipped270)
+
+            texture2Buffer(cursor(), readback.texture, readback.sizeB, readback.transform);
+
+            if (compositor()->imp()->KHR_fence_sync)
+                readbackSync = compositor()->imp()->eglCreateSyncKHR(display, EGL_SYNC_FENCE_KHR, NULL);
+
+            if (readbackSync == EGL_NO_SYNC_KHR)
+                glFinish();
+            else
+                glFlush();
+        }
+
+        if (readbackSync != EGL_NO_SYNC_KHR)
+        {
+            if (compositor()->imp()->eglClientWaitSyncKHR(display, readbackSync, 0, 0) == EGL_TIMEOUT_EXPIRED_KHR)
             {
-                const Float32 tmp { p.x() };
-                p.setX(o->rect().h() - p.y() - size.h());
-                p.setY(o->rect().w() - tmp - size.w());
+                if (!readbackTimer.running())
+                    readbackTimer.start(1);
+
+                return;
             }
-            else if (o->transform() == LTransform::Flipped180)
-                p.setY(o->rect().h() - p.y() - size.y());
-            else if (o->transform() == LTransform::Flipped90)
+
+            compositor()->imp()->eglDestroySyncKHR(display, readbackSync);
+            readbackSync = EGL_NO_SYNC_KHR;
+        }
+
+        if (readback.texture && readback.texture->serial() == readback.textureSerial)
+        {
+            LCursorBuffer &buffer { bufferCache.emplace_front() };
+            buffer.texture = readback.texture;
+            buffer.textureSerial = readback.textureSerial;
+            buffer.sizeB = readback.sizeB;
+            buffer.transform = readback.transform;
+            readBuffer(buffer.pixels);
+
+            if (bufferCache.size() > BufferCacheSize)
+                bufferCache.pop_back();
+
+            for (const LWeak<LOutput> &o : readback.outputs)
             {
-                const Float32 tmp { p.x() };
-                p.setX(p.y());
-                p.setY(tmp);
+                // Skip outputs that changed their mind while the GPU was busy
+                if (o && isVisible && texture == readback.texture &&
+                    cursor()->enabled(o) && cursor()->hasHardwareSupport(o) && cursor()->hwCompositingEnabled(o) &&
+                    std::find(intersectedOutputs.begin(), intersectedOutputs.end(), o.get()) != intersectedOutputs.end())
+                    compositor()->imp()->graphicBackend->outputSetCursorTexture(o, buffer.pixels);
             }
-
-            compositor()->imp()->graphicBackend->outputSetCursorPosition(o, o->scale() * p / ( o->scale() / o->fractionalScale()) );
         }
+
+        readbacks.pop_front();
     }
+}
 
-    size = sizeBckp;
+void LCursor::LCursorPrivate::readBuffer(UChar8 *pixels) noexcept
+{
+    LPainter *painter { compositor()->imp()->painter };
+    glBindFramebuffer(GL_FRAMEBUFFER, glFramebuffer);
 
-    textureChanged = false;
-    posChanged = false;
+    if (painter->imp()->openGLExtensions.EXT_read_format_bgra)
+        glReadPixels(0, 0, 64, 64, GL_BGRA_EXT , GL_UNSIGNED_BYTE, pixels);
+    else
+    {
+        glReadPixels(0, 0, 64, 64, GL_RGBA , GL_UNSIGNED_BYTE, pixels);
+
+        UInt8 tmp;
+
+        // Convert to RGBA8888
+        for (Int32 i = 0; i < 64*64*4; i+=4)
+        {
+            tmp = pixels[i];
+            pixels[i] = pixels[i+2];
+            pixels[i+2] = tmp;
+        }
+    }
 }
 
-void texture2Buffer(LCursor *cursor, const LSizeF &size, LTransform transform) noexcept
+void texture2Buffer(LCursor *cursor, const LTexture *texture, const LSizeF &size, LTransform transform) noexcept
 {
     LPainter *painter { compositor()->imp()->painter };
     glBindFramebuffer(GL_FRAMEBUFFER, cursor->imp()->glFramebuffer);
@@ -107,9 +252,9 @@ void texture2Buffer(LCursor *cursor, const LSizeF &size, LTransform transform) n
     painter->setClearColor(0.f, 0.f, 0.f, 0.f);
     painter->clearScreen();
     painter->bindTextureMode({
-        .texture = cursor->texture(),
+        .texture = const_cast<LTexture*>(texture),
         .pos = LPoint(0, 0),
-        .srcRect = LRect(0, 0, cursor->texture()->sizeB().w(), cursor->texture()->sizeB().h()),
+        .srcRect = LRect(0, 0, texture->sizeB().w(), texture->sizeB().h()),
         .dstSize = size,
         .srcTransform = Louvre::requiredTransform(transform, LTransform::Normal),
         .srcScale = 1.f,
@@ -117,23 +262,94 @@ void texture2Buffer(LCursor *cursor, const LSizeF &size, LTransform transform) n
     glDisable(GL_BLEND);
     painter->drawRect(LRect(0, size));
     glEnable(GL_BLEND);
+}
 
-    glFinish(); // TODO: Replace with sync
+LPoint cursorOutputPos(const LPointF &posS, const LSizeF &size, const LRect &outputRect, LTransform transform, Float32 fractionalScale) noexcept
+{
+    LPointF p { posS - LPointF(outputRect.pos()) };
 
-    if (painter->imp()->openGLExtensions.EXT_read_format_bgra)
-        glReadPixels(0, 0, 64, 64, GL_BGRA_EXT , GL_UNSIGNED_BYTE, cursor->imp()->buffer);
-    else
+    if (transform == LTransform::Flipped)
+        p.setX(outputRect.w() - p.x() - size.w());
+    else if (transform == LTransform::Rotated270)
+    {
+        const Float32 tmp { p.x() };
+        p.setX(outputRect.h() - p.y() - size.h());
+        p.setY(tmp);
+    }
+    else if (transform == LTransform::Rotated180)
+    {
+        p.setX(outputRect.w() - p.x() - size.w());
+        p.setY(outputRect.h() - p.y() - size.h());
+    }
+    else if (transform == LTransform::Rotated90)
+    {
+        const Float32 tmp { p.x() };
+        p.setX(p.y());
+        p.setY(outputRect.w() - tmp - size.h());
+    }
+    else if (transform == LTransform::Flipped270)
     {
-        glReadPixels(0, 0, 64, 64, GL_RGBA , GL_UNSIGNED_BYTE, cursor->imp()->buffer);
+        const Float32 tmp { p.x() };
+        p.setX(outputRect.h() - p.y() - size.h());
+        p.setY(outputRect.w() - tmp - size.w());
+    }
+    else if (transform == LTransform::Flipped180)
+        p.setY(outputRect.h() - p.y() - size.y());
+    else if (transform == LTransform::Flipped90)
+    {
+        const Float32 tmp { p.x() };
+        p.setX(p.y());
+        p.setY(tmp);
+    }
 
-        UInt8 tmp;
+    return p * fractionalScale;
+}
 
-        // Convert to RGBA8888
-        for (Int32 i = 0; i < 64*64*4; i+=4)
+void LCursor::LCursorPrivate::publishHwState() noexcept
+{
+    std::lock_guard<std::mutex> lock { hwStateMutex };
+    hwState.inputSerial = inputSerial;
+    hwState.outputs.clear();
+
+    const LSurface *focus { seat()->pointer()->focus() };
+
+    // The main thread would not move the cursor like the input thread predicts
+    hwState.enabled = isVisible && texture && cursor()->output() && seat()->enabled() &&
+                      !(focus && focus->pointerConstraintEnabled());
+
+    if (!hwState.enabled)
+        return;
+
+    hwState.pos = cursor()->pos();
+    hwState.size = size;
+    hwState.hotspotS = (hotspotB*size)/LSizeF(texture->sizeB());
+
+    for (LOutput *o : compositor()->outputs())
+    {
+        LCursorHwOutput &out { hwState.outputs.emplace_back() };
+        out.output = o;
+        out.rect = o->rect();
+        out.transform = o->transform();
+        out.fractionalScale = o->fractionalScale();
+
+        /* Outputs not showing the hw cursor yet wait for the main thread to set its buffer, and
+         * outputs whose backend can't move the cursor from another thread wait for the main thread */
+        out.hw = cursor()->enabled(o) && cursor()->hasHardwareSupport(o) && cursor()->hwCompositingEnabled(o) &&
+                 compositor()->imp()->graphicBackend->outputHasThreadSafeCursorPosition(o) &&
+                 std::find(intersectedOutputs.begin(), intersectedOutputs.end(), o) != intersectedOutputs.end();
+    }
+}
+
+void LCursor::LCursorPrivate::removeHwStateOutput(LOutput *output) noexcept
+{
+    std::lock_guard<std::mutex> lock { hwStateMutex };
+
+    for (auto it = hwState.outputs.begin(); it != hwState.outputs.end(); it++)
+    {
+        if (it->output == output)
         {
-            tmp = cursor->imp()->buffer[i];
-            cursor->imp()->buffer[i] = cursor->imp()->buffer[i+2];
-            cursor->imp()->buffer[i+2] = tmp;
+            hwState.outputs.erase(it);
+            return;
         }
     }
 }
@@ -8,10 +8,59 @@
 #include <LClientCursor.h>
 #include <LCursor.h>
 #include <LUtils.h>
+#include <LTimer.h>
+#include <list>
+#include <mutex>
 
 using namespace Louvre;
 
-void texture2Buffer(LCursor *cursor, const LSizeF &size, LTransform transform) noexcept;
+// Renders the cursor texture into the cursor framebuffer, the pixels can be read once the GPU finishes
+void texture2Buffer(LCursor *cursor, const LTexture *texture, const LSizeF &size, LTransform transform) noexcept;
+
+// Pixels of the cursor texture already read back from the GPU for a specific size and transform
+struct LCursorBuffer
+{
+    LWeak<const LTexture> texture;
+    UInt32 textureSerial { 0 };
+    LSize sizeB;
+    LTransform transform { LTransform::Normal };
+    UChar8 pixels[64*64*4];
+};
+
+// Cursor buffer requested by outputs, waiting for the GPU
+struct LCursorReadback
+{
+    LWeak<const LTexture> texture;
+    UInt32 textureSerial { 0 };
+    LSize sizeB;
+    LTransform transform { LTransform::Normal };
+    std::vector<LWeak<LOutput>> outputs;
+};
+
+// Output the input backend thread may move the hw cursor on, see LCursorHwState
+struct LCursorHwOutput
+{
+    LOutput *output;
+    LRect rect;
+    LTransform transform;
+    Float32 fractionalScale;
+    bool hw; // false if only used to keep the cursor within outputs
+};
+
+/* Snapshot of the cursor shared with input backends that read events on their own thread.
+ * They move the hw cursor right away, adding the motion not yet processed by the main thread to pos */
+struct LCursorHwState
+{
+    bool enabled { false };
+    UInt64 inputSerial { 0 }; // Last event already applied to pos
+    LPointF pos;
+    LPointF hotspotS;
+    LSizeF size;
+    std::vector<LCursorHwOutput> outputs;
+};
+
+// Position of a cursor rect (global coords) within the output, as expected by the graphic backend
+LPoint cursorOutputPos(const LPointF &posS, const LSizeF &size, const LRect &outputRect, LTransform transform, Float32 fractionalScale) noexcept;
 
 LPRIVATE_CLASS_NO_COPY(LCursor)
     LCursorPrivate();
@@ -31,7 +80,33 @@ LPRIVATE_CLASS_NO_COPY(LCursor)
     LTexture louvreTexture { true };
     GLuint glFramebuffer, glRenderbuffer;
     LFramebufferWrapper fb { 0, LSize(64, 64) };
-    UChar8 buffer[64*64*4];
+
+    /* Animated cursors usually cycle through a few textures, so recently used buffers are kept
+     * to avoid rendering and reading them back again (most recently used first) */
+    static constexpr size_t BufferCacheSize { 8 };
+    std::list<LCursorBuffer> bufferCache;
+
+    /* Readbacks are processed in order since they share the framebuffer. The front one is
+     * in flight while readbackSync is valid, its pixels are read once the GPU signals the fence */
+    std::list<LCursorReadback> readbacks;
+    EGLSyncKHR readbackSync { EGL_NO_SYNC_KHR };
+    LTimer readbackTimer;
+
+    /* Only used if hwStateSharing was enabled by the input backend, which also updates
+     * inputSerial as its events are processed by the main thread */
+    bool hwStateSharing { false };
+    UInt64 inputSerial { 0 };
+    std::mutex hwStateMutex;
+    LCursorHwState hwState;
+    void publishHwState() noexcept;
+    void removeHwStateOutput(LOutput *output) noexcept;
+
+    // Sets the hw cursor buffer of the output, right away if cached or once read back
+    void requestBuffer(LOutput *output, const LSizeF &size, LTransform transform) noexcept;
+    void processReadbacks() noexcept;
+    void cancelBufferRequest(LOutput *output) noexcept;
+    void readBuffer(UChar8 *pixels) noexcept;
+    LCursorBuffer *findBuffer(const LTexture *texture, const LSize &sizeB, LTransform transform) noexcept;
 
     void setOutput(LOutput *out) noexcept
     {
@@ -0,0 +1,27 @@
+#include <private/LDMAFeedbackTranches.h>
+#include <algorithm>
+
+using namespace Louvre;
+
+void LDMAFeedbackTranches::build(const std::vector<LDMAFormat> &table, const std::vector<LDMAFormat> &scanoutFormats) noexcept
+{
+    clear();
+
+    // Indices are 16 bits wide in the protocol
+    const size_t count { std::min(table.size(), size_t(UINT16_MAX) + 1) };
+    formats.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        formats.push_back(UInt16(i));
+
+        if (std::find(scanoutFormats.begin(), scanoutFormats.end(), table[i]) != scanoutFormats.end())
+            scanout.push_back(UInt16(i));
+    }
+}
+
+void LDMAFeedbackTranches::clear() noexcept
+{
+    formats.clear();
+    scanout.clear();
+}
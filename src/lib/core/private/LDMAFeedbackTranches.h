@@ -0,0 +1,24 @@
+#ifndef LDMAFEEDBACKTRANCHES_H
+#define LDMAFEEDBACKTRANCHES_H
+
+#include <LTexture.h>
+#include <vector>
+
+namespace Louvre
+{
+    /* Tranches of the linux-dmabuf feedback, as indices into the format table,
+     * which lists the formats in the same order as the graphic backend returns them */
+    struct LDMAFeedbackTranches
+    {
+        // Every format of the table, preferred for rendering
+        std::vector<UInt16> formats;
+
+        // Formats of the table primary planes can also scan out, only preferred by fullscreen surfaces
+        std::vector<UInt16> scanout;
+
+        void build(const std::vector<LDMAFormat> &table, const std::vector<LDMAFormat> &scanoutFormats) noexcept;
+        void clear() noexcept;
+    };
+};
+
+#endif // LDMAFEEDBACKTRANCHES_H
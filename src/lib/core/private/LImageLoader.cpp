@@ -0,0 +1,327 @@
+#include <private/LImageLoader.h>
+#include <other/stb_image.h>
+#include <LCompositor.h>
+#include <LTexture.h>
+#include <LUtils.h>
+#include <LLog.h>
+#include <sys/eventfd.h>
+#include <pixman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace Louvre;
+
+bool LImageLoader::init() noexcept
+{
+    unit();
+
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_eventFd < 0)
+    {
+        LLog::error("[LImageLoader::init] Failed to create eventfd. Images will be decoded synchronously.");
+        return false;
+    }
+
+    m_eventSource = LCompositor::addFdListener(m_eventFd, this, &LImageLoader::onJobsFinished);
+    m_exit = false;
+    return true;
+}
+
+void LImageLoader::unit() noexcept
+{
+    m_mutex.lock();
+    m_exit = true;
+    m_mutex.unlock();
+    m_cond.notify_all();
+
+    for (std::thread &thread : m_threads)
+        thread.join();
+
+    m_threads.clear();
+
+    // The compositor is being uninitialized, pending requests are dropped without notifying them
+    for (std::list<Job*> *jobs : { &m_queue, &m_finished })
+    {
+        for (Job *job : *jobs)
+        {
+            free(job->image.pixels);
+            delete job;
+        }
+
+        jobs->clear();
+    }
+
+    for (auto &pair : m_cache)
+        delete pair.second.texture;
+
+    m_cache.clear();
+
+    if (m_eventSource)
+    {
+        LCompositor::removeFdListener(m_eventSource);
+        m_eventSource = nullptr;
+    }
+
+    if (m_eventFd >= 0)
+    {
+        close(m_eventFd);
+        m_eventFd = -1;
+    }
+}
+
+void LImageLoader::load(const std::filesystem::path &file, const LSize &maxSize, bool cached, const Callback &callback) noexcept
+{
+    Job *job { new Job() };
+    job->file = file;
+    job->maxSize = maxSize;
+
+    if (cached)
+    {
+        job->cacheKey = file.string() + '@' + std::to_string(maxSize.w()) + 'x' + std::to_string(maxSize.h());
+        auto it { m_cache.find(job->cacheKey) };
+
+        if (it != m_cache.end())
+        {
+            delete job;
+
+            if (it->second.texture)
+            {
+                if (callback)
+                    callback(it->second.texture);
+            }
+            else
+                it->second.waiting.push_back(callback);
+
+            return;
+        }
+
+        m_cache[job->cacheKey].waiting.push_back(callback);
+    }
+    else
+        job->callback = callback;
+
+    if (m_eventFd < 0)
+    {
+        job->decoded = decode(job->file, job->maxSize, job->image);
+        finishJob(job);
+        return;
+    }
+
+    m_mutex.lock();
+
+    if (m_threads.empty())
+    {
+        const UInt32 count { std::clamp(std::thread::hardware_concurrency() / 2, 1u, MaxThreads) };
+
+        for (UInt32 i = 0; i < count; i++)
+            m_threads.emplace_back(&LImageLoader::workerLoop, this);
+    }
+
+    m_queue.push_back(job);
+    m_mutex.unlock();
+    m_cond.notify_one();
+}
+
+void LImageLoader::clearCache() noexcept
+{
+    for (auto it = m_cache.begin(); it != m_cache.end();)
+    {
+        if (it->second.texture)
+        {
+            delete it->second.texture;
+            it = m_cache.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+LSize LImageLoader::fitSize(const LSize &size, const LSize &maxSize) noexcept
+{
+    if (size.w() <= 0 || size.h() <= 0)
+        return size;
+
+    Float64 scale { 1.0 };
+
+    if (maxSize.w() > 0 && size.w() > maxSize.w())
+        scale = std::min(scale, Float64(maxSize.w()) / Float64(size.w()));
+
+    if (maxSize.h() > 0 && size.h() > maxSize.h())
+        scale = std::min(scale, Float64(maxSize.h()) / Float64(size.h()));
+
+    if (scale >= 1.0)
+        return size;
+
+    return LSize(
+        std::max(1, Int32(std::round(Float64(size.w()) * scale))),
+        std::max(1, Int32(std::round(Float64(size.h()) * scale))));
+}
+
+void LImageLoader::swizzle(UInt8 *pixels, const LSize &size, UInt32 stride) noexcept
+{
+    /* Pixman picks SIMD paths for the conversion when available. The source and destination
+     * share the buffer, which is fine since each scanline is fetched before being stored */
+    pixman_image_t *src { pixman_image_create_bits_no_clear(PIXMAN_a8b8g8r8, size.w(), size.h(), (uint32_t*)pixels, stride) };
+    pixman_image_t *dst { pixman_image_create_bits_no_clear(PIXMAN_a8r8g8b8, size.w(), size.h(), (uint32_t*)pixels, stride) };
+    pixman_image_composite32(PIXMAN_OP_SRC, src, nullptr, dst, 0, 0, 0, 0, 0, 0, size.w(), size.h());
+    pixman_image_unref(src);
+    pixman_image_unref(dst);
+}
+
+bool LImageLoader::decode(const std::filesystem::path &file, const LSize &maxSize, Image &image) noexcept
+{
+    Int32 width, height, channels;
+    UInt8 *pixels { stbi_load(file.c_str(), &width, &height, &channels, STBI_rgb_alpha) };
+
+    if (!pixels)
+    {
+        LLog::error("[LImageLoader::decode] Failed to load image %s: %s.", file.c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    const LSize srcSize { width, height };
+    image.size = fitSize(srcSize, maxSize);
+
+    if (image.size == srcSize)
+    {
+        image.pixels = pixels;
+        image.stride = width * 4;
+        swizzle(image.pixels, image.size, image.stride);
+        return true;
+    }
+
+    image.stride = image.size.w() * 4;
+    image.pixels = static_cast<UInt8*>(malloc(image.stride * image.size.h()));
+
+    if (!image.pixels)
+    {
+        LLog::error("[LImageLoader::decode] Failed to allocate memory for image %s.", file.c_str());
+        free(pixels);
+        return false;
+    }
+
+    // Downscale and convert to ARGB8888 in a single pass, box filtering avoids aliasing on large reductions
+    pixman_image_t *src { pixman_image_create_bits_no_clear(PIXMAN_a8b8g8r8, width, height, (uint32_t*)pixels, width * 4) };
+    pixman_image_t *dst { pixman_image_create_bits_no_clear(PIXMAN_a8r8g8b8, image.size.w(), image.size.h(), (uint32_t*)image.pixels, image.stride) };
+
+    const pixman_fixed_t scaleX { pixman_double_to_fixed(Float64(width) / Float64(image.size.w())) };
+    const pixman_fixed_t scaleY { pixman_double_to_fixed(Float64(height) / Float64(image.size.h())) };
+    pixman_transform_t transform;
+    pixman_transform_init_scale(&transform, scaleX, scaleY);
+    pixman_image_set_transform(src, &transform);
+    pixman_image_set_repeat(src, PIXMAN_REPEAT_PAD);
+
+    int nParams { 0 };
+    pixman_fixed_t *params { pixman_filter_create_separable_convolution(&nParams, scaleX, scaleY,
+        PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, 1, 1) };
+
+    if (params)
+    {
+        pixman_image_set_filter(src, PIXMAN_FILTER_SEPARABLE_CONVOLUTION, params, nParams);
+        free(params);
+    }
+    else
+        pixman_image_set_filter(src, PIXMAN_FILTER_GOOD, nullptr, 0);
+
+    pixman_image_composite32(PIXMAN_OP_SRC, src, nullptr, dst, 0, 0, 0, 0, 0, 0, image.size.w(), image.size.h());
+    pixman_image_unref(src);
+    pixman_image_unref(dst);
+    free(pixels);
+    return true;
+}
+
+void LImageLoader::workerLoop() noexcept
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    while (true)
+    {
+        m_cond.wait(lock, [this]{ return m_exit || !m_queue.empty(); });
+
+        if (m_exit)
+            break;
+
+        Job *job { m_queue.front() };
+        m_queue.pop_front();
+        lock.unlock();
+        job->decoded = decode(job->file, job->maxSize, job->image);
+        lock.lock();
+        m_finished.push_back(job);
+
+        const UInt64 one { 1 };
+        const ssize_t n { write(m_eventFd, &one, sizeof(one)) };
+        L_UNUSED(n);
+    }
+}
+
+void LImageLoader::finishJob(Job *job) noexcept
+{
+    LTexture *texture { nullptr };
+
+    if (job->decoded)
+    {
+        texture = new LTexture();
+
+        if (!texture->setDataFromMainMemory(job->image.size, job->image.stride, DRM_FORMAT_ARGB8888, job->image.pixels))
+        {
+            LLog::error("[LImageLoader::finishJob] Failed to create texture from %s.", job->file.c_str());
+            delete texture;
+            texture = nullptr;
+        }
+
+        free(job->image.pixels);
+        job->image.pixels = nullptr;
+    }
+
+    if (job->cacheKey.empty())
+    {
+        if (job->callback)
+            job->callback(texture);
+
+        delete job;
+        return;
+    }
+
+    auto it { m_cache.find(job->cacheKey) };
+    std::vector<Callback> waiting;
+    waiting.swap(it->second.waiting);
+
+    // Failed loads are not cached so they can be retried
+    if (texture)
+        it->second.texture = texture;
+    else
+        m_cache.erase(it);
+
+    delete job;
+
+    // Callbacks may request more images and modify the cache
+    for (Callback &callback : waiting)
+        if (callback)
+            callback(texture);
+}
+
+void LImageLoader::finishJobs() noexcept
+{
+    std::list<Job*> finished;
+    m_mutex.lock();
+    finished.swap(m_finished);
+    m_mutex.unlock();
+
+    while (!finished.empty())
+    {
+        Job *job { finished.front() };
+        finished.pop_front();
+        finishJob(job);
+    }
+}
+
+int LImageLoader::onJobsFinished(int fd, unsigned int /*mask*/, void *data) noexcept
+{
+    UInt64 count;
+    const ssize_t n { read(fd, &count, sizeof(count)) };
+    L_UNUSED(n);
+    static_cast<LImageLoader*>(data)->finishJobs();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef LIMAGELOADER_H
+#define LIMAGELOADER_H
+
+#include <LNamespaces.h>
+#include <LSize.h>
+#include <condition_variable>
+#include <unordered_map>
+#include <filesystem>
+#include <functional>
+#include <wayland-server.h>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <list>
+
+namespace Louvre
+{
+    /* Decodes image files on a pool of worker threads, textures are created on the main thread
+     * once the pixels are ready (see LOpenGL::loadTextureAsync()). Workers are only spawned on the
+     * first request, so compositors that don't use it pay nothing */
+    class LImageLoader
+    {
+    public:
+        using Callback = std::function<void(LTexture*)>;
+
+        // Decoded pixels, always DRM_FORMAT_ARGB8888 (allocated with malloc)
+        struct Image
+        {
+            UInt8 *pixels { nullptr };
+            LSize size;
+            UInt32 stride { 0 };
+        };
+
+        static constexpr UInt32 MaxThreads { 4 };
+
+        bool init() noexcept;
+        void unit() noexcept;
+
+        // Must be called from the main thread or from an output thread while the compositor is locked
+        void load(const std::filesystem::path &file, const LSize &maxSize, bool cached, const Callback &callback) noexcept;
+
+        // Destroys all cached textures, pending cached requests are not affected
+        void clearCache() noexcept;
+
+        /* Decodes the file into an ARGB8888 image. If maxSize is not empty, the image is downscaled to
+         * fit into it keeping the aspect ratio (a width or height <= 0 leaves that axis unconstrained) */
+        static bool decode(const std::filesystem::path &file, const LSize &maxSize, Image &image) noexcept;
+
+        // Swaps the R and B channels of 32 bit pixels in place, ABGR8888 <-> ARGB8888
+        static void swizzle(UInt8 *pixels, const LSize &size, UInt32 stride) noexcept;
+
+        // Size of an image after fitting it into maxSize, images are never upscaled
+        static LSize fitSize(const LSize &size, const LSize &maxSize) noexcept;
+
+    private:
+        struct Job
+        {
+            std::filesystem::path file;
+            LSize maxSize;
+            std::string cacheKey; // Empty if not cached
+            Callback callback;
+            Image image;
+            bool decoded { false };
+        };
+
+        struct CacheEntry
+        {
+            LTexture *texture { nullptr };
+            std::vector<Callback> waiting; // Callbacks of requests made while the image is being decoded
+        };
+
+        void workerLoop() noexcept;
+        void finishJob(Job *job) noexcept;
+        void finishJobs() noexcept;
+        static int onJobsFinished(int fd, unsigned int mask, void *data) noexcept;
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::list<Job*> m_queue;
+        std::list<Job*> m_finished;
+        std::unordered_map<std::string, CacheEntry> m_cache;
+        wl_event_source *m_eventSource { nullptr };
+        Int32 m_eventFd { -1 };
+        bool m_exit { false };
+    };
+};
+
+#endif // LIMAGELOADER_H
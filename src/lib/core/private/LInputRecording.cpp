@@ -0,0 +1,247 @@
+#include <private/LInputRecording.h>
+#include <LPointerMoveEvent.h>
+#include <LPointerButtonEvent.h>
+#include <LPointerScrollEvent.h>
+#include <LPointerSwipeBeginEvent.h>
+#include <LPointerSwipeUpdateEvent.h>
+#include <LPointerSwipeEndEvent.h>
+#include <LPointerPinchBeginEvent.h>
+#include <LPointerPinchUpdateEvent.h>
+#include <LPointerPinchEndEvent.h>
+#include <LPointerHoldBeginEvent.h>
+#include <LPointerHoldEndEvent.h>
+#include <LKeyboardKeyEvent.h>
+#include <LTouchDownEvent.h>
+#include <LTouchMoveEvent.h>
+#include <LTouchUpEvent.h>
+#include <LTouchFrameEvent.h>
+#include <LTouchCancelEvent.h>
+#include <LInputDevice.h>
+#include <LLog.h>
+#include <cstring>
+#include <algorithm>
+
+using namespace Louvre;
+using namespace Louvre::LInputRecording;
+
+bool LInputRecording::encode(const LInputEvent &event, UInt16 device, Record &record) noexcept
+{
+    record = {};
+    record.kind = EventRecord;
+    record.type = (UInt8)event.type();
+    record.subtype = (UInt8)event.subtype();
+    record.device = device;
+    record.ms = event.ms();
+    record.us = event.us();
+
+    switch (event.type())
+    {
+    case LEvent::Type::Pointer:
+    {
+        switch (event.subtype())
+        {
+        case LEvent::Subtype::Move:
+        {
+            const auto &e { static_cast<const LPointerMoveEvent&>(event) };
+            record.code = e.coalescedEvents();
+            record.values[0] = e.delta().x();
+            record.values[1] = e.delta().y();
+            record.values[2] = e.deltaUnaccelerated().x();
+            record.values[3] = e.deltaUnaccelerated().y();
+            return true;
+        }
+        case LEvent::Subtype::Button:
+        {
+            const auto &e { static_cast<const LPointerButtonEvent&>(event) };
+            record.code = e.button();
+            record.state = e.state();
+            return true;
+        }
+        case LEvent::Subtype::Scroll:
+        {
+            const auto &e { static_cast<const LPointerScrollEvent&>(event) };
+            record.state = e.source();
+            record.values[0] = e.axes().x();
+            record.values[1] = e.axes().y();
+            record.values[2] = e.axes120().x();
+            record.values[3] = e.axes120().y();
+            return true;
+        }
+        case LEvent::Subtype::SwipeBegin:
+            record.code = static_cast<const LPointerSwipeBeginEvent&>(event).fingers();
+            return true;
+        case LEvent::Subtype::SwipeUpdate:
+        {
+            const auto &e { static_cast<const LPointerSwipeUpdateEvent&>(event) };
+            record.code = e.fingers();
+            record.values[0] = e.delta().x();
+            record.values[1] = e.delta().y();
+            record.values[2] = e.deltaUnaccelerated().x();
+            record.values[3] = e.deltaUnaccelerated().y();
+            return true;
+        }
+        case LEvent::Subtype::SwipeEnd:
+        {
+            const auto &e { static_cast<const LPointerSwipeEndEvent&>(event) };
+            record.code = e.fingers();
+            record.state = e.cancelled();
+            return true;
+        }
+        case LEvent::Subtype::PinchBegin:
+            record.code = static_cast<const LPointerPinchBeginEvent&>(event).fingers();
+            return true;
+        case LEvent::Subtype::PinchUpdate:
+        {
+            const auto &e { static_cast<const LPointerPinchUpdateEvent&>(event) };
+            record.code = e.fingers();
+            record.values[0] = e.delta().x();
+            record.values[1] = e.delta().y();
+            record.values[2] = e.deltaUnaccelerated().x();
+            record.values[3] = e.deltaUnaccelerated().y();
+            record.values[4] = e.scale();
+            record.values[5] = e.rotation();
+            return true;
+        }
+        case LEvent::Subtype::PinchEnd:
+        {
+            const auto &e { static_cast<const LPointerPinchEndEvent&>(event) };
+            record.code = e.fingers();
+            record.state = e.cancelled();
+            return true;
+        }
+        case LEvent::Subtype::HoldBegin:
+            record.code = static_cast<const LPointerHoldBeginEvent&>(event).fingers();
+            return true;
+        case LEvent::Subtype::HoldEnd:
+        {
+            const auto &e { static_cast<const LPointerHoldEndEvent&>(event) };
+            record.code = e.fingers();
+            record.state = e.cancelled();
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+    case LEvent::Type::Keyboard:
+    {
+        if (event.subtype() != LEvent::Subtype::Key)
+            return false;
+
+        const auto &e { static_cast<const LKeyboardKeyEvent&>(event) };
+        record.code = e.keyCode();
+        record.state = e.state();
+        return true;
+    }
+    case LEvent::Type::Touch:
+    {
+        switch (event.subtype())
+        {
+        case LEvent::Subtype::Down:
+        {
+            const auto &e { static_cast<const LTouchDownEvent&>(event) };
+            record.code = e.id();
+            record.values[0] = e.pos().x();
+            record.values[1] = e.pos().y();
+            return true;
+        }
+        case LEvent::Subtype::Move:
+        {
+            const auto &e { static_cast<const LTouchMoveEvent&>(event) };
+            record.code = e.id();
+            record.values[0] = e.pos().x();
+            record.values[1] = e.pos().y();
+            return true;
+        }
+        case LEvent::Subtype::Up:
+            record.code = static_cast<const LTouchUpEvent&>(event).id();
+            return true;
+        case LEvent::Subtype::Frame:
+        case LEvent::Subtype::Cancel:
+            return true;
+        default:
+            return false;
+        }
+    }
+    }
+
+    return false;
+}
+
+bool LInputRecorder::start(const std::filesystem::path &path) noexcept
+{
+    stop();
+
+    m_file = fopen(path.c_str(), "wbe");
+
+    if (!m_file)
+    {
+        LLog::error("[LInputRecorder::start] Failed to open %s.", path.c_str());
+        return false;
+    }
+
+    Header header;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.recordSize = sizeof(Record);
+
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+    {
+        LLog::error("[LInputRecorder::start] Failed to write to %s.", path.c_str());
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    LLog::debug("[LInputRecorder::start] Recording input events into %s.", path.c_str());
+    return true;
+}
+
+void LInputRecorder::stop() noexcept
+{
+    if (!m_file)
+        return;
+
+    fclose(m_file);
+    m_file = nullptr;
+    m_devices.clear();
+    m_nextDevice = 0;
+}
+
+void LInputRecorder::write(const LInputEvent &event) noexcept
+{
+    LInputDevice *device { event.device() };
+    auto it { m_devices.find(device) };
+    UInt16 index;
+
+    if (it == m_devices.end())
+    {
+        index = m_nextDevice++;
+        m_devices[device] = index;
+
+        Record record {};
+        record.kind = DeviceRecord;
+        record.device = index;
+        record.nameLength = std::min(device->name().size(), size_t(UINT16_MAX));
+
+        for (UInt32 cap = LInputDevice::Pointer; cap <= LInputDevice::Switch; cap++)
+            if (device->hasCapability((LInputDevice::Capability)cap))
+                record.code |= 1 << cap;
+
+        record.ms = device->vendorId();
+        record.us = device->productId();
+        fwrite(&record, sizeof(record), 1, m_file);
+        fwrite(device->name().data(), 1, record.nameLength, m_file);
+    }
+    else
+        index = it->second;
+
+    Record record;
+
+    // Writes are buffered by stdio, so this rarely reaches the kernel
+    if (encode(event, index, record) && fwrite(&record, sizeof(record), 1, m_file) != 1)
+    {
+        LLog::error("[LInputRecorder::write] Failed to write input event, recording stopped.");
+        stop();
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef LINPUTRECORDING_H
+#define LINPUTRECORDING_H
+
+#include <LNamespaces.h>
+#include <filesystem>
+#include <unordered_map>
+#include <stdio.h>
+
+namespace Louvre
+{
+    /* Binary format used to record and replay input events.
+     * A file starts with a Header followed by a sequence of fixed-size records. Device records are written
+     * the first time a device emits an event and are immediately followed by the device name (nameLength bytes).
+     * Values are stored in host byte order, recordings are not meant to be moved between architectures */
+    namespace LInputRecording
+    {
+        static constexpr char Magic[8] { 'L', 'V', 'R', 'I', 'N', 'P', 'U', 'T' };
+        static constexpr UInt32 Version { 1 };
+
+        enum RecordKind : UInt8
+        {
+            DeviceRecord = 0,
+            EventRecord = 1
+        };
+
+        struct Header
+        {
+            char magic[8];
+            UInt32 version;
+            UInt32 recordSize;
+        };
+
+        struct Record
+        {
+            RecordKind kind;
+            UInt8 type;     // LEvent::Type
+            UInt8 subtype;  // LEvent::Subtype
+            UInt8 state;    // Button/key state, scroll source or gesture cancelled flag
+            UInt16 device;  // Device index
+            UInt16 nameLength; // Device records only
+            UInt32 code;    // Button, key code, touch point id, fingers count or device capabilities
+            UInt32 ms;      // Original event time, or vendor id for device records
+            UInt64 us;      // Original event time, or product id for device records
+            Float32 values[6];
+        };
+
+        static_assert(sizeof(Record) == 48, "Unexpected input record size");
+
+        // Fills an event record, returns false if the event can't be recorded.
+        // Events are rebuilt and notified by the headless input backend, see LOUVRE_INPUT_REPLAY
+        bool encode(const LInputEvent &event, UInt16 device, Record &record) noexcept;
+    };
+
+    // Writes input events into a file as they are dispatched by the input backend
+    class LInputRecorder
+    {
+    public:
+        ~LInputRecorder() noexcept { stop(); }
+        bool start(const std::filesystem::path &path) noexcept;
+        void stop() noexcept;
+
+        bool active() const noexcept
+        {
+            return m_file != nullptr;
+        }
+
+        void record(const LInputEvent &event) noexcept
+        {
+            if (m_file)
+                write(event);
+        }
+
+        // Must be called when a device is unplugged, its address may be reused by a new device
+        void forgetDevice(const LInputDevice *device) noexcept
+        {
+            m_devices.erase(device);
+        }
+
+    private:
+        void write(const LInputEvent &event) noexcept;
+        FILE *m_file { nullptr };
+        std::unordered_map<const LInputDevice*, UInt16> m_devices;
+        UInt16 m_nextDevice { 0 };
+    };
+};
+
+#endif // LINPUTRECORDING_H
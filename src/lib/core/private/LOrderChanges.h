@@ -0,0 +1,23 @@
+#ifndef LORDERCHANGES_H
+#define LORDERCHANGES_H
+
+#include <LNamespaces.h>
+#include <algorithm>
+#include <vector>
+
+namespace Louvre
+{
+    /* Coalesced orderChanged() notifications are delivered in stacking order instead of the order they were queued,
+     * so handlers that restack their own data after the previous surface (e.g. view->insertAfter(prevSurface()->view))
+     * always find it already in its final place. key(item) must return the order key of the item */
+    template <class T, class F>
+    void LSortOrderChanges(std::vector<T> &batch, F key)
+    {
+        std::stable_sort(batch.begin(), batch.end(), [&key](const T &a, const T &b)
+        {
+            return key(a) < key(b);
+        });
+    }
+};
+
+#endif // LORDERCHANGES_H
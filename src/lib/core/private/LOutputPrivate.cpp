@@ -24,6 +24,14 @@ LOutput::LOutputPrivate::LOutputPrivate(LOutput *output) : fb(output) {}
 // This is called from LCompositor::addOutput()
 bool LOutput::LOutputPrivate::initialize()
 {
+    if (getenv("LOUVRE_FRAME_TRACE"))
+        frameStatsEnabled = true;
+
+    const char *repaintSchedulingEnv { getenv("LOUVRE_REPAINT_SCHEDULING") };
+
+    if (repaintSchedulingEnv && atoi(repaintSchedulingEnv) == 1)
+        repaintScheduling = true;
+
     output->imp()->state = LOutput::PendingInitialize;
     return compositor()->imp()->graphicBackend->outputInitialize(output);
 }
@@ -31,6 +39,7 @@ bool LOutput::LOutputPrivate::initialize()
 void LOutput::LOutputPrivate::backendInitializeGL()
 {
     threadId = std::this_thread::get_id();
+    LCompositor::LCompositorPrivate::threadSlot = threadSlot;
 
     painter = new LPainter();
     painter->imp()->output = output;
@@ -73,16 +82,21 @@ void LOutput::LOutputPrivate::damageToBufferCoords() noexcept
         damage.offset(-rect.pos().x(), -rect.pos().y());
         damage.transform(rect.size(), transform);
 
-        LRegion tmp; Int32 n;
+        Int32 n;
         const LBox *box { damage.boxes(&n) };
-        while (n > 0)
+        damageBoxes.resize(n);
+
+        for (LBox &b : damageBoxes)
         {
-            tmp.addRect(floorf(Float32(box->x1) * fractionalScale) - 2, floorf(Float32(box->y1) * fractionalScale) - 2,
-                        ceilf(Float32(box->x2 - box->x1) * fractionalScale) + 4, ceilf(Float32(box->y2 - box->y1) * fractionalScale) + 4);
-            n--; box++;
+            b.x1 = floorf(Float32(box->x1) * fractionalScale) - 2;
+            b.y1 = floorf(Float32(box->y1) * fractionalScale) - 2;
+            b.x2 = b.x1 + Int32(ceilf(Float32(box->x2 - box->x1) * fractionalScale)) + 4;
+            b.y2 = b.y1 + Int32(ceilf(Float32(box->y2 - box->y1) * fractionalScale)) + 4;
+            box++;
         }
 
-        damage = std::move(tmp);
+        // The enlarged boxes overlap, so the region is built in a single pass instead of adding them one by one
+        damage.setBoxes(damageBoxes.data(), n);
         damage.clip(LRect(0, output->currentMode()->sizeB()));
 
         if (output->hasBufferDamageSupport())
@@ -100,8 +114,17 @@ void LOutput::LOutputPrivate::damageToBufferCoords() noexcept
                         outputDamage.damage.addRegion(damage);
                 }
             }
+
+            for (ScreenshotBuffer &buffer : screenshotBuffers)
+                if (buffer.tracked)
+                    buffer.damage.addRegion(damage);
         }
     }
+
+    // Damage is not being tracked, the content of screen copy buffers is unknown from now on
+    if (compositor()->imp()->screenshotManagers == 0)
+        for (ScreenshotBuffer &buffer : screenshotBuffers)
+            buffer.tracked = false;
 }
 
 void LOutput::LOutputPrivate::blitFractionalScaleFb(bool cursorOnly) noexcept
@@ -252,17 +275,42 @@ void LOutput::LOutputPrivate::backendPaintGL()
     if (output->imp()->state != LOutput::Initialized)
         return;
 
+    const bool scheduled { repaintScheduling };
+    const UInt64 repaintDelay { scheduled ? waitRepaintDeadline() : 0 };
+    const UInt64 renderBegin { scheduled ? frameStatsTime() : 0 };
+    const bool stats { frameStatsEnabled };
+
+    if (stats)
+    {
+        beginFrameStats();
+        currentFrameStats.repaintDelay = repaintDelay;
+    }
+
+    /* Other outputs may be drawing their scenes in parallel, they only need to be waited
+     * for before modifying state they could be reading (see LScene::enableParallelRendering()) */
     if (callLock)
-        compositor()->imp()->lock();
+    {
+        compositor()->imp()->renderMutex.lock();
+        stateFlags.add(HoldsRenderLock);
+
+        if (stats)
+            currentFrameStats.renderLockWait += frameStatsTime() - currentFrameStats.paintBegin;
+    }
 
     stateFlags.remove(PendingRepaint);
 
-    if (seat()->enabled() && compositor()->imp()->runningAnimations())
+    // Only animations synchronized with this output keep it repainting
+    const bool animating { compositor()->imp()->hasRunningAnimations(output) };
+
+    if (seat()->enabled() && animating)
     {
         output->repaint();
         compositor()->imp()->unlockPoll();
     }
 
+    if (lastPos != rect.pos() || lastSize != rect.size())
+        compositor()->imp()->waitParallelDraws();
+
     if (lastPos != rect.pos())
     {
         output->moveGL();
@@ -279,7 +327,16 @@ void LOutput::LOutputPrivate::backendPaintGL()
     compositor()->imp()->sendPresentationTime();
 
     // Update active LAnimations
-    compositor()->imp()->processAnimations();
+    if (animating)
+        compositor()->imp()->waitParallelDraws();
+
+    compositor()->imp()->processAnimations(output);
+
+    // Complete screen copies from previous frames and forget buffers destroyed by clients
+    if (!screenshotReadbacks.empty())
+        processScreenshotReadbacks(false);
+
+    destroyScreenshotBuffers(false);
 
     painter->bindFramebuffer(&fb);
     compositor()->imp()->currentOutput = output;
@@ -326,6 +383,18 @@ void LOutput::LOutputPrivate::backendPaintGL()
     if (scanout[0].buffer || scanout[1].buffer)
         output->repaint();
 
+    if (stats)
+    {
+        // Still in surface coords here
+        Int32 n;
+        const LBox *box { damage.boxes(&n) };
+
+        for (Int32 i = 0; i < n; i++)
+            currentFrameStats.damageArea += UInt64(box[i].x2 - box[i].x1) * UInt64(box[i].y2 - box[i].y1);
+
+        currentFrameStats.scanout = stateFlags.check(HasScanoutBuffer);
+    }
+
     stateFlags.setFlag(NeedsFullRepaint, needsFullRepaintPrev);
 
     /* This ensures that all active outputs have been repainted at least once after a client requests to lock the session.
@@ -348,6 +417,12 @@ void LOutput::LOutputPrivate::backendPaintGL()
         blitFramebuffers();
         stateFlags.remove(IsBlittingFramebuffers);
     }
+    else
+    {
+        // Not tracked while scanning out custom buffers
+        for (ScreenshotBuffer &buffer : screenshotBuffers)
+            buffer.tracked = false;
+    }
 
     /* Ensure clients receive frame callbacks and pending roles configurations on time */
     compositor()->flushClients();
@@ -356,7 +431,16 @@ void LOutput::LOutputPrivate::backendPaintGL()
     compositor()->imp()->destroyPendingRenderBuffers(&output->imp()->threadId);
 
     if (callLock)
+    {
+        stateFlags.remove(HoldsRenderLock);
         compositor()->imp()->unlock();
+    }
+
+    if (scheduled)
+        updateRenderBudget(frameStatsTime() - renderBegin);
+
+    if (stats)
+        endFrameStats();
 }
 
 void LOutput::LOutputPrivate::backendResizeGL()
@@ -415,6 +499,9 @@ void LOutput::LOutputPrivate::backendUninitializeGL()
        screenshotRequests.pop_back();
     }
 
+    processScreenshotReadbacks(true);
+    destroyScreenshotBuffers(true);
+
     output->uninitializeGL();
     removeFromSessionLockPendingRepaint();
 
@@ -437,6 +524,136 @@ void LOutput::LOutputPrivate::backendPageFlipped()
     stateFlags.add(HasUnhandledPresentationTime);
     frame++;
     pageflipMutex.unlock();
+
+    if (frameStatsEnabled)
+    {
+        const UInt64 now { frameStatsTime() };
+        frameStatsMutex.lock();
+
+        if (frameStatsCount > 0)
+        {
+            LOutputFrameStats &last { frameStatsRing[(frameStatsHead + frameStatsRing.size() - 1) % frameStatsRing.size()] };
+
+            if (last.pageFlip == 0)
+            {
+                last.pageFlip = now;
+                last.pageFlipLatency = now > last.paintEnd ? now - last.paintEnd : 0;
+            }
+        }
+
+        frameStatsMutex.unlock();
+    }
+}
+
+UInt64 LOutput::LOutputPrivate::nextVblankTime(UInt64 now, UInt64 *period) noexcept
+{
+    pageflipMutex.lock();
+    const UInt64 lastVblank { UInt64(presentationTime.time.tv_sec) * 1000000000 + UInt64(presentationTime.time.tv_nsec) };
+    UInt64 refreshPeriod { presentationTime.period };
+    pageflipMutex.unlock();
+
+    if (!output->vSyncEnabled() || lastVblank == 0)
+        return 0;
+
+    if (refreshPeriod == 0 && output->currentMode() && output->currentMode()->refreshRate() > 0)
+        refreshPeriod = 1000000000000 / UInt64(output->currentMode()->refreshRate());
+
+    // Also skips backends whose presentation clock is not CLOCK_MONOTONIC
+    if (refreshPeriod == 0 || lastVblank > now)
+        return 0;
+
+    if (period)
+        *period = refreshPeriod;
+
+    return lastVblank + ((now - lastVblank) / refreshPeriod + 1) * refreshPeriod;
+}
+
+UInt64 LOutput::LOutputPrivate::predictedPresentationTime() noexcept
+{
+    const UInt64 now { frameStatsTime() };
+    const UInt64 nextVblank { nextVblankTime(now) };
+    return nextVblank == 0 ? now : nextVblank;
+}
+
+UInt64 LOutput::LOutputPrivate::waitRepaintDeadline() noexcept
+{
+    pageflipMutex.lock();
+    const UInt64 currentFrame { frame };
+    pageflipMutex.unlock();
+
+    // The previous frame hasn't been presented yet, the backend already throttles this one
+    if (currentFrame == scheduledFrame)
+        return 0;
+
+    scheduledFrame = currentFrame;
+
+    const UInt64 now { frameStatsTime() };
+    UInt64 period { 0 };
+    const UInt64 nextVblank { nextVblankTime(now, &period) };
+
+    if (nextVblank == 0)
+        return 0;
+
+    const UInt64 budget { UInt64(output->renderBudget()) * 1000 };
+
+    // Too late to wait, paint right away
+    if (budget >= period || nextVblank - budget <= now)
+        return 0;
+
+    const UInt64 deadline { nextVblank - budget };
+    const timespec ts { time_t(deadline / 1000000000), long(deadline % 1000000000) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    return frameStatsTime() - now;
+}
+
+void LOutput::LOutputPrivate::updateRenderBudget(UInt64 renderTime) noexcept
+{
+    renderTimes[renderTimesHead] = UInt32(std::min(renderTime / 1000, UInt64(UINT32_MAX)));
+    renderTimesHead = (renderTimesHead + 1) % RenderTimesSize;
+
+    // The slowest recent frame, since a missed vblank costs a whole frame
+    UInt32 slowest { 0 };
+
+    for (UInt32 time : renderTimes)
+        slowest = std::max(slowest, time);
+
+    adaptiveRenderBudget = std::max(slowest + RenderBudgetSlack, RenderBudgetMin);
+}
+
+UInt64 LOutput::LOutputPrivate::frameStatsTime() noexcept
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return UInt64(ts.tv_sec) * 1000000000 + UInt64(ts.tv_nsec);
+}
+
+void LOutput::LOutputPrivate::beginFrameStats() noexcept
+{
+    currentFrameStats = LOutputFrameStats();
+    pageflipMutex.lock();
+    currentFrameStats.frame = frame;
+    pageflipMutex.unlock();
+    currentFrameStats.paintBegin = frameStatsTime();
+    frameStatsDrawCalls = painter->imp()->drawCalls;
+}
+
+void LOutput::LOutputPrivate::endFrameStats() noexcept
+{
+    currentFrameStats.drawCalls = painter->imp()->drawCalls - frameStatsDrawCalls;
+    currentFrameStats.paintEnd = frameStatsTime();
+
+    frameStatsMutex.lock();
+
+    if (frameStatsRing.size() != LOutput::frameStatsCapacity())
+        frameStatsRing.resize(LOutput::frameStatsCapacity());
+
+    frameStatsRing[frameStatsHead] = currentFrameStats;
+    frameStatsHead = (frameStatsHead + 1) % frameStatsRing.size();
+
+    if (frameStatsCount < frameStatsRing.size())
+        frameStatsCount++;
+
+    frameStatsMutex.unlock();
 }
 
 void LOutput::LOutputPrivate::updateRect()
@@ -565,6 +782,171 @@ void LOutput::LOutputPrivate::validateScreenshotRequests() noexcept
         screenshotCursorTimeout--;
 }
 
+static void freeScreenshotBuffer(LOutput::LOutputPrivate::ScreenshotBuffer &buffer) noexcept
+{
+    if (buffer.buffer)
+        wl_list_remove(&buffer.onDestroy.link);
+
+    if (buffer.framebuffer)
+        glDeleteFramebuffers(1, &buffer.framebuffer);
+
+    if (buffer.renderbuffer)
+        glDeleteRenderbuffers(1, &buffer.renderbuffer);
+
+    if (buffer.image != EGL_NO_IMAGE)
+        eglDestroyImage(compositor()->eglDisplay(), buffer.image);
+}
+
+LOutput::LOutputPrivate::ScreenshotBuffer &LOutput::LOutputPrivate::screenshotBuffer(wl_resource *buffer) noexcept
+{
+    for (auto it = screenshotBuffers.begin(); it != screenshotBuffers.end(); it++)
+    {
+        if (it->buffer == buffer)
+        {
+            if (it != screenshotBuffers.begin())
+                screenshotBuffers.splice(screenshotBuffers.begin(), screenshotBuffers, it);
+
+            return screenshotBuffers.front();
+        }
+    }
+
+    if (screenshotBuffers.size() >= ScreenshotBuffersLimit)
+    {
+        freeScreenshotBuffer(screenshotBuffers.back());
+        screenshotBuffers.pop_back();
+    }
+
+    ScreenshotBuffer &screenshotBuffer { screenshotBuffers.emplace_front() };
+    screenshotBuffer.buffer = buffer;
+    wl_resource_add_destroy_listener(buffer, &screenshotBuffer.onDestroy);
+    return screenshotBuffer;
+}
+
+void LOutput::LOutputPrivate::untrackScreenshotBuffer(wl_resource *buffer) noexcept
+{
+    for (ScreenshotBuffer &screenshotBuffer : screenshotBuffers)
+    {
+        if (screenshotBuffer.buffer == buffer)
+        {
+            screenshotBuffer.tracked = false;
+            screenshotBuffer.damage.clear();
+            return;
+        }
+    }
+}
+
+void LOutput::LOutputPrivate::destroyScreenshotBuffers(bool all) noexcept
+{
+    for (auto it = screenshotBuffers.begin(); it != screenshotBuffers.end();)
+    {
+        if (all || !it->buffer)
+        {
+            freeScreenshotBuffer(*it);
+            it = screenshotBuffers.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+void LOutput::LOutputPrivate::processScreenshotReadbacks(bool all) noexcept
+{
+    const EGLDisplay display { eglGetCurrentDisplay() };
+
+    for (auto it = screenshotReadbacks.begin(); it != screenshotReadbacks.end();)
+    {
+        ScreenshotReadback &readback { *it };
+
+        // Still in flight
+        if (!all && readback.sync != EGL_NO_SYNC_KHR &&
+            compositor()->imp()->eglClientWaitSyncKHR(display, readback.sync, 0, 0) == EGL_TIMEOUT_EXPIRED_KHR)
+        {
+            it++;
+            continue;
+        }
+
+        if (readback.sync != EGL_NO_SYNC_KHR)
+            compositor()->imp()->eglDestroySyncKHR(display, readback.sync);
+
+        // The frame or its buffer may have been destroyed meanwhile
+        if (readback.frame && readback.frame->buffer())
+        {
+            bool failed { false };
+
+            if (readback.pbo)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+                const UInt8 *src { static_cast<const UInt8*>(
+                    compositor()->imp()->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.pboSize, GL_MAP_READ_BIT)) };
+
+                if (src)
+                {
+                    wl_shm_buffer *shmBuffer { wl_shm_buffer_get(readback.frame->buffer()) };
+                    const Int32 stride { wl_shm_buffer_get_stride(shmBuffer) };
+                    wl_shm_buffer_begin_access(shmBuffer);
+                    UInt8 *dst { static_cast<UInt8*>(wl_shm_buffer_get_data(shmBuffer)) };
+                    Int32 n;
+                    const LBox *box { readback.copied.boxes(&n) };
+
+                    for (Int32 i = 0; i < n; i++)
+                    {
+                        const Int32 offsetX { box[i].x1 * 4 };
+                        const Int32 width { (box[i].x2 - box[i].x1) * 4 };
+
+                        for (Int32 y = box[i].y1; y < box[i].y2; y++)
+                            memcpy(&dst[y * stride + offsetX], &src[y * readback.pboStride + offsetX], width);
+                    }
+
+                    wl_shm_buffer_end_access(shmBuffer);
+                    compositor()->imp()->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                }
+                else
+                    failed = true;
+
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+
+            if (failed)
+            {
+                // The damage was already consumed, the next copy into the buffer must be complete
+                untrackScreenshotBuffer(readback.buffer);
+                readback.frame->failed();
+            }
+            else
+            {
+                if (readback.sendDamage)
+                    readback.frame->damage(readback.damage);
+
+                /* Backend presentation time may not be available, use LTime instead */
+                readback.frame->ready(LTime::ns());
+            }
+        }
+        else
+            untrackScreenshotBuffer(readback.buffer);
+
+        // Keep a few buffers for the next copies
+        if (readback.pbo)
+        {
+            if (!all && screenshotPBOs.size() < 4)
+                screenshotPBOs.emplace_back(readback.pbo, readback.pboSize);
+            else
+                glDeleteBuffers(1, &readback.pbo);
+        }
+
+        it = screenshotReadbacks.erase(it);
+    }
+
+    if (all)
+    {
+        for (const auto &pbo : screenshotPBOs)
+            glDeleteBuffers(1, &pbo.first);
+
+        screenshotPBOs.clear();
+    }
+    else if (!screenshotReadbacks.empty())
+        output->repaint();
+}
+
 void LOutput::LOutputPrivate::removeFromSessionLockPendingRepaint() noexcept
 {
     if (sessionLockManager()->state() == LSessionLockManager::Locked && !sessionLockManager()->m_sessionLockRes->m_lockedOnce)
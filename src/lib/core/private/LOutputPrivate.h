@@ -8,9 +8,11 @@
 #include <LSurface.h>
 #include <LGammaTable.h>
 #include <LMargins.h>
+#include <EGL/eglext.h>
 #include <atomic>
 #include <list>
 #include <mutex>
+#include <array>
 #include <functional>
 
 using namespace Louvre;
@@ -51,6 +53,7 @@ LPRIVATE_CLASS_NO_COPY(LOutput)
         IsBlittingFramebuffers              = static_cast<UInt32>(1) << 11,
         IsInPaintGL                         = static_cast<UInt32>(1) << 12,
         HasScanoutBuffer                    = static_cast<UInt32>(1) << 13,
+        HoldsRenderLock                     = static_cast<UInt32>(1) << 14,
     };
 
     LOutputPrivate(LOutput *output);
@@ -97,6 +100,7 @@ LPRIVATE_CLASS_NO_COPY(LOutput)
      * the graphic backend uses DUMB buffers or CPU copy. */
     UInt64 frame { 0 };
     LRegion damage;
+    std::vector<LBox> damageBoxes; // Reused by damageToBufferCoords()
     void damageToBufferCoords() noexcept;
     void blitFramebuffers() noexcept;
     void blitFractionalScaleFb(bool cursorOnly) noexcept;
@@ -113,6 +117,9 @@ LPRIVATE_CLASS_NO_COPY(LOutput)
     std::atomic<bool> callLock;
     std::atomic<bool> callLockACK;
     std::thread::id threadId;
+
+    // Dense index assigned in LCompositor::addOutput(), always > 0 (see LCompositorPrivate::threadSlot)
+    UInt32 threadSlot { 0 };
     LGammaTable gammaTable {0};
 
     UInt32 dirtyCursorFBs;
@@ -130,6 +137,54 @@ LPRIVATE_CLASS_NO_COPY(LOutput)
     void handleScreenshotRequests(bool withCursor) noexcept;
     UInt8 screenshotCursorTimeout { 0 };
 
+    /* Client buffers recently used for screen copies. DMA buffers keep their imported EGLImage and
+     * framebuffer, and the output damage since each buffer was last written is accumulated so that
+     * copy_with_damage requests only copy what changed */
+    struct ScreenshotBuffer
+    {
+        wl_listener onDestroy
+        {
+            .link {0},
+            .notify = [](wl_listener *listener, void *)
+            {
+                ScreenshotBuffer *screenshotBuffer = (ScreenshotBuffer*)listener;
+                screenshotBuffer->buffer = nullptr;
+            }
+        };
+        wl_resource *buffer { nullptr };
+        LRect rectB;
+        LRegion damage;
+        bool tracked { false };
+        EGLImage image { EGL_NO_IMAGE };
+        GLuint renderbuffer { 0 };
+        GLuint framebuffer { 0 };
+    };
+    static constexpr size_t ScreenshotBuffersLimit { 8 };
+    std::list<ScreenshotBuffer> screenshotBuffers;
+    ScreenshotBuffer &screenshotBuffer(wl_resource *buffer) noexcept;
+    void untrackScreenshotBuffer(wl_resource *buffer) noexcept;
+    void destroyScreenshotBuffers(bool all) noexcept;
+
+    /* Copies waiting for the GPU, the ready event is sent on the next frame once the fence signals.
+     * SHM copies are read into a pixel pack buffer with rows of the copied rect width, not the client buffer stride */
+    struct ScreenshotReadback
+    {
+        LWeak<Protocols::ScreenCopy::RScreenCopyFrame> frame;
+
+        // See ScreenshotBuffer::tracked, cleared if the copy doesn't complete
+        wl_resource *buffer { nullptr };
+        EGLSyncKHR sync { EGL_NO_SYNC_KHR };
+        GLuint pbo { 0 };
+        GLsizeiptr pboSize { 0 };
+        Int32 pboStride { 0 };
+        LRegion copied;
+        LRegion damage;
+        bool sendDamage { false };
+    };
+    std::list<ScreenshotReadback> screenshotReadbacks;
+    std::vector<std::pair<GLuint, GLsizeiptr>> screenshotPBOs;
+    void processScreenshotReadbacks(bool all) noexcept;
+
     struct ScanoutBuffer
     {
         wl_listener bufferDestroyListener
@@ -163,6 +218,37 @@ LPRIVATE_CLASS_NO_COPY(LOutput)
     void updateRect();
     void updateGlobals();
 
+    // Frame stats, see LOutput::enableFrameStats()
+    std::atomic<bool> frameStatsEnabled { false };
+    mutable std::mutex frameStatsMutex;
+    std::vector<LOutputFrameStats> frameStatsRing;
+    UInt32 frameStatsHead { 0 };
+    UInt32 frameStatsCount { 0 };
+    LOutputFrameStats currentFrameStats;
+    UInt64 frameStatsDrawCalls { 0 };
+    static UInt64 frameStatsTime() noexcept;
+    void beginFrameStats() noexcept;
+    void endFrameStats() noexcept;
+
+    // Repaint scheduling, see LOutput::enableRepaintScheduling()
+    static constexpr UInt32 RenderBudgetMin { 1000 };          // us
+    static constexpr UInt32 RenderBudgetSlack { 1000 };        // us, added to the adaptive estimate
+    static constexpr size_t RenderTimesSize { 32 };            // Frames considered by the adaptive estimate
+    std::atomic<bool> repaintScheduling { false };
+    std::atomic<UInt32> fixedRenderBudget { 0 };
+    std::atomic<UInt32> adaptiveRenderBudget { 4000 };
+    std::array<UInt32, RenderTimesSize> renderTimes {};
+    size_t renderTimesHead { 0 };
+    UInt64 scheduledFrame { 0 };
+    UInt64 waitRepaintDeadline() noexcept;                     // Returns the time waited in ns
+
+    // CLOCK_MONOTONIC ns of the vblank following now, 0 if unknown (e.g. V-Sync disabled)
+    UInt64 nextVblankTime(UInt64 now, UInt64 *period = nullptr) noexcept;
+
+    // When a frame painted now is expected to be presented, used to update LAnimations
+    UInt64 predictedPresentationTime() noexcept;
+    void updateRenderBudget(UInt64 renderTime) noexcept;
+
     std::list<LExclusiveZone*> exclusiveZones;
     LRect availableGeometry;
     LMargins exclusiveEdges;
@@ -1,8 +1,6 @@
 #ifndef LPAINTERPRIVATE_H
 #define LPAINTERPRIVATE_H
 
-#define LPAINTER_TRACK_UNIFORMS 1
-
 #include <private/LTexturePrivate.h>
 #include <private/LOutputPrivate.h>
 #include <LOutputFramebuffer.h>
@@ -10,6 +8,7 @@
 #include <LRect.h>
 #include <GL/gl.h>
 #include <GLES2/gl2.h>
+#include <vector>
 
 using namespace Louvre;
 
@@ -22,22 +21,22 @@ enum ShaderMode : GLint
     ColorMode = 2
 };
 
+// Locations are -1 for uniforms not used by a program variant
 struct Uniforms
 {
-    GLuint
-        texSize,
-        srcRect,
-        activeTexture,
-        mode,
-        color,
-        colorFactorEnabled,
-        texColorEnabled,
-        alpha,
-        premultipliedAlpha,
-        has90deg;
-} uniforms, uniformsExternal;
-
-Uniforms *currentUniforms;
+    GLint
+        texSize { -1 },
+        srcRect { -1 },
+        activeTexture { -1 },
+        mode { -1 },
+        color { -1 },
+        colorFactorEnabled { -1 },
+        texColorEnabled { -1 },
+        alpha { -1 },
+        premultipliedAlpha { -1 },
+        has90deg { -1 },
+        batched { -1 };
+};
 
 struct UniformsScaler
 {
@@ -56,18 +55,27 @@ struct UserState
 {
     TextureParams textureParams;
     ShaderMode mode { TextureMode };
-    LWeak<LTexture> texture;
     LBlendFunc customBlendFunc { GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA };
     Float32 alpha { 1.f };
     LRGBF color { 1.f, 1.f, 1.f };
     LRGBAF colorFactor { 1.f, 1.f, 1.f, 1.f };
     bool autoBlendFunc { true };
     bool customTextureColor { false };
+
+    // Plain flags instead of a weak reference to the texture, so painters of different threads
+    // never register themselves into the same LTexture
+    bool textureBound { false };
+    bool texturePremultipliedAlpha { false };
 } userState;
 
 LRectF srcRect;
 bool needsBlendFuncUpdate { true };
 
+// Batched region drawing
+bool regionBatching { true };
+std::vector<GLfloat> batchVertices;
+UInt64 drawCalls { 0 };
+
 static inline GLfloat square[]
 {
     //  VERTEX     FRAGMENT
@@ -77,28 +85,60 @@ static inline GLfloat square[]
     1.0f,  1.0f,   1.f, 1.f  // TR
 };
 
-GLuint vertexShader, fragmentShader, fragmentShaderExternal, fragmentShaderScaler, fragmentShaderScalerExternal;
+// Shared by all programs, they are linked through LCompositorPrivate::programCache
+const char *vertexShaderSource { nullptr };
 
 struct ShaderState
 {
     LSizeF texSize;
     LRectF srcRect;
-    GLuint activeTexture;
-    ShaderMode mode;
-    LRGBF color;
+    GLuint activeTexture { 0 };
+    ShaderMode mode { TextureMode };
+    LRGBF color { 1.f, 1.f, 1.f };
     bool colorFactorEnabled { false };
     bool texColorEnabled { false };
     bool premultipliedAlpha { false };
     bool has90deg { false };
-    GLfloat alpha;
-    GLfloat scale;
+    bool batched { false };
+    GLfloat alpha { 1.f };
+};
+
+/* Uniform values required by the next draw call. They are only uploaded to the program
+ * selected for it by useProgram(), each program keeps track of its own values */
+ShaderState state;
+
+/* Fragment shader variants without runtime branches, selected from the state above by useProgram().
+ * Each bit enables a feature, combinations that make no difference are never used, e.g. the solid
+ * color variant is always 0 */
+enum ProgramVariant : UInt32
+{
+    VariantTexture          = static_cast<UInt32>(1) << 0,
+    VariantExternal         = static_cast<UInt32>(1) << 1,
+    VariantTexColor         = static_cast<UInt32>(1) << 2,
+    VariantAlpha            = static_cast<UInt32>(1) << 3,
+    VariantPremultiplied    = static_cast<UInt32>(1) << 4,
+    VariantColorFactor      = static_cast<UInt32>(1) << 5,
+    VariantsCount           = static_cast<UInt32>(1) << 6
+};
+
+struct Program
+{
+    GLuint id { 0 };
+    Uniforms uniforms;
+    ShaderState state;
+    bool synced { false };
+    bool failed { false };
 };
 
-ShaderState state, stateExternal;
-ShaderState *currentState;
+// Compiled on first use
+Program variants[VariantsCount];
+
+// Generic programs with runtime branches, used if a variant fails to compile
+Program uber, uberExternal;
+Program *boundProgram { nullptr };
 
 // Program
-GLuint programObject, programObjectExternal, programObjectScaler, programObjectScalerExternal, currentProgram;
+GLuint programObjectScaler, programObjectScalerExternal, currentProgram;
 LOutput *output = nullptr;
 LPainter *painter;
 LFramebuffer *fb = nullptr;
@@ -109,6 +149,7 @@ struct OpenGLExtensions
 {
     bool EXT_read_format_bgra;
     bool OES_EGL_image;
+    bool PBO; // Pixel pack buffers (GLES 3.0)
 } openGLExtensions;
 
 void updateExtensions() noexcept;
@@ -122,139 +163,204 @@ struct CPUFormats
 } cpuFormats;
 
 void updateCPUFormats() noexcept;
-void setupProgram() noexcept;
 void setupProgramScaler() noexcept;
 
-void shaderSetPremultipliedAlpha(bool premultipliedAlpha) noexcept
+void buildProgram(Program &program, const char *fragmentSource) noexcept;
+void compileVariant(UInt32 variant) noexcept;
+
+// Binds the program variant matching the current state and uploads the uniforms it doesn't have yet
+void useProgram() noexcept
 {
-    if (currentState->premultipliedAlpha != premultipliedAlpha)
+    UInt32 variant { 0 };
+
+    if (state.mode != ColorMode)
+    {
+        variant |= VariantTexture;
+
+        if (textureTarget == GL_TEXTURE_EXTERNAL_OES)
+            variant |= VariantExternal;
+
+        if (state.texColorEnabled)
+            variant |= VariantTexColor;
+        else
+        {
+            if (state.alpha != 1.f)
+            {
+                variant |= VariantAlpha;
+
+                if (state.premultipliedAlpha)
+                    variant |= VariantPremultiplied;
+            }
+
+            if (state.colorFactorEnabled)
+                variant |= VariantColorFactor;
+        }
+    }
+
+    Program *program { &variants[variant] };
+
+    if (program->id == 0 && !program->failed)
+        compileVariant(variant);
+
+    if (program->failed)
+        program = (variant & VariantExternal) && uberExternal.id ? &uberExternal : &uber;
+
+    if (boundProgram != program)
+    {
+        boundProgram = program;
+        currentProgram = program->id;
+        glUseProgram(currentProgram);
+    }
+
+    const Uniforms &u { program->uniforms };
+    ShaderState &s { program->state };
+    const bool all { !program->synced };
+    program->synced = true;
+
+    if (u.srcRect != -1 && (all || s.srcRect != state.srcRect))
+    {
+        s.srcRect = state.srcRect;
+        glUniform4f(u.srcRect, s.srcRect.x(), s.srcRect.y(), s.srcRect.w(), s.srcRect.h());
+    }
+
+    if (u.activeTexture != -1 && (all || s.activeTexture != state.activeTexture))
+    {
+        s.activeTexture = state.activeTexture;
+        glUniform1i(u.activeTexture, s.activeTexture);
+    }
+
+    if (u.mode != -1 && (all || s.mode != state.mode))
+    {
+        s.mode = state.mode;
+        glUniform1i(u.mode, s.mode);
+    }
+
+    if (u.color != -1 && (all || s.color != state.color))
+    {
+        s.color = state.color;
+        glUniform3f(u.color, s.color.r, s.color.g, s.color.b);
+    }
+
+    if (u.colorFactorEnabled != -1 && (all || s.colorFactorEnabled != state.colorFactorEnabled))
+    {
+        s.colorFactorEnabled = state.colorFactorEnabled;
+        glUniform1i(u.colorFactorEnabled, s.colorFactorEnabled);
+    }
+
+    if (u.texColorEnabled != -1 && (all || s.texColorEnabled != state.texColorEnabled))
+    {
+        s.texColorEnabled = state.texColorEnabled;
+        glUniform1i(u.texColorEnabled, s.texColorEnabled);
+    }
+
+    if (u.premultipliedAlpha != -1 && (all || s.premultipliedAlpha != state.premultipliedAlpha))
+    {
+        s.premultipliedAlpha = state.premultipliedAlpha;
+        glUniform1i(u.premultipliedAlpha, s.premultipliedAlpha);
+    }
+
+    if (u.has90deg != -1 && (all || s.has90deg != state.has90deg))
+    {
+        s.has90deg = state.has90deg;
+        glUniform1i(u.has90deg, s.has90deg);
+    }
+
+    if (u.batched != -1 && (all || s.batched != state.batched))
+    {
+        s.batched = state.batched;
+        glUniform1i(u.batched, s.batched);
+    }
+
+    if (u.alpha != -1 && (all || s.alpha != state.alpha))
     {
-        currentState->premultipliedAlpha = premultipliedAlpha;
-        glUniform1i(currentUniforms->premultipliedAlpha, premultipliedAlpha);
+        s.alpha = state.alpha;
+        glUniform1f(u.alpha, s.alpha);
     }
 }
 
+void shaderSetPremultipliedAlpha(bool premultipliedAlpha) noexcept
+{
+    state.premultipliedAlpha = premultipliedAlpha;
+}
+
 void shaderSetTexSize(const LSizeF &size) noexcept
 {
-    if (currentState->texSize != size)
-    {
-        currentState->texSize = size;
-        glUniform2f(currentUniforms->texSize, size.w(), size.h());
-    }
+    state.texSize = size;
 }
 
 void shaderSetSrcRect(const LRectF &rect) noexcept
 {
-    if (currentState->srcRect != rect)
-    {
-        currentState->srcRect = rect;
-        glUniform4f(currentUniforms->srcRect, rect.x(), rect.y(), rect.w(), rect.h());
-    }
+    state.srcRect = rect;
 }
 
 void shaderSetActiveTexture(GLuint unit) noexcept
 {
-    if (currentState->activeTexture != unit)
-    {
-        currentState->activeTexture = unit;
-        glUniform1i(currentUniforms->activeTexture, unit);
-    }
+    state.activeTexture = unit;
 }
 
 void shaderSetMode(ShaderMode mode) noexcept
 {
-    if (currentState->mode != mode)
-    {
-        currentState->mode = mode;
-        glUniform1i(currentUniforms->mode, mode);
-    }
+    state.mode = mode;
 }
 
 void shaderSetColor(const LRGBF &color) noexcept
 {
-    if (currentState->color != color)
-    {
-        currentState->color = color;
-        glUniform3f(currentUniforms->color, color.r, color.g, color.b);
-    }
+    state.color = color;
 }
 
 void shaderSetColorFactorEnabled(bool enabled) noexcept
 {
-    if (currentState->colorFactorEnabled != enabled)
-    {
-        currentState->colorFactorEnabled = enabled;
-        glUniform1i(currentUniforms->colorFactorEnabled, enabled);
-    }
+    state.colorFactorEnabled = enabled;
 }
 
 void shaderSetTexColorEnabled(bool enabled) noexcept
 {
-    if (currentState->texColorEnabled != enabled)
-    {
-        currentState->texColorEnabled = enabled;
-        glUniform1i(currentUniforms->texColorEnabled, enabled);
-    }
+    state.texColorEnabled = enabled;
 }
 
 void shaderSetHas90Deg(bool enabled) noexcept
 {
-    if (currentState->has90deg != enabled)
-    {
-        currentState->has90deg = enabled;
-        glUniform1i(currentUniforms->has90deg, enabled);
-    }
+    state.has90deg = enabled;
+}
+
+void shaderSetBatched(bool enabled) noexcept
+{
+    state.batched = enabled;
 }
 
 void shaderSetAlpha(Float32 a) noexcept
 {
-    if (currentState->alpha != a)
-    {
-        currentState->alpha = a;
-        glUniform1f(currentUniforms->alpha, a);
-    }
+    state.alpha = a;
 }
 
 // GL params
 
+// Programs for each target are selected by useProgram()
 void switchTarget(GLenum target) noexcept
 {
-    if (textureTarget != target)
+    textureTarget = target;
+}
+
+Float32 framebufferScale() const noexcept
+{
+    if (fb->type() == LFramebuffer::Output)
     {
-        if (target == GL_TEXTURE_2D)
-        {
-            currentProgram = programObject;
-            currentUniforms = &uniforms;
-            glUseProgram(currentProgram);
-            currentState = &state;
-            shaderSetColorFactorEnabled(stateExternal.colorFactorEnabled);
-            shaderSetAlpha(stateExternal.alpha);
-            shaderSetMode(stateExternal.mode);
-            shaderSetColor(stateExternal.color);
-            shaderSetTexColorEnabled(stateExternal.texColorEnabled);
-            shaderSetPremultipliedAlpha(stateExternal.premultipliedAlpha);
-            shaderSetHas90Deg(stateExternal.has90deg);
-        }
-        else
+        LOutputFramebuffer *outputFB = (LOutputFramebuffer*)fb;
+
+        if (outputFB->output()->usingFractionalScale())
         {
-            currentProgram = programObjectExternal;
-            currentUniforms = &uniformsExternal;
-            glUseProgram(currentProgram);
-            currentState = &stateExternal;
-            shaderSetColorFactorEnabled(state.colorFactorEnabled);
-            shaderSetAlpha(state.alpha);
-            shaderSetMode(state.mode);
-            shaderSetColor(state.color);
-            shaderSetTexColorEnabled(state.texColorEnabled);
-            shaderSetPremultipliedAlpha(state.premultipliedAlpha);
-            shaderSetHas90Deg(state.has90deg);
+            if (outputFB->output()->fractionalOversamplingEnabled())
+                return fb->scale();
+            else
+                return outputFB->output()->fractionalScale();
         }
-
-        textureTarget = target;
     }
+
+    return fb->scale();
 }
 
-void setViewport(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
+// Transforms a rect in compositor-global coords into the bound framebuffer GL viewport space
+void toBufferRect(Int32 &x, Int32 &y, Int32 &w, Int32 &h, Float32 fbScale) const noexcept
 {
     x -= fb->rect().x();
     y -= fb->rect().y();
@@ -320,25 +426,6 @@ void setViewport(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
             y = fb->rect().h() - y - h;
     }
 
-    Float32 fbScale;
-
-    if (fb->type() == LFramebuffer::Output)
-    {
-        LOutputFramebuffer *outputFB = (LOutputFramebuffer*)fb;
-
-        if (outputFB->output()->usingFractionalScale())
-        {
-            if (outputFB->output()->fractionalOversamplingEnabled())
-                fbScale = fb->scale();
-            else
-                fbScale = outputFB->output()->fractionalScale();
-        }
-        else
-            fbScale = fb->scale();
-    }
-    else
-        fbScale = fb->scale();
-
     const Int32 x2 = floorf(Float32(x + w) * fbScale);
     const Int32 y2 = floorf(Float32(y + h) * fbScale);
 
@@ -346,20 +433,81 @@ void setViewport(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
     y = floorf(Float32(y) * fbScale);
     w = x2 - x;
     h = y2 - y;
+}
 
+void setViewport(Int32 x, Int32 y, Int32 w, Int32 h) noexcept
+{
+    toBufferRect(x, y, w, h, framebufferScale());
     glScissor(x, y, w, h);
     glViewport(x, y, w, h);
 
-    if (currentState->mode == TextureMode)
+    if (state.mode == TextureMode)
     {
         shaderSetSrcRect(LRectF(
             (Float32(x) - srcRect.x()) / srcRect.w(),
-            (Float32(y2) - srcRect.y()) / srcRect.h(),
-            (Float32(x2) - srcRect.x()) / srcRect.w(),
+            (Float32(y + h) - srcRect.y()) / srcRect.h(),
+            (Float32(x + w) - srcRect.x()) / srcRect.w(),
             (Float32(y) - srcRect.y()) / srcRect.h()));
     }
 }
 
+/* Draws all boxes with a single call. Vertex positions and texture coords are calculated
+ * here the same way setViewport() and the vertex shader do it for each box individually */
+void drawBoxesBatched(const LBox *boxes, Int32 n) noexcept
+{
+    const Float32 fbScale { framebufferScale() };
+    Int32 fbX { fb->rect().x() }, fbY { fb->rect().y() }, fbW { fb->rect().w() }, fbH { fb->rect().h() };
+    toBufferRect(fbX, fbY, fbW, fbH, fbScale);
+    glScissor(fbX, fbY, fbW, fbH);
+    glViewport(fbX, fbY, fbW, fbH);
+
+    const bool textureMode { state.mode == TextureMode };
+    const Float32 sx { 2.f / Float32(fbW) };
+    const Float32 sy { 2.f / Float32(fbH) };
+    Int32 x, y, w, h;
+    Float32 x1, y1, x2, y2, u1 { 0.f }, v1 { 0.f }, u2 { 0.f }, v2 { 0.f };
+
+    batchVertices.resize(n * 24);
+    GLfloat *v { batchVertices.data() };
+
+    for (Int32 i = 0; i < n; i++)
+    {
+        x = boxes[i].x1;
+        y = boxes[i].y1;
+        w = boxes[i].x2 - x;
+        h = boxes[i].y2 - y;
+        toBufferRect(x, y, w, h, fbScale);
+
+        x1 = Float32(x - fbX) * sx - 1.f;
+        x2 = Float32(x + w - fbX) * sx - 1.f;
+        y1 = Float32(y - fbY) * sy - 1.f;
+        y2 = Float32(y + h - fbY) * sy - 1.f;
+
+        if (textureMode)
+        {
+            u1 = (Float32(x) - srcRect.x()) / srcRect.w();
+            u2 = (Float32(x + w) - srcRect.x()) / srcRect.w();
+            v1 = (Float32(y) - srcRect.y()) / srcRect.h();
+            v2 = (Float32(y + h) - srcRect.y()) / srcRect.h();
+        }
+
+        // Two triangles (BL, BR, TR) (BL, TR, TL)
+        *v++ = x1; *v++ = y1; *v++ = u1; *v++ = v1;
+        *v++ = x2; *v++ = y1; *v++ = u2; *v++ = v1;
+        *v++ = x2; *v++ = y2; *v++ = u2; *v++ = v2;
+        *v++ = x1; *v++ = y1; *v++ = u1; *v++ = v1;
+        *v++ = x2; *v++ = y2; *v++ = u2; *v++ = v2;
+        *v++ = x1; *v++ = y2; *v++ = u1; *v++ = v2;
+    }
+
+    shaderSetBatched(true);
+    useProgram();
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, batchVertices.data());
+    glDrawArrays(GL_TRIANGLES, 0, n * 6);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, square);
+    drawCalls++;
+}
+
 void updateBlendingParams() noexcept
 {
     needsBlendFuncUpdate = false;
@@ -399,7 +547,7 @@ void updateBlendingParams() noexcept
             shaderSetTexColorEnabled(false);
 
             /* Texture has premultiplied alpha */
-            if (userState.texture.get() && userState.texture->premultipliedAlpha())
+            if (userState.textureBound && userState.texturePremultipliedAlpha)
             {
                 if (userState.autoBlendFunc)
                 {
@@ -0,0 +1,311 @@
+#include <private/LProgramCache.h>
+#include <private/LCompositorPrivate.h>
+#include <LOpenGL.h>
+#include <LUtils.h>
+#include <LLog.h>
+#include <GLES2/gl2ext.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+using namespace Louvre;
+
+void LProgramCache::init() noexcept
+{
+    unit();
+
+    const char *env { getenv("LOUVRE_PROGRAM_CACHE") };
+
+    if (env && atoi(env) == 0)
+        return;
+
+    const char *xdgCacheHome { getenv("XDG_CACHE_HOME") };
+    const char *home { getenv("HOME") };
+
+    if (xdgCacheHome && xdgCacheHome[0] == '/')
+        m_dir = std::filesystem::path(xdgCacheHome) / "Louvre" / "programs";
+    else if (home && home[0] == '/')
+        m_dir = std::filesystem::path(home) / ".cache" / "Louvre" / "programs";
+    else
+    {
+        LLog::warning("[LProgramCache::init] Neither XDG_CACHE_HOME nor HOME are set. GL program binaries won't be stored on disk.");
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+
+    if (ec)
+    {
+        LLog::warning("[LProgramCache::init] Failed to create %s: %s. GL program binaries won't be stored on disk.", m_dir.c_str(), ec.message().c_str());
+        return;
+    }
+
+    m_diskEnabled = true;
+}
+
+void LProgramCache::unit() noexcept
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    m_binaries.clear();
+    m_dir.clear();
+    m_driverHash = 0;
+    m_supported = -1;
+    m_diskEnabled = false;
+}
+
+GLuint LProgramCache::link(const char *vertexSource, const char *fragmentSource) noexcept
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    if (!supported())
+    {
+        lock.unlock();
+        return linkFromSource(vertexSource, fragmentSource);
+    }
+
+    const UInt64 key { programKey(vertexSource, fragmentSource) };
+    auto it { m_binaries.find(key) };
+
+    if (it == m_binaries.end())
+    {
+        Binary binary;
+
+        if (m_diskEnabled && readBinary(key, binary))
+            it = m_binaries.emplace(key, std::move(binary)).first;
+    }
+
+    if (it != m_binaries.end())
+    {
+        const GLuint program { linkFromBinary(it->second) };
+
+        if (program)
+            return program;
+
+        // The driver rejected it (e.g. it was updated without changing its version string)
+        m_binaries.erase(it);
+    }
+
+    lock.unlock();
+
+    const GLuint program { linkFromSource(vertexSource, fragmentSource) };
+
+    if (!program)
+        return 0;
+
+    GLint length { 0 };
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+
+    if (length <= 0)
+        return program;
+
+    Binary binary;
+    binary.data.resize(length);
+    GLsizei written { 0 };
+    compositor()->imp()->glGetProgramBinaryOES(program, length, &written, &binary.format, binary.data.data());
+
+    if (written <= 0)
+        return program;
+
+    binary.data.resize(written);
+    lock.lock();
+
+    if (m_diskEnabled)
+        writeBinary(key, binary);
+
+    m_binaries[key] = std::move(binary);
+    return program;
+}
+
+UInt64 LProgramCache::hash(const void *data, size_t size, UInt64 seed) noexcept
+{
+    // FNV-1a
+    const UInt8 *bytes { static_cast<const UInt8*>(data) };
+    UInt64 h { seed };
+
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+
+    return h;
+}
+
+bool LProgramCache::supported() noexcept
+{
+    if (m_supported != -1)
+        return m_supported == 1;
+
+    m_supported = 0;
+
+    if (!compositor()->imp()->glGetProgramBinaryOES || !compositor()->imp()->glProgramBinaryOES)
+        return false;
+
+    const char *extensions { (const char*)glGetString(GL_EXTENSIONS) };
+
+    if (!extensions || !LOpenGL::hasExtension(extensions, "GL_OES_get_program_binary"))
+        return false;
+
+    GLint formats { 0 };
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+
+    if (formats <= 0)
+        return false;
+
+    // Binaries are only valid for the driver that created them
+    UInt64 h { 0xcbf29ce484222325ull };
+
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const char *str { (const char*)glGetString(name) };
+
+        if (str)
+            h = hash(str, strlen(str) + 1, h);
+    }
+
+    m_driverHash = h;
+    m_supported = 1;
+    return true;
+}
+
+UInt64 LProgramCache::programKey(const char *vertexSource, const char *fragmentSource) noexcept
+{
+    UInt64 h { hash(&Version, sizeof(Version), m_driverHash) };
+    h = hash(vertexSource, strlen(vertexSource) + 1, h);
+    return hash(fragmentSource, strlen(fragmentSource) + 1, h);
+}
+
+GLuint LProgramCache::linkFromSource(const char *vertexSource, const char *fragmentSource) noexcept
+{
+    const GLuint vertex { LOpenGL::compileShader(GL_VERTEX_SHADER, vertexSource) };
+
+    if (!vertex)
+        return 0;
+
+    const GLuint fragment { LOpenGL::compileShader(GL_FRAGMENT_SHADER, fragmentSource) };
+
+    if (!fragment)
+    {
+        glDeleteShader(vertex);
+        return 0;
+    }
+
+    GLuint program { glCreateProgram() };
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glBindAttribLocation(program, 0, "vertexPosition");
+    glLinkProgram(program);
+
+    // Released along with the program
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+    if (!linked)
+    {
+        LLog::error("[LProgramCache::linkFromSource] Failed to link program.");
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+GLuint LProgramCache::linkFromBinary(const Binary &binary) noexcept
+{
+    GLuint program { glCreateProgram() };
+    compositor()->imp()->glProgramBinaryOES(program, binary.format, binary.data.data(), binary.data.size());
+
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+    if (!linked)
+    {
+        // Discard GL_INVALID_ENUM if the format is no longer supported
+        while (glGetError() != GL_NO_ERROR) {}
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+bool LProgramCache::readBinary(UInt64 key, Binary &binary) noexcept
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    const std::filesystem::path path { m_dir / name };
+    FILE *file { fopen(path.c_str(), "rbe") };
+
+    if (!file)
+        return false;
+
+    FileHeader header;
+    bool valid { fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+                 header.version == Version &&
+                 header.key == key &&
+                 header.size > 0 &&
+                 header.size <= 64 * 1024 * 1024 };
+
+    if (valid)
+    {
+        binary.format = header.format;
+        binary.data.resize(header.size);
+        valid = fread(binary.data.data(), 1, header.size, file) == header.size &&
+                hash(binary.data.data(), binary.data.size(), 0xcbf29ce484222325ull) == header.checksum;
+    }
+
+    fclose(file);
+
+    if (!valid)
+    {
+        LLog::warning("[LProgramCache::readBinary] Removing invalid GL program binary %s.", path.c_str());
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        binary.data.clear();
+    }
+
+    return valid;
+}
+
+void LProgramCache::writeBinary(UInt64 key, const Binary &binary) noexcept
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    const std::filesystem::path path { m_dir / name };
+
+    // Written into a temporary file first so other compositor instances never read partial files
+    const std::filesystem::path tmpPath { m_dir / (std::string(name) + ".tmp." + std::to_string(getpid())) };
+    FILE *file { fopen(tmpPath.c_str(), "wbe") };
+
+    if (!file)
+        return;
+
+    FileHeader header {};
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.format = binary.format;
+    header.key = key;
+    header.size = binary.data.size();
+    header.checksum = hash(binary.data.data(), binary.data.size(), 0xcbf29ce484222325ull);
+
+    const bool ok { fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    fwrite(binary.data.data(), 1, binary.data.size(), file) == binary.data.size() };
+
+    std::error_code ec;
+
+    if (fclose(file) != 0 || !ok)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return;
+    }
+
+    std::filesystem::rename(tmpPath, path, ec);
+
+    if (ec)
+        std::filesystem::remove(tmpPath, ec);
+}
@@ -0,0 +1,67 @@
+#ifndef LPROGRAMCACHE_H
+#define LPROGRAMCACHE_H
+
+#include <LNamespaces.h>
+#include <GLES2/gl2.h>
+#include <unordered_map>
+#include <filesystem>
+#include <vector>
+#include <mutex>
+
+namespace Louvre
+{
+    /* Links GL programs from their binaries when possible (GL_OES_get_program_binary), so shaders are only
+     * compiled the first time a driver sees them. Binaries are kept in memory for the painters of other
+     * threads, and on disk under $XDG_CACHE_HOME/Louvre/programs for the next runs (see LOUVRE_PROGRAM_CACHE).
+     *
+     * Program objects themselves are not shared between contexts: uniform values are part of the program
+     * object, so output threads rendering in parallel would overwrite each other's state */
+    class LProgramCache
+    {
+    public:
+        void init() noexcept;
+        void unit() noexcept;
+
+        /* Returns a linked program or 0 on failure, the attribute 0 is always bound to "vertexPosition".
+         * Can be called from any thread with a current GL context */
+        GLuint link(const char *vertexSource, const char *fragmentSource) noexcept;
+
+    private:
+        struct Binary
+        {
+            GLenum format { 0 };
+            std::vector<UInt8> data;
+        };
+
+        // Stored at the beginning of each cache file
+        struct FileHeader
+        {
+            char magic[8];
+            UInt32 version;
+            UInt32 format;
+            UInt64 key;
+            UInt64 size;
+            UInt64 checksum; // Of the binary data
+        };
+
+        static constexpr char Magic[8] { 'L', 'V', 'R', 'P', 'R', 'O', 'G', '\0' };
+        static constexpr UInt32 Version { 1 };
+
+        static UInt64 hash(const void *data, size_t size, UInt64 seed) noexcept;
+        bool supported() noexcept;
+        UInt64 programKey(const char *vertexSource, const char *fragmentSource) noexcept;
+        GLuint linkFromSource(const char *vertexSource, const char *fragmentSource) noexcept;
+        GLuint linkFromBinary(const Binary &binary) noexcept;
+        bool readBinary(UInt64 key, Binary &binary) noexcept;
+        void writeBinary(UInt64 key, const Binary &binary) noexcept;
+
+        std::mutex m_mutex;
+        std::unordered_map<UInt64, Binary> m_binaries;
+        std::filesystem::path m_dir;
+        UInt64 m_driverHash { 0 };
+        Int8 m_supported { -1 }; // -1 until checked
+        bool m_diskEnabled { false };
+    };
+};
+
+#endif // LPROGRAMCACHE_H
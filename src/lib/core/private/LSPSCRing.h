@@ -0,0 +1,63 @@
+#ifndef LSPSCRING_H
+#define LSPSCRING_H
+
+#include <LNamespaces.h>
+#include <atomic>
+
+namespace Louvre
+{
+    /* Lock-free ring buffer for a single producer thread and a single consumer thread.
+     * Capacity must be a power of two, one slot is always left empty */
+    template <class T, size_t Capacity>
+    class LSPSCRing
+    {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        // Producer only, returns false if full
+        bool push(const T &value) noexcept
+        {
+            const size_t head { m_head.load(std::memory_order_relaxed) };
+            const size_t next { (head + 1) & (Capacity - 1) };
+
+            if (next == m_tail.load(std::memory_order_acquire))
+                return false;
+
+            m_slots[head] = value;
+            m_head.store(next, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only, returns false if empty
+        bool pop(T &value) noexcept
+        {
+            const size_t tail { m_tail.load(std::memory_order_relaxed) };
+
+            if (tail == m_head.load(std::memory_order_acquire))
+                return false;
+
+            value = m_slots[tail];
+            m_tail.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+            return true;
+        }
+
+        // Approximate if called while the other thread is active
+        bool empty() const noexcept
+        {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+
+        static constexpr size_t capacity() noexcept
+        {
+            return Capacity - 1;
+        }
+
+    private:
+        // Kept on separate cache lines so that both threads don't invalidate each other
+        alignas(64) std::atomic<size_t> m_head { 0 };
+        alignas(64) std::atomic<size_t> m_tail { 0 };
+        alignas(64) T m_slots[Capacity];
+    };
+};
+
+#endif // LSPSCRING_H
@@ -1,4 +1,5 @@
 #include <private/LScenePrivate.h>
+#include <private/LCompositorPrivate.h>
 #include <LSceneTouchPoint.h>
 #include <LOutput.h>
 #include <LCompositor.h>
@@ -8,10 +9,112 @@
 #include <LCursor.h>
 #include <LUtils.h>
 #include <LLog.h>
+#include <private/LOutputPrivate.h>
+#include <private/LSurfacePrivate.h>
+#include <protocols/LinuxDMABuf/LDMABuffer.h>
+#include <private/LCompositorPrivate.h>
+#include <cmath>
 
 using LVS = LView::LViewState;
 using LSS = LScene::LScenePrivate::State;
 
+LScene::ScanoutResult LScene::LScenePrivate::tryAutoScanout(LOutput *output, const LSceneView::ThreadData &ctd) noexcept
+{
+    if (!output->screenshotRequests().empty())
+        return ScanoutScreenshot;
+
+    if (cursor()->visible() && cursor()->enabled(output) && !cursor()->hwCompositingEnabled(output) && cursor()->rect().intersects(output->rect(), false))
+        return ScanoutCursor;
+
+    /* Views fully occluded are not added to the render list, but it also contains views
+     * displayed on other outputs */
+    LBox outputBox { output->pos().x(), output->pos().y(), output->pos().x() + output->size().w(), output->pos().y() + output->size().h() };
+    const LView::ViewCache *candidate { nullptr };
+
+    for (const LView::ViewCache *entry : ctd.renderList)
+    {
+        if (entry->clippingBox.x1 >= outputBox.x2 || entry->clippingBox.x2 <= outputBox.x1 ||
+            entry->clippingBox.y1 >= outputBox.y2 || entry->clippingBox.y2 <= outputBox.y1)
+            continue;
+
+        if (candidate)
+            return ScanoutNoCandidate;
+
+        candidate = entry;
+    }
+
+    if (!candidate)
+        return ScanoutNoCandidate;
+
+    const LView::ViewCache &cache { *candidate };
+
+    if (cache.view->type() != LView::SurfaceType)
+        return ScanoutNotSurface;
+
+    LSurface *surface { static_cast<LSurfaceView*>(cache.view)->surface() };
+
+    if (!surface || !surface->texture())
+        return ScanoutNotSurface;
+
+    if (cache.opacity < 1.f || cache.scalingEnabled ||
+        (cache.colorFactorEnabled && (cache.colorFactor.r != 1.f || cache.colorFactor.g != 1.f || cache.colorFactor.b != 1.f || cache.colorFactor.a != 1.f)))
+        return ScanoutEffects;
+
+    const LTexture *texture { surface->texture() };
+    const LSize bufferSize { is90Transform(surface->bufferTransform()) ? LSize(texture->sizeB().h(), texture->sizeB().w()) : texture->sizeB() };
+
+    // Cropped or stretched buffers (viewporter) can't be displayed as is
+    if (cache.rect != output->rect() ||
+        surface->srcRect().x() != 0.f || surface->srcRect().y() != 0.f ||
+        surface->srcRect().w() * surface->bufferScale() != bufferSize.w() ||
+        surface->srcRect().h() * surface->bufferScale() != bufferSize.h())
+        return ScanoutGeometry;
+
+    // The opaque region is clipped to the visible region
+    if (pixman_region32_contains_rectangle(&cache.opaque.m_region, reinterpret_cast<pixman_box32_t*>(&outputBox)) != PIXMAN_REGION_IN)
+        return ScanoutTranslucent;
+
+    if (surface->bufferTransform() != output->transform())
+        return ScanoutTransform;
+
+    if (texture->sourceType() != LTexture::DMA && texture->sourceType() != LTexture::WL_DRM)
+        return ScanoutBufferType;
+
+    if (texture->sourceType() == LTexture::DMA)
+    {
+        // The texture doesn't store the modifier, so it's taken from the buffer it was created from
+        wl_resource *bufferRes { surface->imp()->current.bufferRes };
+
+        if (!bufferRes || !LDMABuffer::isDMABuffer(bufferRes))
+            return ScanoutBufferType;
+
+        const LDMABuffer *dmaBuffer { static_cast<const LDMABuffer*>(wl_resource_get_user_data(bufferRes)) };
+
+        if (dmaBuffer->texture() != texture)
+            return ScanoutBufferType;
+
+        const LDMAFormat bufferFormat { dmaBuffer->planes()->format, dmaBuffer->planes()->modifiers[0] };
+        bool supported { false };
+
+        for (const LDMAFormat &format : *compositor()->imp()->graphicBackend->backendGetScanoutDMAFormats())
+        {
+            if (format == bufferFormat)
+            {
+                supported = true;
+                break;
+            }
+        }
+
+        if (!supported)
+            return ScanoutFormat;
+    }
+
+    if (!output->setCustomScanoutBuffer(surface->texture()))
+        return ScanoutBackendRejected;
+
+    return ScanoutAccepted;
+}
+
 LView *LScene::LScenePrivate::viewAt(LView *view, const LPoint &pos, LView::Type type, LBitset<InputFilter> flags)
 {
     LView *v { nullptr };
@@ -24,44 +127,61 @@ LView *LScene::LScenePrivate::viewAt(LView *view, const LPoint &pos, LView::Type
             return v;
     }
 
+    return viewMatches(view, pos, type, flags) ? view : nullptr;
+}
+
+LView *LScene::LScenePrivate::viewAtIndexed(const LPoint &pos, LView::Type type, LBitset<InputFilter> flags)
+{
+    updateViewsIndex();
+    viewsIndex.query(pos, viewsIndexCandidates);
+
+    for (LView *view : viewsIndexCandidates)
+        if (viewMatches(view, pos, type, flags))
+            return view;
+
+    return nullptr;
+}
+
+bool LScene::LScenePrivate::viewMatches(LView *view, const LPoint &pos, LView::Type type, LBitset<InputFilter> flags)
+{
     if (!view->mapped())
-        return nullptr;
+        return false;
 
     if (type != LView::UndefinedType && view->type() != type)
-        return nullptr;
+        return false;
 
     if (flags != 0 &&
         !((flags.check(InputFilter::Touch) && view->touchEventsEnabled()) ||
           (flags.check(InputFilter::Pointer) && view->pointerEventsEnabled()) ||
           (flags.check(InputFilter::Keyboard) && view->keyboardEventsEnabled())))
-        return nullptr;
+        return false;
 
     if (view->clippingEnabled() && !view->clippingRect().containsPoint(pos))
-        return nullptr;
+        return false;
 
     if (pointClippedByParent(view, pos))
-        return nullptr;
+        return false;
 
     if (pointClippedByParentScene(view, pos))
-        return nullptr;
+        return false;
 
     if (flags == 0)
-        return view;
+        return true;
 
     if ((view->scalingEnabled() || view->parentScalingEnabled()) && view->scalingVector() != LSizeF(1.f, 1.f))
     {
         if (view->scalingVector().area() == 0.f)
-            return nullptr;
+            return false;
 
         if (view->inputRegion())
         {
             if (view->inputRegion()->containsPoint((pos - view->pos())/view->scalingVector()))
-                v = view;
+                return true;
         }
         else
         {
             if (LRect(view->pos(), view->size()).containsPoint((pos - view->pos())/view->scalingVector()))
-                v = view;
+                return true;
         }
     }
     else
@@ -69,16 +189,145 @@ LView *LScene::LScenePrivate::viewAt(LView *view, const LPoint &pos, LView::Type
         if (view->inputRegion())
         {
             if (view->inputRegion()->containsPoint(pos - view->pos()))
-                v = view;
+                return true;
         }
         else
         {
             if (LRect(view->pos(), view->size()).containsPoint(pos))
-                v = view;
+                return true;
         }
     }
 
-    return v;
+    return false;
+}
+
+void LScene::LScenePrivate::updateViewsIndex()
+{
+    const UInt64 structureSerial { compositor()->imp()->viewsStructureSerial };
+
+    // Reordering only changes the orders, no cell is touched
+    if (viewsIndexStructureSerial != structureSerial)
+    {
+        viewsIndexStructureSerial = structureSerial;
+        UInt64 order { 0 };
+        orderViewsIndex(&view, order);
+    }
+
+    if (viewsIndexDirty.empty())
+        return;
+
+    for (LView *dirty : viewsIndexDirty)
+    {
+        // Already updated along with a dirty parent
+        LView *parent { dirty->parent() };
+
+        while (parent && !parent->m_state.check(LVS::InputIndexDirty))
+            parent = parent->parent();
+
+        if (!parent)
+            updateViewIndexBox(dirty);
+    }
+
+    for (LView *dirty : viewsIndexDirty)
+        dirty->m_state.remove(LVS::InputIndexDirty);
+
+    viewsIndexDirty.clear();
+}
+
+void LScene::LScenePrivate::orderViewsIndex(LView *view, UInt64 &order)
+{
+    // Same stacking order used by viewAt(): parents below their children
+    viewsIndex.setOrder(view, ++order);
+
+    for (LView *child : view->children())
+        orderViewsIndex(child, order);
+}
+
+void LScene::LScenePrivate::updateViewIndexBox(LView *view)
+{
+    // Conservative bounds of the area where viewMatches() could return true, empty if unmapped
+    LBox box { 0, 0, 0, 0 };
+
+    if (view->mapped())
+    {
+        if ((view->scalingEnabled() || view->parentScalingEnabled()) && view->scalingVector() != LSizeF(1.f, 1.f))
+        {
+            const LSizeF &s { view->scalingVector() };
+            const LPoint &p { view->pos() };
+            LBox local;
+
+            if (view->inputRegion())
+                local = view->inputRegion()->extents();
+            else
+                local = { p.x(), p.y(), p.x() + view->size().w(), p.y() + view->size().h() };
+
+            const Float32 xa { p.x() + local.x1 * s.w() }, xb { p.x() + local.x2 * s.w() };
+            const Float32 ya { p.y() + local.y1 * s.h() }, yb { p.y() + local.y2 * s.h() };
+            const Int32 margin { 1 + static_cast<Int32>(std::ceil(std::max(std::fabs(s.w()), std::fabs(s.h())))) };
+            box.x1 = static_cast<Int32>(std::floor(std::min(xa, xb))) - margin;
+            box.y1 = static_cast<Int32>(std::floor(std::min(ya, yb))) - margin;
+            box.x2 = static_cast<Int32>(std::ceil(std::max(xa, xb))) + margin;
+            box.y2 = static_cast<Int32>(std::ceil(std::max(ya, yb))) + margin;
+        }
+        else
+        {
+            const LPoint &p { view->pos() };
+
+            if (view->inputRegion())
+            {
+                const LBox &ext { view->inputRegion()->extents() };
+                box = { ext.x1 + p.x(), ext.y1 + p.y(), ext.x2 + p.x(), ext.y2 + p.y() };
+            }
+            else
+                box = { p.x(), p.y(), p.x() + view->size().w(), p.y() + view->size().h() };
+
+            // Queries truncate floating point positions
+            box.x1--; box.y1--; box.x2++; box.y2++;
+        }
+    }
+
+    // Only moves the grid cells of the view if its box changed
+    viewsIndex.update(view, box);
+
+    // The position, mapping and scaling of children depend on their parent
+    for (LView *child : view->children())
+        updateViewIndexBox(child);
+}
+
+void LScene::LScenePrivate::removeFromInputIndex(LView *view) noexcept
+{
+    viewsIndex.remove(view);
+
+    if (view->m_state.check(LVS::InputIndexDirty))
+    {
+        view->m_state.remove(LVS::InputIndexDirty);
+        LVectorRemoveOneUnordered(viewsIndexDirty, view);
+    }
+
+    if (view->m_state.check(LVS::PointerMoveDone))
+    {
+        view->m_state.remove(LVS::PointerMoveDone);
+        LVectorRemoveOneUnordered(pointerMoveDone, view);
+    }
+}
+
+void LScene::LScenePrivate::updatePointerCandidates()
+{
+    updateViewsIndex();
+    viewsIndex.query(cursor()->pos(), pointerCandidates);
+
+    // Views the pointer may be leaving, merged by stacking order to preserve the order of the events
+    for (LView *focus : pointerFocus)
+    {
+        const UInt64 order { viewsIndex.order(focus) };
+        const auto it { std::lower_bound(pointerCandidates.begin(), pointerCandidates.end(), order, [this](LView *view, UInt64 order)
+        {
+            return viewsIndex.order(view) > order;
+        })};
+
+        if (it == pointerCandidates.end() || *it != focus)
+            pointerCandidates.insert(it, focus);
+    }
 }
 
 bool LScene::LScenePrivate::pointClippedByParent(LView *view, const LPoint &point)
@@ -111,107 +360,112 @@ bool LScene::LScenePrivate::pointClippedByParentScene(LView *view, const LPoint
     return pointClippedByParentScene(parentScene, point);
 }
 
-bool LScene::LScenePrivate::handlePointerMove(LView *view)
+bool LScene::LScenePrivate::handlePointerMove()
 {
     if (state.check(LSS::ChildrenListChanged))
         goto listChangedErr;
 
-    for (std::list<LView*>::const_reverse_iterator it = view->children().crbegin(); it != view->children().crend(); it++)
-        if (!handlePointerMove(*it))
-            return false;
-
-    if (!state.check(LSS::PointerIsBlocked) && pointIsOverView(view, cursor()->pos(), InputFilter::Pointer))
+    // Only the views whose bounds contain the cursor or that had the pointer over them, from top to bottom
+    for (size_t i = 0; i < pointerCandidates.size(); i++)
     {
-        if (view->blockPointerEnabled())
-            state.add(LSS::PointerIsBlocked);
+        LView *view { pointerCandidates[i] };
 
-        if (!view->m_state.check(LVS::PointerMoveDone))
+        if (!state.check(LSS::PointerIsBlocked) && pointIsOverView(view, cursor()->pos(), InputFilter::Pointer))
         {
-            view->m_state.add(LVS::PointerMoveDone);
+            if (view->blockPointerEnabled())
+                state.add(LSS::PointerIsBlocked);
 
-            if (view->m_state.check(LVS::PointerIsOver))
-            {
-                LVectorRemoveOne(pointerFocus, view);
-                pointerFocus.push_back(view);
-                currentPointerMoveEvent.localPos = viewLocalPos(view, cursor()->pos());
-                view->pointerMoveEvent(currentPointerMoveEvent);
-
-                if (state.check(LSS::ChildrenListChanged))
-                    goto listChangedErr;
-            }
-            else
+            if (!view->m_state.check(LVS::PointerMoveDone))
             {
-                view->m_state.add(LVS::PointerIsOver);
-                pointerFocus.push_back(view);
-                currentPointerEnterEvent.localPos = viewLocalPos(view, cursor()->pos());
-                view->pointerEnterEvent(currentPointerEnterEvent);
-
-                if (state.check(LSS::ChildrenListChanged))
-                    goto listChangedErr;
+                view->m_state.add(LVS::PointerMoveDone);
+                pointerMoveDone.push_back(view);
+
+                if (view->m_state.check(LVS::PointerIsOver))
+                {
+                    LVectorRemoveOne(pointerFocus, view);
+                    pointerFocus.push_back(view);
+                    currentPointerMoveEvent.localPos = viewLocalPos(view, cursor()->pos());
+                    view->pointerMoveEvent(currentPointerMoveEvent);
+
+                    if (state.check(LSS::ChildrenListChanged))
+                        goto listChangedErr;
+                }
+                else
+                {
+                    view->m_state.add(LVS::PointerIsOver);
+                    pointerFocus.push_back(view);
+                    currentPointerEnterEvent.localPos = viewLocalPos(view, cursor()->pos());
+                    view->pointerEnterEvent(currentPointerEnterEvent);
+
+                    if (state.check(LSS::ChildrenListChanged))
+                        goto listChangedErr;
+                }
             }
         }
-    }
-    else if (!view->m_state.check(LVS::PointerMoveDone))
-    {
-        view->m_state.add(LVS::PointerMoveDone);
-
-        if (view->m_state.check(LVS::PointerIsOver))
+        else if (!view->m_state.check(LVS::PointerMoveDone))
         {
-            view->m_state.remove(LVS::PointerIsOver);
-
-            if (view->m_state.check(LVS::PendingSwipeEnd))
-            {
-                view->m_state.remove(LVS::PendingSwipeEnd);
-                pointerSwipeEndEvent.setCancelled(true);
-                pointerSwipeEndEvent.setMs(currentPointerMoveEvent.ms());
-                pointerSwipeEndEvent.setUs(currentPointerMoveEvent.us());
-                pointerSwipeEndEvent.setSerial(LTime::nextSerial());
-                view->pointerSwipeEndEvent(pointerSwipeEndEvent);
-
-                if (state.check(LSS::ChildrenListChanged))
-                    goto listChangedErr;
-            }
+            view->m_state.add(LVS::PointerMoveDone);
+            pointerMoveDone.push_back(view);
 
-            if (view->m_state.check(LVS::PendingPinchEnd))
+            if (view->m_state.check(LVS::PointerIsOver))
             {
-                view->m_state.remove(LVS::PendingPinchEnd);
-                pointerPinchEndEvent.setCancelled(true);
-                pointerPinchEndEvent.setMs(currentPointerMoveEvent.ms());
-                pointerPinchEndEvent.setUs(currentPointerMoveEvent.us());
-                pointerPinchEndEvent.setSerial(LTime::nextSerial());
-                view->pointerPinchEndEvent(pointerPinchEndEvent);
+                view->m_state.remove(LVS::PointerIsOver);
+
+                if (view->m_state.check(LVS::PendingSwipeEnd))
+                {
+                    view->m_state.remove(LVS::PendingSwipeEnd);
+                    pointerSwipeEndEvent.setCancelled(true);
+                    pointerSwipeEndEvent.setMs(currentPointerMoveEvent.ms());
+                    pointerSwipeEndEvent.setUs(currentPointerMoveEvent.us());
+                    pointerSwipeEndEvent.setSerial(LTime::nextSerial());
+                    view->pointerSwipeEndEvent(pointerSwipeEndEvent);
+
+                    if (state.check(LSS::ChildrenListChanged))
+                        goto listChangedErr;
+                }
+
+                if (view->m_state.check(LVS::PendingPinchEnd))
+                {
+                    view->m_state.remove(LVS::PendingPinchEnd);
+                    pointerPinchEndEvent.setCancelled(true);
+                    pointerPinchEndEvent.setMs(currentPointerMoveEvent.ms());
+                    pointerPinchEndEvent.setUs(currentPointerMoveEvent.us());
+                    pointerPinchEndEvent.setSerial(LTime::nextSerial());
+                    view->pointerPinchEndEvent(pointerPinchEndEvent);
+
+                    if (state.check(LSS::ChildrenListChanged))
+                        goto listChangedErr;
+                }
+
+                if (view->m_state.check(LVS::PendingHoldEnd))
+                {
+                    view->m_state.remove(LVS::PendingHoldEnd);
+                    pointerHoldEndEvent.setCancelled(true);
+                    pointerHoldEndEvent.setMs(currentPointerMoveEvent.ms());
+                    pointerHoldEndEvent.setUs(currentPointerMoveEvent.us());
+                    pointerHoldEndEvent.setSerial(LTime::nextSerial());
+                    view->pointerHoldEndEvent(pointerHoldEndEvent);
+
+                    if (state.check(LSS::ChildrenListChanged))
+                        goto listChangedErr;
+                }
 
-                if (state.check(LSS::ChildrenListChanged))
-                    goto listChangedErr;
-            }
-
-            if (view->m_state.check(LVS::PendingHoldEnd))
-            {
-                view->m_state.remove(LVS::PendingHoldEnd);
-                pointerHoldEndEvent.setCancelled(true);
-                pointerHoldEndEvent.setMs(currentPointerMoveEvent.ms());
-                pointerHoldEndEvent.setUs(currentPointerMoveEvent.us());
-                pointerHoldEndEvent.setSerial(LTime::nextSerial());
-                view->pointerHoldEndEvent(pointerHoldEndEvent);
+                LVectorRemoveOne(pointerFocus, view);
+                view->pointerLeaveEvent(currentPointerLeaveEvent);
 
                 if (state.check(LSS::ChildrenListChanged))
                     goto listChangedErr;
             }
-
-            LVectorRemoveOne(pointerFocus, view);
-            view->pointerLeaveEvent(currentPointerLeaveEvent);
-
-            if (state.check(LSS::ChildrenListChanged))
-                goto listChangedErr;
         }
     }
 
     return true;
 
-    // If a list was modified, start again, serials are used to prevent resend events
+    // If a list was modified, start again, PointerMoveDone prevents resending events
 listChangedErr:
     state.remove(LSS::ChildrenListChanged);
-    handlePointerMove(&this->view);
+    updatePointerCandidates();
+    handlePointerMove();
     return false;
 }
 
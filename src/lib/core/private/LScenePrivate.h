@@ -12,6 +12,9 @@
 #include <LScene.h>
 #include <LBitset.h>
 #include <LSeat.h>
+#include <private/LSpatialIndex.h>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 
 using namespace Louvre;
@@ -40,6 +43,8 @@ LPRIVATE_CLASS(LScene)
         HandlingKeyboardKeyEvent            = static_cast<UInt32>(1) << 17,
         HandlingTouchEvent                  = static_cast<UInt32>(1) << 18,
         AutoRepaint                         = static_cast<UInt32>(1) << 19,
+        ParallelRendering                   = static_cast<UInt32>(1) << 20,
+        AutoScanout                         = static_cast<UInt32>(1) << 21,
     };
 
     LBitset<State> state { AutoRepaint };
@@ -63,11 +68,42 @@ LPRIVATE_CLASS(LScene)
     LPointF touchGlobalPos;
     LSceneTouchPoint *currentTouchPoint;
 
+    /* Hit-testing index of mapped views. Views whose input bounds may have changed (see LView::invalidateInputIndex())
+     * are queued in viewsIndexDirty and only their boxes (and the ones of their children) are updated before a query.
+     * Orders are renumbered when views are added, removed or reordered (LCompositorPrivate::viewsStructureSerial) */
+    UInt64 viewsIndexStructureSerial { 0 };
+    LSpatialIndex<LView*> viewsIndex;
+    std::vector<LView*> viewsIndexDirty;
+    std::vector<LView*> viewsIndexCandidates;
+    void invalidateInputIndex(LView *view) noexcept
+    {
+        if (view->m_state.check(LView::InputIndexDirty))
+            return;
+
+        view->m_state.add(LView::InputIndexDirty);
+        viewsIndexDirty.push_back(view);
+    }
+    void removeFromInputIndex(LView *view) noexcept;
+    void updateViewsIndex();
+    void orderViewsIndex(LView *view, UInt64 &order);
+    void updateViewIndexBox(LView *view);
+
+    /* Views that may receive pointer move events (see handlePointerMove()): the index candidates
+     * plus the current pointer focus (to send leave events), from top to bottom */
+    std::vector<LView*> pointerCandidates;
+    std::vector<LView*> pointerMoveDone;
+    void updatePointerCandidates();
+
+    // Must be called after the main view damage has been calculated (see LScene::enableAutoScanout())
+    LScene::ScanoutResult tryAutoScanout(LOutput *output, const LSceneView::ThreadData &ctd) noexcept;
+
     bool pointClippedByParent(LView *parent, const LPoint &point);
     bool pointClippedByParentScene(LView *view, const LPoint &point);
     LView *viewAt(LView *view, const LPoint &pos, LView::Type type, LBitset<LScene::InputFilter> flags);
+    LView *viewAtIndexed(const LPoint &pos, LView::Type type, LBitset<LScene::InputFilter> flags);
+    bool viewMatches(LView *view, const LPoint &pos, LView::Type type, LBitset<LScene::InputFilter> flags);
     LPoint viewLocalPos(LView *view, const LPoint &pos);
-    bool handlePointerMove(LView *view);
+    bool handlePointerMove();
     bool handleTouchDown(LView *view);
 
     bool pointIsOverView(LView *view, const LPointF &pos, LBitset<LScene::InputFilter> flags)
@@ -2,6 +2,7 @@
 #define LSEATPRIVATE_H
 
 #include <LSeat.h>
+#include <private/LInputRecording.h>
 #include <LDND.h>
 
 #ifdef  __cplusplus
@@ -27,6 +28,9 @@ LPRIVATE_CLASS(LSeat)
     std::vector<LSurface*> idleInhibitors;
     std::vector<const LIdleListener*> idleListeners;
     bool isUserIdleHint                     { false };
+    bool pointerMotionCoalescing            { false };
+    LSeat::PointerMotionStats pointerMotionStats;
+    LInputRecorder inputRecorder;
 
     libseat *libseatHandle                  { nullptr };
     libseat_seat_listener listener;
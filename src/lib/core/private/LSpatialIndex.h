@@ -0,0 +1,255 @@
+#ifndef LSPATIALINDEX_H
+#define LSPATIALINDEX_H
+
+#include <LNamespaces.h>
+#include <LPoint.h>
+#include <LBox.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace Louvre
+{
+    /* Uniform grid used to speed up hit-testing (LPointer::surfaceAt(), LScene::viewAt(), etc).
+     *
+     * Each item has a conservative bounding box and a stacking order (higher is on top). Boxes are snapshots
+     * the owner keeps up to date with update(), which only moves the cells of an item when its box changes.
+     * Reordering only calls setOrder(), no cell is touched. query() returns the items whose box contains a
+     * point from top to bottom, callers must still perform the exact test on the returned candidates. */
+    template <class T>
+    class LSpatialIndex
+    {
+    public:
+        // Cells are 2^CellShift pixels wide
+        static constexpr Int32 CellShift { 8 };
+
+        // Items covering more cells than this are tested on every query instead
+        static constexpr Int32 MaxCellsPerItem { 64 };
+
+        void clear() noexcept
+        {
+            m_items.clear();
+            m_free.clear();
+            m_lookup.clear();
+            m_large.clear();
+            m_cells.clear();
+        }
+
+        /* Adds the item or updates its bounding box, an empty box keeps the item (and its order)
+         * but removes it from the grid */
+        void update(T data, const LBox &box) noexcept
+        {
+            const auto [it, inserted] { m_lookup.try_emplace(data, 0) };
+
+            if (inserted)
+                it->second = allocItem(data);
+            else
+            {
+                const LBox &prev { m_items[it->second].box };
+
+                if (prev.x1 == box.x1 && prev.y1 == box.y1 && prev.x2 == box.x2 && prev.y2 == box.y2)
+                    return;
+
+                unlink(it->second);
+            }
+
+            m_items[it->second].box = box;
+            link(it->second);
+        }
+
+        // Adds the item with an empty box if missing
+        void setOrder(T data, UInt64 order) noexcept
+        {
+            const auto [it, inserted] { m_lookup.try_emplace(data, 0) };
+
+            if (inserted)
+                it->second = allocItem(data);
+
+            m_items[it->second].order = order;
+        }
+
+        void remove(T data) noexcept
+        {
+            const auto it { m_lookup.find(data) };
+
+            if (it == m_lookup.end())
+                return;
+
+            unlink(it->second);
+            m_items[it->second].data = T();
+            m_free.push_back(it->second);
+            m_lookup.erase(it);
+        }
+
+        bool contains(T data) const noexcept
+        {
+            return m_lookup.find(data) != m_lookup.end();
+        }
+
+        // Returns 0 if the item is not in the index
+        UInt64 order(T data) const noexcept
+        {
+            const auto it { m_lookup.find(data) };
+            return it == m_lookup.end() ? 0 : m_items[it->second].order;
+        }
+
+        /* Replaces the content of candidates with the items whose bounding box contains
+         * the point, ordered from top to bottom */
+        void query(const LPoint &point, std::vector<T> &candidates) const noexcept
+        {
+            candidates.clear();
+            m_query.clear();
+
+            const auto it { m_cells.find(cellKey(point.x() >> CellShift, point.y() >> CellShift)) };
+
+            if (it != m_cells.end())
+                for (UInt32 index : it->second)
+                    if (boxContains(m_items[index].box, point))
+                        m_query.push_back(index);
+
+            for (UInt32 index : m_large)
+                if (boxContains(m_items[index].box, point))
+                    m_query.push_back(index);
+
+            std::sort(m_query.begin(), m_query.end(), [this](UInt32 a, UInt32 b)
+            {
+                return m_items[a].order > m_items[b].order;
+            });
+
+            for (UInt32 index : m_query)
+                candidates.push_back(m_items[index].data);
+        }
+
+        size_t size() const noexcept
+        {
+            return m_lookup.size();
+        }
+
+    private:
+        struct Item
+        {
+            T data;
+            LBox box { 0, 0, 0, 0 };
+            UInt64 order { 0 };
+            bool large { false };
+        };
+
+        static UInt64 cellKey(Int32 cx, Int32 cy) noexcept
+        {
+            return (static_cast<UInt64>(static_cast<UInt32>(cx)) << 32) | static_cast<UInt32>(cy);
+        }
+
+        static bool boxContains(const LBox &box, const LPoint &point) noexcept
+        {
+            return point.x() >= box.x1 && point.x() < box.x2 && point.y() >= box.y1 && point.y() < box.y2;
+        }
+
+        static bool boxEmpty(const LBox &box) noexcept
+        {
+            return box.x1 >= box.x2 || box.y1 >= box.y2;
+        }
+
+        UInt32 allocItem(T data) noexcept
+        {
+            UInt32 index;
+
+            if (m_free.empty())
+            {
+                index = static_cast<UInt32>(m_items.size());
+                m_items.emplace_back();
+            }
+            else
+            {
+                index = m_free.back();
+                m_free.pop_back();
+                m_items[index] = Item();
+            }
+
+            m_items[index].data = data;
+            return index;
+        }
+
+        static void removeIndex(std::vector<UInt32> &list, UInt32 index) noexcept
+        {
+            const auto it { std::find(list.begin(), list.end(), index) };
+
+            if (it == list.end())
+                return;
+
+            *it = list.back();
+            list.pop_back();
+        }
+
+        template <class F>
+        static bool forEachCell(const LBox &box, F func) noexcept
+        {
+            const Int32 cx1 { box.x1 >> CellShift };
+            const Int32 cy1 { box.y1 >> CellShift };
+            const Int32 cx2 { (box.x2 - 1) >> CellShift };
+            const Int32 cy2 { (box.y2 - 1) >> CellShift };
+
+            if (static_cast<Int64>(cx2 - cx1 + 1) * static_cast<Int64>(cy2 - cy1 + 1) > MaxCellsPerItem)
+                return false;
+
+            for (Int32 cy = cy1; cy <= cy2; cy++)
+                for (Int32 cx = cx1; cx <= cx2; cx++)
+                    func(cellKey(cx, cy));
+
+            return true;
+        }
+
+        void link(UInt32 index) noexcept
+        {
+            Item &item { m_items[index] };
+
+            if (boxEmpty(item.box))
+                return;
+
+            item.large = !forEachCell(item.box, [this, index](UInt64 key)
+            {
+                m_cells[key].push_back(index);
+            });
+
+            if (item.large)
+                m_large.push_back(index);
+        }
+
+        void unlink(UInt32 index) noexcept
+        {
+            Item &item { m_items[index] };
+
+            if (boxEmpty(item.box))
+                return;
+
+            if (item.large)
+            {
+                removeIndex(m_large, index);
+                item.large = false;
+                return;
+            }
+
+            // Empty cells are released, so areas items moved away from don't keep memory
+            forEachCell(item.box, [this, index](UInt64 key)
+            {
+                const auto it { m_cells.find(key) };
+
+                if (it == m_cells.end())
+                    return;
+
+                removeIndex(it->second, index);
+
+                if (it->second.empty())
+                    m_cells.erase(it);
+            });
+        }
+
+        std::vector<Item> m_items;
+        std::vector<UInt32> m_free;
+        std::unordered_map<T, UInt32> m_lookup;
+        std::vector<UInt32> m_large;
+        std::unordered_map<UInt64, std::vector<UInt32>> m_cells;
+        mutable std::vector<UInt32> m_query;
+    };
+};
+
+#endif // LSPATIALINDEX_H
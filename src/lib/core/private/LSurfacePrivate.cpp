@@ -3,6 +3,7 @@
 #include <protocols/SinglePixelBuffer/LSinglePixelBuffer.h>
 #include <protocols/FractionalScale/RFractionalScale.h>
 #include <protocols/LinuxDMABuf/LDMABuffer.h>
+#include <protocols/LinuxDMABuf/RLinuxDMABufFeedback.h>
 #include <protocols/Wayland/RCallback.h>
 #include <protocols/Wayland/RSurface.h>
 #include <protocols/Wayland/GOutput.h>
@@ -12,6 +13,7 @@
 #include <private/LOutputPrivate.h>
 #include <private/LKeyboardPrivate.h>
 #include <LOutputMode.h>
+#include <LToplevelRole.h>
 #include <LClient.h>
 #include <LTime.h>
 #include <LLog.h>
@@ -75,6 +77,7 @@ void LSurface::LSurfacePrivate::setParent(LSurface *parent)
 
     parent->imp()->children.push_back(surface);
     surface->imp()->parentLink = std::prev(parent->imp()->children.end());
+    repaintViews(true);
     surface->parentChanged();
 
     if (surface->role())
@@ -88,9 +91,20 @@ void LSurface::LSurfacePrivate::removeChild(LSurface *child)
 
     children.erase(child->imp()->parentLink);
     child->imp()->parent = nullptr;
+    child->imp()->repaintViews(true);
     child->parentChanged();
 }
 
+void LSurface::LSurfacePrivate::repaintViews(bool includeChildren) noexcept
+{
+    for (LSurfaceView *view : views)
+        view->repaint();
+
+    if (includeChildren)
+        for (LSurface *child : children)
+            child->imp()->repaintViews(true);
+}
+
 void LSurface::LSurfacePrivate::setMapped(bool state)
 {
     if (stateFlags.check(Destroyed))
@@ -101,6 +115,8 @@ void LSurface::LSurfacePrivate::setMapped(bool state)
     if (stateFlags.check(Mapped) != state)
     {
         stateFlags.setFlag(Mapped, state);
+        compositor()->imp()->invalidateInputIndex();
+        repaintViews(false);
 
         if (!state)
         {
@@ -216,9 +232,47 @@ void LSurface::LSurfacePrivate::applyPendingChildren()
             child->imp()->pending.role->handleParentChange();
     }
 
-    compositor()->imp()->surfaceRaiseAllowedCounter++;
-    surface->orderChanged();
-    compositor()->imp()->surfaceRaiseAllowedCounter--;
+    compositor()->imp()->addPendingOrderChange(surface);
+}
+
+void LSurface::LSurfacePrivate::releaseShmBuffer() noexcept
+{
+    if (!stateFlags.check(BufferReleased))
+    {
+        wl_buffer_send_release(current.bufferRes);
+        stateFlags.add(BufferReleased);
+    }
+
+    wl_client_flush(wl_resource_get_client(current.bufferRes));
+}
+
+bool LSurface::LSurfacePrivate::updateTextureRegion(const LRegion &region, Int32 stride, UInt32 format, UChar8 *pixels) noexcept
+{
+    if (compositor()->imp()->textureUploader.upload(texture, current.bufferRes, region))
+    {
+        texture->m_serial++;
+        return true;
+    }
+
+    const UInt32 pixelSize { LTexture::formatBytesPerPixel(format) };
+    Int32 n;
+    const LBox *boxes { region.boxes(&n) };
+    LRect rect;
+
+    for (Int32 i = 0; i < n; i++)
+    {
+        rect.setX(boxes->x1);
+        rect.setY(boxes->y1);
+        rect.setW(boxes->x2 - boxes->x1);
+        rect.setH(boxes->y2 - boxes->y1);
+        texture->updateRect(rect,
+                            stride,
+                            &pixels[rect.x()*pixelSize + rect.y()*stride]);
+
+        boxes++;
+    }
+
+    return false;
 }
 
 bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
@@ -254,17 +308,14 @@ bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
         // SHM
         if (wl_shm_buffer_get(current.bufferRes))
         {
-            if (!stateFlags.check(BufferReleased))
-            {
-                wl_buffer_send_release(current.bufferRes);
-                stateFlags.add(BufferReleased);
-            }
-
             if (texture && texture != textureBackup && texture->m_pendingDelete)
                 delete texture;
 
             texture = textureBackup;
 
+            // If the upload is done asynchronously, the uploader releases the buffer once finished
+            bool asyncUpload { false };
+
             wl_shm_buffer *shm_buffer = wl_shm_buffer_get(current.bufferRes);
             wl_shm_buffer_begin_access(shm_buffer);
             UChar8 *pixels = (UChar8*)wl_shm_buffer_get_data(shm_buffer);
@@ -274,7 +325,11 @@ bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
             heightB = wl_shm_buffer_get_height(shm_buffer);
 
             if (!updateDimensions(widthB, heightB))
+            {
+                wl_shm_buffer_end_access(shm_buffer);
+                releaseShmBuffer();
                 return false;
+            }
 
             if (!texture->initialized() || changesToNotify.check(SizeChanged | SourceRectChanged | BufferSizeChanged | BufferTransformChanged | BufferScaleChanged))
             {
@@ -322,23 +377,7 @@ bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
 
                     onlyPending.transform(sizeB, current.transform);
 
-                    UInt32 pixelSize = LTexture::formatBytesPerPixel(format);
-
-                    Int32 n;
-                    const LBox *boxes = onlyPending.boxes(&n);
-                    LRect rect;
-                    for (Int32 i = 0; i < n; i++)
-                    {
-                        rect.setX(boxes->x1);
-                        rect.setY(boxes->y1);
-                        rect.setW(boxes->x2 - boxes->x1);
-                        rect.setH(boxes->y2 - boxes->y1);
-                        texture->updateRect(rect,
-                                            stride,
-                                            &pixels[rect.x()*pixelSize + rect.y()*stride]);
-
-                        boxes++;
-                    }
+                    asyncUpload = updateTextureRegion(onlyPending, stride, format, pixels);
 
                     onlyPending.transform(sizeB, Louvre::requiredTransform(current.transform, LTransform::Normal));
                     currentDamageB.addRegion(onlyPending);
@@ -373,23 +412,7 @@ bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
                     currentDamageB.addRegion(onlyPending);
                     onlyPending.transform(sizeB, current.transform);
 
-                    UInt32 pixelSize = LTexture::formatBytesPerPixel(format);
-
-                    Int32 n;
-                    const LBox *boxes = onlyPending.boxes(&n);
-                    LRect rect;
-                    for (Int32 i = 0; i < n; i++)
-                    {
-                        rect.setX(boxes->x1);
-                        rect.setY(boxes->y1);
-                        rect.setW(boxes->x2 - boxes->x1);
-                        rect.setH(boxes->y2 - boxes->y1);
-                        texture->updateRect(rect,
-                                            stride,
-                                            &pixels[rect.x()*pixelSize + rect.y()*stride]);
-
-                        boxes++;
-                    }
+                    asyncUpload = updateTextureRegion(onlyPending, stride, format, pixels);
 
                     LRegion::multiply(&currentDamage, &currentDamageB, 1.f/Float32(current.bufferScale));
                 }
@@ -397,12 +420,16 @@ bool LSurface::LSurfacePrivate::bufferToTexture() noexcept
             else
             {
                 wl_shm_buffer_end_access(shm_buffer);
-                wl_client_flush(wl_resource_get_client(current.bufferRes));
+                releaseShmBuffer();
                 return true;
             }
 
             wl_shm_buffer_end_access(shm_buffer);
-            wl_client_flush(wl_resource_get_client(current.bufferRes));
+
+            if (asyncUpload)
+                stateFlags.add(BufferReleased);
+            else
+                releaseShmBuffer();
         }
 
         // WL_DRM
@@ -599,6 +626,23 @@ void LSurface::LSurfacePrivate::sendPreferredScale() noexcept
         surfaceResource->fractionalScaleRes()->preferredScale(wlFracScale);
 }
 
+bool LSurface::LSurfacePrivate::prefersScanout() const noexcept
+{
+    const LToplevelRole *toplevel { surfaceResource->surface()->toplevel() };
+    return toplevel && toplevel->fullscreen() && !outputs.empty();
+}
+
+void LSurface::LSurfacePrivate::updateDMAFeedback() noexcept
+{
+    if (dmaFeedbackResources.empty())
+        return;
+
+    const bool scanout { prefersScanout() };
+
+    for (auto *feedback : dmaFeedbackResources)
+        feedback->setScanout(scanout);
+}
+
 void LSurface::LSurfacePrivate::setPendingParent(LSurface *pendParent) noexcept
 {
     if (pendingParent)
@@ -55,6 +55,7 @@ LPRIVATE_CLASS(LSurface)
         VSync                       = static_cast<UInt16>(1) << 10,
         ChildrenListChanged         = static_cast<UInt16>(1) << 11,
         ParentCommitNotified        = static_cast<UInt16>(1) << 12,
+        OrderChangePending          = static_cast<UInt16>(1) << 13,
     };
 
     LBitset<StateFlags> stateFlags
@@ -119,6 +120,7 @@ LPRIVATE_CLASS(LSurface)
     UInt32 damageId;
     UInt32 commitId { 0 };
     std::list<LSurface*>::iterator compositorLink;
+    UInt64 orderKey { 0 }; // See LCompositorPrivate::updateOrderKey()
     std::list<LSurface*>::iterator layerLink;
     LSurfaceLayer layer { LLayerMiddle };
     Int32 lastSentPreferredBufferScale      { -1 };
@@ -128,6 +130,11 @@ LPRIVATE_CLASS(LSurface)
     std::vector<PresentationTime::RPresentationFeedback*> presentationFeedbackResources;
     std::vector<Protocols::IdleInhibit::RIdleInhibitor*> idleInhibitorResources;
 
+    // Surface feedbacks, a scanout tranche is added while the surface is fullscreen on an output
+    std::vector<Protocols::LinuxDMABuf::RLinuxDMABufFeedback*> dmaFeedbackResources;
+    bool prefersScanout() const noexcept;
+    void updateDMAFeedback() noexcept;
+
     // Find the prev surface using layers (returns nullptr if no prev surface)
     LSurface *prevSurfaceInLayers() noexcept;
     void setLayer(LSurfaceLayer layer);
@@ -136,10 +143,16 @@ LPRIVATE_CLASS(LSurface)
     void setParent(LSurface *parent);
     void removeChild(LSurface *child);
     void setMapped(bool state);
+
+    /* Marks the views of the surface as changed, so scenes recalculate them in the next frame (see LView::repaint()).
+     * Children are included when the change can affect their role position */
+    void repaintViews(bool includeChildren) noexcept;
     void setPendingRole(LBaseSurfaceRole *role) noexcept;
     void applyPendingRole();
     void applyPendingChildren();
     bool bufferToTexture() noexcept;
+    bool updateTextureRegion(const LRegion &region, Int32 stride, UInt32 format, UChar8 *pixels) noexcept;
+    void releaseShmBuffer() noexcept;
     void sendPreferredScale() noexcept;
     bool isInChildrenOrPendingChildren(LSurface *child) noexcept;
     bool hasRoleOrPendingRole() noexcept;
@@ -0,0 +1,250 @@
+#include <private/LTextureUploader.h>
+#include <private/LCompositorPrivate.h>
+#include <LTexture.h>
+#include <LUtils.h>
+#include <LLog.h>
+#include <GLES2/gl2.h>
+#include <EGL/eglext.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace Louvre;
+
+bool LTextureUploader::init() noexcept
+{
+    unit();
+
+    const char *env { getenv("LOUVRE_ASYNC_SHM_UPLOADS") };
+
+    if (env && atoi(env) == 0)
+        return false;
+
+    const EGLDisplay display { compositor()->eglDisplay() };
+    const EGLContext mainContext { compositor()->eglContext() };
+
+    if (display == EGL_NO_DISPLAY || mainContext == EGL_NO_CONTEXT)
+        return false;
+
+    // Use the same config of the main context so that they can share textures
+    EGLint configId { 0 }, n { 0 };
+    EGLConfig config { EGL_NO_CONFIG_KHR };
+    eglQueryContext(display, mainContext, EGL_CONFIG_ID, &configId);
+
+    if (configId != 0)
+    {
+        const EGLint configAttribs[] { EGL_CONFIG_ID, configId, EGL_NONE };
+
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &n) || n != 1)
+            config = EGL_NO_CONFIG_KHR;
+    }
+
+    const EGLint contextAttribs[] { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    m_context = eglCreateContext(display, config, mainContext, contextAttribs);
+
+    if (m_context == EGL_NO_CONTEXT)
+    {
+        LLog::error("[LTextureUploader::init] Failed to create shared EGL context. SHM buffers will be uploaded synchronously.");
+        return false;
+    }
+
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_eventFd < 0)
+    {
+        LLog::error("[LTextureUploader::init] Failed to create eventfd. SHM buffers will be uploaded synchronously.");
+        eglDestroyContext(display, m_context);
+        m_context = EGL_NO_CONTEXT;
+        return false;
+    }
+
+    m_eventSource = LCompositor::addFdListener(m_eventFd, this, &LTextureUploader::onJobsFinished);
+    m_exit = false;
+    m_running = true;
+    m_thread = std::thread(&LTextureUploader::workerLoop, this);
+    return true;
+}
+
+void LTextureUploader::unit() noexcept
+{
+    if (!m_running)
+        return;
+
+    m_mutex.lock();
+    m_exit = true;
+    m_mutex.unlock();
+    m_cond.notify_all();
+    m_thread.join();
+    m_running = false;
+
+    // The thread processes all queued jobs before exiting
+    releaseFinishedJobs();
+
+    LCompositor::removeFdListener(m_eventSource);
+    m_eventSource = nullptr;
+    close(m_eventFd);
+    m_eventFd = -1;
+    eglDestroyContext(compositor()->eglDisplay(), m_context);
+    m_context = EGL_NO_CONTEXT;
+}
+
+bool LTextureUploader::upload(LTexture *texture, wl_resource *buffer, const LRegion &region) noexcept
+{
+    if (!m_running)
+        return false;
+
+    Int32 n;
+    Int32 area { 0 };
+    const LBox *boxes { region.boxes(&n) };
+
+    for (Int32 i = 0; i < n; i++)
+        area += (boxes[i].x2 - boxes[i].x1) * (boxes[i].y2 - boxes[i].y1);
+
+    if (area < MinAsyncArea)
+    {
+        // Keep the order of previously queued uploads
+        wait(texture);
+        return false;
+    }
+
+    Job *job { new Job() };
+    job->texture = texture;
+    job->buffer = buffer;
+    job->shmBuffer = wl_shm_buffer_get(buffer);
+
+    /* While referenced, pool resizes requested by the client are deferred until the last
+     * reference is dropped, so the mapping read by the worker thread stays valid */
+    job->pool = wl_shm_buffer_ref_pool(job->shmBuffer);
+    job->region = region;
+    job->destroyListener.notify = &LTextureUploader::onBufferDestroy;
+    wl_resource_add_destroy_listener(buffer, &job->destroyListener);
+
+    m_mutex.lock();
+    m_pendingTextures[texture]++;
+    m_pendingCount++;
+    m_queue.push_back(job);
+    m_mutex.unlock();
+    m_cond.notify_all();
+    return true;
+}
+
+void LTextureUploader::wait(const LTexture *texture) noexcept
+{
+    if (m_pendingCount == 0)
+        return;
+
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_cond.wait(lock, [this, texture]{ return m_pendingTextures.find(texture) == m_pendingTextures.end(); });
+}
+
+void LTextureUploader::waitJob(Job *job) noexcept
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_cond.wait(lock, [job]{ return job->done; });
+}
+
+void LTextureUploader::workerLoop() noexcept
+{
+    eglMakeCurrent(compositor()->eglDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE, m_context);
+
+    std::unique_lock<std::mutex> lock { m_mutex };
+
+    while (true)
+    {
+        m_cond.wait(lock, [this]{ return m_exit || !m_queue.empty(); });
+
+        if (m_queue.empty())
+            break;
+
+        Job *job { m_queue.front() };
+        lock.unlock();
+        process(*job);
+        lock.lock();
+
+        m_queue.pop_front();
+        m_finished.push_back(job);
+        job->done = true;
+        m_pendingCount--;
+
+        auto it { m_pendingTextures.find(job->texture) };
+
+        if (--it->second == 0)
+            m_pendingTextures.erase(it);
+
+        m_cond.notify_all();
+
+        const UInt64 one { 1 };
+        const ssize_t n { write(m_eventFd, &one, sizeof(one)) };
+        L_UNUSED(n);
+    }
+
+    lock.unlock();
+    eglMakeCurrent(compositor()->eglDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+void LTextureUploader::process(Job &job) noexcept
+{
+    wl_shm_buffer_begin_access(job.shmBuffer);
+    const UInt8 *pixels { static_cast<const UInt8*>(wl_shm_buffer_get_data(job.shmBuffer)) };
+    const Int32 stride { wl_shm_buffer_get_stride(job.shmBuffer) };
+    const UInt32 pixelSize { LTexture::formatBytesPerPixel(LTexture::waylandFormatToDRM(wl_shm_buffer_get_format(job.shmBuffer))) };
+
+    Int32 n;
+    const LBox *boxes { job.region.boxes(&n) };
+    LRect rect;
+
+    for (Int32 i = 0; i < n; i++)
+    {
+        rect.setX(boxes->x1);
+        rect.setY(boxes->y1);
+        rect.setW(boxes->x2 - boxes->x1);
+        rect.setH(boxes->y2 - boxes->y1);
+        compositor()->imp()->graphicBackend->textureUpdateRect(job.texture, stride, rect, &pixels[rect.x()*pixelSize + rect.y()*stride]);
+        boxes++;
+    }
+
+    // The client may reuse the buffer after release, so the copy must actually be finished
+    glFinish();
+    wl_shm_buffer_end_access(job.shmBuffer);
+}
+
+void LTextureUploader::releaseFinishedJobs() noexcept
+{
+    std::list<Job*> finished;
+    m_mutex.lock();
+    finished.swap(m_finished);
+    m_mutex.unlock();
+
+    for (Job *job : finished)
+    {
+        // Applies deferred resizes, so it must be called from the main thread
+        wl_shm_pool_unref(job->pool);
+
+        if (job->buffer)
+        {
+            wl_list_remove(&job->destroyListener.link);
+            wl_buffer_send_release(job->buffer);
+            wl_client_flush(wl_resource_get_client(job->buffer));
+        }
+
+        delete job;
+    }
+}
+
+void LTextureUploader::onBufferDestroy(wl_listener *listener, void */*data*/) noexcept
+{
+    Job *job;
+    job = wl_container_of(listener, job, destroyListener);
+
+    // The pixels are being read from the buffer, it can't be destroyed until the upload finishes
+    compositor()->imp()->textureUploader.waitJob(job);
+    job->buffer = nullptr;
+}
+
+int LTextureUploader::onJobsFinished(int fd, unsigned int /*mask*/, void *data) noexcept
+{
+    UInt64 count;
+    const ssize_t n { read(fd, &count, sizeof(count)) };
+    L_UNUSED(n);
+    static_cast<LTextureUploader*>(data)->releaseFinishedJobs();
+    return 0;
+}
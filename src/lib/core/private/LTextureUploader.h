@@ -0,0 +1,75 @@
+#ifndef LTEXTUREUPLOADER_H
+#define LTEXTUREUPLOADER_H
+
+#include <LNamespaces.h>
+#include <LRegion.h>
+#include <condition_variable>
+#include <unordered_map>
+#include <wayland-server.h>
+#include <EGL/egl.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <list>
+
+namespace Louvre
+{
+    /* Uploads damaged regions of SHM buffers from a dedicated thread with its own shared EGL context.
+     * The wl_buffer.release event is sent once the upload finishes, so the main thread never waits
+     * for the copy, unless the texture or buffer is accessed/destroyed before it completes. */
+    class LTextureUploader
+    {
+    public:
+        // Damage smaller than this (in buffer pixels) is uploaded synchronously
+        static constexpr Int32 MinAsyncArea { 256 * 256 };
+
+        bool init() noexcept;
+        void unit() noexcept;
+
+        bool enabled() const noexcept
+        {
+            return m_running;
+        }
+
+        /* Queues the region (in buffer coords) for upload, returns false if it should be uploaded
+         * synchronously instead. Must be called from the main thread. */
+        bool upload(LTexture *texture, wl_resource *buffer, const LRegion &region) noexcept;
+
+        // Blocks until all queued uploads of the texture finish, can be called from any thread
+        void wait(const LTexture *texture) noexcept;
+
+    private:
+        struct Job
+        {
+            LTexture *texture;
+            wl_resource *buffer;
+            wl_shm_buffer *shmBuffer;
+            wl_shm_pool *pool; // Referenced so the client can't resize (remap) it during the copy
+            wl_listener destroyListener;
+            LRegion region;
+            bool done { false };
+        };
+
+        void workerLoop() noexcept;
+        void process(Job &job) noexcept;
+        void waitJob(Job *job) noexcept;
+        void releaseFinishedJobs() noexcept;
+        static void onBufferDestroy(wl_listener *listener, void *data) noexcept;
+        static int onJobsFinished(int fd, unsigned int mask, void *data) noexcept;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::list<Job*> m_queue;
+        std::list<Job*> m_finished;
+        std::unordered_map<const LTexture*, UInt32> m_pendingTextures;
+        std::atomic<UInt32> m_pendingCount { 0 };
+        EGLContext m_context { EGL_NO_CONTEXT };
+        wl_event_source *m_eventSource { nullptr };
+        Int32 m_eventFd { -1 };
+        bool m_running { false };
+        bool m_exit { false };
+    };
+};
+
+#endif // LTEXTUREUPLOADER_H
@@ -22,6 +22,9 @@ LLayerRole::LLayerRole(const void *params) noexcept :
 
     m_exclusiveZone.setOnRectChangeCallback([this](auto)
     {
+        // The role position depends on the zone rect
+        surface()->imp()->repaintViews(true);
+
         if (surface()->mapped() && surface()->hasBuffer())
             configureRequest();
     });
@@ -63,6 +66,7 @@ void LLayerRole::setExclusiveOutput(LOutput *output) noexcept
         surface()->sendOutputEnterEvent(output);
 
     m_exclusiveZone.setOutput(output);
+    surface()->imp()->repaintViews(true);
     updateMappingState();
 }
 
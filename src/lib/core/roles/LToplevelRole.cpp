@@ -53,6 +53,18 @@ RXdgSurface *LToplevelRole::xdgSurfaceResource() const
     return xdgToplevelResource()->xdgSurfaceRes();
 }
 
+void LToplevelRole::setExtraGeometry(const LMargins &margins) noexcept
+{
+    if (m_extraGeometry.left == margins.left && m_extraGeometry.top == margins.top &&
+        m_extraGeometry.right == margins.right && m_extraGeometry.bottom == margins.bottom)
+        return;
+
+    m_extraGeometry = margins;
+
+    // The role position depends on it
+    surface()->repaintOutputs();
+}
+
 void LToplevelRole::setExclusiveOutput(LOutput *output) noexcept
 {
     m_exclusiveOutput.reset(output);
@@ -248,6 +260,9 @@ void LToplevelRole::fullAtomsUpdate()
         }
     }
 
+    if (stateChanges.check(Fullscreen))
+        surface()->imp()->updateDMAFeedback();
+
     if (changesToNotify.check(MaxSizeChanged))
         pendingAtoms().maxSize = currentAtoms().maxSize;
     if (changesToNotify.check(MinSizeChanged))
@@ -555,10 +555,7 @@ public:
      *
      * @param margins Left, top, right, bottom margins.
      */
-    void setExtraGeometry(const LMargins &margins) noexcept
-    {
-        m_extraGeometry = margins;
-    }
+    void setExtraGeometry(const LMargins &margins) noexcept;
 
     /**
      * @brief Extra geometry margins.
@@ -41,7 +41,7 @@ public:
         m_nativePos.setX(x);
         m_nativePos.setY(y);
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -79,7 +79,7 @@ public:
         m_nativeSize.setW(width);
         m_nativeSize.setH(height);
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -99,6 +99,8 @@ public:
         }
         else
             m_inputRegion.reset();
+
+        invalidateInputIndex();
     }
 
     virtual bool nativeMapped() const noexcept override;
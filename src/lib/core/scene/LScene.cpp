@@ -1,5 +1,7 @@
 #include <LSessionLockManager.h>
 #include <private/LScenePrivate.h>
+#include <private/LCompositorPrivate.h>
+#include <private/LOutputPrivate.h>
 #include <private/LSurfacePrivate.h>
 #include <LSceneTouchPoint.h>
 #include <LToplevelMoveSession.h>
@@ -17,17 +19,47 @@
 #include <LTouch.h>
 #include <LTouchPoint.h>
 #include <LUtils.h>
+#include <LLog.h>
 #include <unistd.h>
 
 using LVS = LView::LViewState;
 using LSS = LScene::LScenePrivate::State;
 
+static const char *scanoutResultString(LScene::ScanoutResult result) noexcept
+{
+    switch (result)
+    {
+    case LScene::ScanoutDisabled:           return "Disabled";
+    case LScene::ScanoutAccepted:           return "Accepted";
+    case LScene::ScanoutNoCandidate:        return "NoCandidate";
+    case LScene::ScanoutNotSurface:         return "NotSurface";
+    case LScene::ScanoutGeometry:           return "Geometry";
+    case LScene::ScanoutEffects:            return "Effects";
+    case LScene::ScanoutTranslucent:        return "Translucent";
+    case LScene::ScanoutTransform:          return "Transform";
+    case LScene::ScanoutBufferType:         return "BufferType";
+    case LScene::ScanoutFormat:             return "Format";
+    case LScene::ScanoutCursor:             return "Cursor";
+    case LScene::ScanoutScreenshot:         return "Screenshot";
+    case LScene::ScanoutBackendRejected:    return "BackendRejected";
+    }
+
+    return "Unknown";
+}
+
 LScene::LScene() : LPRIVATE_INIT_UNIQUE(LScene)
 {
     imp()->view.setPos(0);
     LView *baseView = &imp()->view;
     baseView->m_scene = this;
     baseView->m_state.add(LVS::IsScene);
+    baseView->invalidateInputIndex();
+
+    const char *env { getenv("LOUVRE_PARALLEL_RENDERING") };
+    imp()->state.setFlag(LSS::ParallelRendering, env && atoi(env) == 1);
+
+    env = getenv("LOUVRE_AUTO_SCANOUT");
+    imp()->state.setFlag(LSS::AutoScanout, env && atoi(env) == 1);
 }
 
 LScene::~LScene() { notifyDestruction(); }
@@ -42,6 +74,34 @@ bool LScene::autoRepaintEnabled() const noexcept
     return imp()->state.check(LSS::AutoRepaint);
 }
 
+void LScene::enableParallelRendering(bool enabled) noexcept
+{
+    imp()->state.setFlag(LSS::ParallelRendering, enabled);
+}
+
+bool LScene::parallelRenderingEnabled() const noexcept
+{
+    return imp()->state.check(LSS::ParallelRendering);
+}
+
+void LScene::enableAutoScanout(bool enabled) noexcept
+{
+    imp()->state.setFlag(LSS::AutoScanout, enabled);
+}
+
+bool LScene::autoScanoutEnabled() const noexcept
+{
+    return imp()->state.check(LSS::AutoScanout);
+}
+
+LScene::ScanoutResult LScene::autoScanoutResult(LOutput *output) const noexcept
+{
+    if (!output)
+        return ScanoutDisabled;
+
+    return static_cast<ScanoutResult>(imp()->view.m_sceneThreadsData[output->imp()->threadSlot].scanoutResult);
+}
+
 const std::vector<LView *> &LScene::pointerFocus() const
 {
     return imp()->pointerFocus;
@@ -80,10 +140,66 @@ void LScene::handlePaintGL(LOutput *output)
     if (!output)
         return;
 
+    LOutputFrameStats *stats { output->imp()->frameStatsEnabled ? &output->imp()->currentFrameStats : nullptr };
+    UInt64 time { stats ? LOutput::LOutputPrivate::frameStatsTime() : 0 };
+
     imp()->mutex.lock();
+
+    if (stats)
+    {
+        const UInt64 now { LOutput::LOutputPrivate::frameStatsTime() };
+        stats->renderLockWait += now - time;
+        time = now;
+    }
+
     imp()->view.m_fb = output->framebuffer();
-    imp()->view.render();
-    imp()->mutex.unlock();
+    LSceneView::ThreadData *ctd { imp()->view.prepareRender(nullptr) };
+
+    if (!ctd)
+    {
+        imp()->mutex.unlock();
+        return;
+    }
+
+    if (stats)
+    {
+        const UInt64 now { LOutput::LOutputPrivate::frameStatsTime() };
+        stats->damageCalc += now - time;
+        time = now;
+    }
+
+    const ScanoutResult scanoutResult { autoScanoutEnabled() ? imp()->tryAutoScanout(output, *ctd) : ScanoutDisabled };
+
+    if (scanoutResult != ctd->scanoutResult)
+    {
+        LLog::debug("[LScene::handlePaintGL] Output %s automatic scanout result changed to %s.", output->name(), scanoutResultString(scanoutResult));
+        ctd->scanoutResult = scanoutResult;
+    }
+
+    // The scene damage is not lost, the next composited frame is fully repainted (see LOutput::needsFullRepaint())
+    if (scanoutResult == ScanoutAccepted)
+    {
+        imp()->mutex.unlock();
+        return;
+    }
+
+    /* Once damage is calculated, drawing only reads the thread data,
+     * so other outputs can take the lock in the meantime */
+    if (parallelRenderingEnabled() && !ctd->hasNestedScenes && output->imp()->stateFlags.check(LOutput::LOutputPrivate::HoldsRenderLock))
+    {
+        imp()->mutex.unlock();
+        compositor()->imp()->beginParallelDraw();
+        imp()->view.drawRender(*ctd);
+        compositor()->imp()->endParallelDraw();
+    }
+    else
+    {
+        imp()->view.drawRender(*ctd);
+        imp()->mutex.unlock();
+    }
+
+    if (stats)
+        stats->draw += LOutput::LOutputPrivate::frameStatsTime() - time;
 }
 
 void LScene::handleMoveGL(LOutput *output)
@@ -114,9 +230,7 @@ void LScene::handleUninitializeGL(LOutput *output)
         return;
 
     imp()->mutex.lock();
-    auto it { imp()->view.m_sceneThreadsMap.find(output->threadId()) };
-    if (it != imp()->view.m_sceneThreadsMap.end())
-        imp()->view.m_sceneThreadsMap.erase(it);
+    imp()->view.m_sceneThreadsData.reset(output->imp()->threadSlot);
     imp()->mutex.unlock();
 }
 
@@ -199,8 +313,13 @@ void LScene::handlePointerMoveEvent(const LPointerMoveEvent &event, LBitset<Even
 
     imp()->state.remove(LSS::ChildrenListChanged | LSS::PointerIsBlocked);
     imp()->state.add(LSS::HandlingPointerMoveEvent);
-    LView::removeFlagWithChildren(mainView(), LVS::PointerMoveDone);
-    imp()->handlePointerMove(mainView());
+
+    for (LView *view : imp()->pointerMoveDone)
+        view->m_state.remove(LVS::PointerMoveDone);
+
+    imp()->pointerMoveDone.clear();
+    imp()->updatePointerCandidates();
+    imp()->handlePointerMove();
     imp()->state.remove(LSS::HandlingPointerMoveEvent);
 
     if (!(options & WaylandEvents))
@@ -1399,5 +1518,9 @@ LSceneView *LScene::mainView() const
 
 LView *LScene::viewAt(const LPoint &pos, LView::Type type, LBitset<InputFilter> filter)
 {
-    return imp()->viewAt(mainView(), pos, type, filter);
+    // Without filters views are matched regardless of their input region, so the index can't be used
+    if (filter == FilterDisabled)
+        return imp()->viewAt(mainView(), pos, type, filter);
+
+    return imp()->viewAtIndexed(pos, type, filter);
 }
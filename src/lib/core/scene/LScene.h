@@ -152,6 +152,85 @@ public:
      */
     bool autoRepaintEnabled() const noexcept;
 
+    /**
+     * @brief Enables or disables parallel rendering of outputs.
+     *
+     * By default, output threads render the scene one at a time while holding the compositor lock.\n
+     * When enabled, handlePaintGL() releases the lock once damage has been calculated, allowing other
+     * outputs to render simultaneously, and reacquires it before returning, once no other output is drawing.
+     *
+     * During that time, the main thread is blocked and other output threads can only modify
+     * the compositor state before their own handlePaintGL() call. Therefore, when enabled:
+     *
+     * - Code executed within LOutput::paintGL() before handlePaintGL() must not modify views or surfaces.
+     * - Custom LView::paintEvent() implementations must only draw, using the view state captured in LView::PaintEventParams.
+     *   Accessors such as LView::pos() or LView::size() must not be called, since other outputs may be calculating the same view.
+     *
+     * Outputs displaying nested LSceneViews are always rendered while holding the lock, since their
+     * render buffers are shared between outputs.
+     *
+     * Disabled by default unless the **LOUVRE_PARALLEL_RENDERING** environment variable is set to 1.
+     */
+    void enableParallelRendering(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if parallel rendering is enabled.
+     *
+     * @see enableParallelRendering()
+     */
+    bool parallelRenderingEnabled() const noexcept;
+
+    /**
+     * @brief Result of the automatic direct scanout policy for an output frame.
+     *
+     * @see enableAutoScanout()
+     */
+    enum ScanoutResult : UInt8
+    {
+        ScanoutDisabled,        ///< Automatic scanout is disabled.
+        ScanoutAccepted,        ///< The surface buffer was scanned out, composition was skipped.
+        ScanoutNoCandidate,     ///< Zero or more than one view is visible on the output.
+        ScanoutNotSurface,      ///< The visible view is not an LSurfaceView or its surface has no texture.
+        ScanoutGeometry,        ///< The view doesn't exactly cover the output or the surface buffer is cropped.
+        ScanoutEffects,         ///< The view has opacity, scaling or a color factor applied.
+        ScanoutTranslucent,     ///< Part of the view visible on the output is translucent.
+        ScanoutTransform,       ///< The surface buffer transform differs from the output transform.
+        ScanoutBufferType,      ///< The surface buffer is not a DMA or wl_drm buffer.
+        ScanoutFormat,          ///< The buffer format is not supported by the output primary plane.
+        ScanoutCursor,          ///< The cursor is visible on the output and is not composited in hardware.
+        ScanoutScreenshot,      ///< There are pending screenshot requests for the output.
+        ScanoutBackendRejected  ///< The graphic backend refused the buffer, see LOutput::setCustomScanoutBuffer().
+    };
+
+    /**
+     * @brief Enables or disables automatic direct scanout.
+     *
+     * When enabled, handlePaintGL() checks after calculating the damage whether a single opaque LSurfaceView exactly covers the output,
+     * without opacity, scaling, color factor or transform mismatches, and whose buffer can be displayed directly by the output primary plane.\n
+     * If that's the case, the buffer is set with LOutput::setCustomScanoutBuffer() and composition is skipped, saving GPU work and reducing latency.
+     * Otherwise the scene is composited as usual. The reason a frame was or wasn't scanned out can be retrieved with autoScanoutResult().
+     *
+     * @warning Nothing drawn after handlePaintGL() is displayed while a buffer is scanned out. If you draw additional content in LOutput::paintGL(),
+     *          use LOutput::setCustomScanoutBuffer() directly instead.
+     *
+     * Disabled by default unless the **LOUVRE_AUTO_SCANOUT** environment variable is set to 1.
+     */
+    void enableAutoScanout(bool enabled) noexcept;
+
+    /**
+     * @brief Checks if automatic direct scanout is enabled.
+     *
+     * @see enableAutoScanout()
+     */
+    bool autoScanoutEnabled() const noexcept;
+
+    /**
+     * @brief Result of the automatic direct scanout policy during the last handlePaintGL() call for the given output.
+     *
+     * @see enableAutoScanout()
+     */
+    ScanoutResult autoScanoutResult(LOutput *output) const noexcept;
+
     /**
      * @brief Vector of views with pointer focus.
      *
@@ -397,6 +476,10 @@ public:
      *
      * This method returns the first LView whose input region intersects the given position.
      *
+     * When a filter is specified, only views whose bounds contain the position are tested, using an index
+     * that is rebuilt after views call LView::repaint() or are reparented. Custom views whose position, size
+     * or input region change must therefore call LView::repaint(), as the built-in views already do.
+     *
      * @param pos The position to query.
      * @param type The type of view to search for. Passing LView::Type::Undefined disables the type filter.
      * @param filter Additional flags for searching only views with pointer, keyboard and/or touch events enabled.
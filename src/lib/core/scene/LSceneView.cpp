@@ -1,5 +1,8 @@
 #include <private/LCompositorPrivate.h>
 #include <private/LPainterPrivate.h>
+#include <private/LOutputPrivate.h>
+#include <LSolidColorView.h>
+#include <LTextureView.h>
 #include <LSurfaceView.h>
 #include <LSceneView.h>
 #include <LScene.h>
@@ -25,13 +28,14 @@ void LSceneView::damageAll(LOutput *output) noexcept
     if (!output)
         return;
 
-    ThreadData &td { m_sceneThreadsMap[output->threadId()] };
+    ThreadData &td { m_sceneThreadsData[output->imp()->threadSlot] };
 
     if (isLScene())
         td.manuallyAddedDamage.addRect(output->rect());
     else
     {
         td.manuallyAddedDamage.addRect(LRect(pos(), size()));
+        markChanged();
 
         if (scene() && scene()->autoRepaintEnabled())
             output->repaint();
@@ -43,35 +47,52 @@ void LSceneView::addDamage(LOutput *output, const LRegion &damage) noexcept
     if (!output)
         return;
 
-    ThreadData &td { m_sceneThreadsMap[output->threadId()] };
+    ThreadData &td { m_sceneThreadsData[output->imp()->threadSlot] };
 
     if (td.o)
         td.manuallyAddedDamage.addRegion(damage);
 
-    if (!isLScene() && scene() && scene()->autoRepaintEnabled())
+    if (isLScene())
+        return;
+
+    markChanged();
+
+    if (scene() && scene()->autoRepaintEnabled())
         output->repaint();
 }
 
 void LSceneView::render(const LRegion *exclude) noexcept
 {
-    LPainter *painter { compositor()->imp()->threadsMap[std::this_thread::get_id()].painter };
+    ThreadData *ctd { prepareRender(exclude) };
 
-    if (!painter)
-        return;
+    if (ctd)
+        drawRender(*ctd);
+}
 
-    LFramebuffer *prevFb { painter->boundFramebuffer() };
-    painter->bindFramebuffer(m_fb);
+LSceneView::ThreadData *LSceneView::prepareRender(const LRegion *exclude) noexcept
+{
+    LPainter *painter { LCompositor::LCompositorPrivate::threadPainter };
 
-    if (!isLScene())
-        static_cast<LRenderBuffer*>(m_fb)->setPos(pos());
+    if (!painter)
+        return nullptr;
 
-    m_currentThreadData.reset(&m_sceneThreadsMap[std::this_thread::get_id()]);
+    m_currentThreadData.reset(&m_sceneThreadsData[LCompositor::LCompositorPrivate::threadSlot]);
 
     if (!m_currentThreadData)
-        return;
+        return nullptr;
 
     auto &ctd { *m_currentThreadData };
 
+    ctd.prevFb = painter->boundFramebuffer();
+    ctd.fb = m_fb;
+    std::swap(ctd.renderList, ctd.prevRenderList);
+    ctd.renderList.clear();
+    ctd.hasNestedScenes = false;
+    ctd.clearColor = m_clearColor;
+
+    if (!isLScene())
+        static_cast<LRenderBuffer*>(m_fb)->setPos(pos());
+
     // If painter was not cached
     if (!ctd.p)
     {
@@ -95,6 +116,12 @@ void LSceneView::render(const LRegion *exclude) noexcept
     // If extra opaque
     if (exclude)
     {
+        if (!pixman_region32_equal(&ctd.prevExternalExclude.m_region, &exclude->m_region))
+        {
+            addBox(ctd.opaqueChanges, ctd.prevExternalExclude.extents());
+            addBox(ctd.opaqueChanges, exclude->extents());
+        }
+
         ctd.prevExternalExclude.subtractRegion(*exclude);
         ctd.newDamage.addRegion(ctd.prevExternalExclude);
         ctd.prevExternalExclude = *exclude;
@@ -104,15 +131,26 @@ void LSceneView::render(const LRegion *exclude) noexcept
     {
         if (!ctd.prevExternalExclude.empty())
         {
+            addBox(ctd.opaqueChanges, ctd.prevExternalExclude.extents());
             ctd.newDamage.addRegion(ctd.prevExternalExclude);
             ctd.prevExternalExclude.clear();
         }
     }
 
+    updateOutputsLayout(ctd);
+
+    if (ctd.outputsLayoutChanged || ctd.calcSerial < compositor()->imp()->viewsStructureSerial)
+        ctd.forceCalc = true;
+
+    ctd.calcSerial = compositor()->imp()->viewsChangeSerial;
+
     for (std::list<LView*>::const_reverse_iterator it = children().crbegin(); it != children().crend(); it++)
-        calcNewDamage(*it);
+        calcNewDamage(*it, ctd.forceCalc);
 
-    // Save new damage for next frame and add old damage to current damage
+    ctd.forceCalc = false;
+
+    /* Save new damage for next frame and add old damage to current damage.
+     * Render buffers have a single retained buffer, so their damage is only what changed since the last render */
     if (m_fb->buffersCount() > 1)
     {
         // Sum damage generated in other frames into this region
@@ -131,32 +169,41 @@ void LSceneView::render(const LRegion *exclude) noexcept
         ctd.prevDamageList.push_back(front);
     }
 
-    glDisable(GL_BLEND);
+    return &ctd;
+}
 
-    for (std::list<LView*>::const_reverse_iterator it = children().crbegin(); it != children().crend(); it++)
-        drawOpaqueDamage(*it);
+void LSceneView::drawRender(ThreadData &ctd) noexcept
+{
+    // Nothing changed inside the nested scene, its framebuffer content is reused as-is
+    if (!isLScene() && ctd.newDamage.empty())
+    {
+        ctd.opaqueSum.clip(ctd.fb->rect());
+        ctd.translucentSum = ctd.opaqueSum;
+        ctd.translucentSum.inverse(ctd.fb->rect());
+        ctd.fb->setFramebufferDamage(&ctd.newDamage);
+        return;
+    }
 
-    drawBackground(!isLScene() && m_clearColor.a >= 1.f);
+    ctd.p->bindFramebuffer(ctd.fb);
 
+    glDisable(GL_BLEND);
+    drawOpaqueDamage(ctd);
+    drawBackground(ctd, !isLScene() && ctd.clearColor.a >= 1.f);
     glEnable(GL_BLEND);
-
-    for (std::list<LView*>::const_iterator it = children().cbegin(); it != children().cend(); it++)
-        drawTranslucentDamage(*it);
+    drawTranslucentDamage(ctd);
 
     if (!isLScene())
     {
-        ctd.opaqueSum.clip(m_fb->rect());
+        ctd.opaqueSum.clip(ctd.fb->rect());
         ctd.translucentSum = ctd.opaqueSum;
-        ctd.translucentSum.inverse(m_fb->rect());
-        auto &rb = *static_cast<LRenderBuffer*>(m_fb);
+        ctd.translucentSum.inverse(ctd.fb->rect());
+        auto &rb = *static_cast<LRenderBuffer*>(ctd.fb);
         rb.setFence();
     }
-    else
-    {
-        m_fb->setFramebufferDamage(&ctd.newDamage);
-    }
 
-    painter->bindFramebuffer(prevFb);
+    ctd.fb->setFramebufferDamage(&ctd.newDamage);
+
+    ctd.p->bindFramebuffer(ctd.prevFb);
 }
 
 bool LSceneView::nativeMapped() const noexcept
@@ -231,70 +278,185 @@ const LRegion *LSceneView::inputRegion() const noexcept
 
 void LSceneView::paintEvent(const PaintEventParams &params) noexcept
 {
-    params.painter->bindTextureMode({
-        .texture = m_fb->texture(m_fb->currentBufferIndex()),
-        .pos = pos(),
-        .srcRect = LRectF(LPointF(), m_fb->sizeB()) / bufferScale(),
-        .dstSize = size(),
-        .srcTransform = m_fb->transform(),
-        .srcScale = bufferScale(),
-    });
+    if (!params.textureParams.texture)
+        return;
+
+    params.painter->bindTextureMode(params.textureParams);
 
     params.painter->enableCustomTextureColor(false);
     params.painter->drawRegion(*params.region);
 }
 
-void LSceneView::calcNewDamage(LView *view) noexcept
+void LSceneView::calcNewDamage(LView *view, bool force) noexcept
+{
+    auto &ctd { *m_currentThreadData };
+    LView::ViewThreadData &voD { view->m_threadsData[LCompositor::LCompositorPrivate::threadSlot] };
+
+    /* Views may compute their geometry from external state (e.g. a nativePos() override following a toplevel)
+     * without calling repaint(), and children with ParentOffset, ParentClipping, etc depend on it */
+    const bool geometryChanged { voD.cache.rect.pos() != view->pos() ||
+                                 voD.cache.rect.size() != view->size() ||
+                                 voD.calcMapped != view->mapped() };
+
+    /* Nothing changed within the subtree since the last pass and no opaque region above it changed,
+     * so it adds no damage and its opaque regions and render list entries are the same */
+    if (!force && !geometryChanged && view->m_subtreeChangeSerial <= voD.calcSerial && !intersectsRegion(voD.subtreeBox, ctd.opaqueChanges))
+    {
+        const UInt32 renderListBegin { static_cast<UInt32>(ctd.renderList.size()) };
+        ctd.renderList.insert(ctd.renderList.end(),
+                              ctd.prevRenderList.begin() + voD.renderListBegin,
+                              ctd.prevRenderList.begin() + voD.renderListBegin + voD.renderListCount);
+        voD.renderListBegin = renderListBegin;
+        ctd.opaqueSum.addRegion(subtreeOpaque(view, voD));
+        ctd.hasNestedScenes |= voD.subtreeHasNestedScenes;
+        return;
+    }
+
+    // Children depend on the parent state, so they can't be skipped if it changed
+    const bool changed { force || geometryChanged || view->m_changeSerial > voD.calcSerial };
+    const bool hasNestedScenes { ctd.hasNestedScenes };
+    const UInt32 renderListBegin { static_cast<UInt32>(ctd.renderList.size()) };
+    ctd.hasNestedScenes = false;
+
+    // Children first (nested scenes calculate their own children)
+    if (view->type() != SceneType)
+        for (std::list<LView*>::const_reverse_iterator it = view->children().crbegin(); it != view->children().crend(); it++)
+            calcNewDamage(*it, changed);
+
+    calcViewDamage(view, voD);
+
+    voD.calcSerial = ctd.calcSerial;
+    voD.renderListBegin = renderListBegin;
+    voD.renderListCount = static_cast<UInt32>(ctd.renderList.size()) - renderListBegin;
+    voD.subtreeHasNestedScenes = ctd.hasNestedScenes;
+    voD.subtreeBox = voD.cache.clippingBox;
+    ctd.hasNestedScenes |= hasNestedScenes;
+
+    if (view->children().empty() || view->type() == SceneType)
+        return;
+
+    voD.subtreeOpaque = voD.cache.opaque;
+
+    for (LView *child : view->children())
+    {
+        const LView::ViewThreadData &childData { child->m_threadsData[LCompositor::LCompositorPrivate::threadSlot] };
+        voD.subtreeOpaque.addRegion(subtreeOpaque(child, childData));
+        boxUnion(voD.subtreeBox, childData.subtreeBox);
+    }
+}
+
+void LSceneView::snapshotPaintParams(LView *view, LView::ViewCache &cache) noexcept
+{
+    cache.textureParams.texture = nullptr;
+    cache.textureParams.pos = cache.rect.pos();
+    cache.textureParams.dstSize = cache.rect.size();
+
+    switch (view->type())
+    {
+    case SurfaceType:
+    {
+        LSurfaceView &surfaceView { static_cast<LSurfaceView&>(*view) };
+
+        if (!surfaceView.surface())
+            break;
+
+        cache.textureParams.texture = surfaceView.surface()->texture();
+        cache.textureParams.srcRect = surfaceView.srcRect();
+        cache.textureParams.srcTransform = surfaceView.surface()->bufferTransform();
+        cache.textureParams.srcScale = surfaceView.bufferScale();
+        break;
+    }
+    case TextureType:
+    {
+        LTextureView &textureView { static_cast<LTextureView&>(*view) };
+        cache.textureParams.texture = textureView.texture();
+        cache.textureParams.srcRect = textureView.srcRect();
+        cache.textureParams.srcTransform = textureView.transform();
+        cache.textureParams.srcScale = textureView.bufferScale();
+        cache.customColor = textureView.customColorEnabled();
+        cache.color = textureView.customColor();
+        break;
+    }
+    case SolidColorType:
+        cache.color = static_cast<LSolidColorView&>(*view).color();
+        break;
+    case SceneType:
+    {
+        LSceneView &sceneView { static_cast<LSceneView&>(*view) };
+        cache.textureParams.texture = sceneView.m_fb->texture(sceneView.m_fb->currentBufferIndex());
+        cache.textureParams.srcRect = LRectF(LPointF(), sceneView.m_fb->sizeB()) / sceneView.bufferScale();
+        cache.textureParams.srcTransform = sceneView.m_fb->transform();
+        cache.textureParams.srcScale = sceneView.bufferScale();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void LSceneView::calcViewDamage(LView *view, LView::ViewThreadData &voD) noexcept
 {
     auto &ctd { *m_currentThreadData };
 
-    // Children first
     if (view->type() == SceneType)
     {
         LSceneView &sceneView { static_cast<LSceneView&>(*view) };
 
-        if (view->m_cache.scalingEnabled)
+        // Nested scenes are drawn right away since their render buffer is shared by all outputs
+        ctd.hasNestedScenes = true;
+
+        /* Cached layers always render their full content, so opaque views stacked above
+         * don't invalidate them when they move (see enableLayerCache()) */
+        if (sceneView.m_layerCache || voD.cache.scalingEnabled)
             sceneView.render(nullptr);
         else
             sceneView.render(&ctd.opaqueSum);
     }
-    else
-    {
-        for (std::list<LView*>::const_reverse_iterator it = view->children().crbegin(); it != view->children().crend(); it++)
-            calcNewDamage(*it);
-    }
 
     // Quick view cache handle to reduce verbosity
-    LView::ViewCache &cache { view->m_cache };
+    LView::ViewCache &cache { voD.cache };
+
+    // Views below must be recalculated where the opaque region changes
+    const LBox prevOpaqueBox { cache.opaque.extents() };
+    cache.clippingBox = { 0, 0, 0, 0 };
 
     view->m_state.remove(RepaintCalled);
 
-    cache.voD = &view->m_threadsMap[std::this_thread::get_id()];
-    cache.voD->o = ctd.o;
+    cache.view = view;
+    voD.o = ctd.o;
     cache.mapped = view->mapped();
+    voD.calcMapped = cache.mapped;
     cache.rect.setPos(view->pos());
     cache.rect.setSize(view->size());
     cache.scalingVector = view->scalingVector();
     cache.scalingEnabled = (view->scalingEnabled() || view->parentScalingEnabled()) && cache.scalingVector != LSizeF(1.f, 1.f);
 
-    LRegion vRegion {cache.rect};
+    LBox vBox { rectBox(cache.rect) };
 
     if (view->clippingEnabled())
-        vRegion.clip(view->clippingRect());
+        clipBox(vBox, view->clippingRect().x(), view->clippingRect().y(), view->clippingRect().w(), view->clippingRect().h());
 
     if (view->parent() && view->parentClippingEnabled())
-        vRegion.clip(view->parent()->pos(), view->parent()->size());
+        clipBox(vBox, view->parent()->pos().x(), view->parent()->pos().y(), view->parent()->size().w(), view->parent()->size().h());
 
-    // Update view intersected outputs
-    for (LOutput *o : compositor()->outputs())
+    /* Update view intersected outputs, only if the view moved, the outputs layout changed or
+     * something else modified its outputs (e.g. surface outputs updated by other views) */
+    if (!voD.outputsValid || ctd.outputsLayoutChanged || !boxEqual(vBox, voD.prevOutputsBox) || view->outputs().size() != voD.prevOutputsCount)
     {
-        LRegion r { vRegion };
-        r.clip(o->rect());
+        for (LOutput *o : compositor()->outputs())
+        {
+            LBox oBox { vBox };
+            clipBox(oBox, o->pos().x(), o->pos().y(), o->size().w(), o->size().h());
 
-        if (!r.empty())
-            view->enteredOutput(o);
-        else
-            view->leftOutput(o);
+            if (!boxEmpty(oBox))
+                view->enteredOutput(o);
+            else
+                view->leftOutput(o);
+        }
+
+        voD.outputsValid = true;
+        voD.prevOutputsBox = vBox;
+        voD.prevOutputsCount = view->outputs().size();
     }
 
     /*
@@ -315,64 +477,78 @@ void LSceneView::calcNewDamage(LView *view) noexcept
         return;
 
     cache.opacity = view->opacity();
+    cache.colorFactor = view->m_colorFactor;
+    cache.colorFactorEnabled = view->m_state.check(ColorFactor);
+    cache.autoBlendFunc = view->autoBlendFuncEnabled();
+    cache.blendFunc = view->blendFunc();
+    snapshotPaintParams(view, cache);
 
     if (view->m_colorFactor.a <= 0.f || cache.rect.size().area() == 0 || cache.opacity <= 0.f || cache.scalingVector.w() == 0.f || cache.scalingVector.y() == 0.f || (view->clippingEnabled() && view->clippingRect().area() == 0))
         cache.mapped = false;
 
-    const bool mappingChanged { cache.mapped != cache.voD->prevMapped };
+    const bool mappingChanged { cache.mapped != voD.prevMapped };
 
     if (ctd.o && !mappingChanged && !cache.mapped)
     {
         if (view->forceRequestNextFrameEnabled())
+        {
             view->requestNextFrame(ctd.o);
+
+            // Keeps it from being skipped in the next frame
+            view->markChanged();
+        }
         return;
     }
 
-    const bool opacityChanged { cache.opacity != cache.voD->prevOpacity };
+    const bool opacityChanged { cache.opacity != voD.prevOpacity };
 
     cache.localRect = LRect(cache.rect.pos() - m_fb->rect().pos(), cache.rect.size());
 
-    const bool rectChanged { cache.localRect != cache.voD->prevLocalRect };
+    const bool rectChanged { cache.localRect != voD.prevLocalRect };
 
-    bool colorFactorChanged { cache.voD->prevColorFactorEnabled != view->m_state.check(ColorFactor) };
+    bool colorFactorChanged { voD.prevColorFactorEnabled != view->m_state.check(ColorFactor) };
 
     if (!colorFactorChanged && view->m_state.check(ColorFactor))
     {
-        colorFactorChanged = cache.voD->prevColorFactor.r != view->m_colorFactor.r ||
-                             cache.voD->prevColorFactor.g != view->m_colorFactor.g ||
-                             cache.voD->prevColorFactor.b != view->m_colorFactor.b ||
-                             cache.voD->prevColorFactor.a != view->m_colorFactor.a;
+        colorFactorChanged = voD.prevColorFactor.r != view->m_colorFactor.r ||
+                             voD.prevColorFactor.g != view->m_colorFactor.g ||
+                             voD.prevColorFactor.b != view->m_colorFactor.b ||
+                             voD.prevColorFactor.a != view->m_colorFactor.a;
     }
 
     // If rect or order changed (set current rect and prev rect as damage)
-    if (mappingChanged || rectChanged || cache.voD->changedOrder || opacityChanged || cache.scalingEnabled || colorFactorChanged)
+    if (mappingChanged || rectChanged || voD.changedOrder || opacityChanged || cache.scalingEnabled || colorFactorChanged)
     {
         cache.damage.addRect(cache.rect);
 
-        if (cache.voD->changedOrder)
-            cache.voD->changedOrder = false;
+        if (voD.changedOrder)
+            voD.changedOrder = false;
 
         if (mappingChanged)
-            cache.voD->prevMapped = cache.mapped;
+            voD.prevMapped = cache.mapped;
 
         if (rectChanged)
         {
-            cache.voD->prevRect = cache.rect;
-            cache.voD->prevLocalRect = cache.localRect;
+            voD.prevRect = cache.rect;
+            voD.prevLocalRect = cache.localRect;
         }
 
         if (opacityChanged)
-            cache.voD->prevOpacity = cache.opacity;
+            voD.prevOpacity = cache.opacity;
 
         if (colorFactorChanged)
         {
-            cache.voD->prevColorFactorEnabled = view->m_state.check(ColorFactor);
-            cache.voD->prevColorFactor = view->m_colorFactor;
+            voD.prevColorFactorEnabled = view->m_state.check(ColorFactor);
+            voD.prevColorFactor = view->m_colorFactor;
         }
 
         if (!cache.mapped)
         {
-            ctd.newDamage.addRegion(cache.voD->prevClipping);
+            ctd.newDamage.addRegion(voD.prevClipping);
+            addBox(ctd.opaqueChanges, prevOpaqueBox);
+            cache.opaque.clear();
+            cache.translucent.clear();
+            voD.regionsValid = false;
             return;
         }
     }
@@ -391,32 +567,37 @@ void LSceneView::calcNewDamage(LView *view) noexcept
 
     // Calculates the non clipped region
 
-    LRegion currentClipping { cache.rect };
+    LBox clippingBox { rectBox(cache.rect) };
 
     if (view->parentClippingEnabled())
-        parentClipping(view->parent(), &currentClipping);
+        parentClipping(view->parent(), clippingBox);
 
     if (view->clippingEnabled())
-        currentClipping.clip(view->clippingRect());
+        clipBox(clippingBox, view->clippingRect().x(), view->clippingRect().y(), view->clippingRect().w(), view->clippingRect().h());
+
+    // Nothing was exposed or hidden if the clipped region is the same as in the previous frame
+    if (!boxEqual(clippingBox, voD.prevClippingBox))
+    {
+        // Both clippings are single boxes, so no temporary regions are needed
+
+        // Add the new exposed view region to the view damage
+        addBoxDifference(cache.damage, clippingBox, voD.prevClippingBox);
 
-    // Calculates the new exposed view region if parent clipping or clipped region has grown
+        // Add the exposed now non clipped region to the new output damage
+        addBoxDifference(ctd.newDamage, voD.prevClippingBox, clippingBox);
 
-    /* LRegion newExposedClipping = currentClipping;
-     * newExposedClipping.subtractRegion(cache.voD->prevClipping);*/
+        // Saves current clipped region for next frame
+        voD.prevClipping.clear();
 
-    LRegion newExposedClipping;
-    pixman_region32_subtract(&newExposedClipping.m_region,
-                             &currentClipping.m_region,
-                             &cache.voD->prevClipping.m_region);
+        if (!boxEmpty(clippingBox))
+            voD.prevClipping.addRect(clippingBox.x1, clippingBox.y1, clippingBox.x2 - clippingBox.x1, clippingBox.y2 - clippingBox.y1);
 
-    cache.damage.addRegion(newExposedClipping);
+        voD.prevClippingBox = clippingBox;
+    }
 
-    // Add exposed now non clipped region to new output damage
-    cache.voD->prevClipping.subtractRegion(currentClipping);
-    ctd.newDamage.addRegion(cache.voD->prevClipping);
+    cache.clippingBox = clippingBox;
 
-    // Saves current clipped region for next frame
-    cache.voD->prevClipping = currentClipping;
+    const LRegion &currentClipping { voD.prevClipping };
 
     // Clip current damage to current visible region
     cache.damage.intersectRegion(currentClipping);
@@ -427,121 +608,178 @@ void LSceneView::calcNewDamage(LView *view) noexcept
     // Add clipped damage to new damage
     ctd.newDamage.addRegion(cache.damage);
 
+    bool regionsChanged { false };
+
     if (cache.opacity < 1.f || cache.scalingEnabled || view->colorFactor().a < 1.f)
     {
-        cache.translucent.clear();
-        cache.translucent.addRect(cache.rect);
+        // The clipping is always contained in the view rect
+        cache.translucent = currentClipping;
         cache.opaque.clear();
+        voD.regionsValid = false;
     }
     else
     {
-        // Store tansposed traslucent region
-        if (view->translucentRegion())
-        {
-            cache.translucent = *view->translucentRegion();
-
-            if (view->type() != SceneType)
-                cache.translucent.offset(cache.rect.pos());
-        }
-        else
-        {
-            cache.translucent.clear();
-            cache.translucent.addRect(cache.rect);
-        }
-
-        // Store tansposed opaque region
-        if (view->opaqueRegion())
+        const LRegion *translucent { view->translucentRegion() };
+        const LRegion *opaque { view->opaqueRegion() };
+
+        /* Scene views regions are updated each time they are rendered, but are compared like
+         * any other view so undamaged nested scenes don't require clipping them again */
+        regionsChanged =
+            !voD.regionsValid ||
+            voD.regionsRect != cache.rect ||
+            !boxEqual(voD.regionsClippingBox, clippingBox) ||
+            voD.hasSrcTranslucent != (translucent != nullptr) ||
+            voD.hasSrcOpaque != (opaque != nullptr) ||
+            (translucent && !pixman_region32_equal(&translucent->m_region, &voD.srcTranslucent.m_region)) ||
+            (opaque && !pixman_region32_equal(&opaque->m_region, &voD.srcOpaque.m_region));
+
+        if (regionsChanged)
         {
-            cache.opaque = *view->opaqueRegion();
-
-            if (view->type() != SceneType)
-                cache.opaque.offset(cache.rect.pos());
-        }
-        else
-        {
-            cache.opaque = cache.translucent;
-            cache.opaque.inverse(cache.rect);
+            // Store tansposed traslucent region
+            if (translucent)
+            {
+                cache.translucent = *translucent;
+
+                if (view->type() != SceneType)
+                    cache.translucent.offset(cache.rect.pos());
+            }
+            else
+            {
+                cache.translucent.clear();
+                cache.translucent.addRect(cache.rect);
+            }
+
+            // Store tansposed opaque region
+            if (opaque)
+            {
+                cache.opaque = *opaque;
+
+                if (view->type() != SceneType)
+                    cache.opaque.offset(cache.rect.pos());
+            }
+            else
+            {
+                cache.opaque = cache.translucent;
+                cache.opaque.inverse(cache.rect);
+            }
+
+            // Clip opaque and translucent regions to current visible region
+            cache.opaque.intersectRegion(currentClipping);
+            cache.translucent.intersectRegion(currentClipping);
+
+            voD.regionsValid = true;
+            voD.hasSrcTranslucent = translucent != nullptr;
+            voD.hasSrcOpaque = opaque != nullptr;
+
+            if (translucent)
+                voD.srcTranslucent = *translucent;
+
+            if (opaque)
+                voD.srcOpaque = *opaque;
+
+            voD.regionsRect = cache.rect;
+            voD.regionsClippingBox = clippingBox;
         }
     }
 
-    // Clip opaque and translucent regions to current visible region
-    cache.opaque.intersectRegion(currentClipping);
-    cache.translucent.intersectRegion(currentClipping);
+    if (regionsChanged || !boxEqual(prevOpaqueBox, cache.opaque.extents()))
+    {
+        addBox(ctd.opaqueChanges, prevOpaqueBox);
+        addBox(ctd.opaqueChanges, cache.opaque.extents());
+    }
 
     // Check if view is ocludded
-    currentClipping.subtractRegion(ctd.opaqueSum);
-
-    cache.occluded = currentClipping.empty();
+    cache.occluded = boxEmpty(clippingBox) ||
+        pixman_region32_contains_rectangle(&ctd.opaqueSum.m_region, reinterpret_cast<pixman_box32_t*>(&clippingBox)) == PIXMAN_REGION_IN;
 
     if (ctd.o && (!cache.occluded || view->forceRequestNextFrameEnabled()))
         view->requestNextFrame(ctd.o);
 
-    // Store sum of previus opaque regions (this will later be clipped when painting opaque and translucent regions)
-    cache.opaqueOverlay = ctd.opaqueSum;
+    if (view->forceRequestNextFrameEnabled())
+        view->markChanged();
+
     ctd.opaqueSum.addRegion(cache.opaque);
+
+    if (cache.mapped && !cache.occluded)
+        ctd.renderList.push_back(&cache);
 }
 
-void LSceneView::drawOpaqueDamage(LView *view) noexcept
+void LSceneView::drawOpaqueDamage(ThreadData &ctd) noexcept
 {
-    auto &ctd { *m_currentThreadData };
+    PaintEventParams params;
+    params.painter = ctd.p;
+    params.blending = false;
 
-    // Children first
-    if (view->type() != SceneType)
-        for (std::list<LView*>::const_reverse_iterator it = view->children().crbegin(); it != view->children().crend(); it++)
-            drawOpaqueDamage(*it);
+    // The render list is sorted from top to bottom, each opaque region covers the damage of views below
+    ctd.uncoveredDamage = ctd.newDamage;
+    ctd.uncoveredDamage.subtractRegion(ctd.prevExternalExclude);
 
-    LView::ViewCache &cache { view->m_cache };
+    if (ctd.translucentDamage.size() < ctd.renderList.size())
+        ctd.translucentDamage.resize(ctd.renderList.size());
 
-    if (!view->isRenderable() || !cache.mapped || cache.occluded || cache.opacity < 1.f || view->m_colorFactor.a < 1.f)
-        return;
+    for (size_t i = 0; i < ctd.renderList.size(); i++)
+    {
+        LView::ViewCache &cache { *ctd.renderList[i] };
+        LRegion &translucentDamage { ctd.translucentDamage[i] };
+        ctd.opaqueDamage.clear();
 
-    cache.opaque.intersectRegion(ctd.newDamage);
-    cache.opaque.subtractRegion(cache.opaqueOverlay);
+        // Only views intersecting the remaining damage need region operations
+        if (intersectsRegion(cache.clippingBox, ctd.uncoveredDamage))
+        {
+            translucentDamage = cache.translucent;
+            translucentDamage.intersectRegion(ctd.uncoveredDamage);
+
+            if (cache.opacity >= 1.f && cache.colorFactor.a >= 1.f && !cache.opaque.empty())
+            {
+                ctd.opaqueDamage = cache.opaque;
+                ctd.opaqueDamage.intersectRegion(ctd.uncoveredDamage);
+                ctd.uncoveredDamage.subtractRegion(ctd.opaqueDamage);
+            }
+        }
+        else
+            translucentDamage.clear();
 
-    ctd.p->enableAutoBlendFunc(view->autoBlendFuncEnabled());
+        if (cache.opacity < 1.f || cache.colorFactor.a < 1.f)
+            continue;
 
-    if (view->m_state.check(ColorFactor))
-        ctd.p->setColorFactor(view->m_colorFactor);
-    else
-        ctd.p->setColorFactor(1.f, 1.f, 1.f, 1.f);
+        ctd.p->enableAutoBlendFunc(cache.autoBlendFunc);
+
+        if (cache.colorFactorEnabled)
+            ctd.p->setColorFactor(cache.colorFactor);
+        else
+            ctd.p->setColorFactor(1.f, 1.f, 1.f, 1.f);
 
-    ctd.p->setAlpha(1.f);
-    m_paintParams.painter = ctd.p;
-    m_paintParams.region = &cache.opaque;
-    view->paintEvent(m_paintParams);
+        ctd.p->setAlpha(1.f);
+        params.region = &ctd.opaqueDamage;
+        setPaintParams(params, cache);
+        cache.view->paintEvent(params);
+    }
 }
 
-void LSceneView::drawTranslucentDamage(LView *view) noexcept
+void LSceneView::drawTranslucentDamage(ThreadData &ctd) noexcept
 {
-    auto &ctd { *m_currentThreadData };
-    auto &cache { view->m_cache };
-
-    if (!view->isRenderable() || !cache.mapped || cache.occluded)
-        goto drawChildrenOnly;
+    PaintEventParams params;
+    params.painter = ctd.p;
+    params.blending = true;
 
-    ctd.p->enableAutoBlendFunc(view->autoBlendFuncEnabled());
-
-    if (!view->autoBlendFuncEnabled())
-        ctd.p->setBlendFunc(view->blendFunc());
+    // The render list is sorted from top to bottom
+    for (size_t i = ctd.renderList.size(); i-- > 0;)
+    {
+        LView::ViewCache &cache { *ctd.renderList[i] };
 
-    if (view->m_state.check(ColorFactor))
-        ctd.p->setColorFactor(view->m_colorFactor);
-    else
-        ctd.p->setColorFactor(1.f, 1.f, 1.f, 1.f);
+        ctd.p->enableAutoBlendFunc(cache.autoBlendFunc);
 
-    cache.occluded = true;
-    cache.translucent.intersectRegion(ctd.newDamage);
-    cache.translucent.subtractRegion(cache.opaqueOverlay);
+        if (!cache.autoBlendFunc)
+            ctd.p->setBlendFunc(cache.blendFunc);
 
-    ctd.p->setAlpha(cache.opacity);
-    m_paintParams.painter = ctd.p;
-    m_paintParams.region = &cache.translucent;
-    view->paintEvent(m_paintParams);
+        if (cache.colorFactorEnabled)
+            ctd.p->setColorFactor(cache.colorFactor);
+        else
+            ctd.p->setColorFactor(1.f, 1.f, 1.f, 1.f);
 
-drawChildrenOnly:
-    if (view->type() != SceneType)
-        for (std::list<LView*>::const_iterator it = view->children().cbegin(); it != view->children().cend(); it++)
-            drawTranslucentDamage(*it);
+        ctd.p->setAlpha(cache.opacity);
+        params.region = &ctd.translucentDamage[i];
+        setPaintParams(params, cache);
+        cache.view->paintEvent(params);
+    }
 }
-
-
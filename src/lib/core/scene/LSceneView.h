@@ -7,6 +7,7 @@
 #include <LOutput.h>
 #include <LView.h>
 #include <LCursor.h>
+#include <algorithm>
 
 /**
  * @brief View for rendering other views
@@ -22,6 +23,10 @@
  * The main view of the LScene class (LScene::mainView()) is a unique LSceneView designed to render its content onto one or more LOutputs instead of using its own framebuffer.\n
  *
  * @warning Use LSceneViews judiciously. When nested within another scene, they are rendered twice: first, into to its framebuffer, and then into an LOutput framebuffer or another LSurfaceView parent.
+ *
+ * Nested scenes behave as retained layers: their framebuffer is only updated where their children are damaged, and when nothing
+ * changed the previous content is reused without binding the framebuffer. The parent scene only recomposites the damaged region of the layer.
+ * See enableLayerCache() to keep a complex subtree (e.g. a panel or dock) cached regardless of what is stacked above it.
  */
 class Louvre::LSceneView : public LView
 {
@@ -91,6 +96,37 @@ public:
      */
     void addDamage(LOutput *output, const LRegion &damage) noexcept;
 
+    /**
+     * @brief Keeps the full content of the scene cached when nested in another scene.
+     *
+     * By default, nested scenes skip rendering the parts hidden behind opaque views of the parent scene stacked above them,
+     * so these parts must be rendered again once they are exposed.\n
+     * When enabled, the scene always renders its full content, so its framebuffer is only invalidated by damage of its own children.
+     * This is useful for subtrees that rarely change but are frequently partially covered, such as panels or docks.
+     *
+     * Disabled by default.
+     */
+    void enableLayerCache(bool enabled) noexcept
+    {
+        if (isLScene() || m_layerCache == enabled)
+            return;
+
+        m_layerCache = enabled;
+
+        for (LOutput *o : compositor()->outputs())
+            damageAll(o);
+    }
+
+    /**
+     * @brief Checks if the layer cache is enabled.
+     *
+     * @see enableLayerCache()
+     */
+    bool layerCacheEnabled() const noexcept
+    {
+        return m_layerCache;
+    }
+
     /**
      * @brief Render the scene.
      *
@@ -143,7 +179,7 @@ public:
             if (!isLScene())
                 static_cast<LRenderBuffer*>(m_fb)->setPos(m_customPos);
 
-            if (!repaintCalled() && mapped())
+            if (mapped())
                 repaint();
         }
     }
@@ -203,6 +239,14 @@ protected:
     class ThreadData : public LObject
     {
     public:
+        ~ThreadData() noexcept
+        {
+            notifyDestruction();
+
+            for (LRegion *region : prevDamageList)
+                delete region;
+        }
+
         std::list<LRegion*>prevDamageList;
         LRegion newDamage;
         LRegion manuallyAddedDamage;
@@ -212,6 +256,39 @@ protected:
         LRect prevRect;
         LPainter *p { nullptr };
         LOutput *o { nullptr };
+        LFramebuffer *fb { nullptr };
+        LFramebuffer *prevFb { nullptr };
+
+        // Views to draw in the current frame, in the same order calcNewDamage() visited them
+        std::vector<LView::ViewCache*> renderList;
+
+        // Render list of the previous frame, skipped subtrees copy their range of entries from it
+        std::vector<LView::ViewCache*> prevRenderList;
+
+        /* Areas where the opaque region of a view changed during the current calcNewDamage() pass.
+         * Unchanged subtrees below are only skipped if they don't intersect it */
+        LRegion opaqueChanges;
+
+        // Value of LCompositorPrivate::viewsChangeSerial when the last pass started
+        UInt64 calcSerial { 0 };
+
+        // Set when views can't be skipped, e.g. when the layout of views or outputs changed
+        bool forceCalc { true };
+
+        /* Damage not yet covered by opaque regions of views above, and the damaged parts of each
+         * render list entry. Used while drawing so the view caches are never modified */
+        LRegion uncoveredDamage;
+        LRegion opaqueDamage;
+        std::vector<LRegion> translucentDamage;
+
+        // Outputs layout of the previous frame, views only update their intersected outputs if it changes
+        std::vector<std::pair<LOutput*, LRect>> outputsLayout;
+        bool outputsLayoutChanged { true };
+
+        // LScene::ScanoutResult of the last frame, only used by the main view of LScenes
+        UInt8 scanoutResult { 0 };
+        LRGBAF clearColor;
+        bool hasNestedScenes { false };
         LBox *boxes { nullptr };
         Int32 n, w, h;
         LTransform transform;
@@ -219,13 +296,13 @@ protected:
         bool fractionalScale = false;
     };
 
-    std::unordered_map<std::thread::id, ThreadData> m_sceneThreadsMap;
+    ThreadSlots<ThreadData> m_sceneThreadsData;
     LWeak<ThreadData> m_currentThreadData;
     LFramebuffer *m_fb { nullptr };
     LRGBAF m_clearColor {0.f, 0.f, 0.f, 0.f};
     LPoint m_customPos;
     std::vector<LOutput*> m_outputs;
-    PaintEventParams m_paintParams;
+    bool m_layerCache { false };
 
 private:
     friend class LScene;
@@ -235,30 +312,163 @@ private:
         m_fb(framebuffer)
     {}
 
-    void calcNewDamage(LView *view) noexcept;
-    void drawOpaqueDamage(LView *view) noexcept;
-    void drawTranslucentDamage(LView *view) noexcept;
+    /* Rendering is split in two phases: prepareRender() calculates damage and fills the render list, it must be
+     * called with exclusive access to the compositor state. drawRender() only reads what prepareRender() cached,
+     * which allows LScene to draw multiple outputs in parallel (see LScene::enableParallelRendering()) */
+    ThreadData *prepareRender(const LRegion *exclude) noexcept;
+    void drawRender(ThreadData &ctd) noexcept;
+    void calcNewDamage(LView *view, bool force) noexcept;
+    void calcViewDamage(LView *view, LView::ViewThreadData &voD) noexcept;
+
+    // Stores what paintEvent() draws in the cache, drawing only reads the cache (see LView::PaintEventParams)
+    static void snapshotPaintParams(LView *view, LView::ViewCache &cache) noexcept;
 
-    void parentClipping(LView *parent, LRegion *region) noexcept
+    static void setPaintParams(PaintEventParams &params, const LView::ViewCache &cache) noexcept
+    {
+        params.rect = cache.rect;
+        params.textureParams = cache.textureParams;
+        params.color = cache.color;
+        params.customColor = cache.customColor;
+    }
+    void drawOpaqueDamage(ThreadData &ctd) noexcept;
+    void drawTranslucentDamage(ThreadData &ctd) noexcept;
+
+    static void clipBox(LBox &box, Int32 x, Int32 y, Int32 w, Int32 h) noexcept
+    {
+        if (w <= 0 || h <= 0)
+        {
+            box = { 0, 0, 0, 0 };
+            return;
+        }
+
+        box.x1 = std::max(box.x1, x);
+        box.y1 = std::max(box.y1, y);
+        box.x2 = std::min(box.x2, x + w);
+        box.y2 = std::min(box.y2, y + h);
+
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            box = { 0, 0, 0, 0 };
+    }
+
+    static LBox rectBox(const LRect &rect) noexcept
+    {
+        if (rect.w() <= 0 || rect.h() <= 0)
+            return { 0, 0, 0, 0 };
+
+        return { rect.x(), rect.y(), rect.x() + rect.w(), rect.y() + rect.h() };
+    }
+
+    static bool boxEmpty(const LBox &box) noexcept
+    {
+        return box.x1 >= box.x2 || box.y1 >= box.y2;
+    }
+
+    static bool boxEqual(const LBox &a, const LBox &b) noexcept
+    {
+        return a.x1 == b.x1 && a.y1 == b.y1 && a.x2 == b.x2 && a.y2 == b.y2;
+    }
+
+    // Adds a - b to the region, at most 4 rects
+    static void addBoxDifference(LRegion &region, const LBox &a, const LBox &b) noexcept
+    {
+        if (boxEmpty(a))
+            return;
+
+        if (boxEmpty(b) || a.x2 <= b.x1 || b.x2 <= a.x1 || a.y2 <= b.y1 || b.y2 <= a.y1)
+        {
+            region.addRect(a.x1, a.y1, a.x2 - a.x1, a.y2 - a.y1);
+            return;
+        }
+
+        const Int32 y1 { std::max(a.y1, b.y1) };
+        const Int32 y2 { std::min(a.y2, b.y2) };
+
+        // Above and below b
+        if (a.y1 < y1)
+            region.addRect(a.x1, a.y1, a.x2 - a.x1, y1 - a.y1);
+
+        if (y2 < a.y2)
+            region.addRect(a.x1, y2, a.x2 - a.x1, a.y2 - y2);
+
+        // Left and right of b
+        if (a.x1 < b.x1)
+            region.addRect(a.x1, y1, b.x1 - a.x1, y2 - y1);
+
+        if (b.x2 < a.x2)
+            region.addRect(b.x2, y1, a.x2 - b.x2, y2 - y1);
+    }
+
+    static void addBox(LRegion &region, const LBox &box) noexcept
+    {
+        if (!boxEmpty(box))
+            region.addRect(box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+    }
+
+    static void boxUnion(LBox &box, const LBox &other) noexcept
+    {
+        if (boxEmpty(other))
+            return;
+
+        if (boxEmpty(box))
+        {
+            box = other;
+            return;
+        }
+
+        box.x1 = std::min(box.x1, other.x1);
+        box.y1 = std::min(box.y1, other.y1);
+        box.x2 = std::max(box.x2, other.x2);
+        box.y2 = std::max(box.y2, other.y2);
+    }
+
+    static bool intersectsRegion(const LBox &box, const LRegion &region) noexcept
+    {
+        return !boxEmpty(box) && pixman_region32_contains_rectangle(const_cast<pixman_region32_t*>(&region.m_region), reinterpret_cast<pixman_box32_t*>(const_cast<LBox*>(&box))) != PIXMAN_REGION_OUT;
+    }
+
+    // Opaque regions sum of the view and its children, see LView::ViewThreadData::subtreeOpaque
+    static const LRegion &subtreeOpaque(const LView *view, const LView::ViewThreadData &voD) noexcept
+    {
+        return view->children().empty() || view->type() == SceneType ? voD.cache.opaque : voD.subtreeOpaque;
+    }
+
+    // The intersection of rects is always a single rect, so clipping doesn't require LRegions
+    void parentClipping(LView *parent, LBox &box) noexcept
     {
         if (!parent)
             return;
 
-        region->clip(parent->pos(), parent->size());
+        clipBox(box, parent->pos().x(), parent->pos().y(), parent->size().w(), parent->size().h());
 
         if (parent->parentClippingEnabled())
-            parentClipping(parent->parent(), region);
+            parentClipping(parent->parent(), box);
     }
 
-    void drawBackground(bool addToOpaqueSum) noexcept
+    void updateOutputsLayout(ThreadData &ctd) noexcept
+    {
+        const std::vector<LOutput*> &outputs { compositor()->outputs() };
+        ctd.outputsLayoutChanged = ctd.outputsLayout.size() != outputs.size();
+
+        for (size_t i = 0; i < outputs.size() && !ctd.outputsLayoutChanged; i++)
+            ctd.outputsLayoutChanged = ctd.outputsLayout[i].first != outputs[i] || ctd.outputsLayout[i].second != outputs[i]->rect();
+
+        if (!ctd.outputsLayoutChanged)
+            return;
+
+        ctd.outputsLayout.clear();
+
+        for (LOutput *o : outputs)
+            ctd.outputsLayout.emplace_back(o, o->rect());
+    }
+
+    void drawBackground(ThreadData &ctd, bool addToOpaqueSum) noexcept
     {
-        auto &ctd {* m_currentThreadData.get() };
         LRegion backgroundDamage;
         pixman_region32_subtract(&backgroundDamage.m_region,
                                  &ctd.newDamage.m_region,
                                  &ctd.opaqueSum.m_region);
-        ctd.p->setColor({.r = m_clearColor.r, .g = m_clearColor.g, .b = m_clearColor.b});
-        ctd.p->setAlpha(m_clearColor.a);
+        ctd.p->setColor({.r = ctd.clearColor.r, .g = ctd.clearColor.g, .b = ctd.clearColor.b});
+        ctd.p->setAlpha(ctd.clearColor.a);
         ctd.p->enableAutoBlendFunc(true);
         ctd.p->setColorFactor(1.f, 1.f, 1.f, 1.f);
         ctd.p->bindColorMode();
@@ -272,6 +482,7 @@ private:
     {
         ctd.newDamage.clear();
         ctd.opaqueSum.clear();
+        ctd.opaqueChanges.clear();
     }
 
     void damageAll(ThreadData &ctd) noexcept
@@ -284,6 +495,13 @@ private:
     {
         bool needsDamage { false };
 
+        // Cached views local rects are relative to the framebuffer
+        if (ctd.prevRect.pos() != m_fb->rect().pos())
+        {
+            ctd.prevRect.setPos(m_fb->rect().pos());
+            ctd.forceCalc = true;
+        }
+
         if (ctd.prevRect.size() != m_fb->rect().size())
         {
             ctd.prevRect.setSize(m_fb->rect().size());
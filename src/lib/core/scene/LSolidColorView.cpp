@@ -69,7 +69,7 @@ const LRegion *LSolidColorView::inputRegion() const noexcept
 
 void LSolidColorView::paintEvent(const PaintEventParams &params) noexcept
 {
-    params.painter->setColor(color());
+    params.painter->setColor(params.color);
     params.painter->bindColorMode();
     params.painter->drawRegion(*params.region);
 }
@@ -117,7 +117,7 @@ public:
         m_nativePos.setX(x);
         m_nativePos.setY(y);
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -144,7 +144,7 @@ public:
             m_nativeSize.setW(w);
             m_nativeSize.setH(h);
 
-            if (!repaintCalled() && mapped())
+            if (mapped())
                 repaint();
         }
     }
@@ -165,6 +165,8 @@ public:
         }
         else
             m_inputRegion.reset();
+
+        invalidateInputIndex();
     }
 
     virtual bool nativeMapped() const noexcept override;
@@ -1,5 +1,6 @@
 #include <private/LPainterPrivate.h>
 #include <private/LSurfacePrivate.h>
+#include <private/LOutputPrivate.h>
 #include <LSubsurfaceRole.h>
 #include <LOutput.h>
 #include <LUtils.h>
@@ -99,7 +100,7 @@ void LSurfaceView::requestNextFrame(LOutput *output) noexcept
     if (forceRequestNextFrameEnabled())
     {
         surface()->requestNextFrame();
-        m_threadsMap[output->threadId()].lastRenderedDamageId = surface()->damageId();
+        m_threadsData[output->imp()->threadSlot].lastRenderedDamageId = surface()->damageId();
         return;
     }
 
@@ -112,7 +113,9 @@ void LSurfaceView::requestNextFrame(LOutput *output) noexcept
     {
         // If the view is visible on another output and has not rendered the new damage
         // prevent clearing the damage immediately
-        if (o != output && (m_threadsMap[o->threadId()].lastRenderedDamageId < surface()->damageId()))
+        const ViewThreadData *oData { o == output ? nullptr : m_threadsData.get(o->imp()->threadSlot) };
+
+        if (oData && oData->lastRenderedDamageId < surface()->damageId())
         {
             clearDamage = false;
             o->repaint();
@@ -127,7 +130,7 @@ void LSurfaceView::requestNextFrame(LOutput *output) noexcept
             surface()->parent()->requestNextFrame(false);
     }
 
-    m_threadsMap[output->threadId()].lastRenderedDamageId = surface()->damageId();
+    m_threadsData[output->imp()->threadSlot].lastRenderedDamageId = surface()->damageId();
 }
 
 const LRegion *LSurfaceView::damage() const noexcept
@@ -164,17 +167,10 @@ const LRegion *LSurfaceView::inputRegion() const noexcept
 
 void LSurfaceView::paintEvent(const PaintEventParams &params) noexcept
 {
-    if (!surface())
+    if (!params.textureParams.texture)
         return;
 
-    params.painter->bindTextureMode({
-        .texture = surface()->texture(),
-        .pos = pos(),
-        .srcRect = srcRect(),
-        .dstSize = size(),
-        .srcTransform = surface()->bufferTransform(),
-        .srcScale = bufferScale(),
-    });
+    params.painter->bindTextureMode(params.textureParams);
 
     params.painter->enableCustomTextureColor(false);
     params.painter->drawRegion(*params.region);
@@ -73,6 +73,7 @@ public:
     void setPrimary(bool primary) noexcept
     {
         m_state.setFlag(Primary, primary);
+        markChanged();
     }
 
     /**
@@ -98,6 +99,7 @@ public:
     void enableCustomPos(bool enable) noexcept
     {
         m_state.setFlag(CustomPos, enable);
+        markChanged();
     }
 
     /**
@@ -125,7 +127,7 @@ public:
         if (enabled == m_state.check(CustomInputRegion))
             return;
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
 
         m_state.setFlag(CustomInputRegion, enabled);
@@ -159,7 +161,7 @@ public:
         m_customPos.setX(x);
         m_customPos.setY(y);
 
-        if (!repaintCalled() && customPosEnabled() && mapped())
+        if (customPosEnabled() && mapped())
             repaint();
     }
 
@@ -191,6 +193,8 @@ public:
         }
         else
             m_customInputRegion.reset();
+
+        invalidateInputIndex();
     }
 
     /**
@@ -276,7 +280,7 @@ public:
 
         m_state.setFlag(AlwaysMapped, enabled);
 
-        if (!repaintCalled() && prev != mapped())
+        if (prev != mapped())
             repaint();
     }
 
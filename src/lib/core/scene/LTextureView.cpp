@@ -15,6 +15,8 @@ void LTextureView::setInputRegion(const LRegion *region)
     }
     else
         m_inputRegion.reset();
+
+    invalidateInputIndex();
 }
 
 void LTextureView::setTranslucentRegion(const LRegion *region)
@@ -28,6 +30,8 @@ void LTextureView::setTranslucentRegion(const LRegion *region)
     }
     else
         m_translucentRegion.reset();
+
+    markChanged();
 }
 
 void LTextureView::setTexture(LTexture *texture) noexcept
@@ -112,20 +116,12 @@ const LRegion *LTextureView::inputRegion() const noexcept
 
 void LTextureView::paintEvent(const PaintEventParams &params) noexcept
 {
-    if (!m_texture)
+    if (!params.textureParams.texture)
         return;
 
-    params.painter->bindTextureMode({
-        .texture = m_texture,
-        .pos = pos(),
-        .srcRect = srcRect(),
-        .dstSize = size(),
-        .srcTransform = transform(),
-        .srcScale = bufferScale(),
-    });
-
-    params.painter->enableCustomTextureColor(customColorEnabled());
-    params.painter->setColor(customColor());
+    params.painter->bindTextureMode(params.textureParams);
+    params.painter->enableCustomTextureColor(params.customColor);
+    params.painter->setColor(params.color);
     params.painter->drawRegion(*params.region);
 }
 
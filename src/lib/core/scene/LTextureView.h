@@ -68,7 +68,7 @@ public:
         m_nativePos.setX(x);
         m_nativePos.setY(y);
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -116,7 +116,7 @@ public:
         m_bufferScale = scale;
         updateDimensions();
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -185,7 +185,7 @@ public:
         m_customDstSize.setH(h);
         updateDimensions();
 
-        if (!repaintCalled() && dstSizeEnabled() && mapped())
+        if (dstSizeEnabled() && mapped())
             repaint();
     }
 
@@ -96,6 +96,9 @@ void LView::enablePointerEvents(bool enabled) noexcept
 
 void LView::repaint() const noexcept
 {
+    invalidateInputIndex();
+    markChanged();
+
     if (m_state.check(RepaintCalled) || !scene() || !scene()->autoRepaintEnabled())
         return;
 
@@ -135,7 +138,15 @@ void LView::setParent(LView *view) noexcept
     }
 
     markAsChangedOrder();
+    markStructureChanged();
     m_parent = view;
+    invalidateInputIndex();
+}
+
+void LView::invalidateInputIndex() const noexcept
+{
+    if (scene())
+        scene()->imp()->invalidateInputIndex(const_cast<LView*>(this));
 }
 
 void LView::insertAfter(LView *prev) noexcept
@@ -147,6 +158,7 @@ void LView::insertAfter(LView *prev) noexcept
     {
         setParent(prev->parent());
         markAsChangedOrder();
+        markStructureChanged();
         repaint();
 
         if (!parent())
@@ -180,36 +192,57 @@ void LView::insertAfter(LView *prev) noexcept
         parent()->m_children.push_front(this);
         m_parentLink = parent()->m_children.begin();
         markAsChangedOrder();
+        markStructureChanged();
         repaint();
     }
 }
 
-void LView::removeThread(std::thread::id thread)
+void LView::removeThreadSlot(UInt32 slot)
 {
-    auto it { m_threadsMap.find(thread) };
+    if (m_threadsData[slot].o)
+        leftOutput(m_threadsData[slot].o);
 
-    if (it != m_threadsMap.end())
-    {
-        if (it->second.o)
-            leftOutput(it->second.o);
-        m_threadsMap.erase(it);
-    }
+    m_threadsData.reset(slot);
 
     if (type() != SceneType)
         return;
 
-    LSceneView *sceneView { static_cast<LSceneView*>(this) };
+    static_cast<LSceneView*>(this)->m_sceneThreadsData.reset(slot);
+}
+
+UInt32 LView::threadSlotsCount() noexcept
+{
+    return compositor()->imp()->threadSlotsCount;
+}
 
-    auto sit { sceneView->m_sceneThreadsMap.find(thread) };
+void LView::resizeThreadSlots(UInt32 count) noexcept
+{
+    m_threadsData.resize(count);
 
-    if (sit != sceneView->m_sceneThreadsMap.end())
-        sceneView->m_sceneThreadsMap.erase(sit);
+    if (type() != SceneType)
+        return;
+
+    static_cast<LSceneView*>(this)->m_sceneThreadsData.resize(count);
+}
+
+void LView::markChanged() const noexcept
+{
+    const UInt64 serial { ++compositor()->imp()->viewsChangeSerial };
+    m_changeSerial = serial;
+
+    for (const LView *view { this }; view; view = view->parent())
+        view->m_subtreeChangeSerial = serial;
+}
+
+void LView::markStructureChanged() noexcept
+{
+    compositor()->imp()->viewsStructureSerial = ++compositor()->imp()->viewsChangeSerial;
 }
 
 void LView::markAsChangedOrder(bool includeChildren)
 {
-    for (auto &pair : m_threadsMap)
-        pair.second.changedOrder = true;
+    m_threadsData.forEach([](ViewThreadData &data){ data.changedOrder = true; });
+    markChanged();
 
     if (scene())
         damageScene(scene()->mainView(), false);
@@ -223,14 +256,11 @@ void LView::damageScene(LSceneView *scene, bool includeChildren)
 {
     if (scene)
     {
-        for (auto &pair : m_threadsMap)
+        m_threadsData.forEach([scene](ViewThreadData &data)
         {
-            if (!pair.second.prevMapped)
-                continue;
-
-            if (pair.second.o)
-                scene->addDamage(pair.second.o, pair.second.prevClipping);
-        }
+            if (data.prevMapped && data.o)
+                scene->addDamage(data.o, data.prevClipping);
+        });
 
         if (includeChildren)
             for (LView *child : children())
@@ -242,6 +272,8 @@ void LView::sceneChanged(LScene *newScene)
 {
     if (scene())
     {
+        scene()->imp()->removeFromInputIndex(this);
+
         if (m_state.check(KeyboardEvents))
         {
             LVectorRemoveOneUnordered(scene()->imp()->keyboardFocus, this);
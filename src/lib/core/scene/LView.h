@@ -5,12 +5,13 @@
 #include <LBitset.h>
 #include <LRegion.h>
 #include <LFramebuffer.h>
+#include <LPainter.h>
 #include <LColor.h>
 #include <GL/gl.h>
 #include <thread>
 #include <vector>
+#include <memory>
 #include <list>
-#include <map>
 
 /**
  * @brief Base class for LScene views.
@@ -126,6 +127,27 @@ public:
 
         /// Indicates if the region to render is opaque (false) or translucent (true)
         bool blending;
+
+        /**
+         * @brief Rect of the view (pos() and size()) when the scene calculated the damage.
+         *
+         * Outputs may draw in parallel (see LScene::enableParallelRendering()), so paintEvent() should
+         * use this instead of calling pos() or size().
+         */
+        LRect rect;
+
+        /**
+         * @brief Texture parameters of built-in views, taken along with rect.
+         *
+         * The texture is `nullptr` for views without a texture and custom views.
+         */
+        LPainter::TextureParams textureParams { .texture = nullptr };
+
+        /// Color of an LSolidColorView or custom color of an LTextureView, taken along with rect.
+        LRGBF color;
+
+        /// If the custom color of an LTextureView is enabled.
+        bool customColor { false };
     };
 
     /**
@@ -366,6 +388,10 @@ public:
      *
      * This method triggers a repaint for all outputs where this view is currently visible.\n
      * Outputs are those returned by the LView::outputs() method.
+     *
+     * It also marks the view as changed. Scenes only recalculate views that changed since the last frame
+     * (along with their parents and children), so custom views must call it whenever their position, size,
+     * regions or content change.
      */
     void repaint() const noexcept;
 
@@ -418,7 +444,7 @@ public:
 
         m_state.setFlag(ParentOffset, enabled);
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -525,7 +551,7 @@ public:
         {
             m_clippingRect = rect;
 
-            if (!repaintCalled() && mapped())
+            if (mapped())
                 repaint();
         }
     }
@@ -552,7 +578,7 @@ public:
         if (enabled == m_state.check(ParentClipping))
             return;
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
 
         m_state.setFlag(ParentClipping, enabled);
@@ -584,7 +610,7 @@ public:
         if (enabled == m_state.check(Scaling))
             return;
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
 
         m_state.setFlag(Scaling, enabled);
@@ -615,7 +641,7 @@ public:
 
         m_scalingVector = scalingVector;
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
     }
 
@@ -654,7 +680,7 @@ public:
         if (enabled == m_state.check(ParentScaling))
             return;
 
-        if (!repaintCalled() && mapped())
+        if (mapped())
             repaint();
 
         return m_state.setFlag(ParentScaling, enabled);
@@ -685,7 +711,7 @@ public:
         const bool prev { mapped() };
         m_state.setFlag(Visible, visible);
 
-        if (!repaintCalled() && prev != mapped())
+        if (prev != mapped())
             repaint();
     }
 
@@ -800,6 +826,7 @@ public:
     void enableForceRequestNextFrame(bool enabled) noexcept
     {
         m_state.setFlag(ForceRequestNextFrame, enabled);
+        markChanged();
     }
 
     /**
@@ -1005,7 +1032,8 @@ public:
      * @brief Notifies that the view has been rendered on the given output.
      *
      * This method is called by the closest parent scene view and should be used to clear the previous view damage or update its content.\n
-     * If forceRequestNextFrameEnabled() is `true`, this method is always called.
+     * It's only called in frames where the view is recalculated, after it or one of its parents changed (see repaint()).
+     * If forceRequestNextFrameEnabled() is `true`, this method is called in every frame.
      *
      * @param output The LOutput on which the view is rendered.
      */
@@ -1263,12 +1291,63 @@ public:
         CustomInputRegion       = static_cast<UInt64>(1) << 45,
         CustomTranslucentRegion = static_cast<UInt64>(1) << 46,
         AlwaysMapped            = static_cast<UInt64>(1) << 47,
+
+        // Queued in LScenePrivate::viewsIndexDirty
+        InputIndexDirty         = static_cast<UInt64>(1) << 48,
+    };
+
+    // This is used to prevent invoking heavy methods
+    struct ViewCache
+    {
+        LView *view { nullptr };
+        LRect rect;
+        LRect localRect;
+
+        // Non clipped rect of the view (as in ViewThreadData::prevClippingBox)
+        LBox clippingBox { 0, 0, 0, 0 };
+        LRegion damage;
+        LRegion translucent;
+        LRegion opaque;
+        Float32 opacity;
+        LSizeF scalingVector;
+        LRGBAF colorFactor;
+        LBlendFunc blendFunc;
+        bool colorFactorEnabled { false };
+        bool autoBlendFunc { true };
+        bool mapped { false };
+        bool occluded { false };
+        bool scalingEnabled { false };
+
+        /* What paintEvent() draws, taken in LSceneView::calcViewDamage() so that drawing never
+         * reads the view while other threads may modify it (see LScene::enableParallelRendering()) */
+        LPainter::TextureParams textureParams { .texture = nullptr };
+        LRGBF color;
+        bool customColor { false };
     };
 
     // This is used for detecting changes on a view since the last time it was drawn on a specific output
     struct ViewThreadData
     {
         LRegion prevClipping;
+
+        // Always a single rect, used to skip the exposed/hidden region calculation when unchanged
+        LBox prevClippingBox { 0, 0, 0, 0 };
+
+        // Box used to calculate the intersected outputs, and outputs().size() after the calculation
+        LBox prevOutputsBox { 0, 0, 0, 0 };
+        size_t prevOutputsCount { 0 };
+        bool outputsValid { false };
+
+        /* Source regions the cache opaque and translucent regions were calculated from, these
+         * are reused while the source regions, rect and clipping remain the same */
+        LRegion srcOpaque;
+        LRegion srcTranslucent;
+        LRect regionsRect;
+        LBox regionsClippingBox { 0, 0, 0, 0 };
+        bool hasSrcOpaque { false };
+        bool hasSrcTranslucent { false };
+        bool regionsValid { false };
+
         LRGBAF prevColorFactor;
         LRect prevRect;
         LRect prevLocalRect;
@@ -1278,23 +1357,70 @@ public:
         bool prevColorFactorEnabled { false };
         bool changedOrder { true };
         bool prevMapped { false };
+
+        /* Result of the last pass over the view and its children, reused while none of them changed
+         * and no opaque region above changed within subtreeBox. Leaf views use cache.opaque instead of
+         * subtreeOpaque, and their entries are stored as a range of the previous render list */
+        UInt64 calcSerial { 0 };
+        LRegion subtreeOpaque;
+        LBox subtreeBox { 0, 0, 0, 0 };
+        UInt32 renderListBegin { 0 };
+        UInt32 renderListCount { 0 };
+        bool subtreeHasNestedScenes { false };
+
+        // mapped() in the last pass, cache.mapped is also false if the view is transparent, empty, etc
+        bool calcMapped { false };
+
+        // Each output thread keeps its own cache so that frames can be drawn in parallel
+        ViewCache cache;
     };
 
-    // This is used to prevent invoking heavy methods
-    struct ViewCache
+    /* Per-thread data indexed by the dense slot each output gets when added to the compositor,
+     * slot 0 is used by the main thread (see LCompositorPrivate::threadSlot). The data of every
+     * slot is allocated by the main thread when the view is created or an output is added, so
+     * lookups never allocate and output threads never resize the table */
+    template <class T>
+    class ThreadSlots
     {
-        ViewThreadData *voD;
-        LRect rect;
-        LRect localRect;
-        LRegion damage;
-        LRegion translucent;
-        LRegion opaque;
-        LRegion opaqueOverlay;
-        Float32 opacity;
-        LSizeF scalingVector;
-        bool mapped { false };
-        bool occluded { false };
-        bool scalingEnabled;
+    public:
+        ThreadSlots() noexcept
+        {
+            resize(threadSlotsCount());
+        }
+
+        T &operator[](UInt32 slot) noexcept
+        {
+            return *m_slots[slot];
+        }
+
+        // For reading the data of other threads, nullptr if the slot doesn't exist
+        const T *get(UInt32 slot) const noexcept
+        {
+            return slot < m_slots.size() ? m_slots[slot].get() : nullptr;
+        }
+
+        void resize(UInt32 count) noexcept
+        {
+            while (m_slots.size() < count)
+                m_slots.emplace_back(std::make_unique<T>());
+        }
+
+        // Replaces the data of the slot with a default constructed T
+        void reset(UInt32 slot) noexcept
+        {
+            if (slot < m_slots.size())
+                m_slots[slot] = std::make_unique<T>();
+        }
+
+        template <class F>
+        void forEach(F func) noexcept
+        {
+            for (auto &data : m_slots)
+                func(*data);
+        }
+
+    private:
+        std::vector<std::unique_ptr<T>> m_slots;
     };
 
 protected:
@@ -1319,14 +1445,26 @@ protected:
     mutable LPoint m_tmpPoint;
     mutable LSize m_tmpSize;
     mutable LSizeF m_tmpSizeF;
-    ViewCache m_cache;
-    std::map<std::thread::id,ViewThreadData> m_threadsMap;
+    ThreadSlots<ViewThreadData> m_threadsData;
+
+    // See LCompositorPrivate::viewsChangeSerial
+    mutable UInt64 m_changeSerial { 0 };
+    mutable UInt64 m_subtreeChangeSerial { 0 };
+
+    // Updates the change serial of the view and the subtree serial of its parents
+    void markChanged() const noexcept;
+
+    // Makes scenes recalculate all views in the next frame
+    static void markStructureChanged() noexcept;
 
     bool repaintCalled() const noexcept
     {
         return m_state.check(RepaintCalled);
     }
 
+    // Makes the scene update the hit-testing index box of this view and its children, also called by repaint()
+    void invalidateInputIndex() const noexcept;
+
     static void removeFlagWithChildren(LView *view, UInt64 flag)
     {
         view->m_state.remove(flag);
@@ -1335,7 +1473,12 @@ protected:
             removeFlagWithChildren(child, flag);
     }
 
-    void removeThread(std::thread::id thread);
+    void removeThreadSlot(UInt32 slot);
+
+    // Number of thread slots currently in use (see LCompositorPrivate::threadSlotsCount)
+    static UInt32 threadSlotsCount() noexcept;
+    void resizeThreadSlots(UInt32 count) noexcept;
+
     void markAsChangedOrder(bool includeChildren = true);
     void damageScene(LSceneView *scene, bool includeChildren);
     void sceneChanged(LScene *newScene);
@@ -2,6 +2,7 @@
 #include <protocols/LinuxDMABuf/GLinuxDMABuf.h>
 #include <protocols/LinuxDMABuf/RLinuxBufferParams.h>
 #include <protocols/LinuxDMABuf/RLinuxDMABufFeedback.h>
+#include <protocols/Wayland/RSurface.h>
 #include <private/LCompositorPrivate.h>
 #include <private/LClientPrivate.h>
 #include <LUtils.h>
@@ -94,11 +95,12 @@ void GLinuxDMABuf::create_params(wl_client */*client*/, wl_resource *resource, U
 #if LOUVRE_LINUX_DMA_BUF_VERSION >= 4
 void GLinuxDMABuf::get_default_feedback(wl_client */*client*/, wl_resource *resource, UInt32 id)
 {
-    new RLinuxDMABufFeedback(static_cast<GLinuxDMABuf*>(wl_resource_get_user_data(resource)), id);
+    new RLinuxDMABufFeedback(static_cast<GLinuxDMABuf*>(wl_resource_get_user_data(resource)), id, nullptr);
 }
-void GLinuxDMABuf::get_surface_feedback(wl_client */*client*/, wl_resource *resource, UInt32 id, wl_resource */*surface*/)
+void GLinuxDMABuf::get_surface_feedback(wl_client */*client*/, wl_resource *resource, UInt32 id, wl_resource *surface)
 {
-    new RLinuxDMABufFeedback(static_cast<GLinuxDMABuf*>(wl_resource_get_user_data(resource)), id);
+    Wayland::RSurface *surfaceRes { static_cast<Wayland::RSurface*>(wl_resource_get_user_data(surface)) };
+    new RLinuxDMABufFeedback(static_cast<GLinuxDMABuf*>(wl_resource_get_user_data(resource)), id, surfaceRes->surface());
 }
 #endif
 
@@ -2,6 +2,8 @@
 #include <protocols/LinuxDMABuf/GLinuxDMABuf.h>
 #include <protocols/LinuxDMABuf/RLinuxDMABufFeedback.h>
 #include <private/LCompositorPrivate.h>
+#include <private/LSurfacePrivate.h>
+#include <LUtils.h>
 
 using namespace Louvre::Protocols::LinuxDMABuf;
 
@@ -12,7 +14,8 @@ static const struct zwp_linux_dmabuf_feedback_v1_interface imp
 
 RLinuxDMABufFeedback::RLinuxDMABufFeedback(
     GLinuxDMABuf *linuxDMABufRes,
-    UInt32 id
+    UInt32 id,
+    LSurface *surface
     ) noexcept
     :LResource
     (
@@ -21,7 +24,43 @@ RLinuxDMABufFeedback::RLinuxDMABufFeedback(
         linuxDMABufRes->version(),
         id,
         &imp
-    )
+    ),
+    m_surface(surface)
+{
+    if (surface)
+    {
+        m_surface.setOnDestroyCallback([this](LSurface *surface) {
+            LVectorRemoveOneUnordered(surface->imp()->dmaFeedbackResources, this);
+        });
+
+        surface->imp()->dmaFeedbackResources.emplace_back(this);
+        m_scanout = surface->imp()->prefersScanout();
+    }
+
+    sendFeedback();
+}
+
+RLinuxDMABufFeedback::~RLinuxDMABufFeedback() noexcept
+{
+    if (m_surface)
+        LVectorRemoveOneUnordered(m_surface->imp()->dmaFeedbackResources, this);
+}
+
+void RLinuxDMABufFeedback::setScanout(bool scanout) noexcept
+{
+    if (m_scanout == scanout)
+        return;
+
+    m_scanout = scanout;
+
+    // Nothing would change for the client
+    if (compositor()->imp()->dmaFeedback.tranches.scanout.empty())
+        return;
+
+    sendFeedback();
+}
+
+void RLinuxDMABufFeedback::sendFeedback() noexcept
 {
     auto &feedback { compositor()->imp()->dmaFeedback };
 
@@ -36,17 +75,30 @@ RLinuxDMABufFeedback::RLinuxDMABufFeedback(
         mainDevice(&dev);
         formatTable(feedback.tableFd, feedback.tableSize);
 
-        if (!compositor()->imp()->graphicBackend->backendGetScanoutDMAFormats()->empty())
+        // Preferred while the surface is fullscreen, so that its buffers can be scanned out directly
+        if (m_scanout && !feedback.tranches.scanout.empty())
         {
+            wl_array indices {
+                .size = feedback.tranches.scanout.size() * sizeof(UInt16),
+                .alloc = 0,
+                .data = (void *)feedback.tranches.scanout.data(),
+            };
+
             trancheTargetDevice(&dev);
             trancheFlags(ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT);
-            trancheFormats(&feedback.scanoutIndices);
+            trancheFormats(&indices);
             trancheDone();
         }
 
+        wl_array indices {
+            .size = feedback.tranches.formats.size() * sizeof(UInt16),
+            .alloc = 0,
+            .data = (void *)feedback.tranches.formats.data(),
+        };
+
         trancheTargetDevice(&dev);
         trancheFlags(0);
-        trancheFormats(&feedback.formatIndices);
+        trancheFormats(&indices);
         trancheDone();
     }
 
@@ -2,11 +2,21 @@
 #define RLINUXDMABUFFEEDBACK_H
 
 #include <LResource.h>
+#include <LWeak.h>
 
 class Louvre::Protocols::LinuxDMABuf::RLinuxDMABufFeedback final : public LResource
 {
 public:
 
+    // nullptr for the default feedback
+    LSurface *surface() const noexcept
+    {
+        return m_surface.get();
+    }
+
+    // Sends the whole feedback again if the scanout tranche must be added or removed
+    void setScanout(bool scanout) noexcept;
+
     /******************** REQUESTS ********************/
 
     static void destroy(wl_client *, wl_resource *resource) noexcept;
@@ -24,8 +34,11 @@ public:
 
 private:
     friend class Louvre::Protocols::LinuxDMABuf::GLinuxDMABuf;
-    RLinuxDMABufFeedback(GLinuxDMABuf *linuxDMABufRes, UInt32 id) noexcept;
-    ~RLinuxDMABufFeedback() noexcept = default;
+    RLinuxDMABufFeedback(GLinuxDMABuf *linuxDMABufRes, UInt32 id, LSurface *surface) noexcept;
+    ~RLinuxDMABufFeedback() noexcept;
+    void sendFeedback() noexcept;
+    LWeak<LSurface> m_surface;
+    bool m_scanout { false };
 };
 
 #endif // RLINUXDMABUFFEEDBACK_H
@@ -1,6 +1,7 @@
 #include <protocols/Wayland/RDataOffer.h>
 #include <protocols/Wayland/RDataDevice.h>
 #include <protocols/Wayland/GSeat.h>
+#include <private/LCompositorPrivate.h>
 #include <LClient.h>
 #include <LDNDSession.h>
 
@@ -101,48 +102,9 @@ void RDataOffer::receive(wl_client */*client*/, wl_resource *resource, const cha
                 }
                 else if (mimeType.tmp)
                 {
-                    fseek(mimeType.tmp, 0L, SEEK_END);
-
-                    Int64 total { ftell(mimeType.tmp) };
-
-                    // If pointer is at the beggining means the source client has not written any data
-                    if (total == 0)
-                        break;
-
-                    rewind(mimeType.tmp);
-
-                    Int64 written = 0, readN = 0, toRead = 0, offset = 0;
-                    UChar8 buffer[1024];
-
-                    while (total > 0)
-                    {
-                        if (total < 1024)
-                            toRead = total;
-                        else
-                            toRead = 1024;
-
-                        readN = fread(buffer, sizeof(UChar8), toRead, mimeType.tmp);
-
-                        if (readN != toRead)
-                            break;
-
-                        offset = 0;
-
-                    retryWrite:
-                        written = write(fd, &buffer[offset], readN);
-
-                        if (written > 0)
-                            offset += written;
-                        else if (written == -1)
-                            break;
-                        else if (written == 0)
-                            goto retryWrite;
-
-                        if (offset != readN)
-                            goto retryWrite;
-
-                        total -= readN;
-                    }
+                    // Written from the event loop, the engine closes the fd once done
+                    compositor()->imp()->clipboardTransfers.replay(mimeType.tmp, fd);
+                    return;
                 }
 
                 break;
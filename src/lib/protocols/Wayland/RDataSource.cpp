@@ -47,6 +47,18 @@ RDataSource::~RDataSource() noexcept
         if (seat()->clipboard()->m_dataOffer && seat()->clipboard()->m_dataOffer->dataDeviceRes())
             seat()->clipboard()->m_dataOffer->dataDeviceRes()->createOffer(RDataSource::Clipboard);
     }
+    else
+    {
+        // No longer the clipboard source, its data won't be used
+        for (auto &mimeType : m_mimeTypes)
+        {
+            if (mimeType.tmp != NULL)
+            {
+                compositor()->imp()->clipboardTransfers.cancel(mimeType.tmp);
+                fclose(mimeType.tmp);
+            }
+        }
+    }
 }
 
 void RDataSource::requestPersistentMimeType(LClipboard::MimeTypeFile &mimeType)
@@ -56,8 +68,14 @@ void RDataSource::requestPersistentMimeType(LClipboard::MimeTypeFile &mimeType)
 
     if (seat()->clipboard()->persistentMimeTypeFilter(mimeType.mimeType))
     {
-        mimeType.tmp = tmpfile();
-        send(mimeType.mimeType.c_str(), fileno(mimeType.tmp));
+        Int32 fd;
+        mimeType.tmp = compositor()->imp()->clipboardTransfers.capture(&fd);
+
+        if (mimeType.tmp)
+        {
+            send(mimeType.mimeType.c_str(), fd);
+            close(fd);
+        }
     }
 }
 
@@ -84,7 +84,9 @@ RSurface::RSurface
         surface()->imp()->compositorLink = compositor()->imp()->surfaces.begin();
     }
 
+    compositor()->imp()->updateOrderKey(surface());
     compositor()->imp()->surfacesListChanged = true;
+    compositor()->imp()->invalidateInputIndex();
 }
 
 RSurface::~RSurface()
@@ -135,9 +137,12 @@ RSurface::~RSurface()
 
     // Remove the surface from the compositor list
     compositor()->imp()->surfaces.erase(lSurface->imp()->compositorLink);
+    compositor()->imp()->surfacesIndex.remove(lSurface);
     compositor()->imp()->layers[lSurface->imp()->layer].erase(lSurface->imp()->layerLink);
 
     compositor()->imp()->surfacesListChanged = true;
+    compositor()->imp()->invalidateInputIndex();
+    lSurface->imp()->repaintViews(false);
     lSurface->imp()->stateFlags.add(LSurface::LSurfacePrivate::Destroyed);
 }
 
@@ -435,6 +440,10 @@ void RSurface::apply_commit(LSurface *surface, LBaseSurfaceRole::CommitOrigin or
     if (!ref)
         return;
 
+    // The role may have updated the surface geometry
+    compositor()->imp()->invalidateInputIndex();
+    imp.repaintViews(true);
+
     if (changes.check(Changes::BufferSizeChanged))
         surface->bufferSizeChanged();
 
@@ -0,0 +1,65 @@
+#ifndef LDMAFEEDBACKTRANCHES_TEST_H
+#define LDMAFEEDBACKTRANCHES_TEST_H
+
+#include <LTest.h>
+#include <private/LDMAFeedbackTranches.h>
+
+using namespace Louvre;
+
+// Fake fourcc codes and modifiers, only compared by value
+static const std::vector<LDMAFormat> fakeDMAFormatTable
+{
+    { 0x34325241, 0 },                  // ARGB8888 LINEAR
+    { 0x34325241, 0x0100000000000001 }, // ARGB8888 X_TILED
+    { 0x34325258, 0 },                  // XRGB8888 LINEAR
+    { 0x34325258, 0x0100000000000002 }, // XRGB8888 Y_TILED
+    { 0x3231564e, 0 },                  // NV12 LINEAR
+};
+
+void LDMAFeedbackTranches_test_01()
+{
+    LSetTestName("LDMAFeedbackTranches_test_01");
+    LDMAFeedbackTranches tranches;
+    tranches.build(fakeDMAFormatTable, {});
+    LAssert("The formats tranche should list every format in table order",
+            tranches.formats == std::vector<UInt16>({ 0, 1, 2, 3, 4 }));
+    LAssert("The scanout tranche should be empty without scanout formats", tranches.scanout.empty());
+}
+
+void LDMAFeedbackTranches_test_02()
+{
+    LSetTestName("LDMAFeedbackTranches_test_02");
+    LDMAFeedbackTranches tranches;
+
+    // Unordered, with a format missing from the table
+    const std::vector<LDMAFormat> scanout
+    {
+        { 0x34325258, 0x0100000000000002 },
+        { 0x34325241, 0 },
+        { 0x34325241, 0x0100000000000003 },
+    };
+
+    tranches.build(fakeDMAFormatTable, scanout);
+    LAssert("The formats tranche should still list every format", tranches.formats.size() == fakeDMAFormatTable.size());
+    LAssert("The scanout tranche should only list table formats that can be scanned out, in table order",
+            tranches.scanout == std::vector<UInt16>({ 0, 3 }));
+}
+
+void LDMAFeedbackTranches_test_03()
+{
+    LSetTestName("LDMAFeedbackTranches_test_03");
+    LDMAFeedbackTranches tranches;
+    tranches.build(fakeDMAFormatTable, fakeDMAFormatTable);
+    LAssert("Rebuilding should replace the previous tranches", tranches.scanout.size() == fakeDMAFormatTable.size());
+    tranches.build({}, fakeDMAFormatTable);
+    LAssert("An empty table should produce empty tranches", tranches.formats.empty() && tranches.scanout.empty());
+}
+
+void LDMAFeedbackTranches_run_tests()
+{
+    LDMAFeedbackTranches_test_01();
+    LDMAFeedbackTranches_test_02();
+    LDMAFeedbackTranches_test_03();
+}
+
+#endif // LDMAFEEDBACKTRANCHES_TEST_H
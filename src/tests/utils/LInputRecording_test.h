@@ -0,0 +1,57 @@
+#ifndef LINPUTRECORDING_TEST_H
+#define LINPUTRECORDING_TEST_H
+
+#include <LTest.h>
+#include <private/LInputRecording.h>
+#include <LPointerMoveEvent.h>
+#include <LPointerPinchUpdateEvent.h>
+#include <LKeyboardKeyEvent.h>
+#include <LKeyboardModifiersEvent.h>
+#include <LTouchDownEvent.h>
+
+using namespace Louvre;
+using namespace Louvre::LInputRecording;
+
+void LInputRecording_test_01()
+{
+    LSetTestName("LInputRecording_test_01");
+    Record record;
+
+    LPointerMoveEvent move { LPointF(1.5f, -2.f), LPointF(3.f, 4.f), 10, 20, 30 };
+    move.setCoalescedEvents(3);
+    LAssert("encode() should accept LPointerMoveEvent", encode(move, 2, record));
+    LAssert("Record should keep the event type", record.kind == EventRecord && record.type == (UInt8)LEvent::Type::Pointer && record.subtype == (UInt8)LEvent::Subtype::Move);
+    LAssert("Record should keep the device index and timestamps", record.device == 2 && record.ms == 20 && record.us == 30);
+    LAssert("Record should keep the deltas", record.values[0] == 1.5f && record.values[1] == -2.f && record.values[2] == 3.f && record.values[3] == 4.f);
+    LAssert("Record should keep the coalesced events count", record.code == 3);
+
+    LPointerPinchUpdateEvent pinch { 3, LPointF(1.f, 2.f), LPointF(3.f, 4.f), 1.25f, 90.f };
+    LAssert("encode() should accept LPointerPinchUpdateEvent", encode(pinch, 0, record));
+    LAssert("Record should keep the fingers, scale and rotation", record.code == 3 && record.values[4] == 1.25f && record.values[5] == 90.f);
+}
+
+void LInputRecording_test_02()
+{
+    LSetTestName("LInputRecording_test_02");
+    Record record;
+
+    LKeyboardKeyEvent key { 30, LKeyboardKeyEvent::Pressed };
+    LAssert("encode() should accept LKeyboardKeyEvent", encode(key, 1, record));
+    LAssert("Record should keep the key code and state", record.code == 30 && record.state == LKeyboardKeyEvent::Pressed);
+
+    LTouchDownEvent down { 5, LPointF(0.25f, 0.75f) };
+    LAssert("encode() should accept LTouchDownEvent", encode(down, 1, record));
+    LAssert("Record should keep the touch point id and position", record.code == 5 && record.values[0] == 0.25f && record.values[1] == 0.75f);
+
+    // Generated by Louvre, never emitted by input backends
+    LKeyboardModifiersEvent modifiers;
+    LAssert("encode() should reject LKeyboardModifiersEvent", !encode(modifiers, 1, record));
+}
+
+void LInputRecording_run_tests()
+{
+    LInputRecording_test_01();
+    LInputRecording_test_02();
+}
+
+#endif // LINPUTRECORDING_TEST_H
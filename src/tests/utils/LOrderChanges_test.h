@@ -0,0 +1,76 @@
+#ifndef LORDERCHANGES_TEST_H
+#define LORDERCHANGES_TEST_H
+
+#include <LTest.h>
+#include <private/LOrderChanges.h>
+#include <list>
+#include <string>
+
+using namespace Louvre;
+
+struct LOrderChangesTestSurface
+{
+    char name;
+    UInt64 orderKey;
+};
+
+static std::string LOrderChanges_names(const std::list<LOrderChangesTestSurface*> &list)
+{
+    std::string names;
+
+    for (const auto *s : list)
+        names += s->name;
+
+    return names;
+}
+
+/* Simulates orderChanged() handlers that restack each view with insertAfter(prevSurface()->view),
+ * delivering the batch in the given order */
+static std::string LOrderChanges_deliver(const std::list<LOrderChangesTestSurface*> &surfaces,
+                                         std::list<LOrderChangesTestSurface*> views,
+                                         const std::vector<LOrderChangesTestSurface*> &batch)
+{
+    for (auto *s : batch)
+    {
+        auto surfaceIt { std::find(surfaces.begin(), surfaces.end(), s) };
+        views.remove(s);
+
+        if (surfaceIt == surfaces.begin())
+            views.push_front(s);
+        else
+            views.insert(std::next(std::find(views.begin(), views.end(), *std::prev(surfaceIt))), s);
+    }
+
+    return LOrderChanges_names(views);
+}
+
+void LOrderChanges_test_01()
+{
+    LSetTestName("LOrderChanges_test_01");
+    LOrderChangesTestSurface a { 'A', 100 }, x { 'X', 200 }, b { 'B', 300 }, y { 'Y', 400 }, c { 'C', 500 };
+    std::list<LOrderChangesTestSurface*> surfaces { &a, &x, &b, &y, &c };
+    const std::list<LOrderChangesTestSurface*> views { surfaces };
+
+    // Raise X to the end, then insert Y before X within the same batch
+    surfaces.remove(&x);
+    surfaces.push_back(&x);
+    x.orderKey = 600;
+    surfaces.remove(&y);
+    surfaces.insert(std::prev(surfaces.end()), &y);
+    y.orderKey = 550;
+
+    std::vector<LOrderChangesTestSurface*> batch { &x, &b, &y, &c };
+    LAssert("The surfaces list should be A B C Y X", LOrderChanges_names(surfaces) == "ABCYX");
+    LAssert("Delivering in queue order should misplace the views", LOrderChanges_deliver(surfaces, views, batch) != "ABCYX");
+
+    LSortOrderChanges(batch, [](const LOrderChangesTestSurface *s){ return s->orderKey; });
+    LAssert("LSortOrderChanges() should sort the batch by order key", batch == std::vector<LOrderChangesTestSurface*>({ &b, &c, &y, &x }));
+    LAssert("Delivering in stacking order should match the surfaces list", LOrderChanges_deliver(surfaces, views, batch) == "ABCYX");
+}
+
+void LOrderChanges_run_tests()
+{
+    LOrderChanges_test_01();
+}
+
+#endif // LORDERCHANGES_TEST_H
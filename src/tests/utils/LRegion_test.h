@@ -61,10 +61,120 @@ void LRegion_test_02()
     LAssert("regionA should contain 1 box", n == 1);
 }
 
+static bool LRegion_test_extentsEqual(const LRegion &region, Int32 x1, Int32 y1, Int32 x2, Int32 y2)
+{
+    const LBox &e { region.extents() };
+    return e.x1 == x1 && e.y1 == y1 && e.x2 == x2 && e.y2 == y2;
+}
+
+void LRegion_test_03()
+{
+    LSetTestName("LRegion_test_03");
+
+    Int32 n;
+    LRegion region;
+    region.addRect(0, 0, 100, 100);
+    region.addRect(10, 10, 20, 20);
+    region.boxes(&n);
+    LAssert("A contained rect should not split the region", n == 1 && LRegion_test_extentsEqual(region, 0, 0, 100, 100));
+
+    region.addRect(0, 0, 0, 10);
+    region.addRect(0, 0, -5, 10);
+    LAssert("Empty rects should be ignored", LRegion_test_extentsEqual(region, 0, 0, 100, 100));
+
+    region.addRect(200, 0, 50, 50);
+    region.boxes(&n);
+    LAssert("region should contain 2 boxes", n == 2 && LRegion_test_extentsEqual(region, 0, 0, 250, 100));
+
+    region.subtractRect(-10, -10, 300, 300);
+    LAssert("Subtracting a rect containing the region should clear it", region.empty());
+
+    region.addRect(0, 0, 100, 100);
+    region.subtractRect(25, 25, 50, 50);
+    region.boxes(&n);
+    LAssert("Subtracting a centered rect should leave 4 boxes", n == 4);
+    LAssert("The subtracted rect should not be contained", !region.containsPoint(LPoint(50, 50)));
+    LAssert("The remaining area should be contained", region.containsPoint(LPoint(10, 10)) && region.containsPoint(LPoint(90, 90)));
+
+    region.subtractRect(500, 500, 10, 10);
+    region.boxes(&n);
+    LAssert("Subtracting a rect outside the region should not modify it", n == 4);
+
+    region.clip(0, 0, 50, 50);
+    LAssert("Clipping should keep the area inside the rect", LRegion_test_extentsEqual(region, 0, 0, 50, 50));
+    LAssert("Clipping should keep the subtracted area", !region.containsPoint(LPoint(30, 30)));
+
+    region.clip(0, 0, 0, 0);
+    LAssert("Clipping with an empty rect should clear the region", region.empty());
+
+    LRegion regionA(LRect(0, 0, 100, 100));
+    regionA.intersectRegion(LRegion(LRect(50, 50, 100, 100)));
+    regionA.boxes(&n);
+    LAssert("The intersection of two rects should be a single box", n == 1 && LRegion_test_extentsEqual(regionA, 50, 50, 100, 100));
+
+    regionA.intersectRegion(LRegion(LRect(500, 500, 10, 10)));
+    LAssert("The intersection with a disjoint region should be empty", regionA.empty());
+
+    regionA.addRect(0, 0, 10, 10);
+    regionA.inverse(LRect(0, 0, 20, 20));
+    LAssert("The inverted area should be contained", regionA.containsPoint(LPoint(15, 15)));
+    LAssert("The previous area should not be contained", !regionA.containsPoint(LPoint(5, 5)));
+
+    regionA.clear();
+    regionA.inverse(LRect(0, 0, 20, 20));
+    LAssert("The inverse of an empty region should be the rect", LRegion_test_extentsEqual(regionA, 0, 0, 20, 20));
+
+    LRegion regionB;
+    regionB.addRect(0, 0, 10, 10);
+    regionB.addRect(20, 0, 10, 10);
+    regionA.clear();
+    regionA.addRegion(regionB);
+    LAssert("Adding a region to an empty one should copy it", pixman_region32_equal(&regionA.m_region, &regionB.m_region));
+
+    regionA.subtractRegion(regionA);
+    LAssert("Subtracting a region from itself should clear it", regionA.empty());
+}
+
+void LRegion_test_04()
+{
+    LSetTestName("LRegion_test_04");
+
+    const LBox boxes[] {
+        { 0, 0, 10, 10 },
+        { 5, 5, 15, 15 },
+        { 20, 20, 20, 30 } // Empty
+    };
+
+    Int32 n;
+    LRegion region;
+    region.setBoxes(boxes, 3);
+    LAssert("Overlapping boxes should be merged", LRegion_test_extentsEqual(region, 0, 0, 15, 15));
+    LAssert("The union should be contained", region.containsPoint(LPoint(12, 12)) && region.containsPoint(LPoint(2, 2)));
+    LAssert("The area outside the boxes should not be contained", !region.containsPoint(LPoint(2, 12)));
+
+    region.setBoxes(boxes, 0);
+    LAssert("Setting 0 boxes should clear the region", region.empty());
+
+    region.addRect(0, 0, 10, 10);
+    region.transform(LSize(100, 100), LTransform::Rotated180);
+    region.boxes(&n);
+    LAssert("Rotating 180 degrees should move the box to the opposite corner", n == 1 && LRegion_test_extentsEqual(region, 90, 90, 100, 100));
+
+    region.clear();
+    region.addRect(1, 2, 3, 4);
+    region.multiply(2.f);
+    LAssert("Multiplying by 2 should double all components", LRegion_test_extentsEqual(region, 2, 4, 8, 12));
+
+    region.multiply(0.5f);
+    LAssert("Multiplying by 0.5 should halve all components", LRegion_test_extentsEqual(region, 1, 2, 4, 6));
+}
+
 void LRegion_run_tests()
 {
     LRegion_test_01();
     LRegion_test_02();
+    LRegion_test_03();
+    LRegion_test_04();
 }
 
 #endif // LREGION_TEST_H
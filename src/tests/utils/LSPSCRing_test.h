@@ -0,0 +1,61 @@
+#ifndef LSPSCRING_TEST_H
+#define LSPSCRING_TEST_H
+
+#include <LTest.h>
+#include <private/LSPSCRing.h>
+#include <thread>
+
+using namespace Louvre;
+
+void LSPSCRing_test_01()
+{
+    LSetTestName("LSPSCRing_test_01");
+    LSPSCRing<UInt32, 4> ring;
+    UInt32 value;
+    LAssert("LSPSCRing should be empty", ring.empty() && !ring.pop(value));
+    LAssert("LSPSCRing::capacity() should be 3", ring.capacity() == 3);
+    LAssert("LSPSCRing::push() should succeed while not full", ring.push(1) && ring.push(2) && ring.push(3));
+    LAssert("LSPSCRing::push() should fail when full", !ring.push(4));
+    LAssert("LSPSCRing::pop() should return the oldest value", ring.pop(value) && value == 1);
+    LAssert("LSPSCRing::push() should succeed after pop()", ring.push(4));
+    LAssert("LSPSCRing::pop() should keep the order", ring.pop(value) && value == 2 && ring.pop(value) && value == 3 && ring.pop(value) && value == 4);
+    LAssert("LSPSCRing should be empty", ring.empty());
+}
+
+void LSPSCRing_test_02()
+{
+    LSetTestName("LSPSCRing_test_02");
+    static LSPSCRing<UInt64, 64> ring;
+    constexpr UInt64 count { 1000000 };
+
+    std::thread producer([]{
+        for (UInt64 i = 1; i <= count; i++)
+            while (!ring.push(i))
+                std::this_thread::yield();
+    });
+
+    UInt64 expected { 1 }, value;
+    bool ordered { true };
+
+    while (expected <= count)
+    {
+        if (!ring.pop(value))
+            continue;
+
+        if (value != expected)
+            ordered = false;
+
+        expected++;
+    }
+
+    producer.join();
+    LAssert("LSPSCRing should deliver all values in order across threads", ordered && ring.empty());
+}
+
+void LSPSCRing_run_tests()
+{
+    LSPSCRing_test_01();
+    LSPSCRing_test_02();
+}
+
+#endif // LSPSCRING_TEST_H
@@ -0,0 +1,51 @@
+#ifndef LSPATIALINDEX_TEST_H
+#define LSPATIALINDEX_TEST_H
+
+#include <LTest.h>
+#include <private/LSpatialIndex.h>
+
+using namespace Louvre;
+
+void LSpatialIndex_test_01()
+{
+    LSetTestName("LSpatialIndex_test_01");
+    LSpatialIndex<UInt32> index;
+    std::vector<UInt32> candidates;
+
+    index.setOrder(1, 1);
+    index.update(1, { 0, 0, 100, 100 });
+    index.setOrder(2, 2);
+    index.update(2, { 50, 50, 150, 150 });
+    index.setOrder(3, 3);
+    index.update(3, { -5000, -5000, 5000, 5000 });
+
+    index.query(LPoint(75, 75), candidates);
+    LAssert("LSpatialIndex::query() should return items from top to bottom",
+            candidates == std::vector<UInt32>({ 3, 2, 1 }));
+
+    index.setOrder(1, 4);
+    index.query(LPoint(75, 75), candidates);
+    LAssert("LSpatialIndex::setOrder() should restack items", candidates == std::vector<UInt32>({ 1, 3, 2 }));
+
+    index.update(2, { 1000, 1000, 1100, 1100 });
+    index.query(LPoint(75, 75), candidates);
+    LAssert("LSpatialIndex::update() should move items", candidates == std::vector<UInt32>({ 1, 3 }));
+    index.query(LPoint(1050, 1050), candidates);
+    LAssert("LSpatialIndex::update() should move items", candidates == std::vector<UInt32>({ 3, 2 }));
+
+    index.update(1, { 0, 0, 0, 0 });
+    index.query(LPoint(75, 75), candidates);
+    LAssert("LSpatialIndex::update() with an empty box should hide items", candidates == std::vector<UInt32>({ 3 }));
+    LAssert("LSpatialIndex::update() with an empty box should keep items", index.contains(1) && index.order(1) == 4);
+
+    index.remove(3);
+    index.query(LPoint(1050, 1050), candidates);
+    LAssert("LSpatialIndex::remove() should remove items", candidates == std::vector<UInt32>({ 2 }) && index.size() == 2);
+}
+
+void LSpatialIndex_run_tests()
+{
+    LSpatialIndex_test_01();
+}
+
+#endif // LSPATIALINDEX_TEST_H
@@ -10,6 +10,11 @@ using namespace Louvre;
 #include "LWeak_test.h"
 #include "LRegion_test.h"
 #include "LBitset_tests.h"
+#include "LSPSCRing_test.h"
+#include "LDMAFeedbackTranches_test.h"
+#include "LInputRecording_test.h"
+#include "LOrderChanges_test.h"
+#include "LSpatialIndex_test.h"
 
 int main(int, char *[])
 {
@@ -20,6 +25,11 @@ int main(int, char *[])
     LWeak_run_tests();
     LRegion_run_tests();
     LBitset_run_tests();
+    LSPSCRing_run_tests();
+    LDMAFeedbackTranches_run_tests();
+    LInputRecording_run_tests();
+    LOrderChanges_run_tests();
+    LSpatialIndex_run_tests();
 
     return 0;
 }